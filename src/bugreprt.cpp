@@ -1382,6 +1382,18 @@ void CCallStack::PrintBugReport(EXCEPTION_POINTERS* Exception, DWORD ThreadID, D
         PrintLine(param, buf, TRUE);
         sprintf(buf, "UseAsyncCopyAlg = %d", Configuration.UseAsyncCopyAlg);
         PrintLine(param, buf, TRUE);
+        sprintf(buf, "ConcurrentSmallCopy = %d", Configuration.ConcurrentSmallCopy);
+        PrintLine(param, buf, TRUE);
+        sprintf(buf, "StreamingCopy = %d", Configuration.StreamingCopy);
+        PrintLine(param, buf, TRUE);
+        sprintf(buf, "VerifyCopy = %d", Configuration.VerifyCopy);
+        PrintLine(param, buf, TRUE);
+        sprintf(buf, "CopyChecksumManifest = %d", Configuration.CopyChecksumManifest);
+        PrintLine(param, buf, TRUE);
+        sprintf(buf, "DeltaCopy = %d", Configuration.DeltaCopy);
+        PrintLine(param, buf, TRUE);
+        sprintf(buf, "ParallelDelete = %d", Configuration.ParallelDelete);
+        PrintLine(param, buf, TRUE);
         sprintf(buf, "ReloadEnvVariables = %d", Configuration.ReloadEnvVariables);
         PrintLine(param, buf, TRUE);
         sprintf(buf, "AutoSave = %d", Configuration.AutoSave);
@@ -225,6 +225,7 @@ CCallStack::CCallStack(BOOL dontSuspend)
 
     Text[0] = 0;
     End = Text;
+    Line[0] = 0;
     Skipped = 0;
     Reset();
 
@@ -479,47 +480,486 @@ void CCallStack::ReleaseBeforeExitThreadBody()
     HANDLES(LeaveCriticalSection(&Section));
 }
 
-void CCallStack::Push(const char* format, va_list args)
+// priznaky zaznamu v CCallStack::Text
+#define CSRF_BADFORMAT 0x01 // format obsahuje nepodporovanou konverzi, parametry se neulozily
+#define CSRF_EXCEPTION 0x02 // pri cteni parametru doslo k vyjimce, parametry se neulozily
+
+// typy parametru podle konverzi ve formatovacim retezci call-stack message
+enum CCallStackArgType
 {
-#if (defined(_DEBUG) || defined(CALLSTK_MEASURETIMES)) && !defined(CALLSTK_DISABLEMEASURETIMES)
-    PushesCounter++;
-#endif // (defined(_DEBUG) || defined(CALLSTK_MEASURETIMES)) && !defined(CALLSTK_DISABLEMEASURETIMES)
-    while (!DontSuspend && CCallStack::ExceptionExists)
-        Sleep(1000); // misto suspend-thread v exception-handleru
-    if (STACK_CALLS_BUF_SIZE - (End - Text) >= STACK_CALLS_MAX_MESSAGE_LEN + 4)
+    csatInt,     // int (char a short se promovou na int)
+    csatInt64,   // __int64
+    csatPtr,     // velikost ukazatele (%p, %Id, %zu, ...)
+    csatDouble,  // double
+    csatStr,     // char*, uklada se kopie retezce
+    csatWStr,    // WCHAR*, uklada se kopie retezce
+    csatPercent, // "%%", bez parametru
+    csatBad,     // nepodporovana konverze (%n, %Z, ...)
+};
+
+// rozebere konverzi zacinajici za znakem '%'; vraci ukazatel za konverzi, v 'stars' pocet
+// hvezdicek (sirka a presnost predavane parametrem), v 'type' typ parametru
+static const char* ParseCallStackSpec(const char* s, int* stars, CCallStackArgType* type)
+{
+    *stars = 0;
+    while (*s == '-' || *s == '+' || *s == ' ' || *s == '#' || *s == '0')
+        s++;
+    if (*s == '*')
     {
-        char* backup = End;
-        int ret;
-        __try
+        (*stars)++;
+        s++;
+    }
+    else
+    {
+        while (*s >= '0' && *s <= '9')
+            s++;
+    }
+    if (*s == '.')
+    {
+        s++;
+        if (*s == '*')
+        {
+            (*stars)++;
+            s++;
+        }
+        else
+        {
+            while (*s >= '0' && *s <= '9')
+                s++;
+        }
+    }
+    int size = 0; // 0 = bez modifikatoru, 1 = h/hh, 2 = l/w, 3 = ll/I64/L/j, 4 = I/z/t
+    switch (*s)
+    {
+    case 'h':
+    {
+        size = 1;
+        if (*++s == 'h')
+            s++;
+        break;
+    }
+
+    case 'l':
+    {
+        size = 2;
+        if (*++s == 'l')
+        {
+            size = 3;
+            s++;
+        }
+        break;
+    }
+
+    case 'w':
+    {
+        size = 2;
+        s++;
+        break;
+    }
+
+    case 'L':
+    case 'j':
+    {
+        size = 3;
+        s++;
+        break;
+    }
+
+    case 'z':
+    case 't':
+    {
+        size = 4;
+        s++;
+        break;
+    }
+
+    case 'I':
+    {
+        if (s[1] == '6' && s[2] == '4')
+        {
+            size = 3;
+            s += 3;
+        }
+        else
         {
-            ret = _vsnprintf_s(End, STACK_CALLS_MAX_MESSAGE_LEN + 1, _TRUNCATE, format, args);
-            if (ret >= 0)
-                End += ret + 1;
+            if (s[1] == '3' && s[2] == '2')
+                s += 3;
             else
             {
-                strcpy(backup, "vsprintf error in: ");
-                int len = (int)strlen(backup);
-                lstrcpyn(backup + len, format, STACK_CALLS_MAX_MESSAGE_LEN + 1 - len);
-                ret = (int)strlen(backup);
-                End = backup + ret + 1;
+                size = 4;
+                s++;
             }
         }
-        __except (EXCEPTION_EXECUTE_HANDLER)
+        break;
+    }
+    }
+    switch (*s)
+    {
+    case 'd':
+    case 'i':
+    case 'o':
+    case 'u':
+    case 'x':
+    case 'X':
+        *type = size == 3 ? csatInt64 : size == 4 ? csatPtr : csatInt;
+        break;
+
+    case 'c':
+    case 'C':
+        *type = csatInt;
+        break;
+
+    case 'e':
+    case 'E':
+    case 'f':
+    case 'F':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        *type = csatDouble;
+        break;
+
+    case 'p':
+        *type = csatPtr;
+        break;
+
+    case 's':
+        *type = size == 2 ? csatWStr : csatStr;
+        break;
+
+    case 'S':
+        *type = size == 1 ? csatStr : csatWStr;
+        break;
+
+    case '%':
+        *type = *stars == 0 ? csatPercent : csatBad;
+        break;
+
+    default:
+    {
+        *type = csatBad;
+        return s; // muze jit o koncovou nulu, za ni nelezeme
+    }
+    }
+    return s + 1;
+}
+
+// ulozi parametry 'args' podle 'format' do 'buf' (maximalne po 'bufEnd'); vraci ukazatel za ulozena
+// data nebo NULL, pokud se data do bufferu nevesla; pri nepodporovanem formatu nastavi CSRF_BADFORMAT
+// ve 'flags' a parametry neuklada
+static char* StoreCallStackArgsBody(char* buf, char* bufEnd, const char* format, va_list args, BYTE* flags)
+{
+    char* start = buf;
+    int strBudget = STACK_CALLS_MAX_MESSAGE_LEN; // delsi text stejne neni mozne vypsat
+    const char* f = format;
+    while (*f != 0)
+    {
+        if (*f++ != '%')
+            continue;
+        int stars;
+        CCallStackArgType type;
+        f = ParseCallStackSpec(f, &stars, &type);
+        if (type == csatBad)
+        {
+            *flags |= CSRF_BADFORMAT;
+            return start;
+        }
+        for (; stars > 0; stars--)
+        {
+            if (bufEnd - buf < (int)sizeof(int))
+                return NULL;
+            *(int*)buf = va_arg(args, int);
+            buf += sizeof(int);
+        }
+        switch (type)
+        {
+        case csatInt:
+        {
+            if (bufEnd - buf < (int)sizeof(int))
+                return NULL;
+            *(int*)buf = va_arg(args, int);
+            buf += sizeof(int);
+            break;
+        }
+
+        case csatInt64:
+        {
+            if (bufEnd - buf < (int)sizeof(__int64))
+                return NULL;
+            *(__int64*)buf = va_arg(args, __int64);
+            buf += sizeof(__int64);
+            break;
+        }
+
+        case csatPtr:
+        {
+            if (bufEnd - buf < (int)sizeof(INT_PTR))
+                return NULL;
+            *(INT_PTR*)buf = va_arg(args, INT_PTR);
+            buf += sizeof(INT_PTR);
+            break;
+        }
+
+        case csatDouble:
         {
-            strcpy(backup, "exception in: ");
-            int len = (int)strlen(backup);
-            lstrcpyn(backup + len, format, STACK_CALLS_MAX_MESSAGE_LEN + 1 - len);
-            ret = (int)strlen(backup);
-            End = backup + ret + 1;
+            if (bufEnd - buf < (int)sizeof(double))
+                return NULL;
+            *(double*)buf = va_arg(args, double);
+            buf += sizeof(double);
+            break;
+        }
+
+        case csatStr:
+        {
+            const char* str = va_arg(args, const char*);
+            if (buf >= bufEnd)
+                return NULL;
+            *buf++ = str != NULL; // NULL vypiseme jako printf, tedy "(null)"
+            if (str != NULL)
+            {
+                while (*str != 0 && strBudget > 0)
+                {
+                    if (buf >= bufEnd)
+                        return NULL;
+                    *buf++ = *str++;
+                    strBudget--;
+                }
+                if (buf >= bufEnd)
+                    return NULL;
+                *buf++ = 0;
+            }
+            break;
+        }
+
+        case csatWStr:
+        {
+            const WCHAR* str = va_arg(args, const WCHAR*);
+            if (buf >= bufEnd)
+                return NULL;
+            *buf++ = str != NULL;
+            if (str != NULL)
+            {
+                while (*str != 0 && strBudget > 0)
+                {
+                    if (bufEnd - buf < (int)sizeof(WCHAR))
+                        return NULL;
+                    *(WCHAR*)buf = *str++;
+                    buf += sizeof(WCHAR);
+                    strBudget--;
+                }
+                if (bufEnd - buf < (int)sizeof(WCHAR))
+                    return NULL;
+                *(WCHAR*)buf = 0;
+                buf += sizeof(WCHAR);
+            }
+            break;
+        }
         }
-        *(short*)End = (short)ret;
-        End += 2;
-        *End = 0; // double null terminated
     }
-    else
+    return buf;
+}
+
+static char* StoreCallStackArgs(char* buf, char* bufEnd, const char* format, va_list args, BYTE* flags)
+{
+    __try
+    {
+        return StoreCallStackArgsBody(buf, bufEnd, format, args, flags);
+    }
+    __except (EXCEPTION_EXECUTE_HANDLER)
+    {
+        *flags |= CSRF_EXCEPTION; // napr. neplatny ukazatel na retezec, vypiseme jen format
+        return buf;
+    }
+}
+
+template <class T>
+static int FormatCallStackValue(char* buf, int bufSize, const char* spec, int stars, const int* starVals, T value)
+{
+    switch (stars)
+    {
+    case 0:
+        return _snprintf_s(buf, bufSize, _TRUNCATE, spec, value);
+    case 1:
+        return _snprintf_s(buf, bufSize, _TRUNCATE, spec, starVals[0], value);
+    default:
+        return _snprintf_s(buf, bufSize, _TRUNCATE, spec, starVals[0], starVals[1], value);
+    }
+}
+
+// slozi text z 'format' a parametru ulozenych v StoreCallStackArgsBody (od 'args' do 'argsEnd');
+// vraci FALSE, pokud ulozena data neodpovidaji formatu
+static BOOL FormatCallStackArgsBody(char* buf, int bufSize, const char* format, const char* args, const char* argsEnd)
+{
+    char* out = buf;
+    char* outEnd = buf + bufSize - 1; // misto pro koncovou nulu
+    const char* f = format;
+    while (*f != 0 && out < outEnd)
+    {
+        if (*f != '%')
+        {
+            *out++ = *f++;
+            continue;
+        }
+        const char* specBeg = f++;
+        int stars;
+        CCallStackArgType type;
+        f = ParseCallStackSpec(f, &stars, &type);
+        if (type == csatBad)
+            return FALSE;
+        if (type == csatPercent)
+        {
+            *out++ = '%';
+            continue;
+        }
+        char spec[30];
+        if (f - specBeg >= _countof(spec))
+            return FALSE;
+        memcpy(spec, specBeg, f - specBeg);
+        spec[f - specBeg] = 0;
+        int starVals[2];
+        for (int i = 0; i < stars; i++)
+        {
+            if (argsEnd - args < (int)sizeof(int))
+                return FALSE;
+            starVals[i] = *(const int*)args;
+            args += sizeof(int);
+        }
+        int size = (int)(outEnd - out) + 1;
+        int ret;
+        switch (type)
+        {
+        case csatInt:
+        {
+            if (argsEnd - args < (int)sizeof(int))
+                return FALSE;
+            ret = FormatCallStackValue(out, size, spec, stars, starVals, *(const int*)args);
+            args += sizeof(int);
+            break;
+        }
+
+        case csatInt64:
+        {
+            if (argsEnd - args < (int)sizeof(__int64))
+                return FALSE;
+            ret = FormatCallStackValue(out, size, spec, stars, starVals, *(const __int64*)args);
+            args += sizeof(__int64);
+            break;
+        }
+
+        case csatPtr:
+        {
+            if (argsEnd - args < (int)sizeof(INT_PTR))
+                return FALSE;
+            ret = FormatCallStackValue(out, size, spec, stars, starVals, *(const INT_PTR*)args);
+            args += sizeof(INT_PTR);
+            break;
+        }
+
+        case csatDouble:
+        {
+            if (argsEnd - args < (int)sizeof(double))
+                return FALSE;
+            ret = FormatCallStackValue(out, size, spec, stars, starVals, *(const double*)args);
+            args += sizeof(double);
+            break;
+        }
+
+        case csatStr:
+        {
+            if (args >= argsEnd)
+                return FALSE;
+            const char* str = NULL;
+            if (*args++ != 0)
+            {
+                str = args;
+                args += strlen(str) + 1;
+            }
+            ret = FormatCallStackValue(out, size, spec, stars, starVals, str);
+            break;
+        }
+
+        default: // csatWStr
+        {
+            if (args >= argsEnd)
+                return FALSE;
+            const WCHAR* str = NULL;
+            if (*args++ != 0)
+            {
+                str = (const WCHAR*)args;
+                args += (wcslen(str) + 1) * sizeof(WCHAR);
+            }
+            ret = FormatCallStackValue(out, size, spec, stars, starVals, str);
+            break;
+        }
+        }
+        if (args > argsEnd)
+            return FALSE;
+        if (ret >= 0)
+            out += ret;
+        else
+            out += strlen(out); // text se nevesel, je oriznuty
+    }
+    *out = 0;
+    return TRUE;
+}
+
+static BOOL FormatCallStackArgs(char* buf, int bufSize, const char* format, const char* args, const char* argsEnd)
+{
+    __try
+    {
+        return FormatCallStackArgsBody(buf, bufSize, format, args, argsEnd);
+    }
+    __except (EXCEPTION_EXECUTE_HANDLER)
     {
-        Skipped++;
+        return FALSE;
+    }
+}
+
+void CCallStack::FormatRecord(const char* record, char* buf, int bufSize)
+{
+    BYTE flags = (BYTE)record[2];
+    const char* format = *(const char**)(record + 3);
+    const char* args = record + 3 + sizeof(const char*);
+    const char* argsEnd = record + *(const WORD*)record - 2;
+    if ((flags & (CSRF_BADFORMAT | CSRF_EXCEPTION)) == 0 &&
+        FormatCallStackArgs(buf, bufSize, format, args, argsEnd))
+    {
+        return;
+    }
+    lstrcpyn(buf, (flags & CSRF_EXCEPTION) ? "exception in: " : "vsprintf error in: ", bufSize);
+    int len = (int)strlen(buf);
+    lstrcpyn(buf + len, format, bufSize - len);
+}
+
+void CCallStack::Push(const char* format, va_list args)
+{
+#if (defined(_DEBUG) || defined(CALLSTK_MEASURETIMES)) && !defined(CALLSTK_DISABLEMEASURETIMES)
+    PushesCounter++;
+#endif // (defined(_DEBUG) || defined(CALLSTK_MEASURETIMES)) && !defined(CALLSTK_DISABLEMEASURETIMES)
+    while (!DontSuspend && CCallStack::ExceptionExists)
+        Sleep(1000); // misto suspend-thread v exception-handleru
+    // zaznam: WORD delka, BYTE priznaky, ukazatel na format, parametry, WORD delka (pro Pop);
+    // text se sklada az v GetNextLine, tady se jen kopiruji hodnoty parametru
+    const int headerSize = 2 + 1 + sizeof(const char*);
+    char* limit = Text + STACK_CALLS_BUF_SIZE - 2; // misto pro koncovou delku zaznamu
+    // po preskoceni zaznamu musime preskakovat i dalsi (Pop je pak odecita ze Skipped)
+    if (Skipped == 0 && limit - End >= headerSize)
+    {
+        BYTE flags = 0;
+        char* end = StoreCallStackArgs(End + headerSize, limit, format, args, &flags);
+        if (end != NULL)
+        {
+            WORD size = (WORD)(end + 2 - End);
+            *(WORD*)End = size;
+            End[2] = flags;
+            *(const char**)(End + 3) = format;
+            *(WORD*)end = size;
+            End = end + 2; // zaznam je kompletni, muzeme ho zverejnit
+            return;
+        }
     }
+    Skipped++;
 }
 
 void
@@ -535,13 +975,15 @@ CCallStack::Pop()
     {
         if (End > Text)
         {
-            End -= 2;
-            End -= 1 + *(short*)End;
+            End -= *(WORD*)(End - 2);
 #if (defined(_DEBUG) || defined(CALLSTK_MEASURETIMES)) && !defined(CALLSTK_DISABLEMEASURETIMES)
             if (printCallStackTop)
-                TRACE_I("Top of Call Stack: " << End);
+            {
+                char line[STACK_CALLS_MAX_MESSAGE_LEN + 1];
+                FormatRecord(End, line, _countof(line));
+                TRACE_I("Top of Call Stack: " << line);
+            }
 #endif // (defined(_DEBUG) || defined(CALLSTK_MEASURETIMES)) && !defined(CALLSTK_DISABLEMEASURETIMES)
-            *End = 0;
         }
         else
             TRACE_E("Incorrect call to CCallStack::Pop()!");
@@ -557,11 +999,9 @@ CCallStack::GetNextLine()
 {
     if (Enum < End)
     {
-        char* s = Enum;
-        while (*Enum++ != 0)
-            ;
-        Enum += 2;
-        return s;
+        FormatRecord(Enum, Line, _countof(Line));
+        Enum += *(WORD*)Enum;
+        return Line;
     }
     else
     {
@@ -899,10 +1339,9 @@ void CCallStack::CheckCallFrequency(DWORD_PTR callerAddress, LARGE_INTEGER* push
                             }
                             if (Skipped == 0 && End > Text) // vypiseme text posledniho pushe
                             {
-                                char* end = End;
-                                end -= 2;
-                                end -= 1 + *(short*)end;
-                                TRACE_I("Top of Call Stack: " << end);
+                                char line[STACK_CALLS_MAX_MESSAGE_LEN + 1];
+                                FormatRecord(End - *(WORD*)(End - 2), line, _countof(line));
+                                TRACE_I("Top of Call Stack: " << line);
                             }
                         }
                     }
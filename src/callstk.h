@@ -21,7 +21,9 @@
 //
 // ****************************************************************************
 
-// objekt drzi seznam volanych funkci (call-stack) - radky se pridavaji pres CCallStackMessage
+// objekt drzi seznam volanych funkci (call-stack) - radky se pridavaji pres CCallStackMessage;
+// Push si uklada jen ukazatel na formatovaci retezec a binarni hodnoty parametru (retezce kopiruje),
+// text se sklada az v GetNextLine (bug report), takze makra v hustych smyckach stoji minimum casu
 
 typedef void (*FPrintLine)(void* param, const char* txt, BOOL tab);
 
@@ -47,11 +49,12 @@ class CCallStack
 protected:
     DWORD ThreadID;                  // ID aktualniho threadu
     HANDLE ThreadHandle;             // handle aktualniho threadu, pouzivame v CCallStack::PrintBugReport pro GetThreadContext
-    char Text[STACK_CALLS_BUF_SIZE]; // double-null-terminated list + za koncovou nulou je vzdy delka predchoziho stringu (na dvou bytech), nasleduje hned dalsi string
-    char* End;                       // ukazatel na posledni dve nuly
-    int Skipped;                     // pocet messages, ktere nesly ulozit
-    char* Enum;                      // ukazatel na posledni vypsany text
-    BOOL FirstCallstack;             // jsme prvni instance?
+    char Text[STACK_CALLS_BUF_SIZE];            // zaznamy za sebou: WORD delka zaznamu, BYTE priznaky (CSRF_xxx), ukazatel na format, hodnoty parametru, WORD delka zaznamu
+    char* End;                                  // ukazatel za posledni zaznam
+    int Skipped;                                // pocet messages, ktere nesly ulozit
+    char* Enum;                                 // ukazatel na dalsi zaznam pro GetNextLine
+    char Line[STACK_CALLS_MAX_MESSAGE_LEN + 1]; // text zaznamu naformatovany v GetNextLine
+    BOOL FirstCallstack;                        // jsme prvni instance?
 
     const char* PluginDLLName; // DLL plug-inu, kde thread prave bezi (NULL jde-li o salamand.exe)
     int PluginDLLNameUses;     // kolikata Pop() operace ma PluginDLLName NULLovat (uroven vnoreni)
@@ -130,7 +133,10 @@ public:
         Enum = Text;
     }
 
-    const char* GetNextLine(); // vrati bud dalsi radku nebo NULL, pokud jiz zadna neni
+    const char* GetNextLine(); // vrati bud dalsi radku nebo NULL, pokud jiz zadna neni; radka plati do dalsiho volani
+
+    // slozi text zaznamu 'record' (viz Text) do 'buf' o velikosti 'bufSize'
+    static void FormatRecord(const char* record, char* buf, int bufSize);
 
     static void ReleaseBeforeExitThread(); // uvolni data call-stack objektu v aktualnim threadu (pouziva se pred vyvolanim exitu threadu uvnitr hlidane oblasti)
     void ReleaseBeforeExitThreadBody();    // vola se z ReleaseBeforeExitThread() po detekci objektu call-stacku z TLS
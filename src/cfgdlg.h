@@ -213,6 +213,12 @@ struct CConfiguration
         UseSalOpen,             // ma se pouzivat salopen.exe (jinak spousteni asociaci naprimo)
         NetwareFastDirMove,     // ma se na Novell Netware pouzivat fast-dir-move (rename adresaru)? (jinak prejmenovavame jen soubory, adresare se vytvari + stare prazdne mazou) (DUVOD: nekomu proste fast-dir-move na Novellu funguje a tak proste nechce cekat)
         UseAsyncCopyAlg,        // jen Win7+ (starsi OS: vzdy FALSE): ma se pouzivat asynchronni algoritmus kopirovani souboru na sitove disky?
+        ConcurrentSmallCopy,    // maji se male soubory kopirovat soubezne pomocnymi thready? (jen v registry, viz CSmallFilesCopier)
+        StreamingCopy,          // ma Copy/Move z panelu zacit kopirovat uz behem stavby skriptu? (jen v registry, viz COperations::StartStreaming)
+        VerifyCopy,             // ma se po zkopirovani souboru cil znovu precist a porovnat jeho kontrolni soucet se zdrojem? (jen v registry, viz CCopyVerifier)
+        CopyChecksumManifest,   // ma se pri VerifyCopy zapsat do ciloveho adresare SFV soubor s kontrolnimi soucty? (jen v registry, viz CCopyVerifier)
+        DeltaCopy,              // ma se pri prepisu velkeho souboru zapisovat jen zmenene casti? (jen v registry, viz DoCopyFileLoopDelta)
+        ParallelDelete,         // maji se soubory pri mazani mazat soubezne pomocnymi thready? (jen v registry, viz CParallelDeleter)
         ReloadEnvVariables,     // mame pri zmene env promennych provadet regeneraci?
         QuickRenameSelectAll,   // Quick Rename/Pack ma vybrat vse (ne pouze jmeno) -- lide nadavali na foru po zavedeni noveho oznacovani
         EditNewSelectAll,       // EditNew ma vybrat vse (ne pouze jmeno) -- lide si vyzadali samostnou volbu, protoze nekdo zaklada vzdy .TXT (a vyhovuje mu ze prepise jen jmeno) a nekdo ruzne pripony a chce prepsat cely nazev
@@ -29,6 +29,13 @@ enum CDeleteType
     dtDelete    // delete is called for pointers stored in indirect array
 };
 
+enum CArrayGrowth
+{
+    agLinear,   // array is enlarged/reduced by 'Delta' (default)
+    agGeometric // array is enlarged by half of its size (at least by 'Delta') and reduced only
+                // when it is less than quarter full (for arrays growing to millions of items)
+};
+
 enum CErrorType
 {
     etNone,         // OK
@@ -60,6 +67,13 @@ std::ostream& operator<<(std::ostream& out, const CErrorType& err);
 //       char Path[MAX_PATH];  // full file name
 //       char *Name;           // points to 'Path' to file name (without path)
 //     SOLUTION: store only offsets instead of complete pointers
+//   the same applies to objects whose address is stored elsewhere (e.g. CRITICAL_SECTION,
+//   objects registered in other objects), such objects must be stored in TIndirectArray
+//  -any enlargement/reduction of array (Add, Insert, Delete, Detach, Reserve) can move
+//   items, so pointers and references to items are valid only until next such call
+//  -with default growth policy (agLinear) the array is reallocated after each 'Delta' of
+//   added items, so filling the array with N items copies O(N*N/Delta) bytes; arrays which
+//   can grow to huge sizes should use agGeometric (see SetGrowth) and/or Reserve
 
 template <class DATA_TYPE>
 class TDirectArray
@@ -137,11 +151,21 @@ public:
 
     int SetDelta(int delta); // change 'Delta', return real used value; NOTE: can be used only for empty array
 
+    // change growth policy (see CArrayGrowth), can be used anytime
+    void SetGrowth(CArrayGrowth growth) { Growth = growth; }
+
+    // pre-allocates array for at least 'count' items (adding up to 'count' items will not
+    // reallocate array); deleting items can reduce array again (agLinear: right away,
+    // agGeometric: when it is less than quarter full); returns FALSE on lack of memory
+    // (array stays OK, only the reservation failed)
+    BOOL Reserve(int count);
+
 protected:
-    DATA_TYPE* Data; // pointer to array
-    int Available;   // allocated size of array
-    int Base;        // smallest allocated size of array
-    int Delta;       // allocated array size is enlarged/reduced by this value
+    DATA_TYPE* Data;     // pointer to array
+    int Available;       // allocated size of array
+    int Base;            // smallest allocated size of array
+    int Delta;           // allocated array size is enlarged/reduced by this value (agGeometric: at least by this value)
+    CArrayGrowth Growth; // growth policy
 
     virtual void Error(CErrorType err) // array error handling
     {
@@ -151,7 +175,9 @@ protected:
             TRACE_E("Incorrect call to Error method (State = " << State << ").");
     }
     void EnlargeArray(); // enlarges array
-    void ReduceArray();  // reduces array
+    void ReduceArray();  // reduces array if it is too empty (according to growth policy)
+
+    int GetEnlargedSize(int needed); // returns new allocated size of array for 'needed' items
 
     void Move(CArrayDirection direction, int first, int count); // move selected items to next/previous index
 
@@ -651,8 +677,8 @@ void TClassArray<CLASS_TYPE>::Dispose(int index)
                     else
                         break;
 
-            while (this->IsGood() && this->Available > this->Base && this->Available - this->Delta >= this->Count)
-                this->ReduceArray();
+            if (this->IsGood())
+                this->ReduceArray(); // shrinks straight to the target size of the growth policy
 
             if (FirstFreeIndex > this->Count)
                 FirstFreeIndex = this->Count;
@@ -678,6 +704,7 @@ TDirectArray<DATA_TYPE>::TDirectArray(int base, int delta)
     if (delta <= 0)
         TRACE_E("Delta is less or equal to zero, correcting to 1.");
     Delta = (delta > 0) ? delta : 1;
+    Growth = agLinear;
     State = etNone;
     Available = Count = 0;
     Data = (DATA_TYPE*)malloc(Base * sizeof(DATA_TYPE));
@@ -802,8 +829,7 @@ void TDirectArray<DATA_TYPE>::Insert(int index, const DATA_TYPE* members, int co
             int needed = Count + count;
             if (needed > Available)
             {
-                needed -= Base + 1;
-                needed = needed - (needed % Delta) + Delta + Base;
+                needed = GetEnlargedSize(needed);
                 DATA_TYPE* newData = (DATA_TYPE*)realloc(Data, needed * sizeof(DATA_TYPE));
 #ifndef SAFE_ALLOC
                 if (newData == NULL)
@@ -852,8 +878,7 @@ int TDirectArray<DATA_TYPE>::Add(const DATA_TYPE* members, int count)
         int needed = Count + count;
         if (needed > Available)
         {
-            needed -= Base + 1;
-            needed = needed - (needed % Delta) + Delta + Base;
+            needed = GetEnlargedSize(needed);
             DATA_TYPE* newData = (DATA_TYPE*)realloc(Data, needed * sizeof(DATA_TYPE));
 #ifndef SAFE_ALLOC
             if (newData == NULL)
@@ -952,8 +977,7 @@ void TDirectArray<DATA_TYPE>::Delete(int index)
             CallDestructor(Data[index]);
             Move(drUp, index + 1, Count - index - 1);
             Count--;
-            if (Available > Base && Available - Delta == Count)
-                ReduceArray();
+            ReduceArray();
 #if defined(_DEBUG) || defined(__ARRAY_DEBUG)
         }
         else
@@ -977,25 +1001,7 @@ void TDirectArray<DATA_TYPE>::Delete(int index, int count)
                 CallDestructor(Data[i]);
             memmove(Data + index, Data + index + count, (Count - count - index) * sizeof(DATA_TYPE));
             Count -= count;
-            if (Available > Base && Available - Delta >= Count)
-            {
-                int a = (Count <= Base) ? Base : Base + Delta * ((Count - Base - 1) / Delta + 1);
-                DATA_TYPE* New = (DATA_TYPE*)realloc(Data, a * sizeof(DATA_TYPE));
-#ifndef SAFE_ALLOC
-                if (New == NULL)
-                {
-                    TRACE_E("Low memory for operations related to array reducing.");
-                    Error(etLowMemory);
-                }
-                else
-                {
-#endif // SAFE_ALLOC
-                    Data = New;
-                    Available = a;
-#ifndef SAFE_ALLOC
-                }
-#endif // SAFE_ALLOC
-            }
+            ReduceArray();
 #if defined(_DEBUG) || defined(__ARRAY_DEBUG)
         }
         else
@@ -1017,8 +1023,7 @@ void TDirectArray<DATA_TYPE>::Detach(int index)
 #endif
             Move(drUp, index + 1, Count - index - 1);
             Count--;
-            if (Available > Base && Available - Delta == Count)
-                ReduceArray();
+            ReduceArray();
 #if defined(_DEBUG) || defined(__ARRAY_DEBUG)
         }
         else
@@ -1040,25 +1045,7 @@ void TDirectArray<DATA_TYPE>::Detach(int index, int count)
 #endif
             memmove(Data + index, Data + index + count, (Count - count - index) * sizeof(DATA_TYPE));
             Count -= count;
-            if (Available > Base && Available - Delta >= Count)
-            {
-                int a = (Count <= Base) ? Base : Base + Delta * ((Count - Base - 1) / Delta + 1);
-                DATA_TYPE* New = (DATA_TYPE*)realloc(Data, a * sizeof(DATA_TYPE));
-#ifndef SAFE_ALLOC
-                if (New == NULL)
-                {
-                    TRACE_E("Low memory for operations related to array reducing.");
-                    Error(etLowMemory);
-                }
-                else
-                {
-#endif // SAFE_ALLOC
-                    Data = New;
-                    Available = a;
-#ifndef SAFE_ALLOC
-                }
-#endif // SAFE_ALLOC
-            }
+            ReduceArray();
 #if defined(_DEBUG) || defined(__ARRAY_DEBUG)
         }
         else
@@ -1098,7 +1085,8 @@ void TDirectArray<DATA_TYPE>::EnlargeArray()
     if (State == etNone)
     {
 #endif
-        DATA_TYPE* New = (DATA_TYPE*)realloc(Data, (Available + Delta) * sizeof(DATA_TYPE));
+        int a = GetEnlargedSize(Available + 1);
+        DATA_TYPE* New = (DATA_TYPE*)realloc(Data, a * sizeof(DATA_TYPE));
 #ifndef SAFE_ALLOC
         if (New == NULL)
         {
@@ -1108,7 +1096,7 @@ void TDirectArray<DATA_TYPE>::EnlargeArray()
         }
 #endif // SAFE_ALLOC
         Data = New;
-        Available += Delta;
+        Available = a;
 #if defined(_DEBUG) || defined(__ARRAY_DEBUG)
     }
     else
@@ -1123,7 +1111,27 @@ void TDirectArray<DATA_TYPE>::ReduceArray()
     if (State == etNone)
     {
 #endif
-        DATA_TYPE* New = (DATA_TYPE*)realloc(Data, (Available - Delta) * sizeof(DATA_TYPE));
+        if (Available <= Base)
+            return;
+        int a;
+        if (Growth == agGeometric)
+        { // hysteresis: reduce only when less than quarter full and only to half, so
+          // alternating Add/Delete around the boundary does not reallocate on each call
+            if (Count > Available / 4)
+                return;
+            a = Available / 2;
+            while (a / 2 >= Base && Count <= a / 4)
+                a /= 2;
+            if (a < Base)
+                a = Base;
+        }
+        else
+        {
+            if (Available - Delta < Count)
+                return;
+            a = (Count <= Base) ? Base : Base + Delta * ((Count - Base - 1) / Delta + 1);
+        }
+        DATA_TYPE* New = (DATA_TYPE*)realloc(Data, a * sizeof(DATA_TYPE));
 #ifndef SAFE_ALLOC
         if (New == NULL)
         {
@@ -1133,7 +1141,7 @@ void TDirectArray<DATA_TYPE>::ReduceArray()
         }
 #endif // SAFE_ALLOC
         Data = New;
-        Available -= Delta;
+        Available = a;
 #if defined(_DEBUG) || defined(__ARRAY_DEBUG)
     }
     else
@@ -1141,6 +1149,46 @@ void TDirectArray<DATA_TYPE>::ReduceArray()
 #endif
 }
 
+template <class DATA_TYPE>
+int TDirectArray<DATA_TYPE>::GetEnlargedSize(int needed)
+{
+    if (Growth == agGeometric)
+    {
+        int grow = Available / 2;
+        if (grow < Delta)
+            grow = Delta;
+        if (grow > INT_MAX - Available) // int overflow, grow only to needed size
+            return needed;
+        return (Available + grow >= needed) ? Available + grow : needed;
+    }
+    else
+    {
+        needed -= Base + 1;
+        return needed - (needed % Delta) + Delta + Base;
+    }
+}
+
+template <class DATA_TYPE>
+BOOL TDirectArray<DATA_TYPE>::Reserve(int count)
+{
+    if (State != etNone)
+    {
+        TRACE_E("Incorrect call to array method (State = " << State << ").");
+        return FALSE;
+    }
+    if (count <= Available)
+        return TRUE;
+    DATA_TYPE* New = (DATA_TYPE*)realloc(Data, count * sizeof(DATA_TYPE));
+    if (New == NULL)
+    {
+        TRACE_E("Low memory for array reservation."); // array is OK, it is only not pre-allocated
+        return FALSE;
+    }
+    Data = New;
+    Available = count;
+    return TRUE;
+}
+
 template <class DATA_TYPE>
 void TDirectArray<DATA_TYPE>::Move(CArrayDirection direction, int first, int count)
 {
@@ -7,6 +7,7 @@
 #include <crtdbg.h>
 #include <ostream>
 #include <commctrl.h> // potrebuju LPCOLORMAP
+#include <emmintrin.h>
 
 #if defined(_DEBUG) && defined(_MSC_VER) // without passing file+line to 'new' operator, list of memory leaks shows only 'crtdbg.h(552)'
 #define new new (_NORMAL_BLOCK, __FILE__, __LINE__)
@@ -107,6 +108,9 @@ char* StrNCat(char* dst, const char* src, int dstSize)
 
 // ****************************************************************************
 
+// TRUE = pouzivame SSE2 varianty porovnavacich funkci (viz InitializeCase())
+static BOOL UseSSE2StrFuncs = FALSE;
+
 void InitializeCase()
 {
     int i;
@@ -114,6 +118,185 @@ void InitializeCase()
         LowerCase[i] = (char)(UINT_PTR)CharLowerA((LPSTR)(UINT_PTR)i);
     for (i = 0; i < 256; i++)
         UpperCase[i] = (char)(UINT_PTR)CharUpperA((LPSTR)(UINT_PTR)i);
+
+    // SSE2 varianty prevadi ASCII znaky na male primo ('A'..'Z' -> 'a'..'z'), musi tedy
+    // platit, ze LowerCase dela pro ASCII totez a zadny znak nad 127 neprevadi do ASCII
+    // (v ANSI kodovych strankach to plati, ale radsi to overime)
+    BOOL asciiFold = TRUE;
+    for (i = 0; i < 256; i++)
+    {
+        if ((i < 128 && LowerCase[i] != ((i >= 'A' && i <= 'Z') ? i + ('a' - 'A') : i)) ||
+            (i >= 128 && LowerCase[i] < 128))
+        {
+            asciiFold = FALSE;
+            break;
+        }
+    }
+    UseSSE2StrFuncs = asciiFold && IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+}
+
+//
+//*****************************************************************************
+//
+// SSE2 varianty porovnavacich funkci
+//
+// Bloky 16 znaku se porovnavaji po prevodu 'A'..'Z' na male; znaky nad 127 se neprevadi,
+// takze se v bloku shoduji jen pokud jsou stejne. Znaky, ktere se po tomto prevodu
+// lisi (pripadne i nuly u retezcu zakoncenych nulou), se dorovnavaji pres LowerCase,
+// vysledky jsou tedy shodne se skalarnimi variantami.
+
+// prevede znaky 'A'..'Z' v 'v' na male, ostatni znaky nemeni
+static inline __m128i SSE2LowerASCII(__m128i v)
+{
+    // po pricteni (0x80 - 'A') padnou 'A'..'Z' (a jen ty) do rozsahu -128..-103 (se znamenkem)
+    __m128i t = _mm_add_epi8(v, _mm_set1_epi8((char)(0x80 - 'A')));
+    __m128i upper = _mm_cmplt_epi8(t, _mm_set1_epi8((char)(0x80 + 26)));
+    return _mm_add_epi8(v, _mm_and_si128(upper, _mm_set1_epi8('a' - 'A')));
+}
+
+// vraci masku (bit 0 = znak 0) znaku bloku, ktere je nutne dorovnat pres LowerCase:
+// znaky lisici se i po prevodu 'A'..'Z' na male; pri 'stopAtNull' TRUE i nuly v 's1'
+static inline DWORD SSE2MismatchMask(const char* s1, const char* s2, BOOL stopAtNull)
+{
+    __m128i a = _mm_loadu_si128((const __m128i*)s1);
+    __m128i b = _mm_loadu_si128((const __m128i*)s2);
+    int mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(SSE2LowerASCII(a), SSE2LowerASCII(b)));
+    if (stopAtNull)
+        mask |= _mm_movemask_epi8(_mm_cmpeq_epi8(a, _mm_setzero_si128()));
+    return (DWORD)mask & 0xFFFF;
+}
+
+// TRUE pokud 16 bajtu od 's1' i 's2' lezi na jedne strance pameti; u retezcu zakoncenych
+// nulou tak cteni celeho bloku nemuze sahnout do nenamapovane pameti za koncem retezce
+#define SSE2_BLOCK_IN_PAGE(s1, s2) ((((UINT_PTR)(s1)&4095) <= 4096 - 16) && (((UINT_PTR)(s2)&4095) <= 4096 - 16))
+
+static int StrICmpSSE2(const char* s1, const char* s2)
+{
+    while (1)
+    {
+        if (SSE2_BLOCK_IN_PAGE(s1, s2))
+        {
+            DWORD mask = SSE2MismatchMask(s1, s2, TRUE);
+            while (mask != 0)
+            {
+                DWORD i;
+                _BitScanForward(&i, mask);
+                int res = (unsigned)LowerCase[s1[i]] - (unsigned)LowerCase[s2[i]];
+                if (res != 0)
+                    return (res < 0) ? -1 : 1; // < a >
+                if (s1[i] == 0)
+                    return 0; // ==
+                mask &= mask - 1;
+            }
+            s1 += 16;
+            s2 += 16;
+        }
+        else // blok by mohl presahnout na dalsi stranku, jdeme po znacich
+        {
+            int res = (unsigned)LowerCase[*s1] - (unsigned)LowerCase[*s2++];
+            if (res != 0)
+                return (res < 0) ? -1 : 1; // < a >
+            if (*s1++ == 0)
+                return 0; // ==
+        }
+    }
+}
+
+static int StrNICmpSSE2(const char* s1, const char* s2, int n)
+{
+    while (n > 0)
+    {
+        if (n >= 16 && SSE2_BLOCK_IN_PAGE(s1, s2))
+        {
+            DWORD mask = SSE2MismatchMask(s1, s2, TRUE);
+            while (mask != 0)
+            {
+                DWORD i;
+                _BitScanForward(&i, mask);
+                int res = (unsigned)LowerCase[s1[i]] - (unsigned)LowerCase[s2[i]];
+                if (res != 0)
+                    return (res < 0) ? -1 : 1; // < a >
+                if (s1[i] == 0)
+                    return 0; // ==
+                mask &= mask - 1;
+            }
+            s1 += 16;
+            s2 += 16;
+            n -= 16;
+        }
+        else
+        {
+            int res = (unsigned)LowerCase[*s1] - (unsigned)LowerCase[*s2++];
+            if (res != 0)
+                return (res < 0) ? -1 : 1; // < a >
+            if (*s1++ == 0)
+                return 0; // ==
+            n--;
+        }
+    }
+    return 0;
+}
+
+// porovna 'n' bajtu bez ohledu na nuly (pro MemICmp a StrICmpEx), vraci -1, 0 nebo 1
+static int MemICmpSSE2(const char* s1, const char* s2, int n)
+{
+    while (n >= 16)
+    {
+        DWORD mask = SSE2MismatchMask(s1, s2, FALSE);
+        while (mask != 0)
+        {
+            DWORD i;
+            _BitScanForward(&i, mask);
+            int res = (unsigned)LowerCase[s1[i]] - (unsigned)LowerCase[s2[i]];
+            if (res != 0)
+                return (res < 0) ? -1 : 1; // < a >
+            mask &= mask - 1;
+        }
+        s1 += 16;
+        s2 += 16;
+        n -= 16;
+    }
+    while (n-- > 0)
+    {
+        int res = (unsigned)LowerCase[*s1++] - (unsigned)LowerCase[*s2++];
+        if (res != 0)
+            return (res < 0) ? -1 : 1; // < a >
+    }
+    return 0;
+}
+
+// hleda 'pattern' (delky 'len' >= 1) na pozicich 'txt' az 'txt' + 'positions' - 1; bloky 16
+// pozic filtruje podle prvniho znaku vzorku (jen je-li to ASCII znak, jinak by mohl mit
+// vic nez dve podoby), na kandidatech pak vola StrNICmp; zbyle pozice vraci v 'txt'
+// a 'positions' pro dohledani puvodnim zpusobem, nalezeny vyskyt vraci v 'found'
+static BOOL StrIStrSSE2(const char*& txt, int& positions, const char* pattern, int len,
+                        const char*& found)
+{
+    BYTE first = LowerCase[(BYTE)*pattern];
+    if (first >= 128)
+        return FALSE;
+    __m128i lower = _mm_set1_epi8((char)first);
+    __m128i upper = _mm_set1_epi8((char)((first >= 'a' && first <= 'z') ? first - ('a' - 'A') : first));
+    // blok 16 pozic cte znaky txt[0..15], vsechny lezi pred koncem textu, protoze 'len' >= 1
+    while (positions >= 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)txt);
+        DWORD mask = (DWORD)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, lower), _mm_cmpeq_epi8(v, upper)));
+        while (mask != 0)
+        {
+            DWORD i;
+            _BitScanForward(&i, mask);
+            if (StrNICmp(txt + i, pattern, len) == 0)
+            {
+                found = txt + i;
+                return TRUE;
+            }
+            mask &= mask - 1;
+        }
+        txt += 16;
+        positions -= 16;
+    }
+    return FALSE;
 }
 
 //
@@ -137,6 +320,8 @@ int StrICpy(char* dest, const char* src)
 // puvodni funkce
 int StrICmp(const char* s1, const char* s2)
 {
+    if (UseSSE2StrFuncs)
+        return StrICmpSSE2(s1, s2);
     int res;
     while (1)
     {
@@ -152,6 +337,8 @@ int StrICmp(const char* s1, const char* s2)
 
 int StrICmp(const char* s1, const char* s2)
 {
+    if (UseSSE2StrFuncs)
+        return StrICmpSSE2(s1, s2);
     const BYTE* table = LowerCase;
     __asm {
         // load up arguments
@@ -223,6 +410,8 @@ int StrNICmp(const char *s1, const char *s2, int n)
 // opravena verze
 int StrNICmp(const char* s1, const char* s2, int n)
 {
+    if (UseSSE2StrFuncs && n >= 16)
+        return StrNICmpSSE2(s1, s2, n);
     int res;
     while (n--)
     {
@@ -239,6 +428,8 @@ int StrNICmp(const char* s1, const char* s2, int n)
 
 int StrNICmp(const char* s1, const char* s2, int n)
 {
+    if (UseSSE2StrFuncs && n >= 16)
+        return StrNICmpSSE2(s1, s2, n);
     const BYTE* table = LowerCase;
     __asm {
         // load up arguments
@@ -307,6 +498,8 @@ toend:
 
 #ifdef _WIN64
 // Ani ve VC11 MS nedodali x64 ASM verze stringovych operaci, takze zatim take zustavame v C++
+// (x64 verze porovnava pres _memicmp, ne pres LowerCase, proto nepouziva ani SSE2 variantu,
+// ktera by u znaku nad 127 mohla vracet jiny vysledek)
 int MemICmp(const void* buf1, const void* buf2, int n)
 {
     int ret = _memicmp(buf1, buf2, n);
@@ -319,6 +512,8 @@ int MemICmp(const void* buf1, const void* buf2, int n)
 
 int MemICmp(const void* buf1, const void* buf2, int n)
 {
+    if (UseSSE2StrFuncs && n >= 16)
+        return MemICmpSSE2((const char*)buf1, (const char*)buf2, n);
     const BYTE* table = LowerCase;
     __asm {
         // load up arguments
@@ -383,6 +578,13 @@ toend:
 int StrICmpEx(const char* s1, int l1, const char* s2, int l2)
 {
     int res, l = (l1 < l2) ? l1 : l2;
+    if (UseSSE2StrFuncs && l >= 16)
+    {
+        res = MemICmpSSE2(s1, s2, l);
+        if (res != 0)
+            return res;
+        l = 0;
+    }
     while (l--)
     {
         res = (unsigned)LowerCase[*s1++] - (unsigned)LowerCase[*s2++];
@@ -417,7 +619,13 @@ int StrICmpEx(const char* s1, int l1, const char* s2, int l2)
 {
     int l = (l1 < l2) ? l1 : l2;
 
-    if (l > 0)
+    if (UseSSE2StrFuncs && l >= 16)
+    {
+        int res = MemICmpSSE2(s1, s2, l);
+        if (res != 0)
+            return res;
+    }
+    else if (l > 0)
     {
         // MemICmp
         const BYTE* table = LowerCase;
@@ -527,6 +735,14 @@ const char* StrIStr(const char* txt, const char* pattern)
     const char* s = txt;
     int len = (int)strlen(pattern);
     int txtLen = (int)strlen(txt);
+    if (UseSSE2StrFuncs && len > 0 && txtLen - len + 1 >= 16)
+    {
+        int positions = txtLen - len + 1;
+        const char* found;
+        if (StrIStrSSE2(s, positions, pattern, len, found))
+            return found;
+        txtLen = positions + len - 1;
+    }
     while (txtLen >= len)
     {
         if (StrNICmp(s, pattern, len) == 0)
@@ -546,6 +762,14 @@ const char* StrIStr(const char* txtStart, const char* txtEnd,
     const char* s = txtStart;
     int len = (int)(patternEnd - patternStart);
     int txtLen = (int)(txtEnd - txtStart);
+    if (UseSSE2StrFuncs && len > 0 && txtLen - len + 1 >= 16)
+    {
+        int positions = txtLen - len + 1;
+        const char* found;
+        if (StrIStrSSE2(s, positions, patternStart, len, found))
+            return found;
+        txtLen = positions + len - 1;
+    }
     while (txtLen >= len)
     {
         if (StrNICmp(s, patternStart, len) == 0)
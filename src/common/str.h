@@ -18,6 +18,12 @@
 //
 // Funkce StrNICmp v C++ na Pentiu Pro beha rychleji nez v ASM varianta.
 //
+// Na procesorech s SSE2 pouzivaji StrICmp, StrICmpEx, StrNICmp, MemICmp (jen x86;
+// x64 verze porovnava pres _memicmp) a StrIStr variantu, ktera porovnava 16 znaku
+// najednou; ASCII znaky prevadi na male primo, na LowerCase prechazi jen u bloku
+// s rozdilem (tedy i u znaku nad 127 a konce retezce). Volba varianty probiha
+// v InitializeCase().
+//
 
 extern BYTE LowerCase[256]; // premapovani vsech znaku na male; generovano pomoci API CharLower
 extern BYTE UpperCase[256]; // premapovani vsech znaku na velke; generovano pomoci API CharUpper
@@ -58,6 +58,9 @@ const TCHAR* __CONNECT_DATA_ACCEPTED_EVENT_NAME = _T("TraceServerConnectDataAcce
 #ifdef _DEBUG
 #include <sstream>
 #endif // _DEBUG
+#ifdef TRACE_BINLOG_ENABLE
+#include <new>
+#endif // TRACE_BINLOG_ENABLE
 
 #if defined(_DEBUG) && defined(_MSC_VER) // without passing file+line to 'new' operator, list of memory leaks shows only 'crtdbg.h(552)'
 #define new new (_NORMAL_BLOCK, __FILE__, __LINE__)
@@ -75,6 +78,9 @@ const TCHAR* __CONNECT_DATA_ACCEPTED_EVENT_NAME = _T("TraceServerConnectDataAcce
 #endif // MULTITHREADED_TRACE_ENABLE
 
 C__Trace __Trace;
+#ifdef TRACE_BINLOG_ENABLE
+C__TraceBin __TraceBin; // az za __Trace, konstruuje se ve stejne inicializacni sekci
+#endif // TRACE_BINLOG_ENABLE
 
 #ifdef MULTITHREADED_TRACE_ENABLE
 
@@ -1156,6 +1162,530 @@ C__Trace::SendMessageToServer(C__MessageType type, BOOL crash)
     return *this;
 }
 
+#ifdef TRACE_BINLOG_ENABLE
+
+//*****************************************************************************
+//
+// C__TraceBinThread
+//
+
+#define __TRACEBIN_RING_SIZE (64 * 1024)  // velikost kruhoveho bufferu jednoho threadu (mocnina dvou)
+#define __TRACEBIN_SITE_TABLE_SIZE 65536 // velikost tabulky mist volani (mocnina dvou, vic nez se vejde definic do logu)
+#define __TRACEBIN_MAX_RECORD (10 * 1024) // max. velikost zaznamu (hlavicka + text nebo jmeno souboru)
+#define __TRACEBIN_DRAIN_PERIOD 100       // perioda vybirani bufferu threadu v ms
+
+// data jednoho threadu; do kruhoveho bufferu zapisuje jen vlastni thread (meni Head), cte z nej
+// jen C__TraceBin::DrainBody (meni Tail), takze se obejdeme bez zamku
+class C__TraceBinThread
+{
+public:
+    C__TraceBinThread* Next; // dalsi polozka seznamu C__TraceBin::Threads
+    DWORD ThreadID;          // ID threadu
+    HANDLE Thread;           // handle threadu pro zjisteni jeho konce (NULL = neznamy)
+    DWORD Dropped;           // pocet zahozenych zprav, ktere jeste nebyly ohlaseny zaznamem __tbrDropped
+
+    C__StringStreamBuf StringBuf;   // buffer pro skladani textu zpravy (ANSI)
+    C__StringStreamBufW StringBufW; // buffer pro skladani textu zpravy (unicode)
+    C__TraceStream Stream;          // stream pro skladani textu zpravy (ANSI)
+    C__TraceStreamW StreamW;        // stream pro skladani textu zpravy (unicode)
+
+    volatile DWORD Head; // celkovy pocet bajtu zapsanych do Ring
+    volatile DWORD Tail; // celkovy pocet bajtu prectenych z Ring
+    char Ring[__TRACEBIN_RING_SIZE];
+
+public:
+    C__TraceBinThread() : Stream(&StringBuf), StreamW(&StringBufW)
+    {
+        Next = NULL;
+        ThreadID = GetCurrentThreadId();
+        Thread = OpenThread(SYNCHRONIZE, FALSE, ThreadID);
+        Dropped = 0;
+        Head = 0;
+        Tail = 0;
+    }
+
+    ~C__TraceBinThread()
+    {
+        if (Thread != NULL)
+            CloseHandle(Thread);
+    }
+
+    // zapise do Ring zaznam 'rec' nasledovany daty 'data1' a 'data2'; vraci FALSE, pokud se nevejde
+    BOOL Write(C__TraceBinRecord* rec, const void* data1, DWORD size1, const void* data2, DWORD size2);
+
+    // precte z Ring zaznam zacinajici na pozici 'pos' do 'buf' (velikost __TRACEBIN_MAX_RECORD)
+    void Read(DWORD pos, char* buf);
+
+protected:
+    DWORD CopyToRing(DWORD pos, const void* data, DWORD size);
+};
+
+DWORD
+C__TraceBinThread::CopyToRing(DWORD pos, const void* data, DWORD size)
+{
+    DWORD offset = pos & (__TRACEBIN_RING_SIZE - 1);
+    DWORD first = __TRACEBIN_RING_SIZE - offset;
+    if (first > size)
+        first = size;
+    memcpy(Ring + offset, data, first);
+    if (first < size)
+        memcpy(Ring, (const char*)data + first, size - first);
+    return pos + size;
+}
+
+BOOL C__TraceBinThread::Write(C__TraceBinRecord* rec, const void* data1, DWORD size1, const void* data2, DWORD size2)
+{
+    DWORD size = (sizeof(C__TraceBinRecord) + size1 + size2 + 3) & ~3;
+    DWORD tail = Tail;
+    MemoryBarrier(); // Tail cteme pred zapisem dat, ktera mohl drain thread prave uvolnit
+    if (__TRACEBIN_RING_SIZE - (Head - tail) < size)
+        return FALSE; // drain thread nestiha, zprava se zahodi
+    rec->Size = (WORD)size;
+    DWORD pos = CopyToRing(Head, rec, sizeof(C__TraceBinRecord));
+    if (size1 > 0)
+        pos = CopyToRing(pos, data1, size1);
+    if (size2 > 0)
+        CopyToRing(pos, data2, size2);
+    MemoryBarrier(); // data musi byt v Ring driv, nez je drain thread uvidi pres Head
+    Head = Head + size;
+    return TRUE;
+}
+
+void C__TraceBinThread::Read(DWORD pos, char* buf)
+{
+    DWORD offset = pos & (__TRACEBIN_RING_SIZE - 1);
+    // hlavicka zaznamu se nikdy nerozdeli (zaznamy i Ring jsou zarovnane na 4 bajty)
+    DWORD size = *(WORD*)(Ring + offset);
+    DWORD first = __TRACEBIN_RING_SIZE - offset;
+    if (first > size)
+        first = size;
+    memcpy(buf, Ring + offset, first);
+    if (first < size)
+        memcpy(buf + first, Ring, size - first);
+}
+
+//*****************************************************************************
+//
+// C__TraceBinSite
+//
+
+enum C__TraceBinSiteState
+{
+    __tbsEmpty,   // volna polozka
+    __tbsFilling, // polozku prave zaklada nejaky thread
+    __tbsReady,   // File a Line jsou platne
+};
+
+// misto volani (jmeno souboru + radka) v tabulce celeho procesu; definice mista (__tbrSite) se
+// do logu zapisuje jen jednou, at misto pouziva kolik chce threadu
+struct C__TraceBinSite
+{
+    volatile LONG State;   // C__TraceBinSiteState
+    volatile LONG Defined; // 1 = definice je zapsana (nebo ji prave zapisuje nejaky thread)
+    const void* File;
+    int Line;
+};
+
+//*****************************************************************************
+//
+// C__TraceBin
+//
+
+C__TraceBin::C__TraceBin() : NullStream(NULL), NullStreamW(NULL)
+{
+    TlsIndex = TlsAlloc();
+    Threads = NULL;
+    // mimo CRT heap a bez uvolneni, stejne jako data threadu (viz GetThread)
+    Sites = (C__TraceBinSite*)GlobalAlloc(GPTR, __TRACEBIN_SITE_TABLE_SIZE * sizeof(C__TraceBinSite));
+    DrainLock = 0;
+    DrainThreadStarted = 0;
+    StopEvent = NULL;
+    Closed = FALSE;
+    File = NULL;
+    Mapping = NULL;
+    View = NULL;
+    Header = NULL;
+    OpenFailed = FALSE;
+}
+
+C__TraceBin::~C__TraceBin()
+{
+    // na drain thread necekame (pri DLL_PROCESS_DETACH by to byl deadlock), jen ho zastavime
+    // (modul je pri startu drain threadu pripnuty, kod threadu tak zustava v pameti, viz GetThread);
+    // data threadu neuvolnujeme, jine thready mohou jeste posilat zpravy (ty se uz jen zahodi)
+    if (StopEvent != NULL)
+        SetEvent(StopEvent);
+    if (LockDrain(1000))
+    {
+        if (!Closed)
+        {
+            DrainBody();
+            CloseLogFile();
+            Closed = TRUE;
+        }
+        UnlockDrain();
+    }
+}
+
+C__TraceBinThread*
+C__TraceBin::GetThread(DWORD* lastError)
+{
+    *lastError = GetLastError(); // TlsGetValue nuluje last-error
+    C__TraceBinThread* thread = NULL;
+    if (TlsIndex != TLS_OUT_OF_INDEXES)
+    {
+        thread = (C__TraceBinThread*)TlsGetValue(TlsIndex);
+        if (thread == NULL)
+        {
+            // alokujeme mimo CRT heap, data threadu se neuvolnuji pred koncem procesu
+            // (viz ~C__TraceBin) a v debug verzi by se hlasila jako memory leak
+            void* mem = GlobalAlloc(GMEM_FIXED, sizeof(C__TraceBinThread));
+            if (mem != NULL)
+            {
+#pragma push_macro("new")
+#undef new
+                thread = ::new (mem) C__TraceBinThread;
+#pragma pop_macro("new")
+                TlsSetValue(TlsIndex, thread);
+                C__TraceBinThread* first;
+                do
+                {
+                    first = Threads;
+                    thread->Next = first;
+                } while (InterlockedCompareExchangePointer((PVOID volatile*)&Threads, thread, first) != first);
+
+                if (InterlockedExchange(&DrainThreadStarted, 1) == 0)
+                {
+                    // ~C__TraceBin na drain thread neceka, modul s DrainThreadBody (napr. plugin)
+                    // proto nesmi byt pred koncem procesu uvolnen z pameti (FreeLibrary)
+                    HMODULE module;
+                    if (GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_PIN,
+                                           (LPCWSTR)DrainThreadBody, &module))
+                    {
+                        StopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+                    }
+                    DWORD id;
+                    HANDLE drainThread = StopEvent != NULL ? CreateThread(NULL, 0, DrainThreadBody, this, 0, &id) : NULL;
+                    if (drainThread != NULL)
+                        CloseHandle(drainThread);
+                }
+            }
+        }
+    }
+    SetLastError(*lastError);
+    return thread;
+}
+
+C__TraceBinSite*
+C__TraceBin::GetSite(const void* file, int line)
+{
+    if (Sites == NULL)
+        return NULL;
+    DWORD index = (DWORD)(((UINT_PTR)file >> 2) ^ ((DWORD)line * 0x9E3779B1));
+    int i;
+    for (i = 0; i < __TRACEBIN_SITE_TABLE_SIZE; i++, index++)
+    {
+        C__TraceBinSite* site = &Sites[index & (__TRACEBIN_SITE_TABLE_SIZE - 1)];
+        if (site->State == __tbsEmpty &&
+            InterlockedCompareExchange(&site->State, __tbsFilling, __tbsEmpty) == __tbsEmpty)
+        {
+            site->File = file;
+            site->Line = line;
+            MemoryBarrier(); // File a Line musi byt platne driv, nez je uvidi jine thready
+            site->State = __tbsReady;
+            return site;
+        }
+        while (site->State == __tbsFilling) // polozku zaklada jiny thread, je to otazka okamziku
+            Sleep(0);
+        if (site->File == file && site->Line == line)
+            return site;
+    }
+    return NULL; // tabulka je plna, oblast definic v logu uz je tedy take plna
+}
+
+C__TraceStream&
+C__TraceBin::BeginMessage()
+{
+    DWORD lastError;
+    C__TraceBinThread* thread = GetThread(&lastError);
+    return thread != NULL ? thread->Stream : NullStream;
+}
+
+C__TraceStreamW&
+C__TraceBin::BeginMessageW()
+{
+    DWORD lastError;
+    C__TraceBinThread* thread = GetThread(&lastError);
+    return thread != NULL ? thread->StreamW : NullStreamW;
+}
+
+C__TraceBin&
+C__TraceBin::EndMessage(const char* file, const WCHAR* fileW, int line, C__TraceBinRecordType type, BOOL flush)
+{
+    DWORD lastError;
+    C__TraceBinThread* thread = GetThread(&lastError);
+    if (thread == NULL)
+        return *this;
+
+    BOOL unicode = fileW != NULL;
+    const void* text;
+    DWORD textSize;
+    if (unicode)
+    {
+        thread->StreamW.flush();
+        text = thread->StringBufW.c_str();
+        textSize = (DWORD)thread->StringBufW.length();
+        if (textSize > __TRACEBIN_MAX_TEXT)
+            textSize = __TRACEBIN_MAX_TEXT;
+        textSize *= sizeof(WCHAR);
+    }
+    else
+    {
+        thread->Stream.flush();
+        text = thread->StringBuf.c_str();
+        textSize = (DWORD)thread->StringBuf.length();
+        if (textSize > __TRACEBIN_MAX_TEXT)
+            textSize = __TRACEBIN_MAX_TEXT;
+    }
+
+    C__TraceBinRecord rec;
+    rec.Flags = unicode ? __TBF_UNICODE : 0;
+    rec.ThreadID = thread->ThreadID;
+    rec.Counter = 0;
+
+    if (thread->Dropped > 0) // ohlasime zahozene zpravy, at je v logu videt mezera
+    {
+        rec.Type = __tbrDropped;
+        rec.SiteID = 0;
+        if (thread->Write(&rec, &thread->Dropped, sizeof(DWORD), NULL, 0))
+            thread->Dropped = 0;
+    }
+
+    const void* siteFile = unicode ? (const void*)fileW : (const void*)file;
+    C__TraceBinSite* site = GetSite(siteFile, line);
+    DWORD siteID = site != NULL ? (DWORD)(site - Sites) + 1 : 0; // 0 = misto bez definice, dumper vypise "?"
+    BOOL ok = TRUE;
+    if (site != NULL && site->Defined == 0 && InterlockedCompareExchange(&site->Defined, 1, 0) == 0)
+    { // prvni zprava z tohoto mista volani, jeho definici posleme do logu
+        DWORD fileSize = (DWORD)(unicode ? (wcslen(fileW) + 1) * sizeof(WCHAR) : strlen(file) + 1);
+        if (fileSize > __TRACEBIN_MAX_RECORD - sizeof(C__TraceBinRecord) - sizeof(DWORD))
+            fileSize = 0; // nesmyslne dlouhe jmeno, dumper vypise jen cislo radky
+        DWORD siteLine = line;
+        rec.Type = __tbrSite;
+        rec.SiteID = siteID;
+        ok = thread->Write(&rec, &siteLine, sizeof(siteLine), siteFile, fileSize);
+        if (!ok)
+            InterlockedExchange(&site->Defined, 0); // definici posle nektera z dalsich zprav
+    }
+    if (ok)
+    {
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        rec.Type = (BYTE)type;
+        rec.SiteID = siteID;
+        rec.Counter = counter.QuadPart;
+        ok = thread->Write(&rec, text, textSize, NULL, 0);
+    }
+    if (!ok)
+        thread->Dropped++;
+
+    if (unicode)
+        thread->StringBufW.erase(); // priprava pro dalsi trace
+    else
+        thread->StringBuf.erase();
+
+    if (flush)
+        Drain(1000);
+    SetLastError(lastError);
+    return *this;
+}
+
+DWORD WINAPI
+C__TraceBin::DrainThreadBody(void* param)
+{
+    C__TraceBin* traceBin = (C__TraceBin*)param;
+    while (WaitForSingleObject(traceBin->StopEvent, __TRACEBIN_DRAIN_PERIOD) == WAIT_TIMEOUT)
+        traceBin->Drain(INFINITE);
+    return 0;
+}
+
+BOOL C__TraceBin::LockDrain(DWORD timeout)
+{
+    // DrainBody muze bezet jen jednou naraz; drain thread mohl byt pri ukonceni procesu zabit
+    // uprostred DrainBody, proto se mimo nej ceka jen omezenou dobu
+    DWORD start = GetTickCount();
+    while (InterlockedExchange(&DrainLock, 1) != 0)
+    {
+        if (timeout != INFINITE && GetTickCount() - start > timeout)
+            return FALSE;
+        Sleep(1);
+    }
+    return TRUE;
+}
+
+void C__TraceBin::UnlockDrain()
+{
+    InterlockedExchange(&DrainLock, 0);
+}
+
+void C__TraceBin::Drain(DWORD timeout)
+{
+    if (LockDrain(timeout))
+    {
+        if (!Closed)
+            DrainBody();
+        UnlockDrain();
+    }
+}
+
+void C__TraceBin::DrainBody()
+{
+    if (View == NULL && (OpenFailed || !OpenLogFile()))
+        return; // bez souboru zpravy nechame v bufferech, po jejich naplneni se zahazuji
+
+    char buf[__TRACEBIN_MAX_RECORD];
+    C__TraceBinThread* prev = NULL;
+    C__TraceBinThread* thread = Threads;
+    while (thread != NULL)
+    {
+        // zjistime konec threadu jeste pred vybranim bufferu, po skonceni threadu uz do nej nikdo nezapise
+        BOOL finished = thread->Thread != NULL && WaitForSingleObject(thread->Thread, 0) == WAIT_OBJECT_0;
+        DWORD head = thread->Head;
+        MemoryBarrier(); // data v Ring cteme az po precteni Head
+        DWORD tail = thread->Tail;
+        while (tail != head)
+        {
+            thread->Read(tail, buf);
+            WriteRecord((C__TraceBinRecord*)buf);
+            tail += ((C__TraceBinRecord*)buf)->Size;
+        }
+        MemoryBarrier(); // misto v Ring uvolnime az po precteni dat
+        thread->Tail = tail;
+
+        C__TraceBinThread* next = thread->Next;
+        if (finished)
+        { // thread skoncil, jeho data uvolnime (prvni polozku seznamu jen pokud mezitim nepribyla nova)
+            BOOL unlinked;
+            if (prev == NULL)
+                unlinked = InterlockedCompareExchangePointer((PVOID volatile*)&Threads, next, thread) == thread;
+            else
+            {
+                prev->Next = next;
+                unlinked = TRUE;
+            }
+            if (unlinked)
+            {
+                thread->~C__TraceBinThread();
+                GlobalFree(thread);
+                thread = next;
+                continue;
+            }
+        }
+        prev = thread;
+        thread = next;
+    }
+}
+
+void C__TraceBin::WriteRecord(const C__TraceBinRecord* rec)
+{
+    if (rec->Type == __tbrSite)
+    { // definice mist volani jsou v samostatne oblasti, kterou kruhova oblast zprav neprepisuje
+        if (Header->SitesUsed + rec->Size <= __TRACEBIN_SITES_SIZE)
+        {
+            memcpy(View + __TRACEBIN_HEADER_SIZE + Header->SitesUsed, rec, rec->Size);
+            Header->SitesUsed += rec->Size;
+        }
+        else
+            Header->SitesDropped++; // dumper na to upozorni, zpravy z tohoto mista budou bez souboru a radky
+        return;
+    }
+    char* ring = View + __TRACEBIN_HEADER_SIZE + __TRACEBIN_SITES_SIZE;
+    DWORD pos = (DWORD)(Header->WritePos % ((__int64)__TRACEBIN_BLOCK_SIZE * __TRACEBIN_BLOCKS));
+    DWORD rest = __TRACEBIN_BLOCK_SIZE - pos % __TRACEBIN_BLOCK_SIZE;
+    if (rest < rec->Size) // zaznam se do bloku nevejde, zbytek bloku oznacime jako prazdny
+    {
+        *(WORD*)(ring + pos) = 0;
+        Header->WritePos += rest;
+        pos = (DWORD)(Header->WritePos % ((__int64)__TRACEBIN_BLOCK_SIZE * __TRACEBIN_BLOCKS));
+    }
+    memcpy(ring + pos, rec, rec->Size);
+    Header->WritePos += rec->Size;
+}
+
+BOOL C__TraceBin::OpenLogFile()
+{
+    // jmeno logu: TEMP\<jmeno modulu>.<PID>.tbl, kazdy modul s TRACE_BINLOG_ENABLE ma vlastni log
+    WCHAR module[MAX_PATH];
+    HMODULE hModule;
+    if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                            (LPCWSTR)this, &hModule) ||
+        !GetModuleFileNameW(hModule, module, MAX_PATH))
+    {
+        lstrcpynW(module, L"unknown", MAX_PATH);
+    }
+    const WCHAR* moduleName = wcsrchr(module, L'\\');
+    moduleName = moduleName != NULL ? moduleName + 1 : module;
+    WCHAR name[MAX_PATH];
+    DWORD len = GetTempPathW(MAX_PATH, name);
+    if (len == 0 || len >= MAX_PATH ||
+        swprintf_s(name + len, MAX_PATH - len, L"%s.%u.tbl", moduleName, GetCurrentProcessId()) < 0)
+    {
+        OpenFailed = TRUE;
+        return FALSE;
+    }
+
+    File = CreateFileW(name, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                       FILE_ATTRIBUTE_NORMAL, NULL);
+    if (File == INVALID_HANDLE_VALUE)
+        File = NULL;
+    if (File != NULL)
+        Mapping = CreateFileMappingW(File, NULL, PAGE_READWRITE, 0, __TRACEBIN_FILE_SIZE, NULL);
+    if (Mapping != NULL)
+        View = (char*)MapViewOfFile(Mapping, FILE_MAP_WRITE, 0, 0, __TRACEBIN_FILE_SIZE);
+    if (View == NULL)
+    {
+        CloseLogFile();
+        OpenFailed = TRUE;
+        return FALSE;
+    }
+
+    Header = (C__TraceBinFileHeader*)View; // novy soubor je vynulovany
+    Header->ProcessID = GetCurrentProcessId();
+    LARGE_INTEGER li;
+    QueryPerformanceFrequency(&li);
+    Header->PerfFrequency = li.QuadPart;
+    QueryPerformanceCounter(&li);
+    Header->StartCounter = li.QuadPart;
+    GetSystemTimeAsFileTime(&Header->StartTime);
+    lstrcpynW(Header->Module, module, MAX_PATH);
+    Header->Version = __TRACEBIN_VERSION;
+    Header->Signature = __TRACEBIN_SIGNATURE; // nakonec, aby dumper neprijal nedokoncenou hlavicku
+    return TRUE;
+}
+
+void C__TraceBin::CloseLogFile()
+{
+    if (View != NULL)
+    {
+        FlushViewOfFile(View, 0);
+        UnmapViewOfFile(View);
+        View = NULL;
+        Header = NULL;
+    }
+    if (Mapping != NULL)
+    {
+        CloseHandle(Mapping);
+        Mapping = NULL;
+    }
+    if (File != NULL)
+    {
+        CloseHandle(File);
+        File = NULL;
+    }
+}
+
+#endif // TRACE_BINLOG_ENABLE
+
 #endif // TRACE_ENABLE
 
 // pasticka na vlastni definici techto "zakazanych" operatoru (aby fungovala kontrola
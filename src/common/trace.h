@@ -6,6 +6,9 @@
 // makro TRACE_ENABLE - zapoji vypis hlasek na server
 // makro MULTITHREADED_TRACE_ENABLE - zapoji premapovavani TID na UTID
 // makro TRACE_TO_FILE - zapoji vypis hlasek do souboru v TEMPu (vyzaduje definici TRACE_ENABLE)
+// makro TRACE_BINLOG_ENABLE - hlasky TRACE_I/E/C se misto na server zapisuji bez zamykani do binarniho
+//                             logu v TEMPu (vyzaduje definici TRACE_ENABLE), log se prevadi na text
+//                             utilitkou tbldump; urceno pro trvale zapnuty trace i v release verzich
 // makro TRACE_IGNORE_AUTOCLEAR - zakaze Trace Serveru pri pripojeni tohoto procesu smazat vsechny zpravy,
 //                                i kdyz to ma zaple v nastaveni (hodi se pro utilitky spoustene za behu
 //                                hlavniho programu, u kterych je mazani zprav nezadouci)
@@ -414,6 +417,60 @@ struct C__PipeDataHeader
 // aktualni verze clientu (porovnava se s verzi serveru)
 #define TRACE_CLIENT_VERSION 7
 
+//****************************************************************************
+//
+// binarni log (TRACE_BINLOG_ENABLE)
+//
+// soubor: hlavicka C__TraceBinFileHeader (__TRACEBIN_HEADER_SIZE bajtu), oblast definic mist
+// volani (__TRACEBIN_SITES_SIZE bajtu, zaznamy __tbrSite za sebou) a kruhova oblast zprav
+// (__TRACEBIN_BLOCKS bloku po __TRACEBIN_BLOCK_SIZE bajtech); zaznam nikdy nepresahuje hranici
+// bloku, zbytek bloku se oznaci zaznamem s nulovou delkou, takze kazdy blok zacina zaznamem
+
+enum C__TraceBinRecordType
+{
+    __tbrInformation, // zprava TRACE_I
+    __tbrError,       // zprava TRACE_E nebo TRACE_C
+    __tbrSite,        // definice mista volani: DWORD cislo radky + jmeno souboru vcetne nuly
+    __tbrDropped,     // DWORD pocet zprav threadu zahozenych pro plny buffer
+};
+
+#define __TBF_UNICODE 0x01 // text zaznamu (jmeno souboru u __tbrSite) je v WCHARech
+
+#pragma pack(push, 4)
+struct C__TraceBinRecord
+{
+    WORD Size;       // velikost zaznamu vcetne hlavicky, zarovnana na 4 bajty
+    BYTE Type;       // C__TraceBinRecordType
+    BYTE Flags;      // __TBF_xxx
+    DWORD ThreadID;  // ID threadu, ktery zpravu poslal
+    DWORD SiteID;    // misto volani (viz __tbrSite), obdoba ID formatovaciho retezce
+    __int64 Counter; // QueryPerformanceCounter() pri vzniku zpravy
+};
+
+struct C__TraceBinFileHeader
+{
+    DWORD Signature;        // __TRACEBIN_SIGNATURE
+    DWORD Version;          // __TRACEBIN_VERSION
+    DWORD ProcessID;        // ID procesu, ktery log zapsal
+    DWORD SitesUsed;        // pocet pouzitych bajtu v oblasti definic mist volani
+    DWORD SitesDropped;     // pocet definic mist volani, ktere se do oblasti uz nevesly
+    __int64 WritePos;       // celkovy pocet bajtu zapsanych do kruhove oblasti zprav
+    __int64 PerfFrequency;  // QueryPerformanceFrequency()
+    __int64 StartCounter;   // QueryPerformanceCounter() v case StartTime
+    FILETIME StartTime;     // cas zalozeni logu (UTC)
+    WCHAR Module[MAX_PATH]; // modul (exe nebo dll), ktery log zapsal
+};
+#pragma pack(pop)
+
+#define __TRACEBIN_SIGNATURE 0x4C425453 // "STBL"
+#define __TRACEBIN_VERSION 2
+#define __TRACEBIN_HEADER_SIZE 4096
+#define __TRACEBIN_SITES_SIZE (1024 * 1024)
+#define __TRACEBIN_BLOCK_SIZE (64 * 1024)
+#define __TRACEBIN_BLOCKS 512 // 32 MB kruhove oblasti zprav
+#define __TRACEBIN_FILE_SIZE (__TRACEBIN_HEADER_SIZE + __TRACEBIN_SITES_SIZE + __TRACEBIN_BLOCK_SIZE * __TRACEBIN_BLOCKS)
+#define __TRACEBIN_MAX_TEXT 4000 // max. delka textu zpravy ve znacich, delsi se orizne
+
 #endif // defined(__TRACESERVER) || defined(TRACE_ENABLE)
 
 #ifndef TRACE_ENABLE
@@ -479,6 +536,17 @@ uintptr_t __TRACE_beginthreadex(void* security, unsigned stack_size,
 
 #endif // MULTITHREADED_TRACE_ENABLE
 
+#ifdef TRACE_BINLOG_ENABLE
+
+// info-trace, manualne zadana pozice v souboru
+#define TRACE_MI(file, line, str) \
+    (__TraceBin.BeginMessage() << str, __TraceBin).EndMessage(file, NULL, line, __tbrInformation)
+
+#define TRACE_MIW(file, line, str) \
+    (__TraceBin.BeginMessageW() << str, __TraceBin).EndMessage(NULL, file, line, __tbrInformation)
+
+#else // TRACE_BINLOG_ENABLE
+
 // info-trace, manualne zadana pozice v souboru
 #define TRACE_MI(file, line, str) \
     (::EnterCriticalSection(&__Trace.CriticalSection), __Trace.StoreLastError(), \
@@ -494,6 +562,8 @@ uintptr_t __TRACE_beginthreadex(void* security, unsigned stack_size,
         .SendMessageToServer(__mtInformationW) \
         .RestoreLastError()
 
+#endif // TRACE_BINLOG_ENABLE
+
 // info-trace
 #define TRACE_I(str) TRACE_MI(__FILE__, __LINE__, str)
 #define TRACE_IW(str) TRACE_MIW(__WFILE__, __LINE__, str)
@@ -502,6 +572,17 @@ uintptr_t __TRACE_beginthreadex(void* security, unsigned stack_size,
 #define TRACE_W(str) TRACE_I(str)
 #define TRACE_WW(str) TRACE_IW(str)
 
+#ifdef TRACE_BINLOG_ENABLE
+
+// error-trace, manualne zadana pozice v souboru
+#define TRACE_ME(file, line, str) \
+    (__TraceBin.BeginMessage() << str, __TraceBin).EndMessage(file, NULL, line, __tbrError)
+
+#define TRACE_MEW(file, line, str) \
+    (__TraceBin.BeginMessageW() << str, __TraceBin).EndMessage(NULL, file, line, __tbrError)
+
+#else // TRACE_BINLOG_ENABLE
+
 // error-trace, manualne zadana pozice v souboru
 #define TRACE_ME(file, line, str) \
     (::EnterCriticalSection(&__Trace.CriticalSection), __Trace.StoreLastError(), \
@@ -517,6 +598,8 @@ uintptr_t __TRACE_beginthreadex(void* security, unsigned stack_size,
         .SendMessageToServer(__mtErrorW) \
         .RestoreLastError()
 
+#endif // TRACE_BINLOG_ENABLE
+
 // error-trace
 #define TRACE_E(str) TRACE_ME(__FILE__, __LINE__, str)
 #define TRACE_EW(str) TRACE_MEW(__WFILE__, __LINE__, str)
@@ -530,6 +613,19 @@ uintptr_t __TRACE_beginthreadex(void* security, unsigned stack_size,
 // funkce, ze ktere volame TRACE_C/MC, nepouziva stary jednoduchy model ukladani
 // a prace s EBP/ESP (to zalezi na kompileru a zaplych optimalizacich), proto
 // aspon prozatim pouzivame stary primitivni zpusob crashe zapisem na NULL
+#ifdef TRACE_BINLOG_ENABLE
+
+// pred padem zpravu zapiseme az do souboru logu (viz C__TraceBin::EndMessage)
+#define TRACE_MC(file, line, str) \
+    ((__TraceBin.BeginMessage() << str, __TraceBin).EndMessage(file, NULL, line, __tbrError, TRUE), \
+     *((int*)NULL) = 0x666)
+
+#define TRACE_MCW(file, line, str) \
+    ((__TraceBin.BeginMessageW() << str, __TraceBin).EndMessage(NULL, file, line, __tbrError, TRUE), \
+     *((int*)NULL) = 0x666)
+
+#else // TRACE_BINLOG_ENABLE
+
 #define TRACE_MC(file, line, str) \
     ((::EnterCriticalSection(&__Trace.CriticalSection), __Trace.StoreLastError(), \
       __Trace.OStream() << str, __Trace) \
@@ -546,6 +642,8 @@ uintptr_t __TRACE_beginthreadex(void* security, unsigned stack_size,
          .RestoreLastError(), \
      *((int*)NULL) = 0x666)
 
+#endif // TRACE_BINLOG_ENABLE
+
 // fatal-error-trace (CRASHING TRACE)
 #define TRACE_C(str) TRACE_MC(__FILE__, __LINE__, str)
 #define TRACE_CW(str) TRACE_MCW(__WFILE__, __LINE__, str)
@@ -673,6 +771,64 @@ protected:
 
 extern C__Trace __Trace;
 
+#ifdef TRACE_BINLOG_ENABLE
+
+class C__TraceBinThread;
+struct C__TraceBinSite;
+
+// binarni log: kazdy thread sklada text zpravy ve vlastnim streamu a zaznam (cas, thread, druh,
+// misto volani, text) uklada do vlastniho kruhoveho bufferu bez zamykani; drain thread buffery
+// periodicky vybira a zapisuje do souboru namapovaneho do pameti (data preziji i pad procesu)
+class C__TraceBin
+{
+protected:
+    DWORD TlsIndex;                      // TLS index s ukazatelem na C__TraceBinThread aktualniho threadu
+    C__TraceBinThread* volatile Threads; // seznam dat threadu (pridava kazdy thread, odebira jen Drain)
+    C__TraceBinSite* Sites;              // tabulka mist volani celeho procesu (ID = index + 1)
+    volatile LONG DrainLock;             // 1 = prave bezi DrainBody (drain thread, TRACE_C, destruktor)
+    volatile LONG DrainThreadStarted;    // 1 = drain thread uz byl spusten
+    HANDLE StopEvent;                    // signalizuje drain threadu konec
+    BOOL Closed;                         // TRUE = log je zavreny (po destrukci), uz se nezapisuje
+
+    C__TraceStream NullStream;   // stream bez bufferu pro pripad, ze se nepodari alokovat data threadu
+    C__TraceStreamW NullStreamW; // totez pro unicode
+
+    HANDLE File;                   // soubor logu
+    HANDLE Mapping;                // mapovani souboru logu
+    char* View;                    // namapovany soubor logu, NULL = jeste neotevreny
+    C__TraceBinFileHeader* Header; // hlavicka v namapovanem souboru
+    BOOL OpenFailed;               // TRUE = soubor logu se nepodarilo otevrit, dalsi pokusy nedelame
+
+public:
+    C__TraceBin();
+    ~C__TraceBin();
+
+    C__TraceStream& BeginMessage();
+    C__TraceStreamW& BeginMessageW();
+
+    // ulozi zpravu slozenou ve streamu aktualniho threadu (file nebo fileW je jmeno souboru);
+    // je-li 'flush' TRUE, zapise zpravu hned do souboru (pred padem u TRACE_C)
+    C__TraceBin& EndMessage(const char* file, const WCHAR* fileW, int line, C__TraceBinRecordType type,
+                            BOOL flush = FALSE);
+
+protected:
+    C__TraceBinThread* GetThread(DWORD* lastError);
+    C__TraceBinSite* GetSite(const void* file, int line);
+    BOOL LockDrain(DWORD timeout);
+    void UnlockDrain();
+    void Drain(DWORD timeout); // zapise obsah bufferu threadu do souboru
+    void DrainBody();
+    void WriteRecord(const C__TraceBinRecord* rec);
+    BOOL OpenLogFile();
+    void CloseLogFile();
+
+    static DWORD WINAPI DrainThreadBody(void* param);
+};
+
+extern C__TraceBin __TraceBin;
+
+#endif // TRACE_BINLOG_ENABLE
+
 #endif // TRACE_ENABLE
 
 #define TRACE_MIT TRACE_MI
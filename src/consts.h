@@ -111,6 +111,7 @@ BOOL SalGetFileSize(HANDLE file, CQuadWord& size, DWORD& err);
 BOOL SalGetFileSize2(const char* fileName, CQuadWord& size, DWORD* err); // 'err' muze byt NULL pokud nas nezajima
 
 struct COperation;
+class COperations;
 
 // zjisti velikost souboru, na ktery vede symlink 'fileName'; je-li 'op' ruzne od NULL,
 // pri cancelu se vnitrek 'op' uvolni; je-li 'fileName' NULL, bere se 'op->SourceName';
@@ -125,6 +126,14 @@ struct COperation;
 BOOL GetLinkTgtFileSize(HWND parent, const char* fileName, COperation* op, CQuadWord* size,
                         BOOL* cancel, BOOL* ignoreAll);
 
+// streamovane Copy/Move (viz COperations::StartStreaming): zverejni workeru hotove operace
+// skriptu 'script' ('all' je TRUE = vsechny, jinak krome operaci, ktere se jeste mohou
+// vyhodit), pred prvnim zverejnenim zkontroluje volne misto na cilovem disku (pripadne se
+// zepta uzivatele s parentem 'parent') a po zverejneni prvnich operaci otevre progress
+// dialog a spusti worker; vraci FALSE pokud se ma stavba skriptu prerusit (uzivatel nechce
+// pokracovat, worker skoncil nebo ho nelze spustit)
+BOOL PublishStreamedScript(COperations* script, HWND parent, BOOL all);
+
 // protoze windowsova verze GetFileAttributes neumi pracovat se jmeny koncicimi mezerou/teckou,
 // napsali jsme si vlastni (u techto jmen pridava backslash na konec, cimz uz pak
 // GetFileAttributes funguje spravne, ovsem jen pro adresare, pro soubory s mezerou/teckou na
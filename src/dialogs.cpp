@@ -516,8 +516,13 @@ void CProgressDialog::SetDlgTitle(BOOL minimized)
         if (ShowPause)
             sprintf(buf, "(%d %%) %s", (int)((min(1000, SummaryProgress) /*+ 5*/) / 10), Caption); // nezaokrouhlujeme (100% musi byt az pri 100% a ne pri 99.5%)
         else
-            sprintf(buf, "(%s) %s", LoadStr(AutoPaused ? IDS_PROGDLGQUEUEPAUSED : IDS_PROGDLGPAUSED),
+        {
+            int resID = IDS_PROGDLGPAUSED;
+            if (AutoPaused) // cekame ve fronte, pripadne ukazeme, ze na uvolneni disku
+                resID = IsInQueue && OperationsQueue.IsWaitingForDisk(HWindow) ? IDS_PROGDLGDISKPAUSED : IDS_PROGDLGQUEUEPAUSED;
+            sprintf(buf, "(%s) %s", LoadStr(resID),
                     AutoPaused && Script != NULL && Script->WaitInQueueSubject != NULL ? Script->WaitInQueueSubject : Caption);
+        }
         char oldCaption[200];
         ::GetWindowText(HWindow, oldCaption, 200);
         oldCaption[199] = 0;
@@ -646,7 +651,8 @@ CProgressDialog::DialogProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
             break;
         }
         BOOL startPaused = FALSE;
-        if (Script->IsCopyOrMoveOperation && OperationsQueue.AddOperation(HWindow, Script->StartOnIdle, &startPaused))
+        if (Script->IsCopyOrMoveOperation && OperationsQueue.AddOperation(HWindow, Script->StartOnIdle, Script->SrcSpinningDisk,
+                                                                          Script->TgtSpinningDisk, &startPaused))
         {
             IsInQueue = TRUE;
             if (startPaused)
@@ -935,11 +941,11 @@ CProgressDialog::DialogProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
                 char num2[100];
                 if (Script != NULL)
                 {
-                    CQuadWord transferredFileSize, transferSpeed, progressSize, progressSpeed;
+                    CQuadWord transferredFileSize, transferSpeed, progressSize, progressSpeed, unchangedFileSize;
                     BOOL useSpeedLimit;
                     DWORD speedLimit;
                     Script->GetStatus(&transferredFileSize, &transferSpeed, &progressSize, &progressSpeed,
-                                      &useSpeedLimit, &speedLimit);
+                                      &useSpeedLimit, &speedLimit, &unchangedFileSize);
 
                     if (!Script->FastMoveUsed)
                     {
@@ -952,6 +958,12 @@ CProgressDialog::DialogProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
                         }
                         else
                             strcpy(buf, num1);
+                        if (unchangedFileSize.Value > 0) // delta kopirovani: kolik dat uz cil obsahoval (nezapisovalo se)
+                        {
+                            PrintDiskSize(num1, unchangedFileSize, 4);
+                            int len = (int)strlen(buf);
+                            sprintf(buf + len, LoadStr(IDS_PROGDLGSTATUSUNCHANGED), num1);
+                        }
                     }
                     int len = (int)strlen(buf);
 
@@ -974,7 +986,8 @@ CProgressDialog::DialogProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
                     }
 
                     DWORD ti = GetTickCount();
-                    if (!StatusPaused && ShowPause && progressSpeed.Value > 0 && Script->TotalSize > progressSize)
+                    CQuadWord totalSize = Script->GetTotalSize(); // pri streamovani ho worker prubezne meni
+                    if (!StatusPaused && ShowPause && progressSpeed.Value > 0 && totalSize > progressSize)
                     {
                         if (len > 0)
                         {
@@ -982,7 +995,7 @@ CProgressDialog::DialogProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
                             buf[len++] = ' ';
                         }
 
-                        CQuadWord secs = (Script->TotalSize - progressSize) / progressSpeed; // odhad zbyvajicich sekund
+                        CQuadWord secs = (totalSize - progressSize) / progressSpeed; // odhad zbyvajicich sekund
                                                                                              /*
               SYSTEMTIME st;
               GetLocalTime(&st);
@@ -1207,6 +1220,8 @@ MENU_TEMPLATE_ITEM ProgressDialogMenu2[] =
             if (!IsWindowEnabled(HWindow)) // nad dialogem je nejaky modalni dialog (messagebox s dotazem na cancel operace nebo s chybou operace)
                 CloseAllOwnedEnabledDialogs(HWindow);
             CancelWorker = TRUE; // nastavime cancel workera
+            if (Script != NULL)
+                Script->AbortStreaming(); // streamovane Copy/Move: worker muze cekat na dalsi operace skriptu
             EnableWindow(GetDlgItem(HWindow, IDB_PAUSERESUME), FALSE);
             if (WorkerNotSuspended != NULL)
                 SetEvent(WorkerNotSuspended); // aby probehl Cancel i po stisku Pause
@@ -1363,6 +1378,8 @@ MENU_TEMPLATE_ITEM ProgressDialogMenu2[] =
                 if (ret == IDYES)
                 {
                     CancelWorker = TRUE; // nastavime cancel workera
+                    if (Script != NULL)
+                        Script->AbortStreaming(); // streamovane Copy/Move: worker muze cekat na dalsi operace skriptu
                     EnableWindow(GetDlgItem(HWindow, IDB_PAUSERESUME), FALSE);
                 }
                 else
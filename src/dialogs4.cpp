@@ -300,6 +300,12 @@ CConfiguration::CConfiguration()
     UseSalOpen = FALSE;
     NetwareFastDirMove = FALSE; // volime pomalejsi ale 100% funkcni rezim, fajnsmekri si to muzou prepnout
     UseAsyncCopyAlg = TRUE;
+    ConcurrentSmallCopy = TRUE;
+    StreamingCopy = FALSE;
+    VerifyCopy = FALSE;
+    CopyChecksumManifest = FALSE;
+    DeltaCopy = FALSE;
+    ParallelDelete = TRUE;
     ReloadEnvVariables = TRUE;
     QuickRenameSelectAll = FALSE;
     EditNewSelectAll = TRUE;
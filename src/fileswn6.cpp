@@ -221,6 +221,36 @@ BOOL CFilesWindow::MakeFileList(HANDLE hFile)
     return ret;
 }
 
+BOOL PublishStreamedScript(COperations* script, HWND parent, BOOL all)
+{
+    CALL_STACK_MESSAGE2("PublishStreamedScript(, , %d)", all);
+    if (!script->StreamSpaceChecked && script->BytesPerCluster != 0 && // mame informace o disku
+        script->TotalFileSize > script->FreeSpace)
+    { // na nedostatek mista se ptame jen jednou, soucet velikosti souboru behem stavby jen roste
+        script->StreamSpaceChecked = TRUE;
+        char buf1[50];
+        char buf2[50];
+        char buf3[200];
+        sprintf(buf3, LoadStr(IDS_NOTENOUGHSPACE), NumberToStr(buf1, script->TotalFileSize),
+                NumberToStr(buf2, script->FreeSpace));
+        if (SalMessageBox(parent, buf3, script->StreamCaption,
+                          MB_YESNO | MB_ICONQUESTION | MSGBOXEX_ESCAPEENABLED) != IDYES)
+        {
+            return FALSE;
+        }
+        UpdateWindow(MainWindow->HWindow);
+    }
+    if (!script->PublishOps(all))
+        return FALSE; // worker uz skoncil (cancel, chyba)
+    if (!script->StreamDlgStarted && script->GetPublishedCount() > 0)
+    {
+        if (!StartProgressDialog(script, script->StreamCaption, NULL, NULL))
+            return FALSE;
+        script->StreamDlgStarted = TRUE; // od ted skript uvolni worker
+    }
+    return TRUE;
+}
+
 DWORD GetPathFlagsForCopyOp(const char* path, DWORD netFlag, DWORD fixedFlag)
 {
     if (IsUNCPath(path))
@@ -618,6 +648,7 @@ BOOL CFilesWindow::BuildScriptMain2(COperations* script, BOOL copy, char* target
     BOOL targetSupADS = IsPathOnVolumeSupADS(targetPath, &targetIsFAT32);
     script->TargetPathSupADS = targetSupADS;
     DWORD srcAndTgtPathsFlags = GetPathFlagsForCopyOp(targetPath, OPFL_TGTPATH_IS_NET, OPFL_TGTPATH_IS_FAST);
+    script->TgtSpinningDisk = GetPathSpinningDisk(targetPath);
     //  script->TargetPathSupEFS = targetSupEFS;
     CTargetPathState targetPathState = GetTargetPathState(tpsUnknown, targetPath);
     char* targetName = targetPath + strlen(targetPath);
@@ -657,6 +688,8 @@ BOOL CFilesWindow::BuildScriptMain2(COperations* script, BOOL copy, char* target
                     sourceSupADS = IsPathOnVolumeSupADS(lastSourcePath, NULL);
                     srcAndTgtPathsFlags &= ~(OPFL_SRCPATH_IS_NET | OPFL_SRCPATH_IS_FAST);
                     srcAndTgtPathsFlags |= GetPathFlagsForCopyOp(lastSourcePath, OPFL_SRCPATH_IS_NET, OPFL_SRCPATH_IS_FAST);
+                    if (script->SrcSpinningDisk == -1) // pro frontu operaci staci disk prvniho zdrojoveho adresare (obvykle je jen jeden)
+                        script->SrcSpinningDisk = GetPathSpinningDisk(lastSourcePath);
                     lastSourcePath[s - fileName] = 0;
                 }
                 if (IsTheSamePath(sourcePath, targetPath) && // "Copy of..." se dela jen pri shode cest
@@ -1080,6 +1113,7 @@ void CFilesWindow::DropCopyMove(BOOL copy, char* targetPath, CCopyMoveData* data
             // pripravime refresh neautomaticky refreshovanych adresaru
             // zmena v cilovem adresari a v jeho podadresarich
             script->SetWorkPath1(targetPath, TRUE);
+            script->SetTargetPath(targetPath);
             if (!copy) // move operace meni i zdroj operace
             {
                 if (data->Count > 0)
@@ -1253,6 +1287,8 @@ BOOL CFilesWindow::BuildScriptMain(COperations* script, CActionType type,
         srcAndTgtPathsFlags |= GetPathFlagsForCopyOp(sourcePath, OPFL_SRCPATH_IS_NET, OPFL_SRCPATH_IS_FAST) |
                                GetPathFlagsForCopyOp(targetPath, OPFL_TGTPATH_IS_NET, OPFL_TGTPATH_IS_FAST);
         script->SourcePathIsNetwork = (srcAndTgtPathsFlags & OPFL_SRCPATH_IS_NET) != 0;
+        script->SrcSpinningDisk = GetPathSpinningDisk(sourcePath);
+        script->TgtSpinningDisk = GetPathSpinningDisk(targetPath);
 
         if (filterCriteria != NULL)
         {
@@ -1278,6 +1314,11 @@ BOOL CFilesWindow::BuildScriptMain(COperations* script, CActionType type,
             }
         }
     }
+    else if (type == atDelete) // pro pocet pomocnych threadu pri mazani (viz CParallelDeleter)
+    {
+        script->SourcePathIsNetwork = IsNetworkPath(sourcePath);
+        script->SrcSpinningDisk = GetPathSpinningDisk(sourcePath);
+    }
 
     BOOL subDirectories = ((type != atChangeCase) || chCaseData->SubDirs) && type != atConvert;
     BOOL countSize = (type == atCountSize);
@@ -1425,9 +1466,12 @@ BOOL CFilesWindow::BuildScriptMain(COperations* script, CActionType type,
     }
 
     SetCurrentDirectoryToSystem();
-    int i;
-    for (i = 0; i < script->Count; i++)
-        script->TotalSize += script->At(i).Size;
+    if (!script->Streaming) // pri streamovani pricita velikosti operaci COperations::PublishOps()
+    {
+        int i;
+        for (i = 0; i < script->Count; i++)
+            script->TotalSize += script->At(i).Size;
+    }
     return TRUE;
 }
 
@@ -2187,6 +2231,9 @@ MENU_TEMPLATE_ITEM MsgBoxButtons[] =
                         if (res == IDYES)
                             goto BUILD_ERROR;
                     }
+                    // pri streamovanem Copy/Move predame workeru dalsi hotove operace
+                    if (script->Streaming && !PublishStreamedScript(script, HWindow, FALSE))
+                        goto BUILD_ERROR;
 
                     LastTickCount = GetTickCount();
                 }
@@ -2325,9 +2372,7 @@ MENU_TEMPLATE_ITEM MsgBoxButtons[] =
         filterCriteria->SkipEmptyDirs && createDirIndex >= 0 &&
         createDirIndex == script->Count - 1)
     {
-        free(script->At(createDirIndex).SourceName);
-        free(script->At(createDirIndex).TargetName);
-        script->Delete(createDirIndex);
+        script->Delete(createDirIndex); // uvolni i jmena operace
         if (!script->IsGood())
             script->ResetState();
         // pokud se skipuje tento adresar, nelze smazat ani nadrazeny adresar
@@ -2346,7 +2391,8 @@ MENU_TEMPLATE_ITEM MsgBoxButtons[] =
             op.OpFlags = 0;
             op.Size = CHATTRS_FILE_SIZE;
             op.SourceName = sourceDirTime != NULL ? (char*)(DWORD_PTR)sourceDirTime->dwLowDateTime : NULL;
-            op.TargetName = DupStr(script->At(createDirIndex).TargetName);
+            COperationBuf crDir;
+            op.TargetName = DupStr(script->GetOp(createDirIndex, &crDir)->TargetName);
             if (op.TargetName == NULL)
                 return FALSE;
             op.Attr = sourceDirTime != NULL ? sourceDirTime->dwHighDateTime : 0;
@@ -1019,12 +1019,36 @@ void CFilesWindow::FilesAction(CActionType type, CFilesWindow* target, int count
 
                     char* auxTargetPath = NULL;
                     if (type == atCopy || type == atMove)
+                    {
                         auxTargetPath = path;
+                        script->SetTargetPath(path);
+                        // streamovane Copy/Move: worker zacne kopirovat uz behem stavby skriptu,
+                        // adresare pro refresh proto nastavime predem (worker je muze pouzit kdykoliv)
+                        if (Configuration.StreamingCopy && script->StartStreaming(caption))
+                        {
+                            script->SetWorkPath1(type == atCopy ? path : GetPath(), TRUE);
+                            if (type == atMove)
+                                script->SetWorkPath2(path, TRUE);
+                        }
+                    }
                     BOOL res2 = BuildScriptMain(script, type, auxTargetPath, mask, count, indexes,
                                                 f, NULL, &changeCaseData, countSizeMode != 0,
                                                 criteriaPtr);
                     // pokud neni co delat, nebudeme vybalovat progress dialog
                     BOOL emptyScript = script->Count == 0 && type != atCountSize;
+                    BOOL streamed = FALSE; // TRUE = worker uz bezi, skript uz nesmime pouzivat (uvolni ho worker)
+                    if (script->Streaming)
+                    {
+                        streamed = script->StreamDlgStarted;
+                        if (streamed)
+                        {
+                            if (res2)
+                                res2 = PublishStreamedScript(script, HWindow, TRUE);
+                        }
+                        else
+                            script->PublishOps(TRUE); // worker jeste nebezi, zbytek probehne jako bez streamovani
+                        script->EndStreaming(res2);
+                    }
 
                     // prohozeno kvuli umozneni aktivace hlavniho okna (nesmi byt disable), jinak prepina do jine app
                     EnableWindow(MainWindow->HWindow, TRUE);
@@ -1054,7 +1078,8 @@ void CFilesWindow::FilesAction(CActionType type, CFilesWindow* target, int count
                     SetCursor(oldCur);
 
                     BOOL cancel = FALSE;
-                    if (!emptyScript && res2 && (type == atCopy || type == atMove))
+                    if (!streamed && !emptyScript && res2 && (type == atCopy || type == atMove) &&
+                        !script->StreamSpaceChecked) // pri streamovani uz se uzivatel mohl vyjadrit
                     {
                         BOOL occupiedSpTooBig = script->OccupiedSpace != CQuadWord(0, 0) &&
                                                 script->BytesPerCluster != 0 && // mame informace o disku
@@ -1079,7 +1104,7 @@ void CFilesWindow::FilesAction(CActionType type, CFilesWindow* target, int count
                     if (!cancel)
                     {
                         // pripravime refresh neautomaticky refreshovanych adresaru
-                        if (!emptyScript && type != atCountSize)
+                        if (!streamed && !emptyScript && type != atCountSize)
                         {
                             if (type == atDelete || type == atChangeCase || type == atMove)
                             {
@@ -1098,7 +1123,7 @@ void CFilesWindow::FilesAction(CActionType type, CFilesWindow* target, int count
                             }
                         }
 
-                        if (!emptyScript &&
+                        if (!streamed && !emptyScript &&
                             (!res2 || type == atCountSize ||
                              !StartProgressDialog(script, caption, NULL, NULL)))
                         {
@@ -674,7 +674,7 @@ BOOL CFindIgnore::Set(int index, BOOL enabled, const char* path)
 class CDuplicateCandidates : public TIndirectArray<CFoundFilesData>
 {
 public:
-    CDuplicateCandidates() : TIndirectArray<CFoundFilesData>(2000, 4000) {}
+    CDuplicateCandidates() : TIndirectArray<CFoundFilesData>(2000, 4000) { SetGrowth(agGeometric); }
 
     // - [nacteni/vypocet MD5 digestu]
     // - vyrazeni single souboru
@@ -417,6 +417,12 @@ const char* CONFIG_SAVECMDLINEHISTORY_REG = "Save CmdLine History";
 const char* CONFIG_USESALOPEN_REG = "Use salopen.exe";
 const char* CONFIG_NETWAREFASTDIRMOVE_REG = "Netware Fast Dir Move";
 const char* CONFIG_ASYNCCOPYALG_REG = "Async Copy Alg On Network";
+const char* CONFIG_CONCURRENTSMALLCOPY_REG = "Concurrent Small Files Copy";
+const char* CONFIG_STREAMINGCOPY_REG = "Streaming Copy";
+const char* CONFIG_VERIFYCOPY_REG = "Verify Copied Files";
+const char* CONFIG_COPYCHECKSUMMANIFEST_REG = "Copy Checksum Manifest";
+const char* CONFIG_DELTACOPY_REG = "Delta Copy Of Large Files";
+const char* CONFIG_PARALLELDELETE_REG = "Parallel Delete";
 const char* CONFIG_RELOAD_ENV_VARS_REG = "Reload Environment Variables";
 const char* CONFIG_QUICKRENAME_SELALL_REG = "Quick Rename Select All";
 const char* CONFIG_EDITNEW_SELALL_REG = "Edit New File Select All";
@@ -1821,6 +1827,18 @@ void CMainWindow::SaveConfig(HWND parent)
                 if (Windows7AndLater)
                     SetValue(actKey, CONFIG_ASYNCCOPYALG_REG, REG_DWORD,
                              &Configuration.UseAsyncCopyAlg, sizeof(DWORD));
+                SetValue(actKey, CONFIG_CONCURRENTSMALLCOPY_REG, REG_DWORD,
+                         &Configuration.ConcurrentSmallCopy, sizeof(DWORD));
+                SetValue(actKey, CONFIG_STREAMINGCOPY_REG, REG_DWORD,
+                         &Configuration.StreamingCopy, sizeof(DWORD));
+                SetValue(actKey, CONFIG_VERIFYCOPY_REG, REG_DWORD,
+                         &Configuration.VerifyCopy, sizeof(DWORD));
+                SetValue(actKey, CONFIG_COPYCHECKSUMMANIFEST_REG, REG_DWORD,
+                         &Configuration.CopyChecksumManifest, sizeof(DWORD));
+                SetValue(actKey, CONFIG_DELTACOPY_REG, REG_DWORD,
+                         &Configuration.DeltaCopy, sizeof(DWORD));
+                SetValue(actKey, CONFIG_PARALLELDELETE_REG, REG_DWORD,
+                         &Configuration.ParallelDelete, sizeof(DWORD));
                 SetValue(actKey, CONFIG_RELOAD_ENV_VARS_REG, REG_DWORD,
                          &Configuration.ReloadEnvVariables, sizeof(DWORD));
                 SetValue(actKey, CONFIG_QUICKRENAME_SELALL_REG, REG_DWORD,
@@ -3350,6 +3368,18 @@ BOOL CMainWindow::LoadConfig(BOOL importingOldConfig, const CCommandLineParams*
             if (Windows7AndLater)
                 GetValue(actKey, CONFIG_ASYNCCOPYALG_REG, REG_DWORD,
                          &Configuration.UseAsyncCopyAlg, sizeof(DWORD));
+            GetValue(actKey, CONFIG_CONCURRENTSMALLCOPY_REG, REG_DWORD,
+                     &Configuration.ConcurrentSmallCopy, sizeof(DWORD));
+            GetValue(actKey, CONFIG_STREAMINGCOPY_REG, REG_DWORD,
+                     &Configuration.StreamingCopy, sizeof(DWORD));
+            GetValue(actKey, CONFIG_VERIFYCOPY_REG, REG_DWORD,
+                     &Configuration.VerifyCopy, sizeof(DWORD));
+            GetValue(actKey, CONFIG_COPYCHECKSUMMANIFEST_REG, REG_DWORD,
+                     &Configuration.CopyChecksumManifest, sizeof(DWORD));
+            GetValue(actKey, CONFIG_DELTACOPY_REG, REG_DWORD,
+                     &Configuration.DeltaCopy, sizeof(DWORD));
+            GetValue(actKey, CONFIG_PARALLELDELETE_REG, REG_DWORD,
+                     &Configuration.ParallelDelete, sizeof(DWORD));
             GetValue(actKey, CONFIG_RELOAD_ENV_VARS_REG, REG_DWORD,
                      &Configuration.ReloadEnvVariables, sizeof(DWORD));
             GetValue(actKey, CONFIG_SHIFTFORHOTPATHS_REG, REG_DWORD,
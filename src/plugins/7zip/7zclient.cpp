@@ -59,6 +59,7 @@ char *C7zClient::CItemData::GetMethodStr() {
 C7zClient::CItemData::CItemData()
 {
     Method = NULL;
+    Block = SOLID_BLOCK_NONE;
 }
 
 C7zClient::CItemData::~CItemData()
@@ -79,10 +80,15 @@ void C7zClient::CItemData::SetMethod(const char* method)
 
 C7zClient::C7zClient()
 {
+    SolidArchive = FALSE;
+    SolidCacheDir[0] = 0;
+    SolidCacheSize = 0;
 }
 
 C7zClient::~C7zClient()
 {
+    if (SolidCacheDir[0] != 0)
+        SalamanderGeneral->RemoveTemporaryDir(SolidCacheDir);
 }
 
 BOOL C7zClient::CreateObject(const GUID* interfaceID, void** object)
@@ -144,6 +150,11 @@ BOOL C7zClient::ListArchive(const char* fileName, CSalamanderDirectoryAbstract*
     if (!OpenArchive(fileName, &inArchive, password))
         return FALSE;
 
+    // solid archiv -> soubory si pamatuji cislo bloku pro cache solid bloku
+    NWindows::NCOM::CPropVariant propVariant;
+    SolidArchive = inArchive->GetArchiveProperty(kpidSolid, &propVariant) == S_OK && propVariant.vt == VT_BOOL &&
+                   VARIANT_BOOLToBool(propVariant.boolVal);
+
     UINT32 numItems = 0;
     inArchive->GetNumberOfItems(&numItems);
     UINT32 i;
@@ -191,6 +202,12 @@ BOOL C7zClient::FillItemData(IInArchive* archive, UINT32 index, C7zClient::CItem
     else
         itemData->SetMethod(GetAnsiString(propVariant.bstrVal));
 
+    // solid blok, ve kterem soubor lezi (prazdne soubory a adresare v zadnem nelezi)
+    if (SolidArchive && archive->GetProperty(index, kpidBlock, &propVariant) == S_OK && propVariant.vt == VT_UI4)
+        itemData->Block = propVariant.ulVal;
+    else
+        itemData->Block = SOLID_BLOCK_NONE;
+
     /*  // 06F10701 je id pro 7zAES -> cili heslo :)
 //  if (strstr(itemData->Method, "06F10701") != NULL)
   if (strstr(itemData->Method, "7zAES") != NULL)
@@ -428,35 +445,192 @@ int C7zClient::Decompress(CSalamanderForOperationsAbstract* salamander, const ch
                 TRACE_I("C7zClient::Decompress(): PluginData == NULL (to by se nemelo stat!)");
         }
 
-        // setup callback
-        CExtractCallbackImp* extractCallbackSpec = new CExtractCallbackImp(salamander->ProgressGetHWND(), password, itemsToExtract /*, fileIndex, count*/);
-        if (extractCallbackSpec == NULL)
+        ret = ExtractItems(salamander, inArchive, outDir, itemsToExtract, fileIndex, count, password, silentDelete);
+    }
+    catch (int e)
+    {
+        ret = e;
+    }
+
+    delete[] fileIndex;
+
+    return ret;
+} /* C7zClient::Decompress */
+
+// vybali polozky 'itemsToExtract' (indexy v 'fileIndex') z otevreneho archivu do 'outDir';
+// je-li 'numErrors' != NULL, chyby jednotlivych souboru se nehlasi, jen se v nem vraci jejich pocet
+int C7zClient::ExtractItems(CSalamanderForOperationsAbstract* salamander, IInArchive* inArchive, const char* outDir,
+                            ItemsToExtractMap& itemsToExtract, UINT32* fileIndex, int count, UString& password,
+                            BOOL silentDelete, int* numErrors)
+{
+    // setup callback
+    CExtractCallbackImp* extractCallbackSpec = new CExtractCallbackImp(salamander->ProgressGetHWND(), password, itemsToExtract /*, fileIndex, count*/);
+    if (extractCallbackSpec == NULL)
+    {
+        Error(IDS_INSUFFICIENT_MEMORY);
+        return OPER_CANCEL;
+    }
+    CMyComPtr<IArchiveExtractCallback> extractCallback(extractCallbackSpec);
+
+    FILETIME ft;
+    extractCallbackSpec->Init(inArchive, outDir /*,&archiveItems*/, ft, 0, silentDelete);
+    extractCallbackSpec->SetQuiet(numErrors != NULL);
+    qsort(fileIndex, count, sizeof(fileIndex[0]), compare);
+
+    // spustit vybalovani ve vlakne
+    // tahle silenost je tu kvuli tomu, ze 7za.dll je multi-threadovy a nesly zobrazovat nase message boxy
+    CDecompressParamObject dpo;
+    dpo.Archive = inArchive;
+    dpo.FileIndex = fileIndex;
+    dpo.Count = count;
+    dpo.Test = FALSE;
+    dpo.Callback = extractCallback;
+
+    HRESULT result = DoDecompress(salamander, &dpo);
+
+    int ret = (result == E_ABORT) ? OPER_CANCEL : ((result == S_OK) ? OPER_OK : OPER_CONTINUE);
+
+    // kontrolujeme navratovy kod vlakna
+    if (ret == OPER_CANCEL)
+        extractCallbackSpec->Cleanup();
+    if (numErrors != NULL)
+        *numErrors = extractCallbackSpec->NumErrors;
+
+    return ret;
+} /* C7zClient::ExtractItems */
+
+// vybali vsechny soubory solid bloku 'block' do SolidCacheDir\<index>\<jmeno>; vraci OPER_CONTINUE,
+// pokud se blok do cache nevejde nebo se nevyplati (obsahuje jen jeden soubor) nebo pokud se
+// nektery jeho soubor nevybalil bez chyby (chyby se nehlasi, soubory bloku se pak vybaluji primo
+// a chybu ohlasi az vybalovani souboru, ktery chce uzivatel videt)
+int C7zClient::StageSolidBlock(CSalamanderForOperationsAbstract* salamander, const char* archiveName, UINT32 block,
+                               UString& password)
+{
+    CMyComPtr<IInArchive> inArchive;
+
+    if (!OpenArchive(archiveName, &inArchive, password))
+        return OPER_CANCEL;
+
+    UINT32 numItems = 0;
+    inArchive->GetNumberOfItems(&numItems);
+
+    TIndirectArray<CFileData> fileData(100, 100, dtDelete);
+    TIndirectArray<CArchiveItemInfo> items(100, 100, dtDelete);
+    ItemsToExtractMap itemsToExtract;
+    UINT32* fileIndex = NULL;
+    UINT64 blockSize = 0;
+    int ret = OPER_OK;
+
+    try
+    {
+        // posbirat soubory bloku
+        UINT32 i;
+        for (i = 0; i < numItems; i++)
         {
-            Error(IDS_INSUFFICIENT_MEMORY);
-            return OPER_CANCEL;
-        }
-        CMyComPtr<IArchiveExtractCallback> extractCallback(extractCallbackSpec);
+            NWindows::NCOM::CPropVariant propVariant;
+            if (inArchive->GetProperty(i, kpidBlock, &propVariant) != S_OK || propVariant.vt != VT_UI4 ||
+                propVariant.ulVal != block)
+                continue;
+            inArchive->GetProperty(i, kpidIsDir, &propVariant);
+            if (VARIANT_BOOLToBool(propVariant.boolVal))
+                continue;
 
-        FILETIME ft;
-        extractCallbackSpec->Init(inArchive, outDir /*,&archiveItems*/, ft, 0, silentDelete);
-        qsort(fileIndex, count, sizeof(fileIndex[0]), compare);
+            CFileData* fd = new CFileData;
+            if (fd == NULL)
+            {
+                Error(IDS_INSUFFICIENT_MEMORY);
+                throw OPER_CANCEL;
+            }
+            memset(fd, 0, sizeof(CFileData));
+            fileData.Add(fd);
+
+            inArchive->GetProperty(i, kpidSize, &propVariant);
+            ::ConvertPropVariantToUInt64(propVariant, fd->Size.Value);
+            inArchive->GetProperty(i, kpidMTime, &propVariant);
+            fd->LastWrite = propVariant.filetime;
+            inArchive->GetProperty(i, kpidAttrib, &propVariant);
+            fd->Attr = propVariant.ulVal;
+            if (fd->Attr & FILE_ATTRIBUTE_UNIX_EXTENSION)
+                fd->Attr &= 0xFFFF; // Get rid of st_mode
+            blockSize += fd->Size.Value;
+
+            // kazdy soubor do vlastniho podadresare, jmena v bloku se mohou opakovat
+            inArchive->GetProperty(i, kpidPath, &propVariant);
+            CSysString path = GetAnsiString(propVariant.bstrVal);
+            int slash = path.ReverseFind('\\');
+            char name[MAX_PATH];
+            _snprintf_s(name, _TRUNCATE, "%u\\%s", i, (LPCTSTR)path + slash + 1);
+
+            CArchiveItemInfo* aii = new CArchiveItemInfo(name, fd, FALSE);
+            if (aii == NULL)
+            {
+                Error(IDS_INSUFFICIENT_MEMORY);
+                throw OPER_CANCEL;
+            }
+            items.Add(aii);
+            try
+            {
+                itemsToExtract[i] = aii;
+            }
+            catch (const std::bad_alloc&)
+            {
+                Error(IDS_INSUFFICIENT_MEMORY);
+                throw OPER_CANCEL;
+            }
+        }
 
-        // spustit vybalovani ve vlakne
-        // tahle silenost je tu kvuli tomu, ze 7za.dll je multi-threadovy a nesly zobrazovat nase message boxy
-        CDecompressParamObject dpo;
-        dpo.Archive = inArchive;
-        dpo.FileIndex = fileIndex;
-        dpo.Count = count;
-        dpo.Test = FALSE;
-        dpo.Callback = extractCallback;
+        // blok s jednim souborem se vybali primo, velky blok by zbytecne dlouho zdrzoval prvni pristup
+        if (items.Count < 2 || blockSize > SOLID_CACHE_MAX_BLOCK_SIZE || SolidCacheSize + blockSize > SOLID_CACHE_MAX_SIZE)
+            throw OPER_CONTINUE;
 
-        HRESULT result = DoDecompress(salamander, &dpo);
+        if (SolidCacheDir[0] == 0)
+        {
+            DWORD err;
+            if (!SalamanderGeneral->SalGetTempFileName(NULL, "7zc", SolidCacheDir, FALSE, &err))
+            {
+                SolidCacheDir[0] = 0;
+                throw OPER_CONTINUE;
+            }
+        }
 
-        ret = (result == E_ABORT) ? OPER_CANCEL : ((result == S_OK) ? OPER_OK : OPER_CONTINUE);
+        // do tempu nechceme vybalovat, kdyz by po nem zbylo malo mista
+        CQuadWord freeSpace;
+        SalamanderGeneral->GetDiskFreeSpace(&freeSpace, SolidCacheDir, NULL);
+        if (freeSpace == CQuadWord(-1, -1) || freeSpace.Value < 2 * blockSize)
+            throw OPER_CONTINUE;
 
-        // kontrolujeme navratovy kod vlakna
-        if (ret == OPER_CANCEL)
-            extractCallbackSpec->Cleanup();
+        fileIndex = new UINT32[items.Count];
+        if (fileIndex == NULL)
+        {
+            Error(IDS_INSUFFICIENT_MEMORY);
+            throw OPER_CANCEL;
+        }
+        int count = 0;
+        ItemsToExtractMap::iterator it;
+        for (it = itemsToExtract.begin(); it != itemsToExtract.end(); ++it)
+            fileIndex[count++] = it->first;
+
+        int numErrors = 0;
+        ret = ExtractItems(salamander, inArchive, SolidCacheDir, itemsToExtract, fileIndex, count, password, TRUE, &numErrors);
+        if (ret == OPER_OK && numErrors > 0)
+            ret = OPER_CONTINUE;
+        if (ret == OPER_OK)
+            SolidCacheSize += blockSize;
+        else
+        {
+            // v cache nesmi zustat poskozene ani castecne vybalene soubory bloku ('itemsToExtract'
+            // uz je vyprazdnene, vybalene polozky z nej callback odebira)
+            for (i = 0; i < (UINT32)items.Count; i++)
+            {
+                char name[MAX_PATH];
+                if (_snprintf_s(name, _TRUNCATE, "%s\\%s", SolidCacheDir, (const char*)items[i]->NameInArchive) < 0)
+                    continue;
+                SetFileAttributes(name, FILE_ATTRIBUTE_NORMAL);
+                DeleteFile(name);
+                *strrchr(name, '\\') = 0;
+                RemoveDirectory(name);
+            }
+        }
     }
     catch (int e)
     {
@@ -466,7 +640,49 @@ int C7zClient::Decompress(CSalamanderForOperationsAbstract* salamander, const ch
     delete[] fileIndex;
 
     return ret;
-} /* C7zClient::Decompress */
+} /* C7zClient::StageSolidBlock */
+
+int C7zClient::DecompressFromSolidCache(CSalamanderForOperationsAbstract* salamander, const char* archiveName,
+                                        const char* outDir, const CFileData* fileData, UString& password)
+{
+    CItemData* id = (CItemData*)fileData->PluginData;
+    // desifrovany obsah celeho bloku do tempu nevybalujeme
+    if (id == NULL || id->Block == SOLID_BLOCK_NONE || id->Encrypted)
+        return OPER_CONTINUE;
+
+    std::map<UINT32, BOOL>::iterator it = SolidCacheBlocks.find(id->Block);
+    if (it == SolidCacheBlocks.end())
+    {
+        int ret = StageSolidBlock(salamander, archiveName, id->Block, password);
+        try
+        {
+            // neuspesny nebo preruseny blok uz znovu nezkousime, soubory z nej se vybaluji primo
+            it = SolidCacheBlocks.insert(std::make_pair(id->Block, (BOOL)(ret == OPER_OK))).first;
+        }
+        catch (const std::bad_alloc&)
+        {
+            return OPER_CONTINUE;
+        }
+        if (ret == OPER_CANCEL)
+            return OPER_CANCEL;
+    }
+    if (!it->second)
+        return OPER_CONTINUE;
+
+    char srcName[MAX_PATH];
+    char tgtName[MAX_PATH];
+    if (_snprintf_s(srcName, _TRUNCATE, "%s\\%u\\%s", SolidCacheDir, id->Idx, fileData->Name) < 0)
+        return OPER_CONTINUE;
+    lstrcpyn(tgtName, outDir, MAX_PATH);
+    if (!SalamanderGeneral->SalPathAppend(tgtName, fileData->Name, MAX_PATH))
+        return OPER_CONTINUE;
+
+    // soubor se mohl pri vybalovani bloku poskodit (data error) -> vybalit primo
+    // kopirujeme (ne hard-link), cil muze uzivatel editovat a cache musi zustat netknuta
+    if (GetFileAttributes(srcName) == INVALID_FILE_ATTRIBUTES || !CopyFile(srcName, tgtName, FALSE))
+        return OPER_CONTINUE;
+    return OPER_OK;
+} /* C7zClient::DecompressFromSolidCache */
 
 int C7zClient::TestArchive(CSalamanderForOperationsAbstract* salamander, const char* fileName)
 {
@@ -992,7 +1208,7 @@ int C7zClient::UpdateMakeUpdateList(TIndirectArray<CFileItem>* fileList, TIndire
 
 // nastavi parametry komprese podle konfigurace pluginu
 HRESULT
-C7zClient::SetCompressionParams(IOutArchive* outArchive, CCompressParams* compressParams)
+C7zClient::SetCompressionParams(IOutArchive* outArchive, CCompressParams* compressParams, UINT64 totalSize)
 {
     CMyComPtr<ISetProperties> setProperties;
     if (outArchive->QueryInterface(IID_ISetProperties, (void**)&setProperties) == S_OK)
@@ -1005,8 +1221,17 @@ C7zClient::SetCompressionParams(IOutArchive* outArchive, CCompressParams* compre
         values.push_back(NWindows::NCOM::CPropVariant((UINT32)compressParams->CompressLevel));
 
         // solid archive
+        char solidStr[32];
+        if (compressParams->SolidArchive)
+            sprintf(solidStr, "%dm", GetEffectiveSolidBlockSize(compressParams)); // v MB
+        else
+            strcpy(solidStr, "off");
         names.Add(L"s");
-        values.push_back(NWindows::NCOM::CPropVariant(compressParams->SolidArchive ? L"2g" : L"off"));
+        values.push_back(NWindows::NCOM::CPropVariant(GetUnicodeString(solidStr)));
+
+        // number of threads; bez nej by si 7za.dll vzala vsechna jadra bez ohledu na pamet
+        names.Add(L"mt");
+        values.push_back(NWindows::NCOM::CPropVariant((UINT32)GetEffectiveNumThreads(compressParams)));
 
         // TODO: multi volume options
 
@@ -1048,6 +1273,12 @@ C7zClient::SetCompressionParams(IOutArchive* outArchive, CCompressParams* compre
                 names.Add(L"0fb");
                 prop = compressParams->WordSize;
                 values.push_back(prop);
+
+                // set block size; bloky se koduji paralelne, takze u mensich dat je zmensime,
+                // aby dostalo praci kazde vlakno
+                names.Add(L"0c");
+                prop = (UINT32)GetLzma2BlockSize(compressParams, totalSize);
+                values.push_back(prop);
                 break;
 
             case CCompressParams::PPMd:
@@ -1176,7 +1407,11 @@ int C7zClient::Update(CSalamanderForOperationsAbstract* salamander, const char*
         updateCallbackSpec->Password = password;
         updateCallbackSpec->AskPassword = passwordIsDefined;
 
-        SetCompressionParams(outArchive, compressParams);
+        UINT64 totalSize = 0;
+        int i;
+        for (i = 0; i < fileList->Count; i++)
+            totalSize += (*fileList)[i]->Size;
+        SetCompressionParams(outArchive, compressParams, totalSize);
 
         // spustit update ve vlakne
         // tahle silenost je tu kvuli tomu, ze 7za.dll je multi-threadovy a nesly zobrazovat nase message boxy
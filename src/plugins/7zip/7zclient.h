@@ -45,6 +45,13 @@
 
 #define MAX_PATH_LEN 1024
 
+// CItemData::Block pro soubory, ktere nelezi v solid bloku s dalsimi soubory
+#define SOLID_BLOCK_NONE 0xFFFFFFFF
+
+// limity cache solid bloku: vetsi blok se nevybaluje cely, celkem se do tempu vybali nejvys SOLID_CACHE_MAX_SIZE
+#define SOLID_CACHE_MAX_BLOCK_SIZE ((UINT64)256 * 1024 * 1024)
+#define SOLID_CACHE_MAX_SIZE ((UINT64)1024 * 1024 * 1024)
+
 typedef UINT32(WINAPI* TCreateObjectFunc)(const GUID* clsID, const GUID* interfaceID, void** outObject);
 
 // slouzi k predani polozek, ktere se budou vybalovat
@@ -76,6 +83,7 @@ public:
         BOOL Encrypted;
         UINT64 PackedSize;
         char* Method;
+        UINT32 Block; // cislo solid bloku (7z folder), SOLID_BLOCK_NONE pokud soubor v solid bloku nelezi
 
         CItemData();
         ~CItemData();
@@ -94,6 +102,12 @@ public:
     int Decompress(CSalamanderForOperationsAbstract* salamander, const char* archiveName, const char* outDir,
                    TIndirectArray<CArchiveItemInfo>* itemList, UString& password, BOOL silentDelete = FALSE);
 
+    // vybali jeden soubor pres cache solid bloku: pri prvnim pristupu do bloku se do tempu vybali cely blok,
+    // dalsi soubory z nej se uz jen kopiruji; vraci OPER_CONTINUE, pokud cache nelze pouzit (soubor nelezi
+    // v solid bloku, je zaheslovany, blok je moc velky, ...) a soubor je treba vybalit pres Decompress
+    int DecompressFromSolidCache(CSalamanderForOperationsAbstract* salamander, const char* archiveName,
+                                 const char* outDir, const CFileData* fileData, UString& password);
+
     int TestArchive(CSalamanderForOperationsAbstract* salamander, const char* fileName);
 
     int Update(CSalamanderForOperationsAbstract* salamander, const char* archiveName, const char* srcPath, BOOL isNewArchive,
@@ -105,6 +119,12 @@ public:
 protected:
     BOOL OpenArchive(const char* fileName, IInArchive** archive, UString& password, BOOL quiet = FALSE);
 
+    int ExtractItems(CSalamanderForOperationsAbstract* salamander, IInArchive* inArchive, const char* outDir,
+                     ItemsToExtractMap& itemsToExtract, UINT32* fileIndex, int count, UString& password,
+                     BOOL silentDelete, int* numErrors = NULL);
+    int StageSolidBlock(CSalamanderForOperationsAbstract* salamander, const char* archiveName, UINT32 block,
+                        UString& password);
+
     BOOL FillItemData(IInArchive* archive, UINT32 index, C7zClient::CItemData* itemData);
     BOOL AddFileDir(IInArchive* archive, UINT32 idx,
                     CSalamanderDirectoryAbstract* dir, CPluginDataInterface*& pluginData,
@@ -117,5 +137,13 @@ protected:
     int DeleteMakeUpdateList(TIndirectArray<CArchiveItem>* archiveItems, TIndirectArray<CArchiveItemInfo>* deleteList,
                              TIndirectArray<CUpdateInfo>* updateList);
 
-    HRESULT SetCompressionParams(IOutArchive* outArchive, CCompressParams* compressParams);
+    HRESULT SetCompressionParams(IOutArchive* outArchive, CCompressParams* compressParams, UINT64 totalSize);
+
+protected:
+    BOOL SolidArchive; // TRUE = vylistovany archiv je solid (plni ListArchive)
+
+    // cache solid bloku (viz DecompressFromSolidCache)
+    char SolidCacheDir[MAX_PATH];           // temp adresar s vybalenymi bloky, prazdny = zatim nevytvoren
+    std::map<UINT32, BOOL> SolidCacheBlocks; // bloky, ktere uz jsme zkouseli vybalit (TRUE = vybaleny v SolidCacheDir)
+    UINT64 SolidCacheSize;                   // soucet velikosti souboru vybalenych v SolidCacheDir
 };
@@ -55,7 +55,8 @@ int ConfigVersion = 0;
 // 3: Igor zmenil default hodnoty pro LZMA kompresi (velikost slovniku, atd). Zmen je vice
 //    takze jsme se Honzou Paterou dohodli, ze pri importu starych konfiguraci budeme
 //    nastaveni komprese ignorovat a pouziji se tako nove defaulty.
-#define CURRENT_CONFIG_VERSION 3
+// 4: pocet vlaken a velikost solid bloku, default metoda je LZMA2
+#define CURRENT_CONFIG_VERSION 4
 const char* CONFIG_VERSION = "Version";
 
 CConfig Config;
@@ -88,6 +89,8 @@ const char* CONFIG_COMPRESS_METHOD = "Compression Method";
 const char* CONFIG_DICT_SIZE = "Dictionary Size";
 const char* CONFIG_WORD_SIZE = "Word Size";
 const char* CONFIG_SOLID_ARCHIVE = "Solid Archive";
+const char* CONFIG_NUM_THREADS = "Number of Threads";
+const char* CONFIG_SOLID_BLOCK_SIZE = "Solid Block Size";
 
 // menu id
 #define IDM_TESTARCHIVE 1
@@ -434,10 +437,95 @@ void CPluginInterface::SetDefaultConfiguration()
     Config.ShowExtendedOptions = TRUE;
 
     Config.CompressParams.CompressLevel = COMPRESS_LEVEL_NORMAL;
-    Config.CompressParams.Method = CCompressParams::LZMA;
+    Config.CompressParams.Method = CCompressParams::LZMA2;
     Config.CompressParams.DictSize = 16 * 1024; // Dictionary Size in KB
     Config.CompressParams.WordSize = 32;
     Config.CompressParams.SolidArchive = TRUE;
+    Config.CompressParams.NumThreads = 0;     // auto
+    Config.CompressParams.SolidBlockSize = 0; // auto
+}
+
+UINT64 GetLzma2BlockSize(const CCompressParams* compressParams, UINT64 totalSize)
+{
+    // stejne jako 7-Zip: ctyrnasobek slovniku, minimalne 1 MB, maximalne 256 MB
+    UINT64 dictSize = (UINT64)compressParams->DictSize * 1024;
+    UINT64 minBlock = dictSize < ((UINT64)1 << 20) ? ((UINT64)1 << 20) : dictSize;
+    UINT64 block = dictSize * 4;
+    if (block < ((UINT64)1 << 20))
+        block = (UINT64)1 << 20;
+    if (block > ((UINT64)256 << 20))
+        block = (UINT64)256 << 20;
+
+    // kazdy LZMA2 koder bezi ve dvou vlaknech (match finder + koder) a zpracovava cele bloky;
+    // u mensich dat by pri defaultnim bloku vetsina koderu nedostala nic
+    int coders = GetEffectiveNumThreads(compressParams) / 2;
+    if (totalSize > 0 && coders > 1 && totalSize / coders < block)
+    {
+        block = totalSize / coders;
+        if (block < minBlock)
+            block = minBlock;
+        block = (block + (1 << 20) - 1) & ~(UINT64)((1 << 20) - 1); // zaokrouhlit na cele MB
+    }
+    return block;
+}
+
+int GetEffectiveNumThreads(const CCompressParams* compressParams)
+{
+    // ukladani a PPMd jsou v 7za.dll jednovlaknove, LZMA umi nejvys dve vlakna
+    if (compressParams->CompressLevel == COMPRESS_LEVEL_STORE || compressParams->Method == CCompressParams::PPMd)
+        return 1;
+    int maxThreads = compressParams->Method == CCompressParams::LZMA ? 2 : MAX_COMPRESS_THREADS;
+
+    int threads = compressParams->NumThreads;
+    if (threads <= 0)
+    {
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        threads = (int)si.dwNumberOfProcessors;
+
+        // kazdy koder si alokuje match finder (cca 11.5 x slovnik) a u LZMA2 jeste buffery na blok;
+        // pocet koderu omezime tak, aby se vesly do poloviny fyzicke pameti a do volneho adresniho
+        // prostoru (7za.dll bezi v procesu Salamandera)
+        UINT64 dictSize = (UINT64)compressParams->DictSize * 1024;
+        UINT64 coderMem = dictSize * 23 / 2 + ((UINT64)6 << 20);
+        if (compressParams->Method == CCompressParams::LZMA2)
+        {
+            CCompressParams single = *compressParams;
+            single.NumThreads = 1; // jen kvuli vypoctu defaultniho bloku, jinak by se volala rekurze
+            coderMem += 2 * GetLzma2BlockSize(&single);
+        }
+        MEMORYSTATUSEX ms;
+        ms.dwLength = sizeof(ms);
+        if (GlobalMemoryStatusEx(&ms))
+        {
+            UINT64 budget = ms.ullTotalPhys / 2;
+            if (budget > ms.ullAvailVirtual / 4 * 3)
+                budget = ms.ullAvailVirtual / 4 * 3;
+            UINT64 coders = budget / coderMem;
+            if (coders < 1)
+                coders = 1;
+            if ((UINT64)threads > coders * 2)
+                threads = (int)(coders * 2);
+        }
+    }
+    if (threads > maxThreads)
+        threads = maxThreads;
+    if (threads < 1)
+        threads = 1;
+    return threads;
+}
+
+int GetEffectiveSolidBlockSize(const CCompressParams* compressParams)
+{
+    if (compressParams->SolidBlockSize > 0)
+        return compressParams->SolidBlockSize;
+    // stejne jako 7-Zip: 128 x slovnik, v rozmezi 16 MB az 4 GB (pro default slovnik 16 MB vyjde 2 GB)
+    UINT64 size = (UINT64)compressParams->DictSize * 128 / 1024;
+    if (size < 16)
+        size = 16;
+    if (size > 4096)
+        size = 4096;
+    return (int)size;
 }
 
 void CPluginInterface::LoadConfiguration(HWND parent, HKEY regKey, CSalamanderRegistryAbstract* registry)
@@ -481,6 +569,11 @@ void CPluginInterface::LoadConfiguration(HWND parent, HKEY regKey, CSalamanderRe
                 registry->GetValue(regKey, CONFIG_WORD_SIZE, REG_DWORD, &Config.CompressParams.WordSize, sizeof(DWORD));
             }
         }
+        if (ConfigVersion >= 4)
+        {
+            registry->GetValue(regKey, CONFIG_NUM_THREADS, REG_DWORD, &Config.CompressParams.NumThreads, sizeof(DWORD));
+            registry->GetValue(regKey, CONFIG_SOLID_BLOCK_SIZE, REG_DWORD, &Config.CompressParams.SolidBlockSize, sizeof(DWORD));
+        }
     }
 }
 
@@ -508,6 +601,9 @@ void CPluginInterface::SaveConfiguration(HWND parent, HKEY regKey, CSalamanderRe
     registry->SetValue(regKey, CONFIG_DICT_SIZE, REG_DWORD, &Config.CompressParams.DictSize, sizeof(DWORD));
     registry->SetValue(regKey, CONFIG_WORD_SIZE, REG_DWORD, &Config.CompressParams.WordSize, sizeof(DWORD));
     registry->SetValue(regKey, CONFIG_SOLID_ARCHIVE, REG_DWORD, &Config.CompressParams.SolidArchive, sizeof(DWORD));
+    // config version == 4
+    registry->SetValue(regKey, CONFIG_NUM_THREADS, REG_DWORD, &Config.CompressParams.NumThreads, sizeof(DWORD));
+    registry->SetValue(regKey, CONFIG_SOLID_BLOCK_SIZE, REG_DWORD, &Config.CompressParams.SolidBlockSize, sizeof(DWORD));
 }
 
 void CPluginInterface::Configuration(HWND parent)
@@ -778,7 +874,11 @@ BOOL CPluginInterfaceForArchiver::UnpackOneFile(CSalamanderForOperationsAbstract
                                              targetDir, CQuadWord(fileData->Size), LoadStr(IDS_UNPACKING_ARCHIVE)))
         {
             salamander->OpenProgressDialog(LoadStr(IDS_UNPACKING_ARCHIVE), FALSE, NULL, FALSE);
-            ret = client->Decompress(salamander, fileName, targetDir, &archiveItems, pluginData->Password, TRUE) != OPER_CANCEL;
+            // ze solid bloku se soubory berou pres cache, jinak by se blok pri kazdem prohlizeni dekomprimoval od zacatku
+            int res = client->DecompressFromSolidCache(salamander, fileName, targetDir, fileData, pluginData->Password);
+            if (res == OPER_CONTINUE)
+                res = client->Decompress(salamander, fileName, targetDir, &archiveItems, pluginData->Password, TRUE);
+            ret = res != OPER_CANCEL;
             //      ret = client->Decompress(salamander, fileName, targetDir, &archiveItems) == OPER_OK;
             salamander->CloseProgressDialog();
         }
@@ -176,8 +176,22 @@ struct CCompressParams
     int DictSize;      // dictionary size (in KB)
     int WordSize;      // word size
     BOOL SolidArchive; // create solid archive
+    // version 4
+    int NumThreads;     // number of threads (0 = auto, podle poctu jader a volne pameti)
+    int SolidBlockSize; // solid block size (in MB, 0 = auto, podle velikosti slovniku)
 };
 
+// maximalni pocet vlaken, ktery umi LZMA2 koder v 7za.dll
+#define MAX_COMPRESS_THREADS 32
+
+// vraci pocet vlaken, ktery se pouzije pro dane parametry (vyresi NumThreads == 0)
+int GetEffectiveNumThreads(const CCompressParams* compressParams);
+// vraci velikost LZMA2 bloku v bajtech; pri znamem 'totalSize' (velikost baleni dat) blok zmensi
+// tak, aby dostal praci kazdy koder
+UINT64 GetLzma2BlockSize(const CCompressParams* compressParams, UINT64 totalSize = 0);
+// vraci velikost solid bloku v MB, ktera se pouzije pro dane parametry (vyresi SolidBlockSize == 0)
+int GetEffectiveSolidBlockSize(const CCompressParams* compressParams);
+
 // konfigurace
 struct CConfig
 {
@@ -32,7 +32,7 @@ CResDataPair CompressLevel[] =
 CResDataPair CompressMethod[] =
     {
         {IDS_METHOD_LZMA, CCompressParams::LZMA},
-        //  { IDS_METHOD_LZMA2, CCompressParams::LZMA2 },
+        {IDS_METHOD_LZMA2, CCompressParams::LZMA2},
         {IDS_METHOD_PPMD, CCompressParams::PPMd},
 };
 
@@ -49,6 +49,10 @@ int PPMdDictSize[] =
 int PPMdWordSize[] =
     {2, 3, 4, 5, 6, 7, 8, 10, 12, 14, 16, 20, 24, 28, 32};
 
+// v MB, 0 = auto
+int SolidBlockSize[] =
+    {0, 16, 64, 256, 1024, 2048, 4096, 16384, 65536};
+
 void FormatBytes(LPTSTR buffer, int bytes)
 {
     if (bytes >= 1024)
@@ -81,13 +85,16 @@ void SetComboCurSelData(HWND hWnd, DWORD data)
 //
 
 CCompressParamsDlg::CCompressParamsDlg(CCompressParams* compressParams, int idCfgCompressLevel, int idCfgCompressMethod,
-                                       int idCfgDictSize, int idCfgWordSize, int idCfgSolidArchive)
+                                       int idCfgDictSize, int idCfgWordSize, int idCfgNumThreads, int idCfgSolidArchive,
+                                       int idCfgSolidBlockSize)
 {
     IDCfgCompressLevel = idCfgCompressLevel;
     IDCfgCompressMethod = idCfgCompressMethod;
     IDCfgDictSize = idCfgDictSize;
     IDCfgWordSize = idCfgWordSize;
+    IDCfgNumThreads = idCfgNumThreads;
     IDCfgSolidArchive = idCfgSolidArchive;
+    IDCfgSolidBlockSize = idCfgSolidBlockSize;
 
     CompressParams = compressParams;
 }
@@ -190,8 +197,37 @@ void CCompressParamsDlg::Transfer(CTransferInfo& ti)
         }
     }
 
+    // set number of threads
+    if (ti.Type == ttDataToWindow)
+        SetComboCurSelData(GetDlgItem(HWindow, IDCfgNumThreads), CompressParams->NumThreads);
+    else if (ti.Type == ttDataFromWindow)
+    {
+        int curSel = (int)SendMessage(GetDlgItem(HWindow, IDCfgNumThreads), CB_GETCURSEL, (WPARAM)0, (LPARAM)0);
+        if (curSel != CB_ERR)
+        {
+            DWORD data = (DWORD)SendMessage(GetDlgItem(HWindow, IDCfgNumThreads), CB_GETITEMDATA, (WPARAM)curSel, (LPARAM)0);
+            CompressParams->NumThreads = data;
+        }
+    }
+
     // set create solid archive
     ti.CheckBox(IDCfgSolidArchive, CompressParams->SolidArchive);
+
+    // set solid block size
+    if (ti.Type == ttDataToWindow)
+    {
+        SetComboCurSelData(GetDlgItem(HWindow, IDCfgSolidBlockSize), CompressParams->SolidBlockSize);
+        OnChangeSolid();
+    }
+    else if (ti.Type == ttDataFromWindow)
+    {
+        int curSel = (int)SendMessage(GetDlgItem(HWindow, IDCfgSolidBlockSize), CB_GETCURSEL, (WPARAM)0, (LPARAM)0);
+        if (curSel != CB_ERR)
+        {
+            DWORD data = (DWORD)SendMessage(GetDlgItem(HWindow, IDCfgSolidBlockSize), CB_GETITEMDATA, (WPARAM)curSel, (LPARAM)0);
+            CompressParams->SolidBlockSize = data;
+        }
+    }
 }
 
 void CCompressParamsDlg::FillCompressLevelCombo()
@@ -258,6 +294,62 @@ void CCompressParamsDlg::FillWordSizeCombo(int values[], int size)
     }
 }
 
+void CCompressParamsDlg::FillNumThreadsCombo(int maxThreads)
+{
+    HWND combo = GetDlgItem(HWindow, IDCfgNumThreads);
+
+    // pri zmene metody zachovat vyber, pokud to jde
+    DWORD sel = CompressParams->NumThreads;
+    int curSel = (int)SendMessage(combo, CB_GETCURSEL, (WPARAM)0, (LPARAM)0);
+    if (curSel != CB_ERR)
+        sel = (DWORD)SendMessage(combo, CB_GETITEMDATA, (WPARAM)curSel, (LPARAM)0);
+    if (sel > (DWORD)maxThreads)
+        sel = maxThreads;
+
+    SendMessage(combo, CB_RESETCONTENT, 0, 0);
+
+    int res = (int)SendMessage(combo, CB_ADDSTRING, 0, (LPARAM)LoadStr(IDS_AUTO));
+    if (res != CB_ERR)
+        SendMessage(combo, CB_SETITEMDATA, (WPARAM)res, (LPARAM)0);
+
+    int i;
+    for (i = 1; i <= maxThreads; i++)
+    {
+        // vlozit polozku
+        TCHAR buffer[64];
+        _stprintf(buffer, _T("%d"), i);
+        res = (int)SendMessage(combo, CB_ADDSTRING, 0, (LPARAM)buffer);
+        if (res != CB_ERR)
+            // nastavit data
+            SendMessage(combo, CB_SETITEMDATA, (WPARAM)res, (LPARAM)i);
+    }
+
+    SetComboCurSelData(combo, sel);
+}
+
+void CCompressParamsDlg::FillSolidBlockSizeCombo()
+{
+    HWND combo = GetDlgItem(HWindow, IDCfgSolidBlockSize);
+    SendMessage(combo, CB_RESETCONTENT, 0, 0);
+
+    int i;
+    for (i = 0; i < sizeof(SolidBlockSize) / sizeof(int); i++)
+    {
+        // vlozit polozku
+        TCHAR buffer[64];
+        if (SolidBlockSize[i] == 0)
+            lstrcpy(buffer, LoadStr(IDS_AUTO));
+        else if (SolidBlockSize[i] >= 1024)
+            _stprintf(buffer, _T("%d G"), SolidBlockSize[i] / 1024);
+        else
+            _stprintf(buffer, _T("%d M"), SolidBlockSize[i]);
+        int res = (int)SendMessage(combo, CB_ADDSTRING, 0, (LPARAM)buffer);
+        if (res != CB_ERR)
+            // nastavit data
+            SendMessage(combo, CB_SETITEMDATA, (WPARAM)res, (LPARAM)SolidBlockSize[i]);
+    }
+}
+
 void CCompressParamsDlg::OnChangeMethod()
 {
     //  TRACE_I("OnChangeMethod");
@@ -271,17 +363,31 @@ void CCompressParamsDlg::OnChangeMethod()
         {
         case CCompressParams::LZMA:
         case CCompressParams::LZMA2:
+        {
             FillDictSizeCombo(LZMADictSize, sizeof(LZMADictSize) / sizeof(int));
             FillWordSizeCombo(LZMAWordSize, sizeof(LZMAWordSize) / sizeof(int));
+            // LZMA umi jen dve vlakna (match finder + koder), LZMA2 koduje bloky paralelne
+            int maxThreads = 2;
+            if (method == CCompressParams::LZMA2)
+            {
+                SYSTEM_INFO si;
+                GetSystemInfo(&si);
+                maxThreads = 2 * (int)si.dwNumberOfProcessors;
+                if (maxThreads > MAX_COMPRESS_THREADS)
+                    maxThreads = MAX_COMPRESS_THREADS;
+            }
+            FillNumThreadsCombo(maxThreads);
             // set defaults
             OnChangeLevel();
             //        SetComboCurSelData(GetDlgItem(HWindow, IDC_CFG_DICT_SIZE), 1024);
             //        SetComboCurSelData(GetDlgItem(HWindow, IDC_CFG_WORD_SIZE), 32);
             break;
+        }
 
         case CCompressParams::PPMd:
             FillDictSizeCombo(PPMdDictSize, sizeof(PPMdDictSize) / sizeof(int));
             FillWordSizeCombo(PPMdWordSize, sizeof(PPMdWordSize) / sizeof(int));
+            FillNumThreadsCombo(1);
             // set defaults
             OnChangeLevel();
             //        SetComboCurSelData(GetDlgItem(HWindow, IDCfgDictSize), 16384);
@@ -308,6 +414,8 @@ void CCompressParamsDlg::OnChangeLevel()
             EnableWindow(GetDlgItem(HWindow, IDCfgCompressMethod), level != COMPRESS_LEVEL_STORE);
             EnableWindow(GetDlgItem(HWindow, IDCfgDictSize), level != COMPRESS_LEVEL_STORE);
             EnableWindow(GetDlgItem(HWindow, IDCfgWordSize), level != COMPRESS_LEVEL_STORE);
+            // PPMd je jednovlaknove
+            EnableWindow(GetDlgItem(HWindow, IDCfgNumThreads), level != COMPRESS_LEVEL_STORE && method != CCompressParams::PPMd);
 
             switch (method)
             {
@@ -376,6 +484,11 @@ void CCompressParamsDlg::OnChangeLevel()
     }
 }
 
+void CCompressParamsDlg::OnChangeSolid()
+{
+    EnableWindow(GetDlgItem(HWindow, IDCfgSolidBlockSize), IsDlgButtonChecked(HWindow, IDCfgSolidArchive) == BST_CHECKED);
+}
+
 INT_PTR
 CCompressParamsDlg::DialogProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
@@ -385,6 +498,7 @@ CCompressParamsDlg::DialogProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
     {
         FillCompressLevelCombo();
         FillCompressMethodCombo();
+        FillSolidBlockSizeCombo();
 
         SetComboCurSelData(GetDlgItem(HWindow, IDCfgDictSize), CompressParams->DictSize);
         SetComboCurSelData(GetDlgItem(HWindow, IDCfgWordSize), CompressParams->WordSize);
@@ -403,6 +517,10 @@ CCompressParamsDlg::DialogProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
         {
             OnChangeLevel();
         }
+        else if (HIWORD(wParam) == BN_CLICKED && LOWORD(wParam) == IDCfgSolidArchive)
+        {
+            OnChangeSolid();
+        }
         break;
     }
 
@@ -456,7 +574,7 @@ void CCommonDialog::NotifDlgJustCreated()
 CConfigurationDialog::CConfigurationDialog(HWND hParent)
     : CCommonDialog(HLanguage, IDD_CONFIGURATION, IDD_CONFIGURATION, hParent),
       CompressParamsDlg(&Cfg.CompressParams, IDC_CFG_COMPRESS_LEVEL, IDC_CFG_COMPRESS_METHOD, IDC_CFG_DICT_SIZE, IDC_CFG_WORD_SIZE,
-                        IDC_CFG_SOLID_ARCHIVE)
+                        IDC_CFG_NUM_THREADS, IDC_CFG_SOLID_ARCHIVE, IDC_CFG_SOLID_BLOCK_SIZE)
 {
 }
 
@@ -518,7 +636,7 @@ CConfigurationDialog::DialogProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
 CExtOptionsDialog::CExtOptionsDialog(HWND hParent)
     : CCommonDialog(HLanguage, IDD_NEWARCHIVE, IDD_NEWARCHIVE, hParent),
       CompressParamsDlg(&CompressParams, IDC_CFG_COMPRESS_LEVEL, IDC_CFG_COMPRESS_METHOD, IDC_CFG_DICT_SIZE, IDC_CFG_WORD_SIZE,
-                        IDC_CFG_SOLID_ARCHIVE)
+                        IDC_CFG_NUM_THREADS, IDC_CFG_SOLID_ARCHIVE, IDC_CFG_SOLID_BLOCK_SIZE)
 {
     Encrypt = FALSE;
 
@@ -34,14 +34,16 @@ private:
     int IDCfgCompressMethod;
     int IDCfgDictSize;
     int IDCfgWordSize;
+    int IDCfgNumThreads;
     int IDCfgSolidArchive;
+    int IDCfgSolidBlockSize;
 
 public:
     CCompressParams* CompressParams;
     HWND HWindow;
 
     CCompressParamsDlg(CCompressParams* compressParams, int IDCfgCompressLevel, int IDCfgCompressMethod, int IDCfgDictSize,
-                       int IDCfgWordSize, int IDCfgSolidArchive);
+                       int IDCfgWordSize, int IDCfgNumThreads, int IDCfgSolidArchive, int IDCfgSolidBlockSize);
     virtual void Transfer(CTransferInfo& ti);
 
     INT_PTR DialogProc(UINT uMsg, WPARAM wParam, LPARAM lParam);
@@ -51,9 +53,12 @@ protected:
     void FillCompressMethodCombo();
     void FillDictSizeCombo(int values[], int size);
     void FillWordSizeCombo(int values[], int size);
+    void FillNumThreadsCombo(int maxThreads);
+    void FillSolidBlockSizeCombo();
 
     void OnChangeMethod();
     void OnChangeLevel();
+    void OnChangeSolid();
 };
 
 //****************************************************************************
@@ -31,6 +31,7 @@ CExtractCallbackImp::CExtractCallbackImp(HWND _hProgWnd, UString& password,
 
     OutFileStreamSpec = NULL;
     TargetDir = NULL;
+    Quiet = FALSE;
     hProgWnd = _hProgWnd;
 }
 
@@ -240,7 +241,8 @@ STDMETHODIMP CExtractCallbackImp::GetStream(UINT32 index, ISequentialOutStream**
                     CMyComPtr<ISequentialOutStream> outStreamLoc(OutFileStreamSpec);
                     if (!OutFileStreamSpec->Open(GetAnsiString(ProcessedFileInfo.FileName), OPEN_ALWAYS))
                     {
-                        SysError(IDS_ERROR, ::GetLastError());
+                        if (!Quiet)
+                            SysError(IDS_ERROR, ::GetLastError());
                         NumErrors++;
                         throw S_OK;
                     }
@@ -427,6 +429,8 @@ STDMETHODIMP CExtractCallbackImp::SetOperationResult(INT32 resultEOperationResul
 
     default:
         NumErrors++;
+        if (Quiet)
+            break;
 
         switch (resultEOperationResult)
         {
@@ -112,6 +112,8 @@ private:
 
     BOOL WholeFile;
 
+    BOOL Quiet; // chyby vybalovani jen pocitat (NumErrors), nic nehlasit
+
     HWND hProgWnd;
 
 public:
@@ -123,6 +125,11 @@ public:
               BOOL silentDelete = FALSE);
     BOOL InitTest();
 
+    // v tichem rezimu se chyby vybalovani (CRC, data error, vytvoreni souboru) nehlasi,
+    // jen se pocitaji v NumErrors; poskozene soubory zustanou na disku (pouziva se pri
+    // vybalovani solid bloku do cache, ktery se pri chybe cely zahodi)
+    void SetQuiet(BOOL quiet) { Quiet = quiet; }
+
     int NumErrors;
 
     const char* GetFileName() { return TargetFileName; }
@@ -13,6 +13,7 @@ const TCHAR szDiskMapViewClass[] = TEXT("Zar.DM.DMView.WC");
 
 #define IDT_ANIMTIMER 1
 #define ANIMTIMER_TIME 10
+#define PARTIALVIEW_TIME 1000 //jak casto se behem nacitani prekresluje rozpracovana mapa
 
 class CLogger;
 
@@ -47,6 +48,8 @@ protected:
 
     BOOL _tooltipEnabled;
 
+    DWORD _partialTime;
+
     HWND DoCreate(int left, int top, int width, int height)
     {
         return MyCreateWindow(
@@ -72,7 +75,10 @@ protected:
 
         if (this->_anim)
         {
-            this->_anim->Paint(hdc, rect);
+            if (this->_loadAnim != NULL && this->_diskmap && this->_diskmap->Paint(hdc, rect))
+                this->_loadAnim->PaintStatus(hdc, rect); //rozpracovana mapa + prubeh nacitani
+            else
+                this->_anim->Paint(hdc, rect);
         }
         else if (this->_diskmap && this->_diskmap->Paint(hdc, rect))
         {
@@ -204,14 +210,14 @@ protected:
 #ifdef SALAMANDER
                 if (this->_connector->GetSalamander() != NULL)
                 {
-                    icmd = this->_shellmenu->ShowFileMenu(buff, xPos, yPos, this->_connector->GetSalamander()->CanFocusFile(), this->_diskmap->CanZoomIn(), this->_diskmap->CanZoomOut());
+                    icmd = this->_shellmenu->ShowFileMenu(buff, xPos, yPos, this->_connector->GetSalamander()->CanFocusFile(), this->_diskmap->CanZoomIn(), this->_diskmap->CanZoomOut(), this->_diskmap->CanPopulate());
                 }
                 else
                 {
-                    icmd = this->_shellmenu->ShowFileMenu(buff, xPos, yPos, FALSE, this->_diskmap->CanZoomIn(), this->_diskmap->CanZoomOut());
+                    icmd = this->_shellmenu->ShowFileMenu(buff, xPos, yPos, FALSE, this->_diskmap->CanZoomIn(), this->_diskmap->CanZoomOut(), this->_diskmap->CanPopulate());
                 }
 #else
-                icmd = this->_shellmenu->ShowFileMenu(buff, xPos, yPos, this->_diskmap->CanZoomIn(), this->_diskmap->CanZoomOut());
+                icmd = this->_shellmenu->ShowFileMenu(buff, xPos, yPos, this->_diskmap->CanZoomIn(), this->_diskmap->CanZoomOut(), this->_diskmap->CanPopulate());
 #endif
                 if (icmd == IDM_ZOOMIN)
                 {
@@ -227,6 +233,10 @@ protected:
                         this->UpdateMapView();
                     }
                 }
+                else if (icmd == IDM_RESCAN)
+                {
+                    this->RescanDirectory(f);
+                }
 #ifdef SALAMANDER
                 else if (icmd == IDM_FOCUS)
                 {
@@ -332,6 +342,12 @@ protected:
                     INT64 datasize;
                     this->_diskmap->GetStats(filecount, dircount, datasize);
                     this->_loadAnim->SetInfo(filecount, dircount, datasize);
+
+                    if (GetTickCount() - this->_partialTime >= PARTIALVIEW_TIME)
+                    {
+                        this->UpdatePartialView();
+                        this->_partialTime = GetTickCount();
+                    }
                 }
                 this->Repaint();
             }
@@ -369,6 +385,16 @@ protected:
 
         return this->UpdateMapSize(TRUE);
     }
+    void UpdatePartialView()
+    {
+        RECT ClientRect;
+        GetClientRect(this->_hWnd, &ClientRect);
+
+        if (ClientRect.right <= 0 || ClientRect.bottom <= 0)
+            return;
+
+        this->_diskmap->PreparePartialView(ClientRect.right, ClientRect.bottom, this->_renderer);
+    }
     BOOL UpdateMapSize(BOOL force)
     {
         if (!this->_diskmap)
@@ -445,6 +471,8 @@ public:
 
         this->_tooltipEnabled = TRUE;
 
+        this->_partialTime = 0;
+
         //CTreeMapRendererBase *renderer = new CTreeMapRendererBase(dsSquare);
         //CTreeMapRendererBase *renderer = new CTreeMapRendererMaxRatio(dsSquare, 0);//Sequoia
         //CTreeMapRendererBase *renderer = new CTreeMapRendererMaxRatio(dsLonger, 2.5);KDirStat
@@ -713,7 +741,7 @@ public:
         }
         return FALSE;
     }
-    BOOL UpdateFileList()
+    BOOL UpdateFileList(int mode = POPULATE_SNAPSHOT)
     {
         if (this->_diskmap)
         {
@@ -725,14 +753,15 @@ public:
 
                 this->_loadAnim = new CLoadAnimation();
                 this->_anim = this->_loadAnim;
+                this->_partialTime = GetTickCount();
 
 #ifdef SALAMANDER
                 int cs = 512;
                 if (this->_connector->GetSalamander() != NULL)
                     cs = this->_connector->GetSalamander()->GetClusterSize(this->_path->GetString());
-                this->_diskmap->PopulateAsync(this->_path->GetString(), this->_path->GetLength(), cs);
+                this->_diskmap->PopulateAsync(this->_path->GetString(), this->_path->GetLength(), cs, FILESIZE_DISK, mode);
 #else
-                this->_diskmap->PopulateAsync(this->_path->GetString(), this->_path->GetLength());
+                this->_diskmap->PopulateAsync(this->_path->GetString(), this->_path->GetLength(), FILESIZE_DISK, mode);
 #endif
 
                 return TRUE;
@@ -740,6 +769,17 @@ public:
         }
         return FALSE;
     }
+    //znovu nacte adresar souboru (u adresare jeho obsah), zbytek stromu se prevezme, pokud se nezmenil
+    BOOL RescanDirectory(CZFile* file)
+    {
+        if (this->_diskmap == NULL || !this->_diskmap->CanPopulate())
+            return FALSE;
+        CZDirectory* dir = file->IsDirectory() ? (CZDirectory*)file : file->GetParent();
+        if (dir == NULL)
+            return FALSE;
+        dir->MarkForRescan();
+        return this->UpdateFileList(POPULATE_INCREMENTAL);
+    }
     void SetConnector(CViewConnectorBase* connector)
     {
         this->_connector = connector;
@@ -135,6 +135,61 @@ public:
         this->_info_filecount = 0;
         this->_valuesChanged = TRUE;
     }
+    //zmensena verze pro progresivni zobrazeni: jen titulek a hodnoty v levem dolnim rohu pres mapu
+    void PaintStatus(HDC hdc, RECT rect)
+    {
+        if (this->_headersWidth == 0)
+            CalcHeadersWidth(hdc);
+        if (this->_valuesChanged == TRUE)
+            this->PrepareValues();
+
+        HANDLE fo = SelectObject(hdc, this->_hfnormal);
+
+        SIZE sz;
+        int valuesWidth = 0;
+        for (int i = 0; i < LA_LID_MAX; i++)
+        {
+            GetTextExtentPoint32(hdc, this->_values[i]->GetString(), (int)this->_values[i]->GetLength(), &sz);
+            valuesWidth = max(sz.cx, valuesWidth);
+        }
+        GetTextExtentPoint32(hdc, this->_title->GetString(), (int)this->_title->GetLength(), &sz);
+
+        int w = max(sz.cx, this->_headersWidth + 6 + valuesWidth) + 2 * 6;
+        int h = (LA_LID_MAX + 1) * this->_lineHeight + 2 * 4 + 2;
+        int x = rect.left + 8;
+        int y = rect.bottom - 8 - h;
+
+        SetTextColor(hdc, RGB(255, 255, 255));
+        SetBkColor(hdc, RGB(0, 0, 0));
+
+        RECT rct;
+        rct.left = x;
+        rct.right = x + w;
+        rct.top = y;
+        rct.bottom = y + 4 + this->_lineHeight + 2;
+        ExtTextOut(hdc, x + 6, y + 4, ETO_OPAQUE, &rct, this->_title->GetString(), (UINT)this->_title->GetLength(), NULL);
+
+        int texty = rct.bottom;
+        for (int i = 0; i < LA_LID_MAX; i++)
+        {
+            rct.top = texty;
+            rct.bottom = texty + this->_lineHeight;
+            rct.left = x;
+            rct.right = x + 6 + this->_headersWidth + 6;
+            ExtTextOut(hdc, x + 6, texty, ETO_OPAQUE, &rct, this->_headers[i]->GetString(), (UINT)this->_headers[i]->GetLength(), NULL);
+            rct.left = rct.right;
+            rct.right = x + w;
+            ExtTextOut(hdc, rct.left, texty, ETO_OPAQUE, &rct, this->_values[i]->GetString(), (UINT)this->_values[i]->GetLength(), NULL);
+            texty += this->_lineHeight;
+        }
+        rct.top = texty;
+        rct.bottom = y + h;
+        rct.left = x;
+        rct.right = x + w;
+        ExtTextOut(hdc, x, texty, ETO_OPAQUE, &rct, NULL, 0, NULL);
+
+        SelectObject(hdc, fo);
+    }
     void Paint(HDC hdc, RECT rect)
     {
         const int BoxCount = 4;
@@ -194,7 +194,12 @@ protected:
             return TRUE;
         case IDM_FILE_REFRESH:
             this->_logger->Clear();
-            this->_diskMap->UpdateFileList();
+            this->_diskMap->UpdateFileList(POPULATE_FULL);
+            return TRUE;
+        case IDM_FILE_QUICKREFRESH:
+            //jen na vyzadani: prevezme adresare s nezmenenym casem zapisu, zmeny hloubeji v nich nepozna
+            this->_logger->Clear();
+            this->_diskMap->UpdateFileList(POPULATE_INCREMENTAL);
             return TRUE;
         case IDM_FILE_OPEN:
             this->_diskMap->OpenSelectedFile();
@@ -245,6 +250,7 @@ protected:
             EnableMenuItem(hMenu, IDM_FILE_OPEN, MF_BYCOMMAND | (isFileSelected ? MF_ENABLED : MF_GRAYED));
             EnableMenuItem(hMenu, IDM_FILE_ABORT, MF_BYCOMMAND | (this->_diskMap->CanAbort() ? MF_ENABLED : MF_GRAYED));
             EnableMenuItem(hMenu, IDM_FILE_REFRESH, MF_BYCOMMAND | (this->_diskMap->CanPopulate() ? MF_ENABLED : MF_GRAYED));
+            EnableMenuItem(hMenu, IDM_FILE_QUICKREFRESH, MF_BYCOMMAND | (this->_diskMap->CanPopulate() ? MF_ENABLED : MF_GRAYED));
             EnableMenuItem(hMenu, IDM_VIEW_ZOOMIN, MF_BYCOMMAND | (this->_diskMap->CanZoomIn() ? MF_ENABLED : MF_GRAYED));
             BOOL canZoomOut = this->_diskMap->CanZoomOut();
             EnableMenuItem(hMenu, IDM_VIEW_ZOOMOUT, MF_BYCOMMAND | (canZoomOut ? MF_ENABLED : MF_GRAYED));
@@ -340,7 +346,7 @@ protected:
             this->_diskMap->ZoomIn();
             return TRUE;
         case APPCOMMAND_BROWSER_REFRESH:
-            this->_diskMap->UpdateFileList();
+            this->_diskMap->UpdateFileList(POPULATE_FULL);
             return TRUE;
         case APPCOMMAND_BROWSER_STOP:
             this->_diskMap->Abort();
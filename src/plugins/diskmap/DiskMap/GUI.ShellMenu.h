@@ -48,6 +48,7 @@ http://blogs.msdn.com/oldnewthing/archive/2004/10/07/239197.aspx
 #define IDM_FOCUS 0x7000
 #define IDM_ZOOMIN 0x7001
 #define IDM_ZOOMOUT 0x7002
+#define IDM_RESCAN 0x7003
 //dirline menu items
 #define IDM_OPEN 0x7010
 #define IDM_GOTO 0x7011
@@ -324,9 +325,9 @@ public:
     }
 
 #ifdef SALAMANDER
-    int ShowFileMenu(TCHAR* filename, int xPos, int yPos, BOOL canFocus, BOOL canZoomIn, BOOL canZoomOut)
+    int ShowFileMenu(TCHAR* filename, int xPos, int yPos, BOOL canFocus, BOOL canZoomIn, BOOL canZoomOut, BOOL canRescan)
 #else
-    int ShowFileMenu(TCHAR* filename, int xPos, int yPos, BOOL canZoomIn, BOOL canZoomOut)
+    int ShowFileMenu(TCHAR* filename, int xPos, int yPos, BOOL canZoomIn, BOOL canZoomOut, BOOL canRescan)
 #endif
     {
         if (this->_pcm != NULL)
@@ -368,6 +369,7 @@ MENU_TEMPLATE_ITEM FileMenu[] =
 	{MNTT_IT, IDS_DISKMAP_SHELL_FOCUS
 	{MNTT_IT, IDS_DISKMAP_SHELL_ZOOMIN
 	{MNTT_IT, IDS_DISKMAP_SHELL_ZOOMOUT
+	{MNTT_IT, IDS_DISKMAP_SHELL_RESCAN
 	{MNTT_PE, 0
 };
 */
@@ -375,6 +377,7 @@ MENU_TEMPLATE_ITEM FileMenu[] =
 #endif
                     InsertMenu(hmenu, mPos++, MF_BYPOSITION | (canZoomIn ? MF_ENABLED : MF_GRAYED), IDM_ZOOMIN, CZResourceString::GetString(IDS_DISKMAP_SHELL_ZOOMIN)) &&
                     InsertMenu(hmenu, mPos++, MF_BYPOSITION | (canZoomOut ? MF_ENABLED : MF_GRAYED), IDM_ZOOMOUT, CZResourceString::GetString(IDS_DISKMAP_SHELL_ZOOMOUT)) &&
+                    InsertMenu(hmenu, mPos++, MF_BYPOSITION | (canRescan ? MF_ENABLED : MF_GRAYED), IDM_RESCAN, CZResourceString::GetString(IDS_DISKMAP_SHELL_RESCAN)) &&
                     InsertMenu(hmenu, mPos++, MF_BYPOSITION | MF_SEPARATOR, NULL, NULL) &&
                     SUCCEEDED(this->_pcm->QueryContextMenu(hmenu, mPos, SCRATCH_QCM_FIRST, SCRATCH_QCM_LAST, qcmFlags)))
                 {
@@ -431,6 +434,10 @@ MENU_TEMPLATE_ITEM FileMenu[] =
                     {
                         res = iCmd;
                     }
+                    else if (iCmd == IDM_RESCAN)
+                    {
+                        res = iCmd;
+                    }
                     else if (iCmd > 0)
                     {
                         CMINVOKECOMMANDINFOEX info = {0};
@@ -177,7 +177,7 @@ public:
     BOOL Abort(BOOL wait = FALSE, DWORD maxwait = INFINITE) //z ridiciho vlakna pro zastaveni worker threadu
     {
         InterlockedExchange(&this->_abort, TRUE);
-        if (wait)
+        if (wait && this->_hThread != NULL) //thread, ktery se nepovedlo nastartovat, uz skoncil
         {
             return ThreadQueue.WaitForExit(this->_hThread, maxwait);
         }
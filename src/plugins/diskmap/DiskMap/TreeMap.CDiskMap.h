@@ -11,6 +11,7 @@
 #include "TreeMap.TreeData.CTreeMap.h"
 #include "TreeMap.TreeData.CCushionDirectory.h"
 #include "TreeMap.Graphics.CCushionGraphics.h"
+#include "TreeMap.Graphics.CTileRenderer.h"
 #include "System.CLogger.h"
 #include "System.RWLock.h"
 #include "TreeMap.FileData.CZRoot.h"
@@ -33,6 +34,7 @@ protected:
     int _mapHeight;
 
     CCushionGraphics* _graphics;
+    CTileRenderer* _tiles;
 
     HWND _hWnd;
 
@@ -120,7 +122,7 @@ protected:
         g = GetGValue(color) * (8 - level) / 8;
         b = GetBValue(color) * (8 - level) / 8;
 
-        this->_graphics->DrawCushion(pix, pw, ph, cshx, cshy, cshw, cshh, RGB(r, g, b));
+        this->_tiles->Add(cshx, cshy, cshw, cshh, RGB(r, g, b)); //kresli se az v CTileRenderer::Render
     }
 
     void DrawCCushionDirectory(BYTE* pix, int width, int height, CCushionDirectory* csd, int level = 0)
@@ -229,6 +231,7 @@ public:
         this->_directoryOverlayVisible = TRUE;
 
         this->_graphics = new CCushionGraphics();
+        this->_tiles = new CTileRenderer(this->_graphics);
         //this->_graphics->LoadFromFile(TEXT("cushion1.ztc"));
 
         this->_selectedCushion = NULL;
@@ -254,6 +257,9 @@ public:
             delete this->_directoryOverlay;
         this->_directoryOverlay = NULL;
 
+        if (this->_tiles)
+            delete this->_tiles;
+        this->_tiles = NULL;
         if (this->_graphics)
             delete this->_graphics;
         this->_graphics = NULL;
@@ -294,9 +300,9 @@ public:
     }
     //FIXME: clustersize hack
 #ifdef SALAMANDER
-    void PopulateAsync(TCHAR const* name, size_t namelen, int clustersize, int sortorder = FILESIZE_DISK)
+    void PopulateAsync(TCHAR const* name, size_t namelen, int clustersize, int sortorder = FILESIZE_DISK, int mode = POPULATE_SNAPSHOT)
 #else
-    void PopulateAsync(TCHAR const* name, size_t namelen = 0, int sortorder = FILESIZE_DISK)
+    void PopulateAsync(TCHAR const* name, size_t namelen = 0, int sortorder = FILESIZE_DISK, int mode = POPULATE_SNAPSHOT)
 #endif
 
     {
@@ -315,8 +321,16 @@ public:
         //this->_selectedCushion = NULL;
         //this->_selectedOverlay->ClearCushion();
 
+        //inkrementalne lze skenovat jen z kompletne nacteneho stromu stejne cesty
+        CZRoot* previous = NULL;
         if (this->_rootdir)
-            delete this->_rootdir;
+        {
+            if (mode == POPULATE_INCREMENTAL && this->_populateworker == NULL &&
+                this->_rootdir->GetSortOrder() == sortorder && _tcsicmp(this->_rootdir->GetName(), name) == 0)
+                previous = this->_rootdir;
+            else
+                delete this->_rootdir;
+        }
         this->_rootdir = NULL;
         this->_viewdir = NULL;
 
@@ -324,6 +338,9 @@ public:
 #ifdef SALAMANDER
         this->_rootdir->SetClusterSize(clustersize);
 #endif
+        this->_rootdir->SetPopulateMode(mode);
+        if (previous != NULL)
+            this->_rootdir->SetPrevious(previous);
 
         //this->_rootdir->SyncPopulate();
         //PostMessage(this->_hWnd, WM_APP_DIRPOPULATED, 0, (LPARAM)this->_rootdir);
@@ -378,7 +395,7 @@ public:
         this->_viewValid = FALSE;
     }
 
-    void PrepareView(int width, int height, CTreeMapRendererBase* renderer)
+    void PrepareView(int width, int height, CTreeMapRendererBase* renderer, CZRoot* lockTree = NULL)
     {
         //if (width == this->_mapWidth && height == this->_mapHeight) return;
 
@@ -408,7 +425,11 @@ public:
             QueryPerformanceCounter(&lt1);
 #endif
 
+            if (lockTree != NULL)
+                lockTree->LockTree();
             this->_map->Prepare(FILESIZE_DISK); //TODO: optimize!
+            if (lockTree != NULL)
+                lockTree->UnlockTree();
 
 #ifdef TIMINGTEST
             QueryPerformanceCounter(&lt2);
@@ -425,7 +446,9 @@ public:
                 this->_drawcount = 0;
 #endif
 
+                this->_tiles->Begin(pix, width, height);
                 this->DrawCCushionDirectory(pix, width, height, cshr);
+                this->_tiles->Render();
 
 #ifdef TIMINGTEST
                 QueryPerformanceCounter(&lt2);
@@ -439,6 +462,19 @@ public:
             }
         }
     }
+    //zobrazi to, co uz scanner nacetl; vrstva cushionu se stavi nad zamcenym stromem,
+    //kresli se uz bez zamku (cushiony si drzi vlastni kopii velikosti)
+    BOOL PreparePartialView(int width, int height, CTreeMapRendererBase* renderer)
+    {
+        if (this->_rootdir == NULL || this->_populateworker == NULL)
+            return FALSE;
+
+        CZDirectory* viewdir = this->_viewdir;
+        this->_viewdir = this->_rootdir;
+        this->PrepareView(width, height, renderer, this->_rootdir);
+        this->_viewdir = viewdir;
+        return this->_mapReady;
+    }
     CCushionHitInfo* GetCushionByLocation(int x, int y)
     {
         if (this->_map)
@@ -476,7 +512,7 @@ public:
 
     BOOL CanZoomIn()
     {
-        if (this->_selectedCushion == NULL)
+        if (this->_selectedCushion == NULL || this->_populateworker != NULL)
             return FALSE;
         CCushionDirectory* parent = this->_selectedCushion->GetParent();
         if (parent != NULL && parent->GetParent() != NULL)
@@ -485,6 +521,8 @@ public:
     }
     BOOL ZoomIn(/*CCushionHitInfo *cshi*/)
     {
+        if (!this->CanZoomIn()) //behem skenovani je zobrazen jen rozpracovany strom
+            return FALSE;
         CCushionDirectory* oparent = NULL;
         //CCushionDirectory *parent = cshi->GetCushion()->GetParent();
         CCushionDirectory* parent = this->_selectedCushion->GetParent();
@@ -582,6 +620,13 @@ public:
         if (wrk == NULL)
             return FALSE;
 
+        //progresivni zobrazeni ukazuje do stromu, ktery smaze worker
+        if (this->_map)
+            delete this->_map;
+        this->_map = NULL;
+        this->_mapReady = FALSE;
+        this->ClearSelectedFile();
+
         this->_rootdir = NULL;
         this->_populateworker = NULL;
         wrk->SetSelfDelete(TRUE);
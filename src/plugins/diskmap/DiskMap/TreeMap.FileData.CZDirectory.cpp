@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include "TreeMap.FileData.CZDirectory.h"
 #include "TreeMap.FileData.CZRoot.h"
+#include "TreeMap.FileData.CZScanner.h"
 
 void CZDirectory::TEST_ENUM(FILE* fileHandle)
 {
@@ -118,34 +119,160 @@ void CZDirectory::TEST()
     }
 }
 
-INT64 CZDirectory::PopulateDir(CWorkerThread* mythread, TCHAR* path, int pos, size_t pathsize)
+struct CZPreviousDir
+{
+    CZDirectory* Dir;
+    int Index; //pozice v _files predchoziho adresare
+};
+
+static int __cdecl ComparePreviousDirs(const void* a, const void* b)
+{
+    return _tcscmp(((const CZPreviousDir*)a)->Dir->GetName(), ((const CZPreviousDir*)b)->Dir->GetName());
+}
+
+static int __cdecl FindPreviousDir(const void* name, const void* item)
+{
+    return _tcscmp((const TCHAR*)name, ((const CZPreviousDir*)item)->Dir->GetName());
+}
+
+void CZDirectory::SetRoot(CZRoot* root)
+{
+    this->_root = root;
+    int cnt = this->_files->GetCount();
+    for (int i = 0; i < cnt; i++)
+    {
+        CZFile* f = this->_files->At(i);
+        if (f->IsDirectory())
+            ((CZDirectory*)f)->SetRoot(root);
+    }
+}
+
+void CZDirectory::Adopt(CZDirectory* parent)
+{
+    this->_parent = parent;
+    this->_previous = NULL;
+    this->_rescanmode = RESCAN_NONE;
+    this->_pending = 0; //podstrom je hotovy, scanner ho neprochazi
+    this->SetRoot(parent->_root);
+}
+
+void CZDirectory::AddTotals(int filecount, int dircount, INT64 datasize, INT64 realsize, INT64 disksize)
+{
+    //scanner zapisuje paralelne z vice threadu, nadrazene adresare sdili vsechny
+    for (CZDirectory* dir = this; dir != NULL; dir = dir->_parent)
+    {
+        if (filecount != 0)
+            InterlockedExchangeAdd((LONG volatile*)&dir->_filecount, filecount);
+        if (dircount != 0)
+            InterlockedExchangeAdd((LONG volatile*)&dir->_dircount, dircount);
+        if (datasize != 0)
+            InterlockedExchangeAdd64((LONG64 volatile*)&dir->_datasize, datasize);
+        if (realsize != 0)
+            InterlockedExchangeAdd64((LONG64 volatile*)&dir->_realsize, realsize);
+        if (disksize != 0)
+            InterlockedExchangeAdd64((LONG64 volatile*)&dir->_disksize, disksize);
+    }
+}
+
+void CZDirectory::SortFiles(int sortorder)
+{
+    //heap-sort podle velikosti (sestupne)
+    int cnt = this->_files->GetCount();
+    for (int i = cnt / 2 - 1; i >= 0; i--) //postavit MIN-HEAP
+    {
+        CZFile* f = this->_files->At(i);
+        INT64 sortsize = f->GetSizeEx(sortorder);
+        int fre = i;
+        while (fre * 2 + 1 < cnt)
+        {
+            int child = fre * 2 + 1; //leva
+            if ((child + 1 < cnt) && (this->_files->At(child)->GetSizeEx(sortorder) > this->_files->At(child + 1)->GetSizeEx(sortorder)))
+                child++;
+            if (this->_files->At(child)->GetSizeEx(sortorder) < sortsize) //pokud podrazeny je mensi, tak nesplnuje MIN-HEAP
+            {
+                this->_files->Copy(fre, child);
+                fre = child;
+            }
+            else
+            {
+                break;
+            }
+        }
+        this->_files->At(fre) = f;
+    }
+    for (int i = 1; i <= cnt; i++)
+    {
+        int end = cnt - i;
+        CZFile* f = this->_files->At(end);
+        this->_files->Copy(end, 0);
+        int fre = 0;
+        end--;
+        while (fre * 2 + 1 <= end)
+        {
+            int child = fre * 2 + 1; //leva
+            if ((child < end) && (this->_files->At(child)->GetSizeEx(sortorder) > this->_files->At(child + 1)->GetSizeEx(sortorder)))
+                child++;
+            if (this->_files->At(child)->GetSizeEx(sortorder) < f->GetSizeEx(sortorder)) //pokud podrazeny je mensi, tak nesplnuje MIN-HEAP
+            {
+                this->_files->Copy(fre, child);
+                fre = child;
+            }
+            else
+            {
+                break;
+            }
+        }
+        this->_files->At(fre) = f;
+    }
+}
+
+void CZDirectory::FinishScan()
+{
+    CZRoot* root = this->_root;
+    this->_previous = NULL; //predchozi strom se po skenovani rusi
+    root->EnterPublish();
+
+    //prazdne podadresare (nebo ty, ktere se nepodarilo nacist) nezobrazujeme; do poctu
+    //se ale zapocitaly, abychom meli stejne vysledky jako Explorer
+    for (int i = this->_files->GetCount() - 1; i >= 0; i--)
+    {
+        CZFile* f = this->_files->At(i);
+        if (f->IsDirectory() && f->GetSizeEx(FILESIZE_REAL) == 0)
+            this->_files->Remove(i); //posledni prvek presune na pozici i, ten uz jsme prosli
+    }
+    this->SortFiles(root->GetSortOrder());
+
+    root->LeavePublish();
+}
+
+void CZDirectory::ScanDir(CZScanner* scanner, int worker)
 {
     if (this->_root == NULL)
         Beep(1000, 100);
-    if (pathsize < 2 * MAX_PATH)
-        Beep(1000, 100);
+
+    TCHAR path[2 * MAX_PATH + 3]; //aby se vesla MAX_PATH cesta + MAX_PATH dlouhy nazev souboru + nejaka rezerva
 
     WIN32_FIND_DATA FindFileData;
     HANDLE hFind = INVALID_HANDLE_VALUE;
     DWORD dwError;
 
+    //statistiky pro animaci (CZRoot::IncStats)
     int dircount = 0;
     int filecount = 0;
     INT64 tsize = 0;
 
+    //soucty za tento adresar, publikuji se najednou po nacteni celeho listingu
+    int allfiles = 0;
+    int alldirs = 0;
+    int newdirs = 0; //podadresare, ktere se budou cist (ostatni jsou prevzate z predchoziho stromu)
+    INT64 alldata = 0;
+    INT64 allreal = 0;
+    INT64 alldisk = 0;
+
     int sortorder = this->_root->GetSortOrder();
 
-    //prilepit aktualni nazev
-    if ((pos + this->_namelen + 1) < pathsize)
-    {
-        if (pos && path[pos - 1] != TEXT('\\'))
-        {
-            path[pos] = TEXT('\\');
-            pos++;
-        }
-        _tcscpy(path + pos, this->_name);
-        pos += (int)this->_namelen;
-    }
+    //cesta tohoto adresare; rodic mel cestu < MAX_PATH, takze se vzdy vejde cela
+    int pos = (int)this->GetFullName(path, ARRAYSIZE(path));
     if (!pos || path[pos - 1] != TEXT('\\'))
         path[pos++] = TEXT('\\');
 
@@ -154,194 +281,191 @@ INT64 CZDirectory::PopulateDir(CWorkerThread* mythread, TCHAR* path, int pos, si
     {
         //ERROR
         this->_root->Log(LOG_ERROR, TEXT("Path is too long."), this);
-        return -1;
+        this->ScanFailed(scanner);
+        return;
     }
 
     TCHAR* filepart = &path[pos]; //ukazatel na zacatek mista pro prilepeni nazvu souboru
 
     path[pos] = TEXT('*');
     path[pos + 1] = TEXT('\0');
-    /*
-	int radixHistorgram[2048 * 6];
-	radixHistorgram[0] = 0;
-	for (int i = 1; i < 2048 * 6; i++)
-	{
-		radixHistorgram[i] = radixHistorgram[i - 1] + 1;
-	}
-	path[MAX_PATH] = (char)radixHistorgram[2048];
-*/
+
     hFind = FindFirstFile(path, &FindFileData);
     if (hFind == INVALID_HANDLE_VALUE)
     {
         //ERROR
         this->_root->LogLastError(this);
-        return -1;
+        this->ScanFailed(scanner);
+        return;
     }
-    else
+
+    //listing plnime mimo strom, do _files se dostane az pri publikaci (renderer muze cist strom behem skenovani)
+    TAutoIndirectArray<CZFile>* files = new TAutoIndirectArray<CZFile>(ARRAY_BLOCKSIZE_CFILELIST, TRUE);
+
+    //inkrementalni skenovani: podadresare predchoziho stromu serazene podle jmena
+    CZDirectory* previous = this->_previous;
+    CZPreviousDir* prevdirs = NULL;
+    int prevcount = 0;
+    if (previous != NULL)
     {
-        DWORD lastTime = GetTickCount();
-        do
+        int cnt = previous->_files->GetCount();
+        prevdirs = (CZPreviousDir*)malloc(max(cnt, 1) * sizeof(CZPreviousDir));
+        if (prevdirs != NULL)
         {
-            if (FindFileData.cFileName[0] == '.' && (FindFileData.cFileName[1] == '\0' || (FindFileData.cFileName[1] == '.' && FindFileData.cFileName[2] == '\0')))
-                continue;
-            INT64 datasize = 0;
-            INT64 realsize = 0;
-            INT64 disksize = 0;
-
-            CZFile* f = NULL;
-            if ((FindFileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+            for (int i = 0; i < cnt; i++)
             {
-                if ((FindFileData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0)
+                CZFile* f = previous->_files->At(i);
+                if (f != NULL && f->IsDirectory())
                 {
-                    f = new CZDirectory(this, FindFileData.cFileName, &FindFileData.ftCreationTime, &FindFileData.ftLastWriteTime);
-                    datasize = ((CZDirectory*)f)->PopulateDir(mythread, path, pos, pathsize);
-                    if (datasize < 0) //chyba!
-                    {
-                        //this->_root->Log(LOG_ERROR, TEXT("Negative size of directory contents."), f);
-                        delete f;
-                        f = NULL;
-                        datasize = 0;
-                        realsize = 0;
-                        disksize = 0;
-                    }
-                    else if (datasize == 0) //vse ok, ale prazdne
-                    {
-                        this->_dircount++;
-                        dircount++;
-                        this->_dircount += ((CZDirectory*)f)->GetSubDirsCount(); //zapocitame prazdne, abychom meli stejne vysledky jako Explorer
-                        this->_filecount += ((CZDirectory*)f)->GetSubFileCount();
-
-                        delete f;
-                        f = NULL;
-                        datasize = 0;
-                        realsize = 0;
-                        disksize = 0;
-                    }
-                    else
-                    {
-                        this->_dircount++;
-                        dircount++;
-                        datasize = f->GetSizeEx(FILESIZE_DATA);
-                        realsize = f->GetSizeEx(FILESIZE_REAL);
-                        disksize = f->GetSizeEx(FILESIZE_DISK);
-                        this->_dircount += ((CZDirectory*)f)->GetSubDirsCount();
-                        this->_filecount += ((CZDirectory*)f)->GetSubFileCount();
-                    }
-                }
-                else
-                {
-                    f = new CZDirectory(this, FindFileData.cFileName, &FindFileData.ftCreationTime, &FindFileData.ftLastWriteTime);
-                    this->_root->Log(LOG_WARNING, TEXT("Ignoring Reparse Point."), f);
-                    delete f;
-                    f = NULL;
+                    prevdirs[prevcount].Dir = (CZDirectory*)f;
+                    prevdirs[prevcount].Index = i;
+                    prevcount++;
                 }
             }
+            qsort(prevdirs, prevcount, sizeof(CZPreviousDir), ComparePreviousDirs);
+        }
+    }
+
+    DWORD lastTime = GetTickCount();
+    do
+    {
+        if (FindFileData.cFileName[0] == '.' && (FindFileData.cFileName[1] == '\0' || (FindFileData.cFileName[1] == '.' && FindFileData.cFileName[2] == '\0')))
+            continue;
+
+        if ((FindFileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+        {
+            CZDirectory* old = NULL;
+            CZPreviousDir* prev = NULL;
+            if (prevcount > 0 && (FindFileData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0)
+            {
+                prev = (CZPreviousDir*)bsearch(FindFileData.cFileName, prevdirs, prevcount, sizeof(CZPreviousDir), FindPreviousDir);
+                if (prev != NULL)
+                    old = prev->Dir;
+            }
+            if (old != NULL && old->_rescanmode == RESCAN_NONE &&
+                CompareFileTime(old->GetModifyTime(), &FindFileData.ftLastWriteTime) == 0)
+            {
+                //obsah adresare se nezmenil: prevezmeme ho i s podstromem, na disk nesahame
+                previous->_files->At(prev->Index) = NULL; //uz nepatri predchozimu stromu
+                old->Adopt(this);
+                files->Add(old);
+                allfiles += old->_filecount;
+                alldirs += 1 + old->_dircount;
+                alldata += old->_datasize;
+                allreal += old->_realsize;
+                alldisk += old->_disksize;
+                filecount += old->_filecount;
+                dircount += 1 + old->_dircount;
+                tsize += old->GetSizeEx(sortorder);
+            }
             else
             {
-                datasize = ((INT64)FindFileData.nFileSizeHigh * ((INT64)(MAXDWORD) + 1)) + FindFileData.nFileSizeLow;
-                if ((FindFileData.dwFileAttributes & (FILE_ATTRIBUTE_SPARSE_FILE | FILE_ATTRIBUTE_COMPRESSED)) != 0)
+                CZDirectory* d = new CZDirectory(this, FindFileData.cFileName, &FindFileData.ftCreationTime, &FindFileData.ftLastWriteTime);
+                if ((FindFileData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0)
                 {
-                    DWORD lo, hi;
-                    _tcscpy(filepart, FindFileData.cFileName);
-                    lo = GetCompressedFileSize(path, &hi);
-                    if (lo == INVALID_FILE_SIZE)
-                    {
-                        //ErrorExit(FindFileData.cFileName);
-                        realsize = datasize;
-                    }
-                    else
-                    {
-                        realsize = ((INT64)hi * ((INT64)(MAXDWORD) + 1)) + lo;
-                    }
+                    if (old != NULL && old->_rescanmode != RESCAN_FULL)
+                        d->_previous = old;
+                    files->Add(d);
+                    alldirs++;
+                    dircount++;
+                    newdirs++;
                 }
                 else
                 {
-                    realsize = datasize;
-                }
-                //zapocitame vzdy, abychom meli stejna cisla jako Explorer
-                this->_filecount++;
-                filecount++;
-                if (datasize > 0)
-                {
-                    disksize = this->_root->GetDiskSize(realsize);
-
-                    f = new CZFile(this, FindFileData.cFileName, datasize, realsize, disksize, &FindFileData.ftCreationTime, &FindFileData.ftLastWriteTime);
-                    tsize += f->GetSizeEx(sortorder);
+                    this->_root->Log(LOG_WARNING, TEXT("Ignoring Reparse Point."), d);
+                    delete d;
                 }
             }
-            if (datasize > 0)
+        }
+        else
+        {
+            INT64 datasize = ((INT64)FindFileData.nFileSizeHigh * ((INT64)(MAXDWORD) + 1)) + FindFileData.nFileSizeLow;
+            INT64 realsize;
+            if ((FindFileData.dwFileAttributes & (FILE_ATTRIBUTE_SPARSE_FILE | FILE_ATTRIBUTE_COMPRESSED)) != 0)
             {
-                this->_datasize += datasize;
-                this->_realsize += realsize;
-                this->_disksize += disksize;
-
-                INT64 sortsize = f->GetSizeEx(sortorder);
-
-                int fre = this->_files->Add(f);
-                while (fre > 0)
+                DWORD lo, hi;
+                _tcscpy(filepart, FindFileData.cFileName);
+                lo = GetCompressedFileSize(path, &hi);
+                if (lo == INVALID_FILE_SIZE)
                 {
-                    int parent = (fre - 1) / 2;
-                    if (this->_files->At(parent)->GetSizeEx(sortorder) > sortsize) //pokud nadrazeny je vetsi, tak nesplnuje MIN-HEAP
-                    {
-                        this->_files->Copy(fre, parent);
-                        fre = parent;
-                    }
-                    else
-                    {
-                        break;
-                    }
+                    realsize = datasize;
+                }
+                else
+                {
+                    realsize = ((INT64)hi * ((INT64)(MAXDWORD) + 1)) + lo;
                 }
-                this->_files->At(fre) = f;
             }
-            //if (((filecount + dircount) > MAXREPORTEDFILES) || (GetTickCount() - lastTime > 500)) //bud mnoho souboru nebo ubehlo 0.5sec
-            if ((GetTickCount() - lastTime > 250) && (filecount + dircount) > 0) //pokud ubehlo 0.25sec a naslo se alespon neco noveho
+            else
             {
-                this->_root->IncStats(filecount, dircount, tsize);
-                lastTime = GetTickCount();
-                dircount = 0;
-                filecount = 0;
-                tsize = 0;
+                realsize = datasize;
             }
-        } while ((FindNextFile(hFind, &FindFileData) != 0) && (mythread == NULL || !mythread->Aborting()));
-
-        this->_root->IncStats(filecount, dircount, tsize);
+            //zapocitame vzdy, abychom meli stejna cisla jako Explorer
+            allfiles++;
+            filecount++;
+            if (datasize > 0)
+            {
+                INT64 disksize = this->_root->GetDiskSize(realsize);
 
-        dwError = GetLastError();
-        FindClose(hFind);
+                CZFile* f = new CZFile(this, FindFileData.cFileName, datasize, realsize, disksize, &FindFileData.ftCreationTime, &FindFileData.ftLastWriteTime);
+                files->Add(f);
+                tsize += f->GetSizeEx(sortorder);
 
-        int cnt = this->_files->GetCount();
-        for (int i = 1; i <= cnt; i++)
-        {
-            int end = cnt - i;
-            CZFile* f = this->_files->At(end);
-            this->_files->Copy(end, 0);
-            int fre = 0;
-            end--;
-            while (fre * 2 + 1 <= end)
-            {
-                int child = fre * 2 + 1; //leva
-                if ((child < end) && (this->_files->At(child)->GetSizeEx(sortorder) > this->_files->At(child + 1)->GetSizeEx(sortorder)))
-                    child++;
-                if (this->_files->At(child)->GetSizeEx(sortorder) < f->GetSizeEx(sortorder)) //pokud podrazeny je mensi, tak nesplnuje MIN-HEAP
-                {
-                    this->_files->Copy(fre, child);
-                    fre = child;
-                }
-                else
-                {
-                    break;
-                }
+                alldata += datasize;
+                allreal += realsize;
+                alldisk += disksize;
             }
-            this->_files->At(fre) = f;
         }
-
-        if (dwError != ERROR_NO_MORE_FILES)
+        if ((GetTickCount() - lastTime > 250) && (filecount + dircount) > 0) //pokud ubehlo 0.25sec a naslo se alespon neco noveho
         {
-            //ERROR
-            this->_root->LogError(this, dwError);
-            return -1;
+            this->_root->IncStats(filecount, dircount, tsize);
+            lastTime = GetTickCount();
+            dircount = 0;
+            filecount = 0;
+            tsize = 0;
         }
+    } while ((FindNextFile(hFind, &FindFileData) != 0) && !scanner->Aborting());
+
+    this->_root->IncStats(filecount, dircount, tsize);
+
+    dwError = GetLastError();
+    FindClose(hFind);
+
+    if (prevdirs != NULL)
+        free(prevdirs);
+
+    if (dwError != ERROR_NO_MORE_FILES && !scanner->Aborting())
+    {
+        //ERROR: stejne jako driv zahodime i to, co se nacist podarilo
+        this->_root->LogError(this, dwError);
+        delete files;
+        this->ScanFailed(scanner);
+        return;
     }
 
-    return this->_realsize;
-}
\ No newline at end of file
+    //publikace: listing + soucty az ke koreni; podadresare pak dostanou ostatni thready
+    int cnt = files->GetCount();
+    this->_pending = 1 + newdirs;
+
+    this->_root->EnterPublish();
+    TAutoIndirectArray<CZFile>* empty = this->_files;
+    this->_files = files;
+    this->AddTotals(allfiles, alldirs, alldata, allreal, alldisk);
+    this->_root->LeavePublish();
+    delete empty;
+
+    for (int i = 0; i < cnt; i++)
+    {
+        CZFile* f = files->At(i);
+        if (f->IsDirectory() && ((CZDirectory*)f)->_pending != 0) //prevzate adresare jsou hotove
+            scanner->Push(worker, (CZDirectory*)f);
+    }
+    scanner->Complete(this);
+}
+
+void CZDirectory::ScanFailed(CZScanner* scanner)
+{
+    //adresar, ktery nejde nacist, se nezapocitava (rodic ho pri publikaci zapocital)
+    if (this->_parent != NULL)
+        this->_parent->AddTotals(0, -1, 0, 0, 0);
+    scanner->Complete(this);
+}
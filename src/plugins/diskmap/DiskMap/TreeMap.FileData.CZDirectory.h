@@ -11,21 +11,47 @@
 #define ARRAY_BLOCKSIZE_CFILELIST 64
 #define MAXREPORTEDFILES 256
 
+//jak nalozit s adresarem predchoziho stromu pri opakovanem skenovani (viz CZDirectory::_previous)
+#define RESCAN_NONE 0 //nezmeneny cas modifikace -> podstrom se prevezme bez cteni z disku
+#define RESCAN_PATH 1 //lezi na ceste k vynucene prohledavanemu adresari -> nacist, podadresare posoudit zvlast
+#define RESCAN_FULL 2 //vynucene prohledani celeho podstromu
+
 class CZFile;
 class CZDirectory;
 class CZRoot;
+class CZScanner;
+class CZSnapshot;
 
 class CZDirectory : public CZFile
 {
 protected:
+    friend class CZScanner;
+    friend class CZSnapshot;
+
     TAutoIndirectArray<CZFile>* _files;
 
-    int _filecount;
-    int _dircount;
+    volatile int _filecount;
+    volatile int _dircount;
 
     CZRoot* _root;
 
-    INT64 PopulateDir(CWorkerThread* mythread, TCHAR* path, int pos, size_t pathsize);
+    volatile LONG _pending; //pocet nedokoncenych uloh v podstromu (tento adresar + podadresare), viz CZScanner
+
+    CZDirectory* _previous; //stejny adresar z predchoziho stromu (inkrementalni skenovani), jinak NULL
+    int _rescanmode;        //RESCAN_xxx, nastavuje se v predchozim strome
+
+    //prevezme nezmeneny podstrom z predchoziho stromu
+    void Adopt(CZDirectory* parent);
+    void SetRoot(CZRoot* root);
+
+    //nacte obsah tohoto adresare, podadresare preda scanneru jako nove ulohy
+    void ScanDir(CZScanner* scanner, int worker);
+    void ScanFailed(CZScanner* scanner);
+    //vola se jednou, az je naskenovany cely podstrom: odstrani prazdne podadresare a seradi soubory
+    void FinishScan();
+    void SortFiles(int sortorder);
+    //pricte hodnoty k tomuto adresari a ke vsem nadrazenym (lock-free)
+    void AddTotals(int filecount, int dircount, INT64 datasize, INT64 realsize, INT64 disksize);
 
     CZDirectory(CZDirectory* parent, TCHAR const* name, FILETIME* createtime, FILETIME* modifytime) : CZFile(parent, name, 0, 0, 0, createtime, modifytime)
     {
@@ -34,6 +60,11 @@ protected:
         this->_filecount = 0;
         this->_dircount = 0;
 
+        this->_pending = 1;
+
+        this->_previous = NULL;
+        this->_rescanmode = RESCAN_NONE;
+
         if (parent != NULL)
         {
             this->_root = parent->_root;
@@ -63,6 +94,17 @@ public:
     }
     virtual BOOL IsDirectory() { return TRUE; }
 
+    //oznaci adresar (a cestu k nemu) k prohledani pri pristim inkrementalnim skenovani
+    void MarkForRescan()
+    {
+        this->_rescanmode = RESCAN_FULL;
+        for (CZDirectory* dir = this->_parent; dir != NULL; dir = dir->_parent)
+        {
+            if (dir->_rescanmode == RESCAN_NONE)
+                dir->_rescanmode = RESCAN_PATH;
+        }
+    }
+
     void TEST_ENUM(FILE* fileHandle);
     void TEST();
 };
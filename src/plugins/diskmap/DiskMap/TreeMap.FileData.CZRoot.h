@@ -8,12 +8,19 @@
 #include "System.WorkerThread.h"
 #include "TreeMap.FileData.CZFile.h"
 #include "TreeMap.FileData.CZDirectory.h"
+#include "TreeMap.FileData.CZScanner.h"
+#include "TreeMap.FileData.CZSnapshot.h"
 #include "System.CLogger.h"
 #include "Utils.CZString.h"
 
 #define ARRAY_BLOCKSIZE_CFILELIST 64
 #define MAXREPORTEDFILES 256
 
+//zpusob nacteni stromu (CZRoot::SetPopulateMode)
+#define POPULATE_SNAPSHOT 0    //pouzit ulozeny snapshot, pokud existuje, jinak skenovat
+#define POPULATE_INCREMENTAL 1 //skenovat, nezmenene adresare prevzit z predchoziho stromu
+#define POPULATE_FULL 2        //skenovat vse
+
 class CZFile;
 class CZDirectory;
 class CZRoot;
@@ -24,13 +31,21 @@ class CZRoot : public CZDirectory
 {
 protected:
     friend class CZDirectory;
+    friend class CZScanner;
+    friend class CZSnapshot;
 
     int _sortorder;
+    int _populatemode;
+
+    CZRoot* _previousroot; //predchozi strom pro inkrementalni skenovani, smaze se po skenovani
 
     volatile int _allfilecount;
     volatile int _alldircount;
     volatile INT64 _allsize;
 
+    //zamek stromu: workery scanneru strom meni "sdilene" (kazdy adresar plni jen jeden
+    //worker, soucty se pricitaji lock-free), renderer si ho zamyka "exkluzivne", aby
+    //behem skenovani videl konzistentni strom (viz LockTree)
     CRWLock* _lock;
     CLogger* _logger;
 
@@ -42,8 +57,23 @@ protected:
     static DWORD_PTR WINAPI PopulateThreadProc(CWorkerThread* mythread, LPVOID lpParam)
     {
         CZRoot* self = (CZRoot*)lpParam;
-        TCHAR path[2 * MAX_PATH + 3]; //aby se vesla MAX_PATH cesta + MAX_PATH dlouhy nazev souboru + nejaka rezerva
-        self->PopulateDir(mythread, path, 0, ARRAYSIZE(path));
+        if (self->_populatemode == POPULATE_SNAPSHOT && CZSnapshot::Load(self))
+        {
+            self->_logger->Log(new CBasicLogItem(LOG_INFORMATION, TEXT("Loaded from snapshot of a previous scan. Changes deep in the tree may not be shown, use Refresh to rescan."), NULL));
+        }
+        else
+        {
+            CZScanner scanner(self, mythread, CZScanner::GetDefaultThreadCount());
+            scanner.Run();
+            if (!mythread->Aborting() && !CZSnapshot::Save(self))
+            {
+                self->_logger->Log(new CBasicLogItem(LOG_WARNING, TEXT("Unable to save snapshot."), NULL));
+            }
+        }
+        //prevzate podstromy uz v predchozim strome nejsou, zbytek muzeme smazat
+        if (self->_previousroot != NULL)
+            delete self->_previousroot;
+        self->_previousroot = NULL;
         if (mythread->Aborting() && mythread->IsSelfDelete())
         {
             delete self;
@@ -78,12 +108,12 @@ protected:
     }
     void IncStats(int fileinc, int dirinc, INT64 sizeinc)
     {
-        this->_lock->EnterWrite();
-        this->_allfilecount += fileinc;
-        this->_alldircount += dirinc;
-        this->_allsize += sizeinc;
-        this->_lock->LeaveWrite();
+        InterlockedExchangeAdd((LONG volatile*)&this->_allfilecount, fileinc);
+        InterlockedExchangeAdd((LONG volatile*)&this->_alldircount, dirinc);
+        InterlockedExchangeAdd64((LONG64 volatile*)&this->_allsize, sizeinc);
     }
+    void EnterPublish() { this->_lock->EnterRead(); }
+    void LeavePublish() { this->_lock->LeaveRead(); }
 
 public:
     CZRoot(TCHAR const* name, CLogger* logger, int sortorder = FILESIZE_DISK) : CZDirectory(NULL, name, NULL, NULL)
@@ -96,6 +126,8 @@ public:
         this->_allsize = 0;
 
         this->_sortorder = sortorder;
+        this->_populatemode = POPULATE_SNAPSHOT;
+        this->_previousroot = NULL;
 
         this->_lock = new CRWLock();
 
@@ -105,10 +137,22 @@ public:
     }
     virtual ~CZRoot()
     {
+        if (this->_previousroot != NULL)
+            delete this->_previousroot;
         delete this->_lock;
     }
     int GetSortOrder() { return this->_sortorder; }
 
+    void SetPopulateMode(int mode) { this->_populatemode = mode; }
+    //inkrementalni skenovani: strom prevezme nezmenene adresare z predchoziho stromu,
+    //ktery se po skenovani smaze (old musi byt kompletne nacteny a nesmi se uz zobrazovat)
+    void SetPrevious(CZRoot* old)
+    {
+        this->_previousroot = old;
+        if (old->_rescanmode != RESCAN_FULL)
+            this->_previous = old;
+    }
+
     //FIXME: toto je hack :(
     void SetClusterSize(int clustersize)
     {
@@ -147,17 +191,21 @@ public:
 
     void GetStats(int& filecount, int& dircount, INT64& size)
     {
-        this->_lock->EnterRead();
         filecount = this->_allfilecount;
         dircount = this->_alldircount;
-        size = this->_allsize;
-        this->_lock->LeaveRead();
+        size = InterlockedCompareExchange64((LONG64 volatile*)&this->_allsize, 0, 0);
     }
 
+    //pro cteni stromu behem skenovani (progresivni zobrazeni): zastavi publikaci vysledku
+    //workeru, cteni velikosti a seznamu souboru je pak konzistentni
+    void LockTree() { this->_lock->EnterWrite(); }
+    void UnlockTree() { this->_lock->LeaveWrite(); }
+
     INT64 SyncPopulate()
     {
-        TCHAR path[2 * MAX_PATH + 3]; //aby se vesla MAX_PATH cesta + MAX_PATH dlouhy nazev souboru + nejaka rezerva
-        return this->PopulateDir(NULL, path, 0, ARRAYSIZE(path));
+        CZScanner scanner(this, NULL, 1);
+        scanner.Run();
+        return this->_realsize;
     }
 
     CWorkerThread* BeginAsyncPopulate(HWND owner, UINT msg)
@@ -0,0 +1,124 @@
+﻿// SPDX-FileCopyrightText: 2023 Open Salamander Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "precomp.h"
+#include "TreeMap.FileData.CZDirectory.h"
+#include "TreeMap.FileData.CZRoot.h"
+#include "TreeMap.FileData.CZScanner.h"
+
+CZScanner::CZScanner(CZRoot* root, CWorkerThread* abortthread, int workercount)
+{
+    if (workercount < 1)
+        workercount = 1;
+    if (workercount > SCAN_MAXTHREADS)
+        workercount = SCAN_MAXTHREADS;
+
+    this->_root = root;
+    this->_abortthread = abortthread;
+    this->_workercount = workercount;
+    this->_queues = new CZScanQueue[workercount];
+    this->_workers = new CZScanWorker[workercount];
+    for (int i = 0; i < workercount; i++)
+    {
+        this->_workers[i].Scanner = this;
+        this->_workers[i].Index = i;
+        this->_workers[i].Thread = NULL;
+    }
+    this->_pending = 0;
+}
+
+CZScanner::~CZScanner()
+{
+    delete[] this->_workers;
+    delete[] this->_queues;
+}
+
+int CZScanner::GetDefaultThreadCount()
+{
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    int count = (int)si.dwNumberOfProcessors;
+    if (count < 2)
+        count = 2; //i na jednom jadru se vyplati prekryt cekani na disk/sit
+    return min(count, SCAN_MAXTHREADS);
+}
+
+void CZScanner::Run()
+{
+    //velikost clusteru zjistime predem, GetDiskSize() ji jinak dopocitava lazy (a thready by se o ni pretahovaly)
+    this->_root->GetDiskSize(1);
+
+    this->_pending = 1;
+    if (!this->_queues[0].Push(this->_root))
+    {
+        this->_pending = 0;
+        this->_root->ScanDir(this, 0);
+    }
+
+    for (int i = 1; i < this->_workercount; i++)
+    {
+        this->_workers[i].Thread = new CWorkerThread(NULL, CZScanner::WorkerThreadProc, &this->_workers[i],
+                                                     NULL, 0, NULL, FALSE);
+    }
+
+    this->WorkLoop(0);
+
+    for (int i = 1; i < this->_workercount; i++)
+    {
+        if (this->_workers[i].Thread != NULL)
+            delete this->_workers[i].Thread; //pocka na dobehnuti threadu
+        this->_workers[i].Thread = NULL;
+    }
+}
+
+CZDirectory* CZScanner::Steal(int worker)
+{
+    for (int i = 1; i < this->_workercount; i++)
+    {
+        CZDirectory* dir = this->_queues[(worker + i) % this->_workercount].Steal();
+        if (dir != NULL)
+            return dir;
+    }
+    return NULL;
+}
+
+void CZScanner::WorkLoop(int worker)
+{
+    int idle = 0;
+    while (!this->Aborting())
+    {
+        CZDirectory* dir = this->_queues[worker].Pop();
+        if (dir == NULL)
+            dir = this->Steal(worker);
+        if (dir != NULL)
+        {
+            dir->ScanDir(this, worker);
+            InterlockedDecrement(&this->_pending);
+            idle = 0;
+            continue;
+        }
+        if (this->_pending == 0) //vse hotovo (nova uloha muze vzniknout jen z rozpracovane)
+            break;
+        Sleep((idle++ < 64) ? 0 : 1);
+    }
+}
+
+void CZScanner::Push(int worker, CZDirectory* dir)
+{
+    InterlockedIncrement(&this->_pending);
+    if (!this->_queues[worker].Push(dir))
+    {
+        //dosla pamet na frontu: nacteme ho hned v tomto threadu
+        dir->ScanDir(this, worker);
+        InterlockedDecrement(&this->_pending);
+    }
+}
+
+void CZScanner::Complete(CZDirectory* dir)
+{
+    while (dir != NULL && InterlockedDecrement(&dir->_pending) == 0)
+    {
+        dir->FinishScan();
+        dir = dir->GetParent();
+    }
+}
@@ -0,0 +1,153 @@
+﻿// SPDX-FileCopyrightText: 2023 Open Salamander Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "System.Lock.h"
+#include "System.WorkerThread.h"
+#include "TreeMap.FileData.CZDirectory.h"
+
+#define SCAN_MAXTHREADS 16
+#define SCAN_QUEUE_BLOCKSIZE 256
+
+class CZDirectory;
+class CZRoot;
+class CZScanner;
+
+// ****************************************************************************
+// CZScanQueue:
+//  -fronta uloh (adresaru) jednoho workeru
+//  -vlastnik pridava a odebira na konci (LIFO = do hloubky, drzi si "teple" cesty),
+//   ostatni thready kradou ze zacatku (nejstarsi ulohy = nejvetsi podstromy)
+
+class CZScanQueue
+{
+protected:
+    CLock _lock;
+    CZDirectory** _items;
+    int _size;  //kapacita
+    int _head;  //index nejstarsi polozky
+    int _count; //pocet polozek
+
+public:
+    CZScanQueue()
+    {
+        this->_items = NULL;
+        this->_size = 0;
+        this->_head = 0;
+        this->_count = 0;
+    }
+    ~CZScanQueue()
+    {
+        if (this->_items)
+            free(this->_items);
+    }
+
+    BOOL Push(CZDirectory* dir)
+    {
+        this->_lock.Enter();
+        if (this->_count == this->_size)
+        {
+            int newsize = this->_size + SCAN_QUEUE_BLOCKSIZE;
+            CZDirectory** items = (CZDirectory**)malloc(newsize * sizeof(CZDirectory*));
+            if (items == NULL)
+            {
+                this->_lock.Leave();
+                return FALSE;
+            }
+            for (int i = 0; i < this->_count; i++)
+                items[i] = this->_items[(this->_head + i) % this->_size];
+            if (this->_items)
+                free(this->_items);
+            this->_items = items;
+            this->_size = newsize;
+            this->_head = 0;
+        }
+        this->_items[(this->_head + this->_count) % this->_size] = dir;
+        this->_count++;
+        this->_lock.Leave();
+        return TRUE;
+    }
+    CZDirectory* Pop()
+    {
+        CZDirectory* dir = NULL;
+        this->_lock.Enter();
+        if (this->_count > 0)
+        {
+            this->_count--;
+            dir = this->_items[(this->_head + this->_count) % this->_size];
+        }
+        this->_lock.Leave();
+        return dir;
+    }
+    CZDirectory* Steal()
+    {
+        if (this->_count == 0) //rychly test bez zamku, nevadi kdyz se splete
+            return NULL;
+        CZDirectory* dir = NULL;
+        this->_lock.Enter();
+        if (this->_count > 0)
+        {
+            dir = this->_items[this->_head];
+            this->_head = (this->_head + 1) % this->_size;
+            this->_count--;
+        }
+        this->_lock.Leave();
+        return dir;
+    }
+};
+
+// ****************************************************************************
+// CZScanner:
+//  -paralelni nacteni stromu adresaru (work-stealing); kazdy adresar je jedna uloha,
+//   jeho podadresare se stanou novymi ulohami
+//  -prvni worker bezi v threadu, ktery zavolal Run(), ostatni ve vlastnich CWorkerThread
+//  -o preruseni rozhoduje 'abortthread' (thread, ktery ridi nacitani), muze byt NULL
+
+class CZScanner
+{
+protected:
+    struct CZScanWorker
+    {
+        CZScanner* Scanner;
+        int Index;
+        CWorkerThread* Thread;
+    };
+
+    CZRoot* _root;
+    CWorkerThread* _abortthread;
+
+    int _workercount;
+    CZScanQueue* _queues;
+    CZScanWorker* _workers;
+
+    volatile LONG _pending; //pocet uloh ve frontach a rozpracovanych
+
+    static DWORD_PTR WINAPI WorkerThreadProc(CWorkerThread* mythread, LPVOID lpParam)
+    {
+        CZScanWorker* worker = (CZScanWorker*)lpParam;
+        worker->Scanner->WorkLoop(worker->Index);
+        return TRUE;
+    }
+
+    void WorkLoop(int worker);
+    CZDirectory* Steal(int worker);
+
+public:
+    CZScanner(CZRoot* root, CWorkerThread* abortthread, int workercount);
+    ~CZScanner();
+
+    static int GetDefaultThreadCount();
+
+    void Run();
+
+    inline BOOL Aborting()
+    {
+        return this->_abortthread != NULL && this->_abortthread->Aborting();
+    }
+
+    //prida podadresar jako novou ulohu do fronty workeru 'worker'
+    void Push(int worker, CZDirectory* dir);
+    //adresar 'dir' (nebo jeho podadresar) je hotovy; pokud je hotovy cely podstrom, dokonci ho (i nadrazene)
+    void Complete(CZDirectory* dir);
+};
@@ -0,0 +1,546 @@
+﻿// SPDX-FileCopyrightText: 2023 Open Salamander Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "precomp.h"
+#include "TreeMap.FileData.CZDirectory.h"
+#include "TreeMap.FileData.CZRoot.h"
+#include "TreeMap.FileData.CZSnapshot.h"
+
+#define DMSNAPSHOT_BUFFERSIZE (1024 * 1024)
+
+//pole snapshotu v poradi, v jakem jsou v souboru
+enum
+{
+    DMSF_NAME,
+    DMSF_NAMEOFFSET,
+    DMSF_CHILDCOUNT,
+    DMSF_FLAGS,
+    DMSF_DATASIZE,
+    DMSF_REALSIZE,
+    DMSF_DISKSIZE,
+    DMSF_CREATETIME,
+    DMSF_MODIFYTIME,
+    DMSF_FILECOUNT,
+    DMSF_DIRCOUNT,
+    DMSF_COUNT
+};
+
+CZSnapshot::CZSnapshot()
+{
+    this->_header = NULL;
+    this->_names = NULL;
+    this->_nameoffset = NULL;
+    this->_childcount = NULL;
+    this->_flags = NULL;
+    this->_datasize = NULL;
+    this->_realsize = NULL;
+    this->_disksize = NULL;
+    this->_createtime = NULL;
+    this->_modifytime = NULL;
+    this->_filecount = NULL;
+    this->_dircount = NULL;
+
+    this->_file = INVALID_HANDLE_VALUE;
+    this->_buffer = NULL;
+    this->_used = 0;
+    this->_error = FALSE;
+
+    this->_node = 0;
+    this->_dir = 0;
+    this->_namepos = 0;
+}
+
+CZSnapshot::~CZSnapshot()
+{
+    if (this->_buffer != NULL)
+        free(this->_buffer);
+}
+
+UINT64 CZSnapshot::GetDataSize(DWORD nodecount, DWORD dircount, DWORD namechars)
+{
+    UINT64 size = Align8((size_t)namechars * sizeof(TCHAR));
+    size += (UINT64)nodecount * (2 * sizeof(DWORD));
+    size += Align8(nodecount);
+    size += (UINT64)nodecount * (3 * sizeof(INT64) + 2 * sizeof(FILETIME));
+    size += (UINT64)dircount * (2 * sizeof(int));
+    return size;
+}
+
+void CZSnapshot::SetPointers(BYTE* data)
+{
+    DWORD nodecount = this->_header->NodeCount;
+    DWORD dircount = this->_header->DirCount;
+
+    this->_names = (TCHAR*)data;
+    data += Align8((size_t)this->_header->NameChars * sizeof(TCHAR));
+    this->_nameoffset = (DWORD*)data;
+    data += (size_t)nodecount * sizeof(DWORD);
+    this->_childcount = (DWORD*)data;
+    data += (size_t)nodecount * sizeof(DWORD);
+    this->_flags = data;
+    data += Align8(nodecount);
+    this->_datasize = (INT64*)data;
+    data += (size_t)nodecount * sizeof(INT64);
+    this->_realsize = (INT64*)data;
+    data += (size_t)nodecount * sizeof(INT64);
+    this->_disksize = (INT64*)data;
+    data += (size_t)nodecount * sizeof(INT64);
+    this->_createtime = (FILETIME*)data;
+    data += (size_t)nodecount * sizeof(FILETIME);
+    this->_modifytime = (FILETIME*)data;
+    data += (size_t)nodecount * sizeof(FILETIME);
+    this->_filecount = (int*)data;
+    data += (size_t)dircount * sizeof(int);
+    this->_dircount = (int*)data;
+}
+
+BOOL CZSnapshot::GetSnapshotFileName(TCHAR const* path, TCHAR* buff, size_t size)
+{
+    TCHAR dir[MAX_PATH];
+    if (SHGetFolderPath(NULL, CSIDL_LOCAL_APPDATA, NULL, 0 /* SHGFP_TYPE_CURRENT */, dir) != S_OK)
+        return FALSE;
+    size_t len = _tcslen(dir);
+    const TCHAR* subdir = TEXT("\\Open Salamander\\DiskMap");
+    if (len + _tcslen(subdir) + 1 + 16 + _tcslen(DMSNAPSHOT_EXT) + 1 > min(size, MAX_PATH))
+        return FALSE;
+    _tcscpy(dir + len, TEXT("\\Open Salamander"));
+    CreateDirectory(dir, NULL); //pokud uz existuje, nevadi
+    _tcscpy(dir + len, subdir);
+    CreateDirectory(dir, NULL);
+
+    //FNV-1a z cesty prevedene na velka pismena (cesty se porovnavaji bez ohledu na velikost pismen)
+    UINT64 hash = 14695981039346656037ULL;
+    TCHAR ch[2];
+    ch[1] = TEXT('\0');
+    for (TCHAR const* s = path; *s != TEXT('\0'); s++)
+    {
+        ch[0] = *s;
+        CharUpperBuff(ch, 1);
+        hash ^= (UINT64)ch[0];
+        hash *= 1099511628211ULL;
+    }
+    _stprintf(buff, TEXT("%s\\%016I64X%s"), dir, hash, DMSNAPSHOT_EXT);
+    return TRUE;
+}
+
+void CZSnapshot::CountNodes(CZDirectory* dir, DWORD& nodecount, DWORD& dircount, DWORD& namechars)
+{
+    int cnt = dir->GetFileCount();
+    for (int i = 0; i < cnt; i++)
+    {
+        CZFile* f = dir->GetFile(i);
+        nodecount++;
+        namechars += (DWORD)f->GetNameLen() + 1;
+        if (f->IsDirectory())
+        {
+            dircount++;
+            this->CountNodes((CZDirectory*)f, nodecount, dircount, namechars);
+        }
+    }
+}
+
+void CZSnapshot::Flush()
+{
+    if (this->_used > 0 && !this->_error)
+    {
+        DWORD written;
+        if (!WriteFile(this->_file, this->_buffer, this->_used, &written, NULL) || written != this->_used)
+            this->_error = TRUE;
+    }
+    this->_used = 0;
+}
+
+void CZSnapshot::Write(const void* data, DWORD size)
+{
+    const BYTE* src = (const BYTE*)data;
+    while (size > 0)
+    {
+        if (this->_used == DMSNAPSHOT_BUFFERSIZE)
+            this->Flush();
+        DWORD part = min(size, DMSNAPSHOT_BUFFERSIZE - this->_used);
+        memcpy(this->_buffer + this->_used, src, part);
+        this->_used += part;
+        src += part;
+        size -= part;
+    }
+}
+
+void CZSnapshot::Pad8(UINT64 written)
+{
+    static const BYTE zeros[8] = {0};
+    if (written % 8 != 0)
+        this->Write(zeros, (DWORD)(8 - written % 8));
+}
+
+void CZSnapshot::WriteField(CZFile* file, int field)
+{
+    BOOL isDir = file->IsDirectory();
+    switch (field)
+    {
+    case DMSF_NAME:
+        this->Write(file->GetName(), (DWORD)((file->GetNameLen() + 1) * sizeof(TCHAR)));
+        break;
+    case DMSF_NAMEOFFSET:
+        this->Write(&this->_namepos, sizeof(DWORD));
+        this->_namepos += (DWORD)file->GetNameLen() + 1;
+        break;
+    case DMSF_CHILDCOUNT:
+    {
+        DWORD count = isDir ? (DWORD)((CZDirectory*)file)->GetFileCount() : 0;
+        this->Write(&count, sizeof(DWORD));
+        break;
+    }
+    case DMSF_FLAGS:
+    {
+        BYTE flags = isDir ? DMSNAPSHOT_FLAG_DIRECTORY : 0;
+        this->Write(&flags, sizeof(BYTE));
+        break;
+    }
+    case DMSF_DATASIZE:
+    case DMSF_REALSIZE:
+    case DMSF_DISKSIZE:
+    {
+        INT64 size = file->GetSizeEx(field == DMSF_DATASIZE ? FILESIZE_DATA : field == DMSF_REALSIZE ? FILESIZE_REAL : FILESIZE_DISK);
+        this->Write(&size, sizeof(INT64));
+        break;
+    }
+    case DMSF_CREATETIME:
+        this->Write(file->GetCreateTime(), sizeof(FILETIME));
+        break;
+    case DMSF_MODIFYTIME:
+        this->Write(file->GetModifyTime(), sizeof(FILETIME));
+        break;
+    case DMSF_FILECOUNT:
+    case DMSF_DIRCOUNT:
+        if (isDir)
+        {
+            int count = (field == DMSF_FILECOUNT) ? ((CZDirectory*)file)->GetSubFileCount() : ((CZDirectory*)file)->GetSubDirsCount();
+            this->Write(&count, sizeof(int));
+        }
+        break;
+    }
+    if (isDir)
+    {
+        CZDirectory* dir = (CZDirectory*)file;
+        int cnt = dir->GetFileCount();
+        for (int i = 0; i < cnt && !this->_error; i++)
+            this->WriteField(dir->GetFile(i), field);
+    }
+}
+
+BOOL CZSnapshot::Save(CZRoot* root)
+{
+    TCHAR fileName[MAX_PATH + 8];
+    if (!GetSnapshotFileName(root->GetName(), fileName, MAX_PATH))
+        return FALSE;
+
+    CZSnapshot snap;
+    snap._buffer = (BYTE*)malloc(DMSNAPSHOT_BUFFERSIZE);
+    if (snap._buffer == NULL)
+        return FALSE;
+
+    CZSnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    header.Magic = DMSNAPSHOT_MAGIC;
+    header.Version = DMSNAPSHOT_VERSION;
+    header.CharSize = sizeof(TCHAR);
+    header.NodeCount = 1;
+    header.DirCount = 1;
+    header.NameChars = (DWORD)root->GetNameLen() + 1;
+    snap.CountNodes(root, header.NodeCount, header.DirCount, header.NameChars);
+    header.SortOrder = root->GetSortOrder();
+    header.ClusterSize = root->_clustersize;
+    GetSystemTimeAsFileTime(&header.ScanTime);
+
+    if (sizeof(CZSnapshotHeader) + GetDataSize(header.NodeCount, header.DirCount, header.NameChars) > DMSNAPSHOT_CACHELIMIT)
+    { //takovy snapshot necachujeme (a stary uz neodpovida), pristi otevreni strom znovu nacte
+        DeleteFile(fileName);
+        return TRUE;
+    }
+
+    //zapisujeme do docasneho souboru, nedokonceny snapshot nesmi prepsat platny
+    TCHAR tmpName[MAX_PATH + 8];
+    _stprintf(tmpName, TEXT("%s.tmp"), fileName);
+    snap._file = CreateFile(tmpName, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (snap._file == INVALID_HANDLE_VALUE)
+        return FALSE;
+
+    snap.Write(&header, sizeof(header));
+    for (int field = 0; field < DMSF_COUNT && !snap._error; field++)
+    {
+        snap.WriteField(root, field);
+        if (field == DMSF_NAME)
+            snap.Pad8((UINT64)header.NameChars * sizeof(TCHAR));
+        if (field == DMSF_FLAGS)
+            snap.Pad8(header.NodeCount);
+    }
+    snap.Flush();
+    CloseHandle(snap._file);
+    snap._file = INVALID_HANDLE_VALUE;
+
+    if (snap._error || !MoveFileEx(tmpName, fileName, MOVEFILE_REPLACE_EXISTING))
+    {
+        DeleteFile(tmpName);
+        return FALSE;
+    }
+    TrimCache(fileName);
+    return TRUE;
+}
+
+void CZSnapshot::TrimCache(TCHAR const* keep)
+{
+    TCHAR mask[MAX_PATH + 8];
+    _tcscpy(mask, keep);
+    TCHAR* name = _tcsrchr(mask, TEXT('\\'));
+    if (name == NULL)
+        return;
+    name++;
+    TCHAR const* keepName = keep + (name - mask);
+
+    while (1)
+    {
+        //jeden pruchod: celkova velikost a nejdele nepouzity snapshot
+        _stprintf(name, TEXT("*%s"), DMSNAPSHOT_EXT);
+        WIN32_FIND_DATA fd;
+        HANDLE hFind = FindFirstFile(mask, &fd);
+        if (hFind == INVALID_HANDLE_VALUE)
+            return;
+        UINT64 total = 0;
+        TCHAR oldest[MAX_PATH];
+        FILETIME oldestTime;
+        oldestTime.dwLowDateTime = oldestTime.dwHighDateTime = 0;
+        oldest[0] = TEXT('\0');
+        do
+        {
+            if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+                continue;
+            total += ((UINT64)fd.nFileSizeHigh << 32) | fd.nFileSizeLow;
+            if (_tcsicmp(fd.cFileName, keepName) != 0 &&
+                (oldest[0] == TEXT('\0') || CompareFileTime(&fd.ftLastWriteTime, &oldestTime) < 0))
+            {
+                lstrcpyn(oldest, fd.cFileName, MAX_PATH);
+                oldestTime = fd.ftLastWriteTime;
+            }
+        } while (FindNextFile(hFind, &fd));
+        FindClose(hFind);
+
+        if (total <= DMSNAPSHOT_CACHELIMIT || oldest[0] == TEXT('\0') ||
+            _tcslen(oldest) + (name - mask) >= MAX_PATH)
+        {
+            return;
+        }
+        _tcscpy(name, oldest);
+        if (!DeleteFile(mask))
+            return; //napr. ho prave cte jina instance, zkusime to pri dalsim ukladani
+    }
+}
+
+BOOL CZSnapshot::LoadDir(DWORD index, CZDirectory* dir, TAutoIndirectArray<CZFile>* files, int depth)
+{
+    if (depth > MAX_PATH) //kazda uroven pridava do cesty aspon dva znaky, poskozeny soubor
+        return FALSE;
+
+    DWORD count = this->_childcount[index];
+    for (DWORD i = 0; i < count; i++)
+    {
+        if (this->_node >= this->_header->NodeCount)
+            return FALSE;
+        DWORD n = this->_node++;
+        if (this->_nameoffset[n] >= this->_header->NameChars)
+            return FALSE;
+        TCHAR const* name = this->_names + this->_nameoffset[n];
+
+        if (this->_flags[n] & DMSNAPSHOT_FLAG_DIRECTORY)
+        {
+            if (this->_dir >= this->_header->DirCount)
+                return FALSE;
+            DWORD d = this->_dir++;
+
+            CZDirectory* sub = new CZDirectory(dir, name, &this->_createtime[n], &this->_modifytime[n]);
+            sub->_datasize = this->_datasize[n];
+            sub->_realsize = this->_realsize[n];
+            sub->_disksize = this->_disksize[n];
+            sub->_filecount = this->_filecount[d];
+            sub->_dircount = this->_dircount[d];
+            sub->_pending = 0; //hotovy podstrom (pro pristi inkrementalni skenovani)
+            files->Add(sub);
+            if (!this->LoadDir(n, sub, sub->_files, depth + 1))
+                return FALSE;
+        }
+        else
+        {
+            if (this->_childcount[n] != 0)
+                return FALSE;
+            files->Add(new CZFile(dir, name, this->_datasize[n], this->_realsize[n], this->_disksize[n],
+                                  &this->_createtime[n], &this->_modifytime[n]));
+        }
+    }
+    return TRUE;
+}
+
+static int __cdecl CompareFileNames(const void* a, const void* b)
+{
+    return _tcsicmp((*(CZFile* const*)a)->GetName(), (*(CZFile* const*)b)->GetName());
+}
+
+static int __cdecl FindFileName(const void* name, const void* item)
+{
+    return _tcsicmp((const TCHAR*)name, (*(CZFile* const*)item)->GetName());
+}
+
+BOOL CZSnapshot::IsListingCurrent(CZDirectory* dir, TAutoIndirectArray<CZFile>* files)
+{
+    TCHAR path[MAX_PATH + 2];
+    size_t pos = dir->GetFullName(path, MAX_PATH - 2);
+    if (pos == 0 || pos >= MAX_PATH - 2)
+        return FALSE;
+    if (path[pos - 1] != TEXT('\\'))
+        path[pos++] = TEXT('\\');
+    path[pos++] = TEXT('*');
+    path[pos] = TEXT('\0');
+
+    int cnt = files->GetCount();
+    CZFile** sorted = (CZFile**)malloc(max(cnt, 1) * sizeof(CZFile*));
+    if (sorted == NULL)
+        return FALSE;
+    for (int i = 0; i < cnt; i++)
+        sorted[i] = files->At(i);
+    qsort(sorted, cnt, sizeof(CZFile*), CompareFileNames);
+
+    WIN32_FIND_DATA FindFileData;
+    HANDLE hFind = FindFirstFile(path, &FindFileData);
+    BOOL ret = hFind != INVALID_HANDLE_VALUE;
+    if (ret)
+    {
+        int found = 0;
+        do
+        {
+            if (FindFileData.cFileName[0] == '.' && (FindFileData.cFileName[1] == '\0' || (FindFileData.cFileName[1] == '.' && FindFileData.cFileName[2] == '\0')))
+                continue;
+            //stejne jako scanner: reparse pointy a prazdne soubory ve strome nejsou
+            BOOL isDir = (FindFileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+            if (isDir && (FindFileData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0)
+                continue;
+            INT64 datasize = ((INT64)FindFileData.nFileSizeHigh * ((INT64)(MAXDWORD) + 1)) + FindFileData.nFileSizeLow;
+            if (!isDir && datasize == 0)
+                continue;
+            CZFile** f = (CZFile**)bsearch(FindFileData.cFileName, sorted, cnt, sizeof(CZFile*), FindFileName);
+            if (f == NULL || (*f)->IsDirectory() != isDir ||
+                CompareFileTime((*f)->GetModifyTime(), &FindFileData.ftLastWriteTime) != 0 ||
+                (!isDir && (*f)->GetSizeEx(FILESIZE_DATA) != datasize))
+            {
+                ret = FALSE;
+                break;
+            }
+            found++;
+        } while (FindNextFile(hFind, &FindFileData) != 0);
+        if (ret && (GetLastError() != ERROR_NO_MORE_FILES || found != cnt))
+            ret = FALSE; //chyba cteni nebo nektere polozky na disku uz nejsou
+        FindClose(hFind);
+    }
+    free(sorted);
+    return ret;
+}
+
+BOOL CZSnapshot::Load(CZRoot* root)
+{
+    TCHAR fileName[MAX_PATH + 8];
+    if (!GetSnapshotFileName(root->GetName(), fileName, MAX_PATH))
+        return FALSE;
+
+    //FILE_WRITE_ATTRIBUTES: po nacteni posuneme cas posledniho zapisu (LRU v TrimCache)
+    HANDLE hFile = CreateFile(fileName, GENERIC_READ | FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return FALSE;
+
+    BOOL ret = FALSE;
+    LARGE_INTEGER fileSize;
+    HANDLE hMap = NULL;
+    BYTE* view = NULL;
+    if (GetFileSizeEx(hFile, &fileSize) && fileSize.QuadPart >= (LONGLONG)sizeof(CZSnapshotHeader) &&
+        (UINT64)fileSize.QuadPart <= DMSNAPSHOT_CACHELIMIT)
+    {
+        //v 32-bitove verzi se velky snapshot nemusi vejit do adresoveho prostoru; pak
+        //vracime FALSE a strom se nacte znovu skenovanim
+        hMap = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (hMap != NULL)
+            view = (BYTE*)MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0);
+        if (view == NULL)
+            TRACE_E("CZSnapshot::Load(): unable to map snapshot, error " << GetLastError());
+    }
+    if (view != NULL)
+    {
+        CZSnapshot snap;
+        CZSnapshotHeader* header = (CZSnapshotHeader*)view;
+        //hlavicka i vsechny pozice se overuji drive, nez se pouziji (soubor muze byt
+        //zkraceny nebo poskozeny); pozice jmen potomku overuje LoadDir
+        if (header->Magic == DMSNAPSHOT_MAGIC && header->Version == DMSNAPSHOT_VERSION &&
+            header->CharSize == sizeof(TCHAR) && header->SortOrder == root->GetSortOrder() &&
+            header->NodeCount >= 1 && header->DirCount >= 1 && header->DirCount <= header->NodeCount &&
+            header->NameChars >= 1 &&
+            (UINT64)fileSize.QuadPart == sizeof(CZSnapshotHeader) + GetDataSize(header->NodeCount, header->DirCount, header->NameChars))
+        {
+            snap._header = header;
+            snap.SetPointers(view + sizeof(CZSnapshotHeader));
+
+            if (snap._names[header->NameChars - 1] == TEXT('\0') && // vsechna jmena jsou ukoncena
+                snap._nameoffset[0] < header->NameChars &&
+                (snap._flags[0] & DMSNAPSHOT_FLAG_DIRECTORY) != 0 &&
+                _tcsicmp(snap._names + snap._nameoffset[0], root->GetName()) == 0)
+            {
+                //strom stavime mimo koren a publikujeme najednou (progresivni zobrazeni muze cist koren)
+                TAutoIndirectArray<CZFile>* files = new TAutoIndirectArray<CZFile>(ARRAY_BLOCKSIZE_CFILELIST, TRUE);
+                snap._node = 1;
+                snap._dir = 1;
+                BOOL current = snap.LoadDir(0, root, files, 0) && snap._node == header->NodeCount && snap._dir == header->DirCount;
+                if (current)
+                {
+                    //zastaraly snapshot nepouzijeme: jina velikost clusteru (jine velikosti na disku),
+                    //prilis stary snapshot nebo zmeny v korenu ci v adresarich prvni urovne (obsah
+                    //adresaru hloubeji se nekontroluje, viz DMSNAPSHOT_MAXAGE)
+                    FILETIME now;
+                    GetSystemTimeAsFileTime(&now);
+                    UINT64 scanTime = ((UINT64)header->ScanTime.dwHighDateTime << 32) | header->ScanTime.dwLowDateTime;
+                    UINT64 nowTime = ((UINT64)now.dwHighDateTime << 32) | now.dwLowDateTime;
+                    current = header->ClusterSize == (int)root->GetDiskSize(1) &&
+                              nowTime >= scanTime && nowTime - scanTime <= DMSNAPSHOT_MAXAGE &&
+                              IsListingCurrent(root, files);
+                    for (int i = 0; current && i < files->GetCount(); i++)
+                    {
+                        CZFile* f = files->At(i);
+                        if (f->IsDirectory())
+                            current = IsListingCurrent((CZDirectory*)f, ((CZDirectory*)f)->_files);
+                    }
+                    if (!current)
+                        TRACE_I("CZSnapshot::Load(): snapshot is out of date, rescanning");
+                }
+                if (current)
+                {
+                    root->EnterPublish();
+                    TAutoIndirectArray<CZFile>* empty = root->_files;
+                    root->_files = files;
+                    root->AddTotals(snap._filecount[0], snap._dircount[0], snap._datasize[0], snap._realsize[0], snap._disksize[0]);
+                    root->_pending = 0;
+                    root->LeavePublish();
+                    delete empty;
+
+                    root->IncStats(snap._filecount[0], snap._dircount[0], root->GetSizeEx(root->GetSortOrder()));
+                    ret = TRUE;
+
+                    FILETIME now;
+                    GetSystemTimeAsFileTime(&now);
+                    SetFileTime(hFile, NULL, NULL, &now);
+                }
+                else
+                {
+                    delete files;
+                }
+            }
+        }
+        UnmapViewOfFile(view);
+    }
+    if (hMap != NULL)
+        CloseHandle(hMap);
+    CloseHandle(hFile);
+    return ret;
+}
@@ -0,0 +1,110 @@
+﻿// SPDX-FileCopyrightText: 2023 Open Salamander Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "TreeMap.FileData.CZDirectory.h"
+
+#define DMSNAPSHOT_MAGIC 0x50534D44 // "DMSP"
+#define DMSNAPSHOT_VERSION 1
+#define DMSNAPSHOT_EXT TEXT(".dmsnap")
+
+//limit celkove velikosti cache adresare se snapshoty; pri prekroceni se mazou snapshoty,
+//ktere se nejdele nepouzily (pri nacteni se snapshotu aktualizuje cas posledniho zapisu);
+//snapshot vetsi nez limit se vubec neuklada
+#define DMSNAPSHOT_CACHELIMIT ((UINT64)256 * 1024 * 1024)
+
+//starsi snapshot se nepouzije (strom se naskenuje znovu), v jednotkach FILETIME (24 hodin)
+#define DMSNAPSHOT_MAXAGE ((UINT64)24 * 60 * 60 * 10000000)
+
+#define DMSNAPSHOT_FLAG_DIRECTORY 0x01
+
+class CZDirectory;
+class CZRoot;
+
+// ****************************************************************************
+// Snapshot nacteneho stromu (ulozeny v cache adresari, jeden soubor na cestu):
+//
+//  CZSnapshotHeader
+//  TCHAR  Names[NameChars]        - tabulka jmen (vsechna ukoncena nulou), zarovnano na 8
+//  DWORD  NameOffset[NodeCount]   - pozice jmena v tabulce
+//  DWORD  ChildCount[NodeCount]   - pocet primych potomku (u souboru 0)
+//  BYTE   Flags[NodeCount]        - DMSNAPSHOT_FLAG_xxx, zarovnano na 8
+//  INT64  DataSize[NodeCount], RealSize[NodeCount], DiskSize[NodeCount]
+//  FILETIME CreateTime[NodeCount], ModifyTime[NodeCount]
+//  int    FileCount[DirCount], DirCount[DirCount] - jen pro adresare, v poradi adresaru
+//
+//  Uzly jsou v poradi pre-order (0 = koren), potomci adresare nasleduji hned za nim.
+
+struct CZSnapshotHeader
+{
+    DWORD Magic;
+    WORD Version;
+    WORD CharSize; // sizeof(TCHAR) pri ukladani
+    DWORD NodeCount;
+    DWORD DirCount;
+    DWORD NameChars;
+    int SortOrder;
+    int ClusterSize;
+    DWORD Reserved;
+    FILETIME ScanTime;
+};
+
+class CZSnapshot
+{
+protected:
+    //cteni: ukazatele do namapovaneho souboru
+    CZSnapshotHeader* _header;
+    TCHAR* _names;
+    DWORD* _nameoffset;
+    DWORD* _childcount;
+    BYTE* _flags;
+    INT64* _datasize;
+    INT64* _realsize;
+    INT64* _disksize;
+    FILETIME* _createtime;
+    FILETIME* _modifytime;
+    int* _filecount;
+    int* _dircount;
+
+    //zapis: pole se zapisuji postupne (jeden pruchod stromem na pole), aby se snapshot
+    //nemusel cely sestavit v pameti
+    HANDLE _file;
+    BYTE* _buffer;
+    DWORD _used;
+    BOOL _error;
+
+    //pozice pri zapisu/cteni
+    DWORD _node;
+    DWORD _dir;
+    DWORD _namepos;
+
+    static size_t Align8(size_t size) { return (size + 7) & ~(size_t)7; }
+    static UINT64 GetDataSize(DWORD nodecount, DWORD dircount, DWORD namechars);
+    void SetPointers(BYTE* data);
+
+    void CountNodes(CZDirectory* dir, DWORD& nodecount, DWORD& dircount, DWORD& namechars);
+    void Write(const void* data, DWORD size);
+    void Pad8(UINT64 written);
+    void Flush();
+    void WriteField(CZFile* file, int field);
+    BOOL LoadDir(DWORD index, CZDirectory* dir, TAutoIndirectArray<CZFile>* files, int depth);
+
+    //porovna primy obsah adresare 'dir' ('files' z nacteneho snapshotu) s diskem: stejne
+    //polozky, u souboru stejna velikost a cas zapisu, u adresaru cas zapisu
+    static BOOL IsListingCurrent(CZDirectory* dir, TAutoIndirectArray<CZFile>* files);
+
+    //maze nejdele nepouzite snapshoty z cache adresare, dokud jejich celkova velikost
+    //presahuje DMSNAPSHOT_CACHELIMIT; snapshot 'keep' (prave ulozeny) se nemaze
+    static void TrimCache(TCHAR const* keep);
+
+    CZSnapshot();
+    ~CZSnapshot();
+
+public:
+    //jmeno souboru se snapshotem pro danou cestu (v cache adresari pluginu)
+    static BOOL GetSnapshotFileName(TCHAR const* path, TCHAR* buff, size_t size);
+
+    static BOOL Save(CZRoot* root);
+    static BOOL Load(CZRoot* root);
+};
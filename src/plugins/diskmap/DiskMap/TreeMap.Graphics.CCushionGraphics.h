@@ -4,6 +4,7 @@
 #pragma once
 
 #include <xmmintrin.h>
+#include <emmintrin.h>
 
 // opatreni proti runtime check failure v debug verzi: puvodni verze makra pretypovava rgb na WORD,
 // takze hlasi ztratu dat (RED slozky)
@@ -383,12 +384,54 @@ public:
     }
 
 private:
+    //SSE2 verze: 8 pixelu najednou, vysledek je stejny jako z atab
+    //zdroj: 8x WORD (maska v dolnim, alfa v hornim bajtu); atab[alfa][c] = (alfa * c) / 255,
+    //pro x <= 255 * 255 plati x / 255 == (x + 1 + (x >> 8)) >> 8
+    static __forceinline __m128i Div255(__m128i x)
+    {
+        return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_srli_epi16(x, 8)), 8);
+    }
+    static __forceinline void ShadePixels8(unsigned int* dst, __m128i src, __m128i cr, __m128i cg, __m128i cb)
+    {
+        __m128i mask = _mm_and_si128(src, _mm_set1_epi16(0x00FF));
+        __m128i alpha = _mm_srli_epi16(src, 8);
+
+        __m128i vb = _mm_add_epi16(Div255(_mm_mullo_epi16(alpha, cb)), mask);
+        __m128i vg = _mm_add_epi16(Div255(_mm_mullo_epi16(alpha, cg)), mask);
+        __m128i vr = _mm_add_epi16(Div255(_mm_mullo_epi16(alpha, cr)), mask);
+
+        //soucet se vejde do bajtu (maska je premultiplikovana doplnkem alfy), takze staci posuny
+        __m128i bg = _mm_or_si128(vb, _mm_slli_epi16(vg, 8));
+        _mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi16(bg, vr));
+        _mm_storeu_si128((__m128i*)(dst + 4), _mm_unpackhi_epi16(bg, vr));
+    }
+    static __forceinline int NextSample(BYTE const*& src, unsigned int& cx, unsigned int dx)
+    {
+        int sample = *(WORD const*)src;
+        cx += dx;
+        src += (cx >> 16) << 1;
+        cx &= 0xFFff;
+        return sample;
+    }
+
     __forceinline void DrawLinePartSimple(BYTE* dst, BYTE const* src, unsigned int const* atab, unsigned int width, int r, int g, int b)
     {
         unsigned int* pi = (unsigned int*)dst;
 
-        unsigned int j;
-        for (j = 0; j < width; j++)
+        unsigned int j = 0;
+        if (width >= 8)
+        {
+            __m128i cr = _mm_set1_epi16((short)r);
+            __m128i cg = _mm_set1_epi16((short)g);
+            __m128i cb = _mm_set1_epi16((short)b);
+            for (; j + 8 <= width; j += 8)
+            {
+                ShadePixels8(pi, _mm_loadu_si128((__m128i const*)src), cr, cg, cb);
+                pi += 8;
+                src += 16;
+            }
+        }
+        for (; j < width; j++)
         {
             unsigned int mask = *src++;
             unsigned int alpha = *src++;
@@ -406,8 +449,28 @@ private:
         unsigned int dx = (sourcewidth << 16) / width;
         unsigned int cx = 0;
 
-        unsigned int j;
-        for (j = 0; j < width; j++)
+        unsigned int j = 0;
+        if (width >= 8)
+        {
+            __m128i cr = _mm_set1_epi16((short)r);
+            __m128i cg = _mm_set1_epi16((short)g);
+            __m128i cb = _mm_set1_epi16((short)b);
+            for (; j + 8 <= width; j += 8)
+            {
+                //zdroj se pri roztahovani neprochazi souvisle, vzorky posbirame po jednom
+                __m128i s = _mm_cvtsi32_si128(NextSample(src, cx, dx));
+                s = _mm_insert_epi16(s, NextSample(src, cx, dx), 1);
+                s = _mm_insert_epi16(s, NextSample(src, cx, dx), 2);
+                s = _mm_insert_epi16(s, NextSample(src, cx, dx), 3);
+                s = _mm_insert_epi16(s, NextSample(src, cx, dx), 4);
+                s = _mm_insert_epi16(s, NextSample(src, cx, dx), 5);
+                s = _mm_insert_epi16(s, NextSample(src, cx, dx), 6);
+                s = _mm_insert_epi16(s, NextSample(src, cx, dx), 7);
+                ShadePixels8(pi, s, cr, cg, cb);
+                pi += 8;
+            }
+        }
+        for (; j < width; j++)
         {
             unsigned int mask = *src;
             unsigned int alpha = *(src + 1);
@@ -464,12 +527,16 @@ private:
     }
 
 public:
-    BOOL DrawCushion(BYTE* tBits, unsigned int pw, unsigned int ph, int cshx, int cshy, int cshw, int cshh, COLORREF color)
+    //clipTop/clipBottom: kresli se jen radky v <clipTop, clipBottom), ostatni se jen preskoci
+    //(stejne vzorkovani zdroje jako bez orezu, viz CTileRenderer)
+    BOOL DrawCushion(BYTE* tBits, unsigned int pw, unsigned int ph, int cshx, int cshy, int cshw, int cshh, COLORREF color,
+                     int clipTop = 0, int clipBottom = INT_MAX)
     {
         BYTE r, g, b;
         BYTE const* spa;
         int dy;
         int cy;
+        int y;
 
 #ifdef _DEBUG
         if (cshx < 0)
@@ -491,6 +558,8 @@ public:
             return FALSE;
         if (cshh < 1)
             return FALSE;
+        if (cshy >= clipBottom || cshy + cshh <= clipTop)
+            return TRUE;
 
         r = GetRValue(color);
         g = GetGValue(color);
@@ -500,9 +569,11 @@ public:
 
         if (cshh == 1 || cshw == 1 || this->_pix == NULL)
         {
-            tBits += 4 * pw * cshy;
+            int top = max(cshy, clipTop);
+            int bottom = min(cshy + cshh, clipBottom);
+            tBits += 4 * pw * top;
             tBits += 4 * cshx;
-            for (int i = 0; i < cshh; i++)
+            for (int i = top; i < bottom; i++)
             {
                 for (int j = 0; j < cshw; j++)
                 {
@@ -521,6 +592,7 @@ public:
             spa = this->_pix;
             tBits += 4 * pw * cshy;
             tBits += 4 * cshx;
+            y = cshy;
             if (cshh <= this->_fixed_top + this->_fixed_bottom)
             {
                 int tp = cshh * this->_fixed_top / (this->_fixed_top + this->_fixed_bottom);
@@ -532,42 +604,47 @@ public:
                     else
                         bp++;
                 }
-                for (i = 0; i < tp; i++)
+                for (i = 0; i < tp; i++, y++)
                 {
-                    DrawLine(tBits, spa, this->_alphaTable, this->_width, this->_fixed_left, this->_fixed_right, cshw, r, g, b);
+                    if (y >= clipTop && y < clipBottom)
+                        DrawLine(tBits, spa, this->_alphaTable, this->_width, this->_fixed_left, this->_fixed_right, cshw, r, g, b);
                     tBits += 4 * pw;
                     spa += this->_width << 1;
                 }
                 spa = this->_pix + ((this->_width * (this->_height - bp)) << 1);
-                for (i = 0; i < bp; i++)
+                for (i = 0; i < bp; i++, y++)
                 {
-                    DrawLine(tBits, spa, this->_alphaTable, this->_width, this->_fixed_left, this->_fixed_right, cshw, r, g, b);
+                    if (y >= clipTop && y < clipBottom)
+                        DrawLine(tBits, spa, this->_alphaTable, this->_width, this->_fixed_left, this->_fixed_right, cshw, r, g, b);
                     tBits += 4 * pw;
                     spa += this->_width << 1;
                 }
             }
             else
             {
-                for (i = 0; i < this->_fixed_top; i++)
+                for (i = 0; i < this->_fixed_top; i++, y++)
                 {
-                    DrawLine(tBits, spa, this->_alphaTable, this->_width, this->_fixed_left, this->_fixed_right, cshw, r, g, b);
+                    if (y >= clipTop && y < clipBottom)
+                        DrawLine(tBits, spa, this->_alphaTable, this->_width, this->_fixed_left, this->_fixed_right, cshw, r, g, b);
                     tBits += 4 * pw;
                     spa += this->_width << 1;
                 }
                 dy = ((this->_height - (this->_fixed_top + this->_fixed_bottom)) << 16) / (cshh - (this->_fixed_top + this->_fixed_bottom));
                 cy = 0;
-                for (i = 0; i < cshh - (this->_fixed_top + this->_fixed_bottom); i++)
+                for (i = 0; i < cshh - (this->_fixed_top + this->_fixed_bottom); i++, y++)
                 {
-                    DrawLine(tBits, spa, this->_alphaTable, this->_width, this->_fixed_left, this->_fixed_right, cshw, r, g, b);
+                    if (y >= clipTop && y < clipBottom)
+                        DrawLine(tBits, spa, this->_alphaTable, this->_width, this->_fixed_left, this->_fixed_right, cshw, r, g, b);
                     tBits += 4 * pw;
                     cy += dy;
                     spa += ((cy >> 16) * this->_width) << 1;
                     cy &= 0xFFFF;
                 }
                 spa = this->_pix + ((this->_width * (this->_height - this->_fixed_bottom)) << 1);
-                for (i = 0; i < this->_fixed_bottom; i++)
+                for (i = 0; i < this->_fixed_bottom; i++, y++)
                 {
-                    DrawLine(tBits, spa, this->_alphaTable, this->_width, this->_fixed_left, this->_fixed_right, cshw, r, g, b);
+                    if (y >= clipTop && y < clipBottom)
+                        DrawLine(tBits, spa, this->_alphaTable, this->_width, this->_fixed_left, this->_fixed_right, cshw, r, g, b);
                     tBits += 4 * pw;
                     spa += this->_width << 1;
                 }
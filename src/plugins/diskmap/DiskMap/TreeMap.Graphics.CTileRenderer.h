@@ -0,0 +1,134 @@
+﻿// SPDX-FileCopyrightText: 2023 Open Salamander Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "Utils.Array.h"
+#include "System.WorkerThread.h"
+#include "TreeMap.Graphics.CCushionGraphics.h"
+
+#define TILE_MAXTHREADS 8
+#define TILE_MINHEIGHT 32        //nizsi pasy se nevyplati (kazdy pas prochazi cely seznam cushionu)
+#define TILE_BANDSPERTHREAD 4    //vic pasu nez threadu, aby se prace rozlozila i pri nerovnomerne hustote
+#define TILE_MINPARALLELITEMS 64 //pro par cushionu se thready nevyplati
+#define ARRAY_BLOCKSIZE_DRAWLIST 4096
+
+struct CCushionDrawItem
+{
+    int X;
+    int Y;
+    int W;
+    int H;
+    COLORREF Color;
+};
+
+// ****************************************************************************
+// CTileRenderer: vykresleni cushionu do bitmapy po vodorovnych pasech
+//  -nejdriv se projde strom a posbiraji se cushiony (Add), pak se pasy rozdeli mezi thready;
+//   kazdy pas kresli jen svoje radky, takze se thready v bitmape nepotkaji
+//  -vysledek je stejny jako pri kresleni po jednom (viz clip v CCushionGraphics::DrawCushion)
+
+class CTileRenderer
+{
+protected:
+    CCushionGraphics* _graphics;
+    TAutoDirectArray<CCushionDrawItem> _items;
+
+    BYTE* _pix;
+    int _width;
+    int _height;
+    int _bandheight;
+    int _bandcount;
+    volatile LONG _nextband;
+
+    static DWORD_PTR WINAPI TileThreadProc(CWorkerThread* mythread, LPVOID lpParam)
+    {
+        ((CTileRenderer*)lpParam)->RenderBands();
+        return TRUE;
+    }
+    void RenderBands()
+    {
+        LONG band;
+        while ((band = InterlockedIncrement(&this->_nextband) - 1) < this->_bandcount)
+        {
+            int top = band * this->_bandheight;
+            int bottom = min(top + this->_bandheight, this->_height);
+            int cnt = this->_items.GetCount();
+            for (int i = 0; i < cnt; i++)
+            {
+                CCushionDrawItem& item = this->_items[i];
+                if (item.Y < bottom && item.Y + item.H > top)
+                    this->_graphics->DrawCushion(this->_pix, this->_width, this->_height, item.X, item.Y, item.W, item.H, item.Color, top, bottom);
+            }
+        }
+    }
+
+public:
+    CTileRenderer(CCushionGraphics* graphics) : _items(ARRAY_BLOCKSIZE_DRAWLIST)
+    {
+        this->_graphics = graphics;
+        this->_pix = NULL;
+        this->_width = 0;
+        this->_height = 0;
+        this->_bandheight = 0;
+        this->_bandcount = 0;
+        this->_nextband = 0;
+    }
+
+    static int GetDefaultThreadCount()
+    {
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        return max(1, min((int)si.dwNumberOfProcessors, TILE_MAXTHREADS));
+    }
+
+    void Add(int x, int y, int w, int h, COLORREF color)
+    {
+        CCushionDrawItem item;
+        item.X = x;
+        item.Y = y;
+        item.W = w;
+        item.H = h;
+        item.Color = color;
+        if (this->_items.Add(item) < 0) //nedostatek pameti: nakreslime hned
+            this->_graphics->DrawCushion(this->_pix, this->_width, this->_height, x, y, w, h, color);
+    }
+
+    void Begin(BYTE* pix, int width, int height)
+    {
+        this->_items.Destroy();
+        this->_pix = pix;
+        this->_width = width;
+        this->_height = height;
+    }
+
+    //vykresli posbirane cushiony a seznam vyprazdni
+    void Render()
+    {
+        int threads = GetDefaultThreadCount();
+        if (this->_items.GetCount() < TILE_MINPARALLELITEMS)
+            threads = 1;
+        threads = max(1, min(threads, this->_height / TILE_MINHEIGHT));
+
+        this->_bandcount = (threads == 1) ? 1 : threads * TILE_BANDSPERTHREAD;
+        this->_bandheight = max((this->_height + this->_bandcount - 1) / this->_bandcount, 1);
+        this->_bandcount = (this->_height + this->_bandheight - 1) / this->_bandheight;
+        this->_nextband = 0;
+
+        CWorkerThread* helpers[TILE_MAXTHREADS];
+        int i;
+        for (i = 1; i < threads; i++)
+            helpers[i] = new CWorkerThread(NULL, CTileRenderer::TileThreadProc, this, NULL, 0, NULL, FALSE);
+
+        this->RenderBands();
+        //vsechny pasy uz jsou rozdane, pas muze jeste kreslit pomocny thread: pockame na
+        //ukonceni threadu (Abort jen zaridi, ze thread, ktery se nestihl rozbehnout, nic nedela)
+        for (i = 1; i < threads; i++)
+        {
+            helpers[i]->Abort(TRUE);
+            delete helpers[i];
+        }
+
+        this->_items.Destroy();
+    }
+};
@@ -0,0 +1,440 @@
+﻿// SPDX-FileCopyrightText: 2023 Open Salamander Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "precomp.h"
+
+using namespace std;
+
+#undef min
+#undef max
+
+// nejmensi delka bloku; mensi shody se nehledaji
+#define BM_MIN_BLOCK_SIZE 512
+// maximalni pocet bloku prvniho souboru (pamet tabulky hashu je 16 bajtu na blok)
+#define BM_MAX_BLOCKS (1024 * 1024)
+// maximalni pocet threadu
+#define BM_MAX_THREADS 8
+// velikost useku druheho souboru, ktery prochazi jeden thread najednou
+#define BM_SCAN_CHUNK (4 * 1024 * 1024)
+
+struct CBlockEntry
+{
+    DWORD Weak;
+    DWORD Block;
+    QWORD Strong;
+};
+
+static inline bool operator<(const CBlockEntry& a, const CBlockEntry& b)
+{
+    return a.Weak < b.Weak || a.Weak == b.Weak && a.Block < b.Block;
+}
+
+// slaby hash okna (a = soucet bajtu, b = vazeny soucet), lze posouvat o bajt, viz RollWeak()
+static inline void ComputeWeak(const BYTE* data, DWORD size, DWORD& a, DWORD& b)
+{
+    a = 0;
+    b = 0;
+    for (DWORD i = 0; i < size; i++)
+    {
+        a += data[i];
+        b += (size - i) * data[i];
+    }
+}
+
+static inline void RollWeak(DWORD& a, DWORD& b, BYTE out, BYTE in, DWORD size)
+{
+    a += in - out;
+    b += a - size * out;
+}
+
+static inline DWORD GetWeak(DWORD a, DWORD b)
+{
+    return (a & 0xFFFF) | (b << 16);
+}
+
+// silny hash bloku (64-bit FNV-1a po DWORDech)
+static inline QWORD ComputeStrong(const BYTE* data, DWORD size)
+{
+    QWORD h = 14695981039346656037ULL;
+    const DWORD* d = (const DWORD*)data;
+    for (DWORD i = 0; i < size / sizeof(DWORD); i++)
+    {
+        h ^= d[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+struct CBlockMatchJob
+{
+    const BYTE* View[2];
+    QWORD Size[2];
+    DWORD BlockSize;
+    DWORD BlocksPerItem;         // pocet bloku hashovanych najednou jednim threadem
+    vector<CBlockEntry> Entries; // bloky prvniho souboru, po setrideni podle Weak
+    vector<DWORD> Buckets;       // Buckets[w & BucketMask] = index prvniho zaznamu v Entries
+    DWORD BucketMask;
+    vector<CBinaryMatches> ChunkMatches; // vysledky jednotlivych useku druheho souboru
+    QWORD Chunks;
+    volatile LONG NextItem;  // dalsi usek ke zpracovani
+    volatile LONG DoneItems; // pocet zpracovanych useku (pro progress)
+    const int* CancelFlag;
+    volatile LONG Failed;    // 1/2 = chyba cteni souboru, 3 = malo pameti, 4 = cancel
+    DWORD Error;             // GetLastError() pro Failed == 1/2
+};
+
+// hashovani bloku prvniho souboru, 'chunk' je index skupiny BlocksPerItem bloku
+static void HashBlocks(CBlockMatchJob* job, QWORD chunk)
+{
+    size_t first = (size_t)(chunk * job->BlocksPerItem);
+    size_t last = min(first + job->BlocksPerItem, job->Entries.size());
+    for (size_t i = first; i < last; i++)
+    {
+        const BYTE* data = job->View[0] + (QWORD)i * job->BlockSize;
+        DWORD a, b;
+        ComputeWeak(data, job->BlockSize, a, b);
+        CBlockEntry& e = job->Entries[i];
+        e.Weak = GetWeak(a, b);
+        e.Block = (DWORD)i;
+        e.Strong = ComputeStrong(data, job->BlockSize);
+    }
+}
+
+// hledani bloku prvniho souboru v useku druheho souboru (okna zacinajici v useku)
+static void ScanChunk(CBlockMatchJob* job, QWORD chunk)
+{
+    const BYTE* data0 = job->View[0];
+    const BYTE* data1 = job->View[1];
+    const DWORD blockSize = job->BlockSize;
+    QWORD start = chunk * BM_SCAN_CHUNK;
+    QWORD end = min(start + BM_SCAN_CHUNK, job->Size[1] - blockSize + 1);
+    CBinaryMatches& matches = job->ChunkMatches[(size_t)chunk];
+    QWORD lastEnd = start; // dal nez sem shody zpet nerozsirujeme
+    QWORD pos = start;
+    DWORD a, b;
+    bool recompute = true;
+    while (pos < end)
+    {
+        if (recompute)
+        {
+            ComputeWeak(data1 + pos, blockSize, a, b);
+            recompute = false;
+        }
+        DWORD weak = GetWeak(a, b);
+        DWORD bucket = weak & job->BucketMask;
+        DWORD i = job->Buckets[bucket];
+        DWORD iEnd = job->Buckets[bucket + 1];
+        bool strongValid = false;
+        QWORD strong = 0;
+        for (; i < iEnd; i++)
+        {
+            const CBlockEntry& e = job->Entries[i];
+            if (e.Weak != weak)
+                continue;
+            if (!strongValid)
+            {
+                strong = ComputeStrong(data1 + pos, blockSize);
+                strongValid = true;
+            }
+            if (e.Strong == strong && memcmp(data0 + (QWORD)e.Block * blockSize, data1 + pos, blockSize) == 0)
+                break;
+        }
+        if (i < iEnd)
+        { // shoda, rozsirime ji na obe strany
+            QWORD o0 = (QWORD)job->Entries[i].Block * blockSize;
+            QWORD o1 = pos;
+            while (o0 > 0 && o1 > lastEnd && data0[o0 - 1] == data1[o1 - 1])
+                o0--, o1--;
+            // dopredu rozsirujeme jen do konce useku, jinak by kazdy usek prochazel posunutou
+            // oblast az do konce souboru; pokracovani najde dalsi usek a Match() shody spoji
+            QWORD e0 = (QWORD)job->Entries[i].Block * blockSize + blockSize;
+            QWORD e1 = pos + blockSize;
+            QWORD e1Limit = min(start + BM_SCAN_CHUNK, job->Size[1]);
+            while (e0 < job->Size[0] && e1 < e1Limit && data0[e0] == data1[e1])
+                e0++, e1++;
+            CBinaryMatch m = {{o0, o1}, e1 - o1};
+            matches.push_back(m);
+            lastEnd = e1;
+            pos = e1;
+            recompute = true;
+            if (*job->CancelFlag)
+                return;
+            continue;
+        }
+        if (pos + blockSize >= job->Size[1])
+            break;
+        RollWeak(a, b, data1[pos], data1[pos + blockSize], blockSize);
+        pos++;
+        if ((pos & 0xFFFFF) == 0 && *job->CancelFlag)
+            return;
+    }
+}
+
+static int InPageErrorFilter(DWORD code)
+{
+    return code == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH;
+}
+
+// zpracovani useku 'chunk' s osetrenim chyby cteni z mapovaneho souboru
+static int ProcessChunk(CBlockMatchJob* job, QWORD chunk, BOOL scan)
+{
+    __try
+    {
+        if (scan)
+            ScanChunk(job, chunk);
+        else
+            HashBlocks(job, chunk);
+    }
+    __except (InPageErrorFilter(GetExceptionCode()))
+    {
+        return 1;
+    }
+    return 0;
+}
+
+struct CBlockMatchThreadParam
+{
+    CBlockMatchJob* Job;
+    BOOL Scan;
+};
+
+static unsigned WINAPI BlockMatchThread(void* param)
+{
+    CBlockMatchJob* job = ((CBlockMatchThreadParam*)param)->Job;
+    BOOL scan = ((CBlockMatchThreadParam*)param)->Scan;
+    try
+    {
+        while (job->Failed == 0)
+        {
+            if (*job->CancelFlag)
+            {
+                InterlockedCompareExchange(&job->Failed, 4, 0);
+                break;
+            }
+            QWORD chunk = (QWORD)InterlockedIncrement(&job->NextItem) - 1;
+            if (chunk >= job->Chunks)
+                break;
+            if (ProcessChunk(job, chunk, scan) != 0)
+            {
+                // chybu cteni nelze z mapovani priradit souboru, pri hashovani jde o prvni soubor
+                job->Error = ERROR_READ_FAULT;
+                InterlockedCompareExchange(&job->Failed, scan ? 2 : 1, 0);
+                break;
+            }
+            InterlockedIncrement(&job->DoneItems);
+        }
+    }
+    catch (bad_alloc&)
+    {
+        InterlockedCompareExchange(&job->Failed, 3, 0);
+    }
+    return 0;
+}
+
+// ****************************************************************************
+//
+// CBinaryBlockMatcher
+//
+
+CBinaryBlockMatcher::CBinaryBlockMatcher(HWND mainWindow, const int& cancelFlag)
+    : MainWindow(mainWindow), CancelFlag(cancelFlag)
+{
+    Mapping[0] = Mapping[1] = NULL;
+    View[0] = View[1] = NULL;
+}
+
+CBinaryBlockMatcher::~CBinaryBlockMatcher()
+{
+    Unmap();
+}
+
+void CBinaryBlockMatcher::Unmap()
+{
+    int i;
+    for (i = 0; i < 2; i++)
+    {
+        if (View[i] != NULL)
+            UnmapViewOfFile(View[i]);
+        if (Mapping[i] != NULL)
+            CloseHandle(Mapping[i]);
+        View[i] = NULL;
+        Mapping[i] = NULL;
+    }
+}
+
+DWORD CBinaryBlockMatcher::GetBlockSize(QWORD size)
+{
+    DWORD blockSize = BM_MIN_BLOCK_SIZE;
+    while (size / blockSize > BM_MAX_BLOCKS)
+        blockSize *= 2;
+    return blockSize;
+}
+
+int CBinaryBlockMatcher::Match(const HANDLE (&files)[2], const QWORD (&sizes)[2], CBinaryMatches& matches)
+{
+    CALL_STACK_MESSAGE1("CBinaryBlockMatcher::Match(, , )");
+
+    matches.clear();
+    DWORD blockSize = GetBlockSize(sizes[0]);
+    if (sizes[0] < blockSize || sizes[1] < blockSize)
+        return 0; // neni co hledat
+
+    int i;
+    for (i = 0; i < 2; i++)
+    {
+        if (sizes[i] > (SIZE_T)-1)
+        {
+            SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+            return i + 1;
+        }
+        Mapping[i] = CreateFileMapping(files[i], NULL, PAGE_READONLY, 0, 0, NULL);
+        if (Mapping[i] != NULL)
+            View[i] = (const BYTE*)MapViewOfFile(Mapping[i], FILE_MAP_READ, 0, 0, 0);
+        if (View[i] == NULL)
+        {
+            DWORD err = GetLastError();
+            Unmap();
+            SetLastError(err);
+            return i + 1;
+        }
+    }
+
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    int threads = min((int)si.dwNumberOfProcessors, BM_MAX_THREADS);
+    if (threads < 1)
+        threads = 1;
+
+    int ret = 0;
+    try
+    {
+        CBlockMatchJob job;
+        job.View[0] = View[0];
+        job.View[1] = View[1];
+        job.Size[0] = sizes[0];
+        job.Size[1] = sizes[1];
+        job.BlockSize = blockSize;
+        job.BlocksPerItem = max((DWORD)1, (DWORD)(BM_SCAN_CHUNK / blockSize));
+        job.CancelFlag = &CancelFlag;
+        job.Failed = 0;
+        job.Error = 0;
+        job.Entries.resize((size_t)(sizes[0] / blockSize));
+        job.BucketMask = 0xFFFF;
+        while (job.BucketMask < job.Entries.size())
+            job.BucketMask = job.BucketMask * 2 + 1;
+
+        DWORD tickCount = GetTickCount() - 1000;
+        QWORD hashChunks = (job.Entries.size() + job.BlocksPerItem - 1) / job.BlocksPerItem;
+        QWORD scanChunks = (sizes[1] - blockSize + BM_SCAN_CHUNK) / BM_SCAN_CHUNK;
+        job.ChunkMatches.resize((size_t)scanChunks);
+
+        int pass;
+        for (pass = 0; pass < 2 && job.Failed == 0; pass++)
+        {
+            // pass 0: hashovani bloku prvniho souboru, pass 1: hledani bloku ve druhem souboru
+            CBlockMatchThreadParam param = {&job, pass == 1};
+            job.Chunks = pass == 0 ? hashChunks : scanChunks;
+            job.NextItem = 0;
+            job.DoneItems = 0;
+
+            HANDLE handles[BM_MAX_THREADS];
+            int started = 0;
+            for (; started < threads; started++)
+            {
+                handles[started] = ThreadQueue.StartThread(BlockMatchThread, &param);
+                if (handles[started] == NULL)
+                    break;
+            }
+            if (started == 0)
+                BlockMatchThread(&param);
+            else
+            {
+                int t;
+                for (t = 0; t < started; t++)
+                {
+                    while (!ThreadQueue.WaitForExit(handles[t], 500))
+                    {
+                        if ((GetTickCount() - tickCount) > 500)
+                        {
+                            tickCount = GetTickCount();
+                            // hashovani je rychlejsi nez prochazeni, progress mu dame 20%
+                            int pct = pass == 0 ? (int)(20 * job.DoneItems / job.Chunks)
+                                                : 20 + (int)(80 * job.DoneItems / job.Chunks);
+                            SendMessage(MainWindow, WM_USER_WORKERNOTIFIES, WN_SET_PROGRESS, MAKELPARAM(pct, 0));
+                        }
+                    }
+                }
+            }
+
+            if (pass == 0 && job.Failed == 0)
+            { // tabulka hashu: zaznamy setridene podle slabeho hashu v kapsach podle jeho spodnich bitu
+                sort(job.Entries.begin(), job.Entries.end(),
+                     [&job](const CBlockEntry& a, const CBlockEntry& b)
+                     {
+                         DWORD ba = a.Weak & job.BucketMask, bb = b.Weak & job.BucketMask;
+                         return ba < bb || ba == bb && a < b;
+                     });
+                job.Buckets.assign((size_t)job.BucketMask + 2, 0);
+                DWORD e = 0;
+                DWORD bucket;
+                for (bucket = 0; bucket <= job.BucketMask; bucket++)
+                {
+                    job.Buckets[bucket] = e;
+                    while (e < job.Entries.size() && (job.Entries[e].Weak & job.BucketMask) == bucket)
+                        e++;
+                }
+                job.Buckets[(size_t)job.BucketMask + 1] = e;
+            }
+        }
+
+        if (job.Failed == 0 && CancelFlag)
+            job.Failed = 4;
+        if (job.Failed != 0)
+        {
+            ret = job.Failed;
+            if (ret == 1 || ret == 2)
+                SetLastError(job.Error);
+        }
+        else
+        {
+            // slozime vysledky useku, prekryvy (shody rozsirene za hranici useku) odrizneme
+            size_t count = 0;
+            for (vector<CBinaryMatches>::iterator it = job.ChunkMatches.begin(); it < job.ChunkMatches.end(); ++it)
+                count += it->size();
+            matches.reserve(count);
+            QWORD prevEnd = 0;
+            for (vector<CBinaryMatches>::iterator it = job.ChunkMatches.begin(); it < job.ChunkMatches.end(); ++it)
+            {
+                for (CBinaryMatches::iterator m = it->begin(); m < it->end(); ++m)
+                {
+                    CBinaryMatch match = *m;
+                    if (match.Offset[1] + match.Length <= prevEnd)
+                        continue;
+                    if (match.Offset[1] < prevEnd)
+                    {
+                        QWORD cut = prevEnd - match.Offset[1];
+                        match.Offset[0] += cut;
+                        match.Offset[1] += cut;
+                        match.Length -= cut;
+                    }
+                    if (!matches.empty() && matches.back().Offset[1] + matches.back().Length == match.Offset[1] &&
+                        matches.back().Offset[0] + matches.back().Length == match.Offset[0])
+                    {
+                        matches.back().Length += match.Length; // navazujici shoda
+                    }
+                    else
+                        matches.push_back(match);
+                    prevEnd = match.Offset[1] + match.Length;
+                }
+            }
+        }
+    }
+    catch (bad_alloc&)
+    {
+        matches.clear();
+        ret = 3;
+    }
+
+    Unmap();
+    return ret;
+}
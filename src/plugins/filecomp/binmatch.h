@@ -0,0 +1,47 @@
+﻿// SPDX-FileCopyrightText: 2023 Open Salamander Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+// ****************************************************************************
+//
+// CBinaryBlockMatcher -- hledani shodnych useku binarnich souboru i na jinych
+// offsetech (vlozena, smazana nebo presunuta data)
+//
+// Prvni soubor se rozdeli na bloky, pro kazdy blok se spocte slaby (rolling,
+// jako rsync) a silny hash. Druhym souborem se pak posouva okno velikosti bloku,
+// pri shode obou hashu a obsahu se shoda rozsiri na obe strany co nejdal.
+// Soubory se ctou pres mapovani do pameti, hashovani i prochazeni druheho
+// souboru bezi ve vice threadech.
+//
+
+struct CBinaryMatch
+{
+    QWORD Offset[2]; // offset shodneho useku v prvnim a ve druhem souboru
+    QWORD Length;
+};
+
+typedef std::vector<CBinaryMatch> CBinaryMatches; // serazene podle Offset[1], neprekryvaji se
+
+class CBinaryBlockMatcher
+{
+public:
+    CBinaryBlockMatcher(HWND mainWindow, const int& cancelFlag);
+    ~CBinaryBlockMatcher();
+
+    // najde shodne useky souboru 'files' o velikostech 'sizes'; vraci 0 pri uspechu,
+    // 1 nebo 2 pri chybe cteni prvniho nebo druheho souboru (viz GetLastError()),
+    // 3 pri nedostatku pameti, 4 pri preruseni uzivatelem
+    int Match(const HANDLE (&files)[2], const QWORD (&sizes)[2], CBinaryMatches& matches);
+
+    // vraci delku bloku pro soubor velikosti 'size'
+    static DWORD GetBlockSize(QWORD size);
+
+protected:
+    HWND MainWindow;
+    const int& CancelFlag;
+    HANDLE Mapping[2];
+    const BYTE* View[2];
+
+    void Unmap();
+};
@@ -71,9 +71,11 @@ void CFilecompCoWorkerBase<CChar>::ReadFilesAndFindLines(CTextFileReader (&reade
 
 template <class CChar>
 void CFilecompCoWorkerBase<CChar>::SendResults(CLineScript (&lineScript)[2],
-                                               CIntIndexes& changesToLines, CIntIndexes& changesLengths, CEditScript& changes, CTextFileReader (&reader)[2])
+                                               CIntIndexes& changesToLines, CIntIndexes& changesLengths, CEditScript& changes, CTextFileReader (&reader)[2],
+                                               bool approximate)
 {
     CTextCompareResults<CChar> results(Options);
+    results.Approximate = approximate;
     int i;
     for (i = 0; i < 2; ++i)
     {
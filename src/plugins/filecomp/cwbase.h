@@ -61,7 +61,8 @@ protected:
 
     void ReadFilesAndFindLines(CTextFileReader (&reader)[2], bool& binaryIdentical);
     void SendResults(CLineScript (&lineScript)[2], CIntIndexes& changesToLines,
-                     CIntIndexes& changesLengths, CEditScript& changes, CTextFileReader (&reader)[2]);
+                     CIntIndexes& changesLengths, CEditScript& changes, CTextFileReader (&reader)[2],
+                     bool approximate = false);
     void ScrictCompare(size_t (&firstLines)[2], size_t (&lenghts)[2],
                        CLineScript (&script)[2], int lcCommon);
     void RemoveSingleCharMatches();
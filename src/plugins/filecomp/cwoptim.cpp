@@ -132,7 +132,7 @@ struct CLineEqual
 
 template <class CChar>
 template <class CCaseConverter, class CLineIterator>
-void CFilecompCoWorkerOptimized<CChar>::IdentifyLines(CFilecompCoWorkerBase<CChar>::CFCFileData (&files)[2], CIndexes (&compareData)[2], const int& cancel)
+size_t CFilecompCoWorkerOptimized<CChar>::IdentifyLines(CFilecompCoWorkerBase<CChar>::CFCFileData (&files)[2], CIndexes (&compareData)[2], const int& cancel)
 {
     typedef vector<CChar*> CLineBuffer;
     typedef unordered_map<
@@ -164,6 +164,7 @@ void CFilecompCoWorkerOptimized<CChar>::IdentifyLines(CFilecompCoWorkerBase<CCha
                 throw CFilecompWorker::CAbortByUserException();
         }
     }
+    return next;
 }
 
 template <class CChar>
@@ -197,40 +198,35 @@ void CFilecompCoWorkerOptimized<CChar>::Compare(CTextFileReader (&reader)[2])
 
     CEditScript editScript;
     ptrdiff_t d = 0;
+    bool approximate = false; // nektere useky byly moc velke pro presne porovnani
     if (!binaryIdentical)
     {
         // do the comparison
 
         // prepare compare data
         CIndexes compareData[2];
+        size_t classesCount;
         if (this->Options.IgnoreCase)
         {
             if (this->Options.IgnoreAllSpace)
-                IdentifyLines<CToLowerCase<CChar>, CIgnoringSpace<CChar>>(this->Files, compareData, this->CancelFlag);
+                classesCount = IdentifyLines<CToLowerCase<CChar>, CIgnoringSpace<CChar>>(this->Files, compareData, this->CancelFlag);
             elif (this->Options.IgnoreSpaceChange)
-                IdentifyLines<CToLowerCase<CChar>, CIgnoringSpaceChange<CChar>>(this->Files, compareData, this->CancelFlag);
-            else IdentifyLines<CToLowerCase<CChar>, const CChar*>(this->Files, compareData, this->CancelFlag);
+                classesCount = IdentifyLines<CToLowerCase<CChar>, CIgnoringSpaceChange<CChar>>(this->Files, compareData, this->CancelFlag);
+            else classesCount = IdentifyLines<CToLowerCase<CChar>, const CChar*>(this->Files, compareData, this->CancelFlag);
         }
         else
         {
             if (this->Options.IgnoreAllSpace)
-                IdentifyLines<::identity<CChar>, CIgnoringSpace<CChar>>(this->Files, compareData, this->CancelFlag);
+                classesCount = IdentifyLines<::identity<CChar>, CIgnoringSpace<CChar>>(this->Files, compareData, this->CancelFlag);
             elif (this->Options.IgnoreSpaceChange)
-                IdentifyLines<::identity<CChar>, CIgnoringSpaceChange<CChar>>(this->Files, compareData, this->CancelFlag);
-            else IdentifyLines<::identity<CChar>, const CChar*>(this->Files, compareData, this->CancelFlag);
+                classesCount = IdentifyLines<::identity<CChar>, CIgnoringSpaceChange<CChar>>(this->Files, compareData, this->CancelFlag);
+            else classesCount = IdentifyLines<::identity<CChar>, const CChar*>(this->Files, compareData, this->CancelFlag);
         }
 
         // compare the two sequences sequence
-        d = diff(
-            0, compareData[0].size(),
-            0, compareData[1].size(),
-            sequence_comparator(
-                compareData[0].begin(),
-                compareData[1].begin()),
-            CEditScriptBuilder(editScript),
-            this->CancelFlag);
-        if (d == -1)
-            CFilecompWorker::CException::Raise(IDS_INTERNALERROR, 0);
+        d = DiffLines(compareData, classesCount, editScript, this->CancelFlag, approximate);
+        if (approximate)
+            TRACE_I("Compare: some differing regions were too large for exact comparison, they are reported as whole changes");
         /*  if (d == 0) We now let the file display
     {
       throw CFilecompWorker::CFilesDontDifferException();
@@ -333,7 +329,7 @@ void CFilecompCoWorkerOptimized<CChar>::Compare(CTextFileReader (&reader)[2])
         d = 0;
     }
     // send results
-    this->SendResults(script, changesToLines, changesLengths, changes, reader);
+    this->SendResults(script, changesToLines, changesLengths, changes, reader, approximate);
     if (d == 0)
     {
         if (binaryIdentical)
@@ -16,7 +16,7 @@ class CFilecompCoWorkerOptimized : public CFilecompCoWorkerBase<CChar>
 public:
     CFilecompCoWorkerOptimized(HWND mainWindow, CCompareOptions& options, const int& cancelFlag);
     template <class CCaseConverter, class CLineIterator>
-    void IdentifyLines(CFilecompCoWorkerBase<CChar>::CFCFileData (&files)[2], CIndexes (&compareData)[2], const int& cancel);
+    size_t IdentifyLines(CFilecompCoWorkerBase<CChar>::CFCFileData (&files)[2], CIndexes (&compareData)[2], const int& cancel);
     bool IsChangeIgnorable(const CChange& change);
     void Compare(CTextFileReader (&reader)[2]);
 
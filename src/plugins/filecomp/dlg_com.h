@@ -24,7 +24,8 @@ enum
     WN_COMPARE_FINISHED,     // comparison finishes
     WN_GET_CHANGESCOMBO,     // queries HWND of the Change combobox
     WN_SET_PROGRESS,         // sets progress MAKELPARAM(percent, changesCnt)
-    WN_ADD_CHANGE            // registers a change in binary comparison
+    WN_ADD_CHANGE,           // registers a change in binary comparison
+    WN_SET_SHIFTED           // (CBinaryMatches *)lParam jsou useky nalezene na jinych offsetech
 };
 
 #define WM_USER_VSCROLL (WM_APP + 2)
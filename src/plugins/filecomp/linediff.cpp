@@ -0,0 +1,346 @@
+﻿// SPDX-FileCopyrightText: 2023 Open Salamander Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "precomp.h"
+
+using namespace std;
+
+// vstupy s mene radkami se porovnavaji primo pres diff() bez hledani kotev
+#define LD_ANCHOR_MIN_LINES 20000
+// oblasti s mene radkami se uz dale nedeli a porovnaji se pres diff()
+#define LD_LEAF_LINES 2000
+// maximalni hloubka rekurze hledani kotev
+#define LD_MAX_DEPTH 32
+// maximalni pocet threadu pro porovnani oblasti
+#define LD_MAX_THREADS 8
+// pamet pro pracovni buffery diff() vsech threadu
+#define LD_MEMORY_BUDGET (256 * 1024 * 1024)
+// oblasti vetsi nez tolik radek se porovnavaji s omezenou delkou editacniho skriptu
+#define LD_APPROX_LINES 100000
+// omezeni delky editacniho skriptu pro velke oblasti (cena diff() je O((N+M)*D))
+#define LD_APPROX_DMAX 8192
+
+// usek vysledku: shoda (Leaf == false, Length[0] == Length[1]) nebo oblast pro diff()
+struct CLineDiffSegment
+{
+    size_t Position[2];
+    size_t Length[2];
+    bool Leaf;
+};
+
+class CLineDiff
+{
+public:
+    CLineDiff(const CIndexes (&compareData)[2], size_t classesCount, const int& cancel)
+        : A(compareData[0]), B(compareData[1]), Cancel(cancel)
+    {
+        CountA.resize(classesCount);
+        CountB.resize(classesCount);
+        PosA.resize(classesCount);
+    }
+
+    // rozdeli oblast na shody a oblasti pro diff(), vysledek pridava do Segments
+    void Split(size_t a0, size_t a1, size_t b0, size_t b1, int depth);
+
+    vector<CLineDiffSegment> Segments;
+
+protected:
+    const CIndexes& A;
+    const CIndexes& B;
+    const int& Cancel;
+
+    vector<int> CountA; // pocty vyskytu trid radek v aktualni oblasti
+    vector<int> CountB;
+    CIndexes PosA;      // pozice (posledniho) vyskytu tridy v aktualni oblasti prvniho souboru
+
+    void AddMatch(size_t a, size_t b, size_t length);
+    void AddLeaf(size_t a0, size_t a1, size_t b0, size_t b1);
+    void FindAnchors(size_t a0, size_t a1, size_t b0, size_t b1, vector<pair<size_t, size_t>>& anchors);
+};
+
+void CLineDiff::AddMatch(size_t a, size_t b, size_t length)
+{
+    if (length == 0)
+        return;
+    if (!Segments.empty() && !Segments.back().Leaf &&
+        Segments.back().Position[0] + Segments.back().Length[0] == a)
+    {
+        Segments.back().Length[0] += length;
+        Segments.back().Length[1] += length;
+        return;
+    }
+    CLineDiffSegment s = {{a, b}, {length, length}, false};
+    Segments.push_back(s);
+}
+
+void CLineDiff::AddLeaf(size_t a0, size_t a1, size_t b0, size_t b1)
+{
+    if (a0 == a1 && b0 == b1)
+        return;
+    CLineDiffSegment s = {{a0, b0}, {a1 - a0, b1 - b0}, true};
+    Segments.push_back(s);
+}
+
+void CLineDiff::FindAnchors(size_t a0, size_t a1, size_t b0, size_t b1, vector<pair<size_t, size_t>>& anchors)
+{
+    size_t i;
+    for (i = a0; i < a1; i++)
+    {
+        CountA[A[i]]++;
+        PosA[A[i]] = i;
+    }
+    for (i = b0; i < b1; i++)
+        CountB[B[i]]++;
+
+    // kandidati na kotvy v poradi druheho souboru: (pozice v prvnim, pozice ve druhem)
+    vector<pair<size_t, size_t>> unique;
+    for (i = b0; i < b1; i++)
+    {
+        size_t c = B[i];
+        if (CountA[c] == 1 && CountB[c] == 1)
+            unique.push_back(pair<size_t, size_t>(PosA[c], i));
+    }
+
+    for (i = a0; i < a1; i++)
+        CountA[A[i]] = 0;
+    for (i = b0; i < b1; i++)
+        CountB[B[i]] = 0;
+
+    // kotvy = nejdelsi rostouci podposloupnost pozic v prvnim souboru (patience sorting)
+    anchors.clear();
+    if (unique.empty())
+        return;
+    vector<size_t> tails;          // index kandidata, ktery konci rostouci posloupnost dane delky
+    vector<ptrdiff_t> prev(unique.size()); // predchudce kandidata v posloupnosti
+    for (i = 0; i < unique.size(); i++)
+    {
+        size_t lo = 0, hi = tails.size();
+        while (lo < hi)
+        {
+            size_t mid = (lo + hi) / 2;
+            if (unique[tails[mid]].first < unique[i].first)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        prev[i] = lo > 0 ? (ptrdiff_t)tails[lo - 1] : -1;
+        if (lo == tails.size())
+            tails.push_back(i);
+        else
+            tails[lo] = i;
+    }
+    anchors.resize(tails.size());
+    ptrdiff_t k = tails.back();
+    for (size_t j = tails.size(); j-- > 0; k = prev[k])
+        anchors[j] = unique[k];
+}
+
+void CLineDiff::Split(size_t a0, size_t a1, size_t b0, size_t b1, int depth)
+{
+    if (Cancel)
+        throw CFilecompWorker::CAbortByUserException();
+
+    // spolecny zacatek a konec
+    size_t prefix = 0;
+    while (a0 + prefix < a1 && b0 + prefix < b1 && A[a0 + prefix] == B[b0 + prefix])
+        prefix++;
+    AddMatch(a0, b0, prefix);
+    a0 += prefix;
+    b0 += prefix;
+    size_t suffix = 0;
+    while (a0 < a1 - suffix && b0 < b1 - suffix && A[a1 - suffix - 1] == B[b1 - suffix - 1])
+        suffix++;
+    a1 -= suffix;
+    b1 -= suffix;
+
+    if (a0 == a1 || b0 == b1 || (a1 - a0) + (b1 - b0) < LD_LEAF_LINES || depth >= LD_MAX_DEPTH)
+        AddLeaf(a0, a1, b0, b1);
+    else
+    {
+        vector<pair<size_t, size_t>> anchors;
+        FindAnchors(a0, a1, b0, b1, anchors);
+        if (anchors.empty())
+            AddLeaf(a0, a1, b0, b1);
+        else
+        {
+            size_t pa = a0, pb = b0;
+            for (vector<pair<size_t, size_t>>::iterator it = anchors.begin(); it < anchors.end(); ++it)
+            {
+                Split(pa, it->first, pb, it->second, depth + 1);
+                AddMatch(it->first, it->second, 1);
+                pa = it->first + 1;
+                pb = it->second + 1;
+            }
+            Split(pa, a1, pb, b1, depth + 1);
+        }
+    }
+    AddMatch(a1, b1, suffix);
+}
+
+// ****************************************************************************
+//
+// paralelni porovnani oblasti
+//
+
+struct CLineDiffLeafResult
+{
+    ed_script_builder::ed_script Script;
+    ptrdiff_t D;
+    bool Approximate;
+};
+
+struct CLineDiffJob
+{
+    const CIndexes* CompareData;
+    const vector<CLineDiffSegment>* Segments;
+    vector<size_t>* Leaves;                     // indexy oblasti v Segments
+    vector<CLineDiffLeafResult>* Results;       // vysledky pro Leaves
+    volatile LONG NextLeaf;                     // dalsi oblast ke zpracovani
+    const int* Cancel;
+    volatile LONG Failed;                       // 1 = preruseno uzivatelem, 2 = chyba (napr. malo pameti)
+};
+
+static void DiffLeaf(CLineDiffJob* job, size_t leaf, vector<ptrdiff_t>& buf)
+{
+    const CLineDiffSegment& s = (*job->Segments)[(*job->Leaves)[leaf]];
+    CLineDiffLeafResult& r = (*job->Results)[leaf];
+    size_t lines = s.Length[0] + s.Length[1];
+    ptrdiff_t dmax = lines > LD_APPROX_LINES ? LD_APPROX_DMAX : INT_MAX;
+    // pri prekroceni limitu vraci diff() primo limit, coz muze byt i presna delka skriptu;
+    // limit proto zvetsime o 1, aby skript s delkou presne dmax zustal platny
+    r.D = diff(s.Position[0], s.Length[0], s.Position[1], s.Length[1],
+               sequence_comparator(job->CompareData[0].begin(), job->CompareData[1].begin()),
+               ed_script_builder(r.Script), *job->Cancel, dmax == INT_MAX ? dmax : dmax + 1, buf);
+    r.Approximate = false;
+    if (dmax != INT_MAX && r.D > dmax)
+    { // presne porovnani by bylo prilis drahe, oblast bereme jako celou zmenenou
+        r.Script.clear();
+        r.Script.push_back(ed_script_builder::edit(diff_base::ed_delete, s.Position[0], s.Length[0]));
+        r.Script.push_back(ed_script_builder::edit(diff_base::ed_insert, s.Position[1], s.Length[1]));
+        r.D = (ptrdiff_t)lines;
+        r.Approximate = true;
+    }
+    else if (r.D < 0)
+        InterlockedExchange(&job->Failed, 2);
+}
+
+static unsigned WINAPI DiffLeavesThread(void* param)
+{
+    CLineDiffJob* job = (CLineDiffJob*)param;
+    vector<ptrdiff_t> buf;
+    try
+    {
+        while (job->Failed == 0)
+        {
+            size_t leaf = (size_t)InterlockedIncrement(&job->NextLeaf) - 1;
+            if (leaf >= job->Leaves->size())
+                break;
+            DiffLeaf(job, leaf, buf);
+        }
+    }
+    catch (diff_exception)
+    {
+        InterlockedExchange(&job->Failed, 1);
+    }
+    catch (...)
+    {
+        InterlockedExchange(&job->Failed, 2);
+    }
+    return 0;
+}
+
+ptrdiff_t DiffLines(const CIndexes (&compareData)[2], size_t classesCount,
+                    CEditScript& editScript, const int& cancel, bool& approximate)
+{
+    approximate = false;
+    size_t n = compareData[0].size();
+    size_t m = compareData[1].size();
+
+    vector<CLineDiffSegment> segments;
+    if (n + m < LD_ANCHOR_MIN_LINES)
+    {
+        CLineDiffSegment s = {{0, 0}, {n, m}, true};
+        segments.push_back(s);
+    }
+    else
+    {
+        CLineDiff lineDiff(compareData, classesCount, cancel);
+        lineDiff.Split(0, n, 0, m, 0);
+        segments.swap(lineDiff.Segments);
+    }
+
+    vector<size_t> leaves;
+    size_t maxLeafLines = 0;
+    size_t i;
+    for (i = 0; i < segments.size(); i++)
+    {
+        if (segments[i].Leaf)
+        {
+            leaves.push_back(i);
+            size_t lines = segments[i].Length[0] + segments[i].Length[1];
+            if (lines > maxLeafLines)
+                maxLeafLines = lines;
+        }
+    }
+
+    CLineDiffJob job;
+    job.CompareData = compareData;
+    job.Segments = &segments;
+    job.Leaves = &leaves;
+    vector<CLineDiffLeafResult> results(leaves.size());
+    job.Results = &results;
+    job.NextLeaf = 0;
+    job.Cancel = &cancel;
+    job.Failed = 0;
+
+    // pocet threadu: podle poctu procesoru, oblasti a pameti pro buffery diff() (~ 2 * 8 bajtu na radku)
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    size_t threads = si.dwNumberOfProcessors;
+    if (threads > LD_MAX_THREADS)
+        threads = LD_MAX_THREADS;
+    if (threads > leaves.size())
+        threads = leaves.size();
+    size_t bufSize = 2 * sizeof(ptrdiff_t) * (maxLeafLines + 2);
+    while (threads > 1 && threads * bufSize > LD_MEMORY_BUDGET)
+        threads--;
+
+    HANDLE handles[LD_MAX_THREADS];
+    int started = 0;
+    if (threads > 1)
+    {
+        for (; started < (int)threads - 1; started++) // posledni "thread" je aktualni thread
+        {
+            handles[started] = ThreadQueue.StartThread(DiffLeavesThread, &job);
+            if (handles[started] == NULL)
+                break;
+        }
+    }
+    DiffLeavesThread(&job);
+    for (int t = 0; t < started; t++)
+        ThreadQueue.WaitForExit(handles[t]);
+    if (job.Failed == 1 || cancel)
+        throw CFilecompWorker::CAbortByUserException();
+    if (job.Failed != 0)
+        CFilecompWorker::CException::Raise(IDS_INTERNALERROR, 0);
+
+    // slozime vysledny editacni skript
+    CEditScriptBuilder builder(editScript);
+    ptrdiff_t d = 0;
+    size_t leaf = 0;
+    for (i = 0; i < segments.size(); i++)
+    {
+        if (!segments[i].Leaf)
+        {
+            builder(diff_base::ed_match, segments[i].Position[0], segments[i].Length[0]);
+            continue;
+        }
+        CLineDiffLeafResult& r = results[leaf++];
+        for (ed_script_builder::ed_iterator e = r.Script.begin(); e < r.Script.end(); ++e)
+            builder(e->op, e->off, e->len);
+        d += r.D;
+        if (r.Approximate)
+            approximate = true;
+    }
+    return d;
+}
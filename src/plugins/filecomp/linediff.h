@@ -0,0 +1,25 @@
+﻿// SPDX-FileCopyrightText: 2023 Open Salamander Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+// ****************************************************************************
+//
+// DiffLines -- porovnani dvou posloupnosti trid radek (viz IdentifyLines)
+//
+// Velke vstupy se nejdriv rozdeli na nezavisle oblasti: radky, ktere jsou
+// v oblasti obou souboru jedinecne, slouzi jako kotvy (patience diff, kotvy
+// tvori nejdelsi rostouci podposloupnost), mezi kotvami se postup rekurzivne
+// opakuje. Zbyle oblasti se porovnavaji klasickym diff() (Myers) paralelne
+// ve vice threadech. Oblasti, jejichz presne porovnani by bylo prilis drahe,
+// se oznaci jako zmena cele oblasti (priblizny vysledek, vraci 'approximate').
+//
+// Male vstupy se porovnavaji primo pres diff(), vysledek je tedy stejny jako
+// drive (nejkratsi editacni skript).
+//
+// Vraci delku editacniho skriptu (pocet zmenenych radek), pri preruseni
+// uzivatelem hazi CFilecompWorker::CAbortByUserException.
+//
+
+ptrdiff_t DiffLines(const CIndexes (&compareData)[2], size_t classesCount,
+                    CEditScript& editScript, const int& cancel, bool& approximate);
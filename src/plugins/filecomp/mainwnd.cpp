@@ -41,6 +41,7 @@ CMainWindow::CMainWindow(char* path1, char* path2, CCompareOptions* options, UIN
     DetailedDifferences = ::Configuration.DetailedDifferences;
     InputEnabled = TRUE;
     OutOfRange = FALSE; // Used only in binary/hex view
+    ShiftedMatchesFirst = 0;
     ShowCmd = showCmd;
     bOptionsChangedBeingHandled = FALSE;
 }
@@ -466,6 +467,19 @@ void CMainWindow::SelectDifference(int i, int cmd, BOOL setSel, BOOL center)
     }
 }
 
+void CMainWindow::SelectShiftedMatch(int i)
+{
+    CALL_STACK_MESSAGE2("CMainWindow::SelectShiftedMatch(%d)", i);
+    if (!DataValid)
+        return;
+    // oba pohledy ukazuji stejny offset, oznacime usek v pravem souboru; offset
+    // v levem souboru je v textu polozky combo boxu
+    QWORD offset = ShiftedMatches[i].Offset[1];
+    QWORD length = ShiftedMatches[i].Length;
+    ((CHexFileViewWindow*)FileView[fviLeft])->SelectDifference(offset, length, TRUE);
+    ((CHexFileViewWindow*)FileView[fviRight])->SelectDifference(offset, length, TRUE);
+}
+
 void CMainWindow::SelectDifferenceByLine(int line, BOOL center)
 {
     CALL_STACK_MESSAGE2("CMainWindow::SelectDifferenceByLine(%d)", line);
@@ -1468,7 +1482,15 @@ CMainWindow::WindowProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
                 LRESULT i = SendMessage(ComboBox->HWindow, CB_GETCURSEL, 0, 0);
                 OutOfRange = FALSE;
                 if (i != CB_ERR && DataValid)
-                    SelectDifference(int(i), 0, FALSE);
+                {
+                    if (!FileView[fviLeft]->Is(fvtText) && i >= ShiftedMatchesFirst &&
+                        size_t(i - ShiftedMatchesFirst) < ShiftedMatches.size())
+                    {
+                        SelectShiftedMatch(int(i - ShiftedMatchesFirst));
+                    }
+                    else
+                        SelectDifference(int(i), 0, FALSE);
+                }
                 return 0;
             }
             break;
@@ -1822,6 +1844,7 @@ CMainWindow::WindowProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
         *message = 0;
         UINT type = MB_ICONERROR;
         LPCTSTR encoding[2] = {_T(""), _T("")};
+        bool approximate = false;
         switch (wParam)
         {
         case WN_ERROR:
@@ -1991,6 +2014,7 @@ CMainWindow::WindowProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
         {
             // tady to schvalne kopirujem, nevolame swap
             Changes = *(CBinaryChanges*)lParam;
+            ShiftedMatches.clear();
             if (Changes.size() < MaxBinChanges)
                 DifferencesCount = int(Changes.size());
             else
@@ -1999,6 +2023,12 @@ CMainWindow::WindowProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
             return (LRESULT)ComboBox->HWindow;
         }
 
+        case WN_SET_SHIFTED:
+            // useky se pridavaji do combo boxu za zmeny
+            ShiftedMatches = *(CBinaryMatches*)lParam;
+            ShiftedMatchesFirst = int(SendMessage(ComboBox->HWindow, CB_GETCOUNT, 0, 0));
+            return 0;
+
         case WN_GET_CHANGESCOMBO:
             DifferencesCount++;
             OutOfRange = FALSE;
@@ -2058,6 +2088,7 @@ CMainWindow::WindowProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
             _CrtCheckMemory();
             // Patera 2009.05.23: Set to 0 to avoid GPF if files become equal after recompare
             DifferencesCount = 0;
+            approximate = ((CTextCompareResults<char>*)lParam)->Approximate;
             ret = TextFilesDiffer((CTextCompareResults<char>*)lParam, message, type, encoding);
             _CrtCheckMemory();
             break;
@@ -2067,6 +2098,7 @@ CMainWindow::WindowProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
         {
             // Patera 2009.05.23: Set to 0 to avoid GPF if files become equal after recompare
             DifferencesCount = 0;
+            approximate = ((CTextCompareResults<wchar_t>*)lParam)->Approximate;
             ret = TextFilesDiffer((CTextCompareResults<wchar_t>*)lParam, message, type, encoding);
             break;
         }
@@ -2105,7 +2137,8 @@ CMainWindow::WindowProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
             if (DifferencesCount)
             {
                 CQuadWord qDC(DifferencesCount, 0);
-                SG->ExpandPluralString(fmt, SizeOf(fmt), LoadStr(IDS_MAINWNDHEADER), 1, &qDC);
+                // priblizny diff hlasi moc velke useky jako celek, at to uzivatel vi
+                SG->ExpandPluralString(fmt, SizeOf(fmt), LoadStr(approximate ? IDS_MAINWNDHEADERAPPROX : IDS_MAINWNDHEADER), 1, &qDC);
             }
             else
                 _tcscpy(fmt, LoadStr((WN_NO_DIFFERENCE == wParam) ? IDS_MAINWNDHEADER_NODIF : IDS_MAINWNDHEADERCOMPUTING2));
@@ -95,6 +95,8 @@ protected:
     // pro binarni compare
     CBinaryChanges Changes;
     BOOL OutOfRange;
+    CBinaryMatches ShiftedMatches; // useky na jinych offsetech, v combo boxu jsou za zmenami
+    int ShiftedMatchesFirst;       // index prvniho useku z ShiftedMatches v combo boxu
     UINT ShowCmd;
 
 public:
@@ -107,6 +109,7 @@ public:
     void SelectDifferenceByLine(int line, BOOL center);
     BOOL GetDifferenceRange(int line, int* start, int* end);
     void SelectDifferenceByOffset(QWORD offset, BOOL center);
+    void SelectShiftedMatch(int i);
     int FindDifference(QWORD offset);
     BOOL EnableToolbarButton(UINT cmd, BOOL enable);
     void UpdateToolbarButtons(DWORD flags);
@@ -71,9 +71,11 @@
 #include "filemap.h"
 #include "filecache.h"
 #include "textio.h"
+#include "binmatch.h"
 #include "worker.h"
 #include "cwbase.h"
 #include "cwstrict.h"
+#include "linediff.h"
 #include "cwoptim.h"
 #include "filecomp.h"
 #include "dlg_com.h"
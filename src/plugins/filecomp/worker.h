@@ -228,8 +228,9 @@ struct CTextCompareResults
     CIntIndexes ChangesToLines;
     CIntIndexes ChangesLengths;
     CEditScript Changes; // data to fill combo-box
+    bool Approximate;    // nektere zmenene useky byly moc velke, jsou hlaseny jako celek
 
-    CTextCompareResults(CCompareOptions& options) : Options(options) {}
+    CTextCompareResults(CCompareOptions& options) : Options(options), Approximate(false) {}
 };
 
 // ****************************************************************************
@@ -318,6 +319,7 @@ protected:
     void CompareBinaryFiles();
     int CompareBinaryFilesAux(CCachedFile (&cf)[2], QWORD& changeOffs);
     int FindDifferencesBody(CCachedFile (&cf)[2], QWORD changeOffs, CBinaryChanges& changes);
+    BOOL FindShiftedBlocks(int& foundPct, int& gaps, CBinaryMatches& shiftedMatches);
 
     template <class CChar>
     void CompareTextFiles(CTextFileReader (&reader)[2])
@@ -55,6 +55,15 @@ void CFilecompWorker::CompareBinaryFiles()
         ret = FindDifferencesBody(cf, changeOffs, changes);
         if (ret == 0)
         {
+            // vlozena nebo smazana data posunou zbytek souboru, porovnani po offsetech pak
+            // hlasi vse za nimi jako zmenu; zkusime najit shodne useky na jinych offsetech
+            int foundPct = 0;
+            int gaps = 0;
+            BOOL shifted = FALSE;
+            CBinaryMatches shiftedMatches;
+            if (Files[0].Size != Files[1].Size || changes.size() >= MaxBinChanges)
+                shifted = FindShiftedBlocks(foundPct, gaps, shiftedMatches);
+
             HWND comboHWnd = (HWND)SendMessage(MainWindow, WM_USER_WORKERNOTIFIES, WN_SETCHANGES, (LPARAM)&changes);
             if (comboHWnd)
             {
@@ -79,12 +88,43 @@ void CFilecompWorker::CompareBinaryFiles()
                     if (CancelFlag)
                         throw CAbortByUserException(); // cancel
                 }
+                if (shifted)
+                {
+                    // za zmeny pridame useky nalezene na jinych offsetech, at je uzivatel vidi
+                    if (shiftedMatches.size() > MaxBinChanges)
+                        shiftedMatches.resize(MaxBinChanges);
+                    SendMessage(MainWindow, WM_USER_WORKERNOTIFIES, WN_SET_SHIFTED, (LPARAM)&shiftedMatches);
+                    for (j = 0; j < shiftedMatches.size(); j++)
+                    {
+                        TCHAR buf1[32], buf2[32], buf3[32], report[200], fmt[128];
+                        SG->ExpandPluralString(fmt, SizeOf(fmt), LoadStr(IDS_BINREPORTSHIFTED), 1, &CQuadWord().SetUI64(shiftedMatches[j].Length));
+                        _stprintf(report, fmt, _ui64toa(shiftedMatches[j].Length, buf1, 10),
+                                  QWord2Ascii(shiftedMatches[j].Offset[1], buf2, digits),
+                                  QWord2Ascii(shiftedMatches[j].Offset[0], buf3, digits));
+                        LRESULT ret2 = SendMessage(comboHWnd, CB_ADDSTRING, 0, (LPARAM)report);
+                        if (ret2 == CB_ERR || ret2 == CB_ERRSPACE)
+                        {
+                            TRACE_E("CB_ADDSTRING has failed, j = " << j);
+                            break;
+                        }
+                        if (CancelFlag)
+                            throw CAbortByUserException(); // cancel
+                    }
+                }
                 SendMessage(comboHWnd, WM_SETREDRAW, TRUE, 0);
                 InvalidateRect(comboHWnd, NULL, TRUE);
                 UpdateWindow(comboHWnd);
 
                 TCHAR buf[MAX_PATH * 2 + 200];
-                if (changes.size() < MaxBinChanges)
+                if (shifted)
+                {
+                    TCHAR fmt[128];
+                    CQuadWord qGaps((DWORD)gaps, 0);
+                    SG->ExpandPluralString(fmt, SizeOf(fmt), LoadStr(IDS_MAINWNDHEADERSHIFTED), 1, &qGaps);
+                    _stprintf(buf, fmt, SG->SalPathFindFileName(Files[0].Name),
+                              SG->SalPathFindFileName(Files[1].Name), foundPct, gaps);
+                }
+                else if (changes.size() < MaxBinChanges)
                 {
                     TCHAR fmt[128];
                     CQuadWord qSize((DWORD)changes.size(), 0);
@@ -373,3 +413,52 @@ int CFilecompWorker::FindDifferencesBody(CCachedFile (&cf)[2], QWORD changeOffs,
 
     return 0; // succes
 }
+
+// Hleda useky druheho souboru, ktere jsou v prvnim souboru na jinem offsetu. Vraci TRUE,
+// pokud takove useky nasel; 'foundPct' je podil druheho souboru nalezeny v prvnim souboru
+// na jinem offsetu, 'gaps' je pocet useku druheho souboru, ktere v prvnim souboru nejsou
+// (vlozena nebo zmenena data), 'shiftedMatches' dostane useky na jinych offsetech.
+BOOL CFilecompWorker::FindShiftedBlocks(int& foundPct, int& gaps, CBinaryMatches& shiftedMatches)
+{
+    CALL_STACK_MESSAGE1("CFilecompWorker::FindShiftedBlocks(, , )");
+
+    HANDLE files[2] = {Files[0].File, Files[1].File};
+    QWORD sizes[2] = {Files[0].Size, Files[1].Size};
+    CBinaryMatches matches;
+    CBinaryBlockMatcher matcher(MainWindow, CancelFlag);
+    switch (matcher.Match(files, sizes, matches))
+    {
+    case 1:
+    case 2:
+        TRACE_E("FindShiftedBlocks: unable to map file, error " << GetLastError());
+        return FALSE;
+    case 3:
+        TRACE_E("FindShiftedBlocks: not enough memory");
+        return FALSE;
+    case 4:
+        throw CAbortByUserException(); // cancel
+    }
+
+    QWORD found = 0;
+    QWORD pos = 0;
+    gaps = 0;
+    shiftedMatches.clear();
+    for (CBinaryMatches::iterator it = matches.begin(); it < matches.end(); ++it)
+    {
+        if (it->Offset[1] > pos)
+            gaps++;
+        if (it->Offset[0] != it->Offset[1])
+        {
+            // shody na stejnem offsetu ukazuje uz porovnani po offsetech, nepocitame je
+            found += it->Length;
+            shiftedMatches.push_back(*it);
+        }
+        pos = it->Offset[1] + it->Length;
+    }
+    if (pos < Files[1].Size)
+        gaps++;
+    if (shiftedMatches.empty())
+        return FALSE; // shody jsou jen na stejnych offsetech, to uz ukazuje porovnani po offsetech
+    foundPct = (int)(100 * found / Files[1].Size);
+    return TRUE;
+}
@@ -9,6 +9,7 @@
 #include "lang\lang.rh"
 #include "combine.h"
 #include "dialogs.h"
+#include "pipeline.h"
 
 // *****************************************************************************
 //
@@ -17,6 +18,13 @@
 
 #define BUFSIZE (512 * 1024)
 
+static void CloseParts(SAFE_FILE* parts, int count)
+{
+    int i;
+    for (i = 0; i < count; i++)
+        SalamanderSafeFile->SafeFileClose(&parts[i]);
+}
+
 BOOL CombineFiles(TIndirectArray<char>& files, LPTSTR targetName,
                   BOOL bOnlyCrc, BOOL bTestCrc, UINT32& Crc,
                   BOOL bTime, FILETIME* origTime, HWND parent,
@@ -32,22 +40,35 @@ BOOL CombineFiles(TIndirectArray<char>& files, LPTSTR targetName,
 
     int idTitle = bOnlyCrc ? IDS_CRCTITLE : IDS_COMBINE;
 
-    // nascitani velikosti vsech partial files (soucasne kontrola jejich pristupnosti)
+    SAFE_FILE* parts = new SAFE_FILE[files.Count + 1];
+    CQuadWord* partSizes = new CQuadWord[files.Count + 1];
+    if (parts == NULL || partSizes == NULL)
+    {
+        SalamanderGeneral->ShowMessageBox(LoadStr(IDS_OUTOFMEM), LoadStr(idTitle), MSGBOX_ERROR);
+        if (parts != NULL)
+            delete[] parts;
+        if (partSizes != NULL)
+            delete[] partSizes;
+        return FALSE;
+    }
+
+    // otevreni vsech partial files a nascitani jejich velikosti (zustanou otevrene, cte je
+    // CReadPipeline jeden po druhem)
     CQuadWord totalSize = CQuadWord(0, 0);
     char text[MAX_PATH + 50];
     int i;
     for (i = 0; i < files.Count; i++)
     {
-        SAFE_FILE file;
-        if (!SalamanderSafeFile->SafeFileOpen(&file, files[i], GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING,
-                                              0, parent, BUTTONS_RETRYCANCEL, NULL, NULL))
+        if (!SalamanderSafeFile->SafeFileOpen(&parts[i], files[i], GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING,
+                                              FILE_FLAG_SEQUENTIAL_SCAN, parent, BUTTONS_RETRYCANCEL, NULL, NULL))
         {
+            CloseParts(parts, i);
+            delete[] parts;
+            delete[] partSizes;
             return FALSE;
         }
-        CQuadWord size;
-        size.LoDWord = GetFileSize(file.HFile, &size.HiDWord);
-        totalSize += size;
-        SalamanderSafeFile->SafeFileClose(&file);
+        partSizes[i].LoDWord = GetFileSize(parts[i].HFile, &partSizes[i].HiDWord);
+        totalSize += partSizes[i];
     }
 
     // test volneho mista
@@ -57,7 +78,12 @@ BOOL CombineFiles(TIndirectArray<char>& files, LPTSTR targetName,
         strncpy_s(dir, targetName, _TRUNCATE);
         SalamanderGeneral->CutDirectory(dir);
         if (!SalamanderGeneral->TestFreeSpace(parent, dir, totalSize, LoadStr(IDS_COMBINE)))
+        {
+            CloseParts(parts, files.Count);
+            delete[] parts;
+            delete[] partSizes;
             return FALSE;
+        }
     }
 
     // vytvoreni vystupniho souboru
@@ -67,80 +93,87 @@ BOOL CombineFiles(TIndirectArray<char>& files, LPTSTR targetName,
         if (SalamanderSafeFile->SafeFileCreate(targetName, GENERIC_WRITE, FILE_SHARE_READ, FILE_ATTRIBUTE_NORMAL,
                                                FALSE, parent, NULL, NULL, NULL, FALSE, NULL, NULL, 0, NULL, &outfile) == INVALID_HANDLE_VALUE)
         {
+            CloseParts(parts, files.Count);
+            delete[] parts;
+            delete[] partSizes;
             return FALSE;
         }
     }
 
-    // spojeni
-    char* pBuffer = new char[BUFSIZE];
-    if (pBuffer == NULL)
+    // spojeni: cteni dalsich bloku a vypocet CRC bezi v threadech CReadPipeline, tady se
+    // jen zapisuje
+    CReadPipeline pipeline;
+    if (!pipeline.Start(parts, files.Count, BUFSIZE))
     {
         SalamanderGeneral->ShowMessageBox(LoadStr(IDS_OUTOFMEM), LoadStr(idTitle), MSGBOX_ERROR);
         if (!bOnlyCrc)
+        {
             SalamanderSafeFile->SafeFileClose(&outfile);
+            DeleteFile(targetName);
+        }
+        CloseParts(parts, files.Count);
+        delete[] parts;
+        delete[] partSizes;
         return FALSE;
     }
 
-    UINT32 CrcVal = 0;
-
     // otevreni progress dialogu
     salamander->OpenProgressDialog(LoadStr(idTitle), TRUE, parent, FALSE);
     salamander->ProgressSetTotalSize(CQuadWord(-1, -1), totalSize);
     salamander->ProgressSetSize(CQuadWord(-1, -1), CQuadWord(0, 0), FALSE);
-    CQuadWord totalProgress = CQuadWord(0, 0);
+    CQuadWord totalProgress = CQuadWord(0, 0), currentProgress = CQuadWord(0, 0);
 
     int ret = TRUE;
-    int j;
-    for (j = 0; j < files.Count; j++)
+    int currentPart = -1;
+    while (1)
     {
-        sprintf(text, "%s %s...", LoadStr(IDS_PROCESSING), files[j]);
-        salamander->ProgressDialogAddText(text, TRUE);
-
-        SAFE_FILE file;
-        if (!SalamanderSafeFile->SafeFileOpen(&file, files[j], GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING,
-                                              FILE_FLAG_SEQUENTIAL_SCAN, parent, BUTTONS_RETRYCANCEL, NULL, NULL))
+        const char* data;
+        DWORD numread, numwr;
+        int part;
+        if (!pipeline.GetBlock(&data, &numread, &part, parent))
         {
             ret = FALSE;
             break;
         }
+        if (numread == 0)
+            break; // konec posledni casti
 
-        DWORD numread, numwr;
-        CQuadWord currentProgress = CQuadWord(0, 0), size;
-        size.LoDWord = GetFileSize(file.HFile, &size.HiDWord);
-        salamander->ProgressSetTotalSize(size, CQuadWord(-1, -1));
-        salamander->ProgressSetSize(CQuadWord(0, 0), CQuadWord(-1, -1), TRUE);
-        do
-        {
-            if (!SalamanderSafeFile->SafeFileRead(&file, pBuffer, BUFSIZE, &numread, parent, BUTTONS_RETRYCANCEL, NULL, NULL))
-            {
-                ret = FALSE;
-                break;
-            }
-            if (!bOnlyCrc && numread)
-            {
-                if (!SalamanderSafeFile->SafeFileWrite(&outfile, pBuffer, numread, &numwr, parent, BUTTONS_RETRYCANCEL, NULL, NULL))
-                {
-                    ret = FALSE;
-                    break;
-                }
-            }
-            CrcVal = SalamanderGeneral->UpdateCrc32(pBuffer, numread, CrcVal);
-            currentProgress += CQuadWord(numread, 0);
-            if (!salamander->ProgressSetSize(currentProgress, totalProgress + currentProgress, TRUE))
+        if (part != currentPart)
+        { // zacatek dalsi casti (prazdne casti pipeline preskakuje)
+            while (currentPart < part)
             {
-                ret = FALSE;
-                break;
+                currentPart++;
+                sprintf(text, "%s %s...", LoadStr(IDS_PROCESSING), files[currentPart]);
+                salamander->ProgressDialogAddText(text, TRUE);
             }
-        } while (numread == BUFSIZE);
+            totalProgress += currentProgress;
+            currentProgress = CQuadWord(0, 0);
+            salamander->ProgressSetTotalSize(partSizes[part], CQuadWord(-1, -1));
+            salamander->ProgressSetSize(CQuadWord(0, 0), CQuadWord(-1, -1), TRUE);
+        }
 
-        totalProgress += currentProgress;
-        SalamanderSafeFile->SafeFileClose(&file);
+        if (!bOnlyCrc)
+        {
+            if (!SalamanderSafeFile->SafeFileWrite(&outfile, (LPVOID)data, numread, &numwr, parent, BUTTONS_RETRYCANCEL, NULL, NULL))
+                ret = FALSE;
+        }
+        pipeline.ReleaseBlock();
         if (ret == FALSE)
             break;
+
+        currentProgress += CQuadWord(numread, 0);
+        if (!salamander->ProgressSetSize(currentProgress, totalProgress + currentProgress, TRUE))
+        {
+            ret = FALSE;
+            break;
+        }
     }
+    UINT32 CrcVal = pipeline.Stop();
+    CloseParts(parts, files.Count);
+    delete[] parts;
+    delete[] partSizes;
 
     salamander->CloseProgressDialog();
-    delete[] pBuffer;
     if (!bOnlyCrc)
     {
         if (ret)
@@ -0,0 +1,269 @@
+﻿// SPDX-FileCopyrightText: 2023 Open Salamander Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "precomp.h"
+#include "splitcbn.h"
+#include "pipeline.h"
+
+// *****************************************************************************
+//
+//  CReadPipeline
+//
+
+CReadPipeline::CReadPipeline()
+{
+    int i;
+    for (i = 0; i < PIPELINE_BUFFERS; i++)
+        Blocks[i].Data = NULL;
+    BufSize = 0;
+    Files = NULL;
+    FilesCount = 0;
+    FreeSem = NULL;
+    ReadSem = NULL;
+    CrcSem = NULL;
+    ReaderThread = NULL;
+    CrcThread = NULL;
+    Abort = FALSE;
+    ReadIndex = 0;
+    ReadFileIndex = 0;
+    WriteIndex = 0;
+    Handed = 0;
+    Ended = FALSE;
+    CrcIndex = 0;
+    Crc = 0;
+}
+
+CReadPipeline::~CReadPipeline()
+{
+    Stop();
+}
+
+void CReadPipeline::Cleanup()
+{
+    int i;
+    for (i = 0; i < PIPELINE_BUFFERS; i++)
+    {
+        if (Blocks[i].Data != NULL)
+            delete[] Blocks[i].Data;
+        Blocks[i].Data = NULL;
+    }
+    if (FreeSem != NULL)
+        CloseHandle(FreeSem);
+    if (ReadSem != NULL)
+        CloseHandle(ReadSem);
+    if (CrcSem != NULL)
+        CloseHandle(CrcSem);
+    FreeSem = ReadSem = CrcSem = NULL;
+}
+
+BOOL CReadPipeline::Start(SAFE_FILE* files, int count, DWORD bufSize)
+{
+    CALL_STACK_MESSAGE3("CReadPipeline::Start(, %d, %u)", count, bufSize);
+
+    Files = files;
+    FilesCount = count;
+    BufSize = bufSize;
+    Abort = FALSE;
+    ReadIndex = 0;
+    ReadFileIndex = 0;
+    WriteIndex = 0;
+    Handed = 0;
+    Ended = FALSE;
+    CrcIndex = 0;
+    Crc = 0;
+
+    int i;
+    for (i = 0; i < PIPELINE_BUFFERS; i++)
+    {
+        Blocks[i].Data = new char[bufSize];
+        if (Blocks[i].Data == NULL)
+        {
+            Cleanup();
+            return FALSE;
+        }
+    }
+    FreeSem = CreateSemaphore(NULL, PIPELINE_BUFFERS, LONG_MAX, NULL);
+    ReadSem = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+    CrcSem = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+    if (FreeSem == NULL || ReadSem == NULL || CrcSem == NULL)
+    {
+        TRACE_E("CReadPipeline::Start(): unable to create semaphores");
+        Cleanup();
+        return FALSE;
+    }
+
+    CrcThread = ThreadQueue.StartThread(CrcThreadBody, this);
+    if (CrcThread != NULL)
+        ReaderThread = ThreadQueue.StartThread(ReaderThreadBody, this);
+    if (ReaderThread == NULL)
+    {
+        TRACE_E("CReadPipeline::Start(): unable to start threads");
+        Stop();
+        return FALSE;
+    }
+    return TRUE;
+}
+
+unsigned WINAPI
+CReadPipeline::ReaderThreadBody(void* param)
+{
+    CALL_STACK_MESSAGE1("CReadPipeline::ReaderThreadBody()");
+    CReadPipeline* pipe = (CReadPipeline*)param;
+    while (1)
+    {
+        WaitForSingleObject(pipe->FreeSem, INFINITE);
+        if (pipe->Abort)
+            break;
+
+        CPipelineBlock* block = &pipe->Blocks[pipe->ReadIndex % PIPELINE_BUFFERS];
+        block->Size = 0;
+        block->Error = FALSE;
+        block->End = FALSE;
+        while (1)
+        {
+            if (pipe->ReadFileIndex >= pipe->FilesCount)
+            {
+                block->End = TRUE;
+                break;
+            }
+            HANDLE hFile = pipe->Files[pipe->ReadFileIndex].HFile;
+            LARGE_INTEGER zero;
+            zero.QuadPart = 0;
+            block->File = pipe->ReadFileIndex;
+            SetFilePointerEx(hFile, zero, &block->Pos, FILE_CURRENT);
+            // chyby se tu nehlasi, cteni s dialogem zopakuje hlavni thread v GetBlock()
+            if (!ReadFile(hFile, block->Data, pipe->BufSize, &block->Size, NULL))
+            {
+                block->Size = 0;
+                block->Error = TRUE;
+                break;
+            }
+            if (block->Size > 0)
+                break;
+            pipe->ReadFileIndex++; // konec souboru, pokracujeme dalsim
+        }
+
+        BOOL finished = block->Error || block->End; // po ReleaseSemaphore uz blok patri hlavnimu threadu
+        if (!finished)
+        {
+            block->Users = 2;
+            pipe->ReadIndex++;
+        }
+        ReleaseSemaphore(pipe->ReadSem, 1, NULL);
+        if (finished)
+            break;
+    }
+    return 0;
+}
+
+unsigned WINAPI
+CReadPipeline::CrcThreadBody(void* param)
+{
+    CALL_STACK_MESSAGE1("CReadPipeline::CrcThreadBody()");
+    CReadPipeline* pipe = (CReadPipeline*)param;
+    while (1)
+    {
+        WaitForSingleObject(pipe->CrcSem, INFINITE);
+        if (pipe->CrcIndex == pipe->Handed)
+            break; // vsechny predane bloky jsou zpracovane a Stop() nas ukoncuje
+
+        CPipelineBlock* block = &pipe->Blocks[pipe->CrcIndex++ % PIPELINE_BUFFERS];
+        pipe->Crc = SalamanderGeneral->UpdateCrc32(block->Data, block->Size, pipe->Crc);
+        if (InterlockedDecrement(&block->Users) == 0)
+            ReleaseSemaphore(pipe->FreeSem, 1, NULL);
+    }
+    return 0;
+}
+
+BOOL CReadPipeline::GetBlock(const char** data, DWORD* size, int* file, HWND parent)
+{
+    CALL_STACK_MESSAGE1("CReadPipeline::GetBlock(, , , )");
+
+    *size = 0;
+    if (Ended)
+        return TRUE;
+
+    WaitForSingleObject(ReadSem, INFINITE);
+    CPipelineBlock* block = &Blocks[WriteIndex % PIPELINE_BUFFERS];
+    if (block->Error)
+    { // cteci thread skoncil, cteni zopakujeme s Retry dialogem a pak ho spustime znovu
+        ThreadQueue.WaitForExit(ReaderThread);
+        ReaderThread = NULL;
+        while (1)
+        {
+            SAFE_FILE* f = &Files[block->File];
+            SetFilePointerEx(f->HFile, block->Pos, NULL, FILE_BEGIN);
+            DWORD numread;
+            if (!SalamanderSafeFile->SafeFileRead(f, block->Data, BufSize, &numread, parent,
+                                                  BUTTONS_RETRYCANCEL, NULL, NULL))
+            {
+                return FALSE; // cancel
+            }
+            if (numread > 0)
+            {
+                block->Size = numread;
+                block->Error = FALSE;
+                block->Users = 2;
+                ReadIndex = WriteIndex + 1;
+                ReadFileIndex = block->File;
+                ReaderThread = ThreadQueue.StartThread(ReaderThreadBody, this);
+                if (ReaderThread == NULL)
+                {
+                    TRACE_E("CReadPipeline::GetBlock(): unable to restart reader thread");
+                    return FALSE;
+                }
+                break;
+            }
+            if (++block->File >= FilesCount)
+            {
+                block->Error = FALSE;
+                block->End = TRUE;
+                break;
+            }
+            LARGE_INTEGER zero;
+            zero.QuadPart = 0;
+            SetFilePointerEx(Files[block->File].HFile, zero, &block->Pos, FILE_CURRENT);
+        }
+    }
+
+    if (block->End)
+    {
+        Ended = TRUE;
+        return TRUE;
+    }
+    *data = block->Data;
+    *size = block->Size;
+    if (file != NULL)
+        *file = block->File;
+    InterlockedIncrement(&Handed);
+    ReleaseSemaphore(CrcSem, 1, NULL);
+    return TRUE;
+}
+
+void CReadPipeline::ReleaseBlock()
+{
+    CPipelineBlock* block = &Blocks[WriteIndex++ % PIPELINE_BUFFERS];
+    if (InterlockedDecrement(&block->Users) == 0)
+        ReleaseSemaphore(FreeSem, 1, NULL);
+}
+
+UINT32
+CReadPipeline::Stop()
+{
+    CALL_STACK_MESSAGE1("CReadPipeline::Stop()");
+    if (CrcThread != NULL)
+    { // CRC thread dopocita predane bloky a skonci
+        ReleaseSemaphore(CrcSem, 1, NULL);
+        ThreadQueue.WaitForExit(CrcThread);
+        CrcThread = NULL;
+    }
+    if (ReaderThread != NULL)
+    { // cteci thread muze cekat na volny buffer
+        Abort = TRUE;
+        ReleaseSemaphore(FreeSem, 1, NULL);
+        ThreadQueue.WaitForExit(ReaderThread);
+        ReaderThread = NULL;
+    }
+    Cleanup();
+    return Crc;
+}
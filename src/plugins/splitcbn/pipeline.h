@@ -0,0 +1,83 @@
+﻿// SPDX-FileCopyrightText: 2023 Open Salamander Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+// *****************************************************************************
+//
+//  CReadPipeline
+//
+//  Postupne cteni posloupnosti souboru (casti pri Combine, jeden soubor pri Split)
+//  do kruhu bufferu: cteci thread predcita dalsi bloky, zatimco hlavni thread zapisuje
+//  aktualni blok a CRC thread z nej pocita CRC. Blok se vraci do kruhu az ho uvolni
+//  hlavni thread i CRC thread. Chyby cteni resi hlavni thread (SafeFileRead s Retry
+//  dialogem), cteci thread pri chybe jen skonci a po vyreseni chyby se spusti znovu.
+//
+
+#define PIPELINE_BUFFERS 4 // pocet bufferu v kruhu
+
+class CReadPipeline
+{
+public:
+    CReadPipeline();
+    ~CReadPipeline();
+
+    // alokuje buffery o velikosti 'bufSize' a spusti thready; soubory 'files' se ctou
+    // od aktualni pozice do konce, musi zustat otevrene az do volani Stop(); pri
+    // nedostatku pameti nebo chybe spusteni threadu vraci FALSE (chyba se neohlasuje)
+    BOOL Start(SAFE_FILE* files, int count, DWORD bufSize);
+
+    // vraci dalsi blok dat (ceka na jeho nacteni); '*size' == 0 znamena konec vsech
+    // souboru; 'file' (muze byt NULL) vraci index souboru, ze ktereho blok pochazi;
+    // vraci FALSE pokud uzivatel zrusil operaci v dialogu chyby cteni (nebo pokud se po
+    // chybe nepodarilo znovu spustit cteci thread)
+    BOOL GetBlock(const char** data, DWORD* size, int* file, HWND parent);
+    // uvolni blok vraceny poslednim volanim GetBlock() (jen pro '*size' != 0)
+    void ReleaseBlock();
+
+    // ukonci thready (i pokud nebyl dosazen konec) a uvolni buffery; vraci CRC vsech
+    // bloku vracenych z GetBlock()
+    UINT32 Stop();
+
+protected:
+    struct CPipelineBlock
+    {
+        char* Data;
+        DWORD Size;
+        int File;            // index souboru, ze ktereho jsou data
+        LARGE_INTEGER Pos;   // pozice dat v souboru (pro opakovani cteni po chybe)
+        BOOL Error;          // cteni skoncilo chybou, cteci thread skoncil
+        BOOL End;            // konec vsech souboru, cteci thread skoncil
+        volatile LONG Users; // hlavni thread + CRC thread; kdo blok uvolni posledni, vrati ho do kruhu
+    };
+
+    CPipelineBlock Blocks[PIPELINE_BUFFERS];
+    DWORD BufSize;
+    SAFE_FILE* Files;
+    int FilesCount;
+
+    HANDLE FreeSem; // pocet volnych bufferu (pro cteci thread)
+    HANDLE ReadSem; // pocet nactenych bloku (pro hlavni thread)
+    HANDLE CrcSem;  // pocet bloku predanych hlavnimu threadu (pro CRC thread)
+
+    HANDLE ReaderThread;
+    HANDLE CrcThread;
+    volatile BOOL Abort; // cteci thread ma skoncit (volani Stop())
+
+    // data cteciho threadu (hlavni thread je meni jen pokud cteci thread nebezi)
+    int ReadIndex;     // poradove cislo dalsiho cteneho bloku
+    int ReadFileIndex; // index prave cteneho souboru
+
+    // data hlavniho threadu
+    int WriteIndex;       // poradove cislo dalsiho bloku pro GetBlock()
+    volatile LONG Handed; // pocet bloku predanych z GetBlock() (cte i CRC thread)
+    BOOL Ended;           // GetBlock() uz vratil konec
+
+    // data CRC threadu
+    int CrcIndex;
+    UINT32 Crc;
+
+    void Cleanup();
+    static unsigned WINAPI ReaderThreadBody(void* param);
+    static unsigned WINAPI CrcThreadBody(void* param);
+};
@@ -31,3 +31,4 @@
 #include "dbg.h"
 #include "arraylt.h"
 #include "mhandles.h"
+#include "auxtools.h"
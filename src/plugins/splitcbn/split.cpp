@@ -8,6 +8,7 @@
 #include "lang\lang.rh"
 #include "split.h"
 #include "dialogs.h"
+#include "pipeline.h"
 
 // *****************************************************************************
 //
@@ -176,18 +177,17 @@ static BOOL SplitFile(LPTSTR fileName, LPTSTR targetDir, CQuadWord& qwPartSize,
         return TRUE;
     }
 
-    // alokace bufferu
+    // spusteni cteni souboru (predcitani a vypocet CRC bezi v threadech CReadPipeline)
     DWORD dwBufSize = (driveType == DRIVE_REMOVABLE) ? BUFSIZE1 : BUFSIZE2;
-    char* pBuffer = new char[dwBufSize];
-    if (pBuffer == NULL)
+    CReadPipeline pipeline;
+    if (!pipeline.Start(&file, 1, dwBufSize))
     {
         SalamanderGeneral->ShowMessageBox(LoadStr(IDS_OUTOFMEM), LoadStr(IDS_SPLIT), MSGBOX_ERROR);
         SalamanderSafeFile->SafeFileClose(&file);
         return FALSE;
     }
-
-    // init CRC
-    UINT32 Crc = 0;
+    const char* data = NULL; // nezapsany zbytek bloku z pipeline (blok muze presahovat do dalsi casti)
+    DWORD dataSize = 0;
 
     // progress dialog
     salamander->OpenProgressDialog(LoadStr(IDS_SPLIT), TRUE, NULL, FALSE);
@@ -236,7 +236,8 @@ static BOOL SplitFile(LPTSTR fileName, LPTSTR targetDir, CQuadWord& qwPartSize,
             break;
         }
 
-        // konecne: vykopirovani thisPartSize bajtu vstupniho souboru do vystupniho
+        // konecne: vykopirovani thisPartSize bajtu vstupniho souboru do vystupniho (u preskocene
+        // casti se data jen prectou, aby sedelo CRC celeho souboru)
         salamander->ProgressSetTotalSize(thisPartSize, CQuadWord(-1, -1));
         salamander->ProgressSetSize(CQuadWord(0, 0), CQuadWord(-1, -1), delayed);
         fileProgress = CQuadWord(0, 0);
@@ -245,41 +246,54 @@ static BOOL SplitFile(LPTSTR fileName, LPTSTR targetDir, CQuadWord& qwPartSize,
             char text2[MAX_PATH + 50];
             sprintf(text2, "%s %s...", LoadStr(IDS_WRITING), name2);
             salamander->ProgressDialogAddText(text2, delayed);
+        }
 
-            CQuadWord numBytes = thisPartSize;
-            while (numBytes.Value)
+        CQuadWord numBytes = thisPartSize;
+        while (numBytes.Value)
+        {
+            if (dataSize == 0)
             {
-                DWORD toread = (numBytes > CQuadWord(dwBufSize, 0)) ? dwBufSize : numBytes.LoDWord;
-                DWORD numread, numwr;
-                if (!SalamanderSafeFile->SafeFileRead(&file, pBuffer, toread, &numread, parent, BUTTONS_RETRYCANCEL, NULL, NULL) ||
-                    !SalamanderSafeFile->SafeFileWrite(&outfile, pBuffer, numread, &numwr, parent, BUTTONS_RETRYCANCEL, NULL, NULL))
+                if (!pipeline.GetBlock(&data, &dataSize, NULL, parent))
                 {
                     ret = FALSE;
                     break;
                 }
-                Crc = SalamanderGeneral->UpdateCrc32(pBuffer, numread, Crc);
-                CQuadWord qwnr(numread, 0);
-                numBytes -= qwnr;
-                fileProgress += qwnr;
-                if (!salamander->ProgressSetSize(fileProgress, totalProgress + fileProgress, delayed))
+                if (dataSize == 0) // soubor se mezitim zkratil
                 {
+                    SalamanderGeneral->ShowMessageBox(LoadStr(IDS_READERROR), LoadStr(IDS_SPLIT), MSGBOX_ERROR);
                     ret = FALSE;
                     break;
                 }
             }
-            SalamanderSafeFile->SafeFileClose(&outfile);
-            if (ret == FALSE)
+            DWORD towrite = (numBytes > CQuadWord(dataSize, 0)) ? dataSize : numBytes.LoDWord;
+            DWORD numwr;
+            if (!bSkip &&
+                !SalamanderSafeFile->SafeFileWrite(&outfile, (LPVOID)data, towrite, &numwr, parent, BUTTONS_RETRYCANCEL, NULL, NULL))
             {
-                DeleteFile(text);
+                ret = FALSE;
+                break;
+            }
+            data += towrite;
+            dataSize -= towrite;
+            if (dataSize == 0)
+                pipeline.ReleaseBlock();
+            CQuadWord qwnr(towrite, 0);
+            numBytes -= qwnr;
+            fileProgress += qwnr;
+            if (!salamander->ProgressSetSize(fileProgress, totalProgress + fileProgress, delayed))
+            {
+                ret = FALSE;
                 break;
             }
         }
-        else
+        if (!bSkip)
         {
-            CQuadWord distance = thisPartSize; // 'thisPartSize' se nesmi zmenit (zmeni se misto ni 'distance')
-            SalamanderSafeFile->SafeFileSeekMsg(&file, &distance, FILE_CURRENT, parent,
-                                                BUTTONS_RETRYCANCEL, NULL, NULL, TRUE);
+            SalamanderSafeFile->SafeFileClose(&outfile);
+            if (ret == FALSE)
+                DeleteFile(text);
         }
+        if (ret == FALSE)
+            break;
 
         bytesRemaining -= thisPartSize;
         totalProgress += thisPartSize;
@@ -297,7 +311,7 @@ static BOOL SplitFile(LPTSTR fileName, LPTSTR targetDir, CQuadWord& qwPartSize,
         }
     }
 
-    delete[] pBuffer;
+    UINT32 Crc = pipeline.Stop();
     SalamanderSafeFile->SafeFileClose(&file);
 
     // vytvoreni batch file
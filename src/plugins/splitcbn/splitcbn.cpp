@@ -29,6 +29,8 @@ CSalamanderGUIAbstract* SalamanderGUI = NULL;
 // definice promenne pro "dbg.h"
 CSalamanderDebugAbstract* SalamanderDebug = NULL;
 
+CThreadQueue ThreadQueue("Split & Combine Workers");
+
 BOOL configIncludeFileExt;
 BOOL configCreateBatchFile;
 BOOL configSplitToOther;
@@ -126,6 +128,13 @@ void CPluginInterface::About(HWND parent)
     SalamanderGeneral->SalMessageBox(parent, buf, LoadStr(IDS_ABOUTTITLE), MB_OK | MB_ICONINFORMATION);
 }
 
+BOOL CPluginInterface::Release(HWND parent, BOOL force)
+{
+    CALL_STACK_MESSAGE2("CPluginInterface::Release(, %d)", force);
+    ThreadQueue.KillAll(TRUE); // thready konci s koncem operace (CReadPipeline::Stop()), tohle je jen pojistka
+    return TRUE;
+}
+
 void CPluginInterface::LoadConfiguration(HWND parent, HKEY regKey, CSalamanderRegistryAbstract* registry)
 {
     CALL_STACK_MESSAGE1("CPluginInterface::LoadConfiguration(, ,)");
@@ -6,13 +6,14 @@
 extern CSalamanderGeneralAbstract* SalamanderGeneral;
 extern CSalamanderSafeFileAbstract* SalamanderSafeFile;
 extern CSalamanderGUIAbstract* SalamanderGUI;
+extern CThreadQueue ThreadQueue; // cteci a CRC thready pri split/combine (viz CReadPipeline)
 
 class CPluginInterface : public CPluginInterfaceAbstract
 {
 public:
     virtual void WINAPI About(HWND parent);
 
-    virtual BOOL WINAPI Release(HWND parent, BOOL force) { return TRUE; }
+    virtual BOOL WINAPI Release(HWND parent, BOOL force);
 
     virtual void WINAPI LoadConfiguration(HWND parent, HKEY regKey, CSalamanderRegistryAbstract* registry);
     virtual void WINAPI SaveConfiguration(HWND parent, HKEY regKey, CSalamanderRegistryAbstract* registry);
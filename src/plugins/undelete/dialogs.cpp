@@ -267,6 +267,7 @@ void CConnectDialog::Transfer(CTransferInfo& ti)
     ti.CheckBox(IDC_CHECK_SHOWEMPTYDIRS, ConfigShowEmptyDirs);
     ti.CheckBox(IDC_CHECK_SHOWMETAFILES, ConfigShowMetafiles);
     ti.CheckBox(IDC_CHECK_ESTIMATEDAMAGE, ConfigEstimateDamage);
+    ti.CheckBox(IDC_CHECK_CARVEFILES, ConfigCarveFiles);
 }
 
 void CConnectDialog::AddVolumeDetails(const char* root, const char* volumeName, const char* volumeFS,
@@ -18,6 +18,7 @@
 #include "undelete.h"
 #include "bitmap.h"
 #include "dataruns.h"
+#include "carver.h"
 #include "ntfs.h"
 #include "fat.h"
 #include "exfat.h"
@@ -76,6 +77,8 @@ CPluginFSInterface::CPluginFSInterface()
         Flags |= UF_SHOWMETAFILES;
     if (ConfigEstimateDamage)
         Flags |= UF_ESTIMATEDAMAGE;
+    if (ConfigCarveFiles)
+        Flags |= UF_CARVEFILES;
 }
 
 void WINAPI
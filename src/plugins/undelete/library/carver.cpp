@@ -0,0 +1,678 @@
+﻿// SPDX-FileCopyrightText: 2023 Open Salamander Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "precomp.h"
+
+#include <emmintrin.h>
+
+#include "..\undelete.rh2"
+
+#include "undelete.h"
+#include "miscstr.h"
+#include "os.h"
+#include "volume.h"
+#include "snapshot.h"
+
+#include "../dialogs.h"
+#include "../undelete.h"
+
+#include "carver.h"
+
+// **************************************************************************************
+//
+//   signatures
+//
+
+// header signatures, compared with first 16 bytes of each cluster at once
+struct CHeaderSignature
+{
+    BYTE Bytes[16];
+    BYTE Mask[16];
+};
+
+static const CHeaderSignature HeaderSignatures[cftCount] =
+    {
+        // cftJPEG: SOI marker followed by another marker
+        {{0xFF, 0xD8, 0xFF}, {0xFF, 0xFF, 0xFF}},
+        // cftPNG
+        {{0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A}, {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}},
+        // cftPDF
+        {{'%', 'P', 'D', 'F', '-'}, {0xFF, 0xFF, 0xFF, 0xFF, 0xFF}},
+        // cftZIP: local file header
+        {{'P', 'K', 0x03, 0x04}, {0xFF, 0xFF, 0xFF, 0xFF}},
+        // cftMP4: 'ftyp' box (its size is checked in GetHeaderType)
+        {{0, 0, 0, 0, 'f', 't', 'y', 'p'}, {0xFF, 0xFF, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF}},
+        // cftSQLite
+        {{'S', 'Q', 'L', 'i', 't', 'e', ' ', 'f', 'o', 'r', 'm', 'a', 't', ' ', '3', 0},
+         {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}},
+};
+
+// length of footer signatures (0 = type has no footer)
+static const DWORD FooterLength[cftCount] = {2, 0, 5, 4, 0, 0};
+
+// max. size of carved files, it also limits distance of footers from their headers
+static const QWORD MaxFileSize[cftCount] =
+    {
+        (QWORD)64 * 1024 * 1024,        // cftJPEG
+        (QWORD)64 * 1024 * 1024,        // cftPNG
+        (QWORD)512 * 1024 * 1024,       // cftPDF
+        (QWORD)0xFFFFFFFF,              // cftZIP (ZIP64 is not supported)
+        (QWORD)16 * 1024 * 1024 * 1024, // cftMP4
+        (QWORD)0xFFFFFFFF,              // cftSQLite
+};
+
+// top level boxes of ISO base media files (MP4, MOV, 3GP)
+static const char* const MP4Boxes[] = {"ftyp", "moov", "mdat", "free", "skip", "wide", "uuid", "moof", "mfra",
+                                       "meta", "pdin", "styp", "sidx", "ssix", "prft", "emsg", "udta", "pnot", NULL};
+
+static const char* const Extensions[cftCount] = {"jpg", "png", "pdf", "zip", "mp4", "sqlite"};
+
+static inline WORD GetBE16(const BYTE* p) { return (WORD)((p[0] << 8) | p[1]); }
+static inline DWORD GetBE32(const BYTE* p) { return ((DWORD)p[0] << 24) | ((DWORD)p[1] << 16) | ((DWORD)p[2] << 8) | p[3]; }
+static inline QWORD GetBE64(const BYTE* p) { return ((QWORD)GetBE32(p) << 32) | GetBE32(p + 4); }
+static inline WORD GetLE16(const BYTE* p) { return (WORD)(p[0] | (p[1] << 8)); }
+static inline DWORD GetLE32(const BYTE* p) { return p[0] | ((DWORD)p[1] << 8) | ((DWORD)p[2] << 16) | ((DWORD)p[3] << 24); }
+
+// returns type of file whose header is at 'data' (start of cluster) or -1
+static int GetHeaderType(const BYTE* data)
+{
+    __m128i v = _mm_loadu_si128((const __m128i*)data);
+    for (int i = 0; i < cftCount; i++)
+    {
+        __m128i mask = _mm_loadu_si128((const __m128i*)HeaderSignatures[i].Mask);
+        __m128i sig = _mm_loadu_si128((const __m128i*)HeaderSignatures[i].Bytes);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(v, mask), sig)) == 0xFFFF)
+        {
+            if (i == cftMP4)
+            {
+                DWORD size = GetBE32(data);
+                if (size < 16 || size > 256 || (size & 3) != 0)
+                    continue;
+            }
+            return i;
+        }
+    }
+    return -1;
+}
+
+// returns type of file whose footer is at 'data' or -1; 'avail' is number of bytes available at 'data'
+static int MatchFooter(const BYTE* data, DWORD avail)
+{
+    switch (data[0])
+    {
+    case 0xFF:
+    {
+        if (avail >= 2 && data[1] == 0xD9) // EOI
+            return cftJPEG;
+        break;
+    }
+
+    case '%':
+    {
+        if (avail >= 5 && memcmp(data, "%%EOF", 5) == 0)
+            return cftPDF;
+        break;
+    }
+
+    case 'P':
+    {
+        if (avail >= 4 && memcmp(data, "PK\x05\x06", 4) == 0) // end of central directory
+            return cftZIP;
+        break;
+    }
+    }
+    return -1;
+}
+
+// **************************************************************************************
+//
+//   CFileCarver
+//
+
+CFileCarver::CFileCarver(CCarvingSource* source, DWORD bytesPerCluster)
+    : Files(1000, 1000), Headers(1000, 1000), Footers(1000, 1000)
+{
+    Source = source;
+    BytesPerCluster = bytesPerCluster;
+    LowMemory = FALSE;
+    PrevTailEnd = (QWORD)-1;
+    Window = NULL;
+    WindowSize = 0;
+    WindowPos = 0;
+    WindowLen = 0;
+}
+
+CFileCarver::~CFileCarver()
+{
+    delete[] Window;
+}
+
+const char* CFileCarver::GetExtension(int type)
+{
+    CALL_STACK_MESSAGE_NONE
+    return type >= 0 && type < cftCount ? Extensions[type] : "";
+}
+
+void CFileCarver::AddHit(CCarveChunk* chunk, QWORD pos, int type, BOOL isFooter)
+{
+    CALL_STACK_MESSAGE_NONE
+    CCarveHit hit;
+    hit.Pos = pos;
+    hit.Type = type;
+    hit.IsFooter = isFooter;
+    chunk->Hits.Add(hit);
+    if (!chunk->Hits.IsGood())
+    {
+        chunk->Hits.ResetState();
+        chunk->LowMemory = TRUE;
+    }
+}
+
+void CFileCarver::ScanChunk(CCarveChunk* chunk)
+{
+    CALL_STACK_MESSAGE1("CFileCarver::ScanChunk()");
+
+    const __m128i ff = _mm_set1_epi8((char)0xFF);
+    const __m128i percent = _mm_set1_epi8('%');
+    const __m128i p = _mm_set1_epi8('P');
+    DWORD bytesPerCluster = chunk->Carver->BytesPerCluster;
+    for (DWORD offset = 0; offset < chunk->Size && !chunk->LowMemory; offset += bytesPerCluster)
+    {
+        const BYTE* data = chunk->Buffer + offset;
+        int type = GetHeaderType(data);
+        if (type != -1)
+            AddHit(chunk, chunk->Pos + offset, type, FALSE);
+
+        // look for first bytes of all footers at once, then verify candidates; clusters
+        // are multiples of 16 bytes, footer may continue into the next cluster
+        for (DWORD i = 0; i < bytesPerCluster; i += 16)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+            __m128i eq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, ff), _mm_cmpeq_epi8(v, percent)),
+                                      _mm_cmpeq_epi8(v, p));
+            unsigned mask = _mm_movemask_epi8(eq);
+            while (mask != 0)
+            {
+                unsigned long bit;
+                _BitScanForward(&bit, mask);
+                mask &= mask - 1;
+                DWORD pos = offset + i + bit;
+                type = MatchFooter(chunk->Buffer + pos, chunk->Size - pos);
+                if (type != -1)
+                    AddHit(chunk, chunk->Pos + pos, type, TRUE);
+            }
+        }
+    }
+}
+
+unsigned WINAPI CFileCarver::ScanThread(void* param)
+{
+    CALL_STACK_MESSAGE1("CFileCarver::ScanThread()");
+    ScanChunk((CCarveChunk*)param);
+    return 0;
+}
+
+void CFileCarver::AddFooter(QWORD pos, int type)
+{
+    CALL_STACK_MESSAGE_NONE
+    // footer can end only a file whose header precedes it closely enough, others are useless
+    if (LastHeaderPos[type] == (QWORD)-1 || pos - LastHeaderPos[type] > MaxFileSize[type])
+        return;
+    CCarveHit hit;
+    hit.Pos = pos;
+    hit.Type = type;
+    hit.IsFooter = TRUE;
+    Footers.Add(hit);
+    if (!Footers.IsGood())
+    {
+        Footers.ResetState();
+        LowMemory = TRUE;
+    }
+}
+
+void CFileCarver::MergeChunk(CCarveChunk* chunk)
+{
+    CALL_STACK_MESSAGE1("CFileCarver::MergeChunk()");
+
+    if (chunk->Thread != NULL)
+    {
+        ThreadQueue.WaitForExit(chunk->Thread);
+        chunk->Thread = NULL;
+    }
+    chunk->Pending = FALSE;
+    if (chunk->LowMemory)
+    {
+        LowMemory = TRUE;
+        chunk->LowMemory = FALSE;
+    }
+
+    // footers crossing the boundary with previous chunk (not seen by scanning threads)
+    if (PrevTailEnd == chunk->Pos)
+    {
+        BYTE window[16];
+        memcpy(window, PrevTail, 8);
+        memcpy(window + 8, chunk->Buffer, 8);
+        for (int i = 1; i < 8; i++)
+        {
+            int type = MatchFooter(window + i, 16 - i);
+            if (type != -1 && i + FooterLength[type] > 8)
+                AddFooter(chunk->Pos - 8 + i, type);
+        }
+    }
+
+    // hits are sorted by position, chunks are merged in order they were read
+    for (int i = 0; i < chunk->Hits.Count; i++)
+    {
+        const CCarveHit* hit = &chunk->Hits[i];
+        if (hit->IsFooter)
+            AddFooter(hit->Pos, hit->Type);
+        else
+        {
+            CCarveHeader header;
+            header.Pos = hit->Pos;
+            header.End = chunk->RangeEnd;
+            header.Type = hit->Type;
+            Headers.Add(header);
+            if (!Headers.IsGood())
+            {
+                Headers.ResetState();
+                LowMemory = TRUE;
+            }
+            LastHeaderPos[hit->Type] = hit->Pos;
+        }
+    }
+    chunk->Hits.DetachMembers();
+
+    memcpy(PrevTail, chunk->Buffer + chunk->Size - 8, 8);
+    PrevTailEnd = chunk->Pos + chunk->Size;
+}
+
+BOOL CFileCarver::Scan(const QWORD* firstCluster, const QWORD* clustersCount, DWORD count, CSnapshotProgressDlg* progress)
+{
+    CALL_STACK_MESSAGE2("CFileCarver::Scan(, , %u, )", count);
+
+    Files.DestroyMembers();
+    Headers.DestroyMembers();
+    Footers.DestroyMembers();
+    for (int i = 0; i < cftCount; i++)
+        LastHeaderPos[i] = (QWORD)-1;
+    PrevTailEnd = (QWORD)-1;
+    LowMemory = FALSE;
+
+    QWORD total = 0;
+    for (DWORD i = 0; i < count; i++)
+        total += clustersCount[i];
+    if (total == 0)
+        return TRUE;
+
+    // phase 1: main thread reads chunks sequentially (volume reads are not thread-safe),
+    // scanning threads look for signatures; one more chunk than threads is needed to keep
+    // reading while all threads are busy
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    int threads = min((int)si.dwNumberOfProcessors, CARVE_MAX_THREADS);
+    if (threads < 1)
+        threads = 1;
+    int slots = threads + 1;
+    DWORD chunkClusters = max(CARVE_CHUNK_SIZE / BytesPerCluster, (DWORD)1);
+
+    CCarveChunk chunks[CARVE_MAX_THREADS + 1];
+    BOOL ret = TRUE;
+    for (int i = 0; i < slots; i++)
+    {
+        chunks[i].Carver = this;
+        chunks[i].Buffer = new BYTE[chunkClusters * BytesPerCluster];
+        if (chunks[i].Buffer == NULL)
+        {
+            LowMemory = TRUE;
+            ret = FALSE;
+            break;
+        }
+    }
+
+    QWORD done = 0;
+    int slot = 0;
+    for (DWORD r = 0; ret && r < count; r++)
+    {
+        QWORD cluster = firstCluster[r];
+        QWORD left = clustersCount[r];
+        QWORD rangeEnd = (cluster + left) * BytesPerCluster;
+        while (left > 0)
+        {
+            CCarveChunk* chunk = &chunks[slot];
+            if (chunk->Pending)
+                MergeChunk(chunk); // the oldest chunk, its buffer is reused now
+
+            DWORD num = (DWORD)min(left, (QWORD)chunkClusters);
+            if (Source->ReadClusters(chunk->Buffer, cluster, num))
+            {
+                chunk->Pos = cluster * BytesPerCluster;
+                chunk->Size = num * BytesPerCluster;
+                chunk->RangeEnd = rangeEnd;
+                chunk->Pending = TRUE;
+                chunk->Thread = NULL;
+                if (threads > 1)
+                    chunk->Thread = ThreadQueue.StartThread(ScanThread, chunk);
+                if (chunk->Thread == NULL)
+                    ScanChunk(chunk); // single thread is enough or thread was not started
+                slot = (slot + 1) % slots;
+            }
+            else
+                TRACE_E("CFileCarver::Scan(): unable to read clusters from " << cluster << ", count " << num << ", skipping them");
+
+            cluster += num;
+            left -= num;
+            done += num;
+            progress->SetProgress((DWORD)(done * 900 / total));
+            if (progress->GetWantCancel() || LowMemory)
+            {
+                ret = FALSE;
+                break;
+            }
+        }
+    }
+
+    // merge remaining chunks from the oldest one, this also waits for their threads
+    for (int i = 0; i < slots; i++)
+    {
+        CCarveChunk* chunk = &chunks[(slot + i) % slots];
+        if (chunk->Pending)
+            MergeChunk(chunk);
+    }
+    for (int i = 0; i < slots; i++)
+        delete[] chunks[i].Buffer;
+
+    TRACE_I("CFileCarver::Scan(): headers=" << Headers.Count << ", footers=" << Footers.Count);
+
+    // phase 2: estimate file ends from their structure (few small reads per file)
+    if (ret)
+    {
+        WindowSize = max((DWORD)CARVE_WINDOW_SIZE, 2 * BytesPerCluster);
+        WindowLen = 0;
+        Window = new BYTE[WindowSize];
+        if (Window == NULL)
+        {
+            LowMemory = TRUE;
+            ret = FALSE;
+        }
+    }
+    QWORD carvedEnd = 0; // end of last carved file, headers inside carved files are skipped
+    for (int i = 0; ret && i < Headers.Count; i++)
+    {
+        if ((i & 0xff) == 0)
+        {
+            progress->SetProgress(900 + (DWORD)((QWORD)i * 100 / Headers.Count));
+            if (progress->GetWantCancel())
+            {
+                ret = FALSE;
+                break;
+            }
+        }
+        if (Headers[i].Pos < carvedEnd)
+            continue;
+
+        QWORD size = GetFileSize(i);
+        if (size > 0)
+        {
+            CCarvedFile file;
+            file.Cluster = Headers[i].Pos / BytesPerCluster;
+            file.Size = size;
+            file.Type = Headers[i].Type;
+            Files.Add(file);
+            if (!Files.IsGood())
+            {
+                Files.ResetState();
+                LowMemory = TRUE;
+                ret = FALSE;
+            }
+            carvedEnd = Headers[i].Pos + size;
+        }
+    }
+    delete[] Window;
+    Window = NULL;
+
+    Headers.DestroyMembers();
+    Footers.DestroyMembers();
+
+    if (LowMemory)
+        return String<char>::Error(IDS_UNDELETE, IDS_LOWMEM);
+    TRACE_I("CFileCarver::Scan(): carved files=" << Files.Count);
+    return ret;
+}
+
+BOOL CFileCarver::ReadAt(QWORD pos, void* buffer, DWORD size, QWORD limit)
+{
+    CALL_STACK_MESSAGE_NONE
+    if (pos + size > limit)
+        return FALSE;
+    if (pos < WindowPos || pos + size > WindowPos + WindowLen)
+    {
+        // 'limit' never exceeds end of cluster range, so rounding up stays inside it
+        QWORD cluster = pos / BytesPerCluster;
+        QWORD num = min((QWORD)(WindowSize / BytesPerCluster),
+                        (limit - cluster * BytesPerCluster + BytesPerCluster - 1) / BytesPerCluster);
+        WindowLen = 0;
+        if (!Source->ReadClusters(Window, cluster, num))
+            return FALSE;
+        WindowPos = cluster * BytesPerCluster;
+        WindowLen = (DWORD)num * BytesPerCluster;
+    }
+    memcpy(buffer, Window + (pos - WindowPos), size);
+    return TRUE;
+}
+
+int CFileCarver::FindFooter(int type, QWORD from, QWORD to)
+{
+    CALL_STACK_MESSAGE_NONE
+    // binary search for the first footer at 'from' or later
+    int l = 0;
+    int r = Footers.Count;
+    while (l < r)
+    {
+        int m = (l + r) / 2;
+        if (Footers[m].Pos < from)
+            l = m + 1;
+        else
+            r = m;
+    }
+    for (; l < Footers.Count && Footers[l].Pos < to; l++)
+    {
+        if (Footers[l].Type == type)
+            return l;
+    }
+    return -1;
+}
+
+QWORD CFileCarver::GetFileSize(int index)
+{
+    CALL_STACK_MESSAGE_NONE
+    const CCarveHeader* header = &Headers[index];
+    QWORD limit = header->End;
+    if (limit - header->Pos > MaxFileSize[header->Type])
+        limit = header->Pos + MaxFileSize[header->Type];
+
+    switch (header->Type)
+    {
+    case cftJPEG:
+        return GetJPEGSize(header->Pos, limit);
+    case cftPNG:
+        return GetPNGSize(header->Pos, limit);
+    case cftPDF:
+        return GetPDFSize(index, limit);
+    case cftZIP:
+        return GetZIPSize(header->Pos, limit);
+    case cftMP4:
+        return GetMP4Size(header->Pos, limit);
+    case cftSQLite:
+        return GetSQLiteSize(header->Pos, limit);
+    }
+    return 0;
+}
+
+QWORD CFileCarver::GetJPEGSize(QWORD start, QWORD limit)
+{
+    CALL_STACK_MESSAGE_NONE
+    // walk marker segments up to the first SOS, entropy-coded data cannot contain EOI,
+    // so the file ends with the first EOI found behind it
+    QWORD pos = start + 2;
+    for (int segments = 0; segments < 1000; segments++)
+    {
+        BYTE m[4];
+        if (!ReadAt(pos, m, 4, limit) || m[0] != 0xFF)
+            return 0;
+        if (m[1] == 0xFF) // fill byte
+        {
+            pos++;
+            continue;
+        }
+        if (m[1] == 0xD9) // EOI
+            return pos + 2 - start;
+        if (m[1] == 0x01 || (m[1] >= 0xD0 && m[1] <= 0xD7)) // markers without length
+        {
+            pos += 2;
+            continue;
+        }
+        WORD len = GetBE16(m + 2);
+        if (len < 2)
+            return 0;
+        pos += 2 + len;
+        if (m[1] == 0xDA) // SOS
+        {
+            int footer = FindFooter(cftJPEG, pos, limit - 1);
+            return footer != -1 ? Footers[footer].Pos + 2 - start : 0;
+        }
+    }
+    return 0;
+}
+
+QWORD CFileCarver::GetPNGSize(QWORD start, QWORD limit)
+{
+    CALL_STACK_MESSAGE_NONE
+    // walk chunks up to IEND
+    QWORD pos = start + 8;
+    for (int chunks = 0; chunks < 100000; chunks++)
+    {
+        BYTE h[8];
+        if (!ReadAt(pos, h, 8, limit))
+            return 0;
+        DWORD len = GetBE32(h);
+        for (int i = 4; i < 8; i++)
+        {
+            if (!((h[i] >= 'A' && h[i] <= 'Z') || (h[i] >= 'a' && h[i] <= 'z')))
+                return 0; // not a chunk type
+        }
+        if (len > 0x7FFFFFFF)
+            return 0;
+        pos += 12 + (QWORD)len; // length, type, data, CRC
+        if (memcmp(h + 4, "IEND", 4) == 0)
+            return pos <= limit ? pos - start : 0;
+    }
+    return 0;
+}
+
+QWORD CFileCarver::GetPDFSize(int index, QWORD limit)
+{
+    CALL_STACK_MESSAGE_NONE
+    // incrementally updated PDF contains several %%EOF, take the last one before next PDF
+    QWORD start = Headers[index].Pos;
+    for (int i = index + 1; i < Headers.Count && Headers[i].Pos < limit; i++)
+    {
+        if (Headers[i].Type == cftPDF)
+        {
+            limit = Headers[i].Pos;
+            break;
+        }
+    }
+    QWORD end = 0;
+    for (int footer = FindFooter(cftPDF, start, limit); footer != -1;
+         footer = FindFooter(cftPDF, Footers[footer].Pos + 1, limit))
+    {
+        if (Footers[footer].Pos + 5 <= limit)
+            end = Footers[footer].Pos + 5;
+    }
+    if (end == 0)
+        return 0;
+    BYTE eol[2]; // include end of line behind %%EOF
+    if (ReadAt(end, eol, 2, limit) && eol[0] == '\r' && eol[1] == '\n')
+        end += 2;
+    else if (ReadAt(end, eol, 1, limit) && (eol[0] == '\r' || eol[0] == '\n'))
+        end++;
+    return end - start;
+}
+
+QWORD CFileCarver::GetZIPSize(QWORD start, QWORD limit)
+{
+    CALL_STACK_MESSAGE_NONE
+    // end of central directory record must point to central directory right before it
+    int footers = 0;
+    for (int footer = FindFooter(cftZIP, start, limit); footer != -1 && footers < 10000;
+         footer = FindFooter(cftZIP, Footers[footer].Pos + 1, limit), footers++)
+    {
+        QWORD pos = Footers[footer].Pos;
+        BYTE eocd[22];
+        if (!ReadAt(pos, eocd, 22, limit))
+            break;
+        if (GetLE16(eocd + 4) != 0 || GetLE16(eocd + 6) != 0 || GetLE16(eocd + 8) != GetLE16(eocd + 10))
+            continue; // multi-disk archives are not supported
+        QWORD cdEnd = (QWORD)GetLE32(eocd + 16) + GetLE32(eocd + 12);
+        if (cdEnd == pos - start)
+        {
+            QWORD end = pos + 22 + GetLE16(eocd + 20);
+            return end <= limit ? end - start : 0;
+        }
+    }
+    return 0;
+}
+
+QWORD CFileCarver::GetMP4Size(QWORD start, QWORD limit)
+{
+    CALL_STACK_MESSAGE_NONE
+    // walk top level boxes until something else is found
+    QWORD pos = start;
+    BOOL mdat = FALSE;
+    for (int boxes = 0; pos < limit && boxes < 10000; boxes++)
+    {
+        BYTE h[16];
+        if (!ReadAt(pos, h, 8, limit))
+            break;
+        int i;
+        for (i = 0; MP4Boxes[i] != NULL && memcmp(h + 4, MP4Boxes[i], 4) != 0; i++)
+            ;
+        if (MP4Boxes[i] == NULL)
+            break;
+        QWORD size = GetBE32(h);
+        if (size == 1) // 64-bit size follows
+        {
+            if (!ReadAt(pos, h, 16, limit))
+                break;
+            size = GetBE64(h + 8);
+        }
+        else if (size == 0) // box extends to the end of file
+            size = limit - pos;
+        if (size < 8 || size > limit - pos)
+            return 0; // truncated file
+        if (memcmp(h + 4, "mdat", 4) == 0)
+            mdat = TRUE;
+        pos += size;
+    }
+    return mdat ? pos - start : 0;
+}
+
+QWORD CFileCarver::GetSQLiteSize(QWORD start, QWORD limit)
+{
+    CALL_STACK_MESSAGE_NONE
+    // database size in pages is valid only when "version-valid-for" equals change counter
+    BYTE h[100];
+    if (!ReadAt(start, h, 100, limit))
+        return 0;
+    DWORD pageSize = GetBE16(h + 16);
+    if (pageSize == 1)
+        pageSize = 65536;
+    if (pageSize < 512 || (pageSize & (pageSize - 1)) != 0)
+        return 0;
+    DWORD pages = GetBE32(h + 28);
+    if (pages == 0 || GetBE32(h + 24) != GetBE32(h + 92))
+        return 0;
+    QWORD size = (QWORD)pageSize * pages;
+    return size <= limit - start ? size : 0;
+}
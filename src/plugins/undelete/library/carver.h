@@ -0,0 +1,140 @@
+﻿// SPDX-FileCopyrightText: 2023 Open Salamander Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+// **************************************************************************************
+//
+//   CFileCarver - looks for lost files by their signatures
+//
+//   Files are searched in given cluster ranges (typically the lost clusters map returned
+//   by UF_GETLOSTCLUSTERMAP or a whole disk image). Headers are recognized at cluster
+//   starts only, footers anywhere. Scanning is split into chunks, the main thread reads
+//   them sequentially and worker threads scan them; the end of each found file is then
+//   estimated from its format structure. Carved files are expected to be contiguous.
+//
+
+#define CARVE_CHUNK_SIZE (4 * 1024 * 1024) // size of one read in scanning phase
+#define CARVE_MAX_THREADS 4                // max. number of scanning threads
+#define CARVE_WINDOW_SIZE (64 * 1024)      // read window used when walking file structures
+
+enum CCarvedFileType
+{
+    cftJPEG,
+    cftPNG,
+    cftPDF,
+    cftZIP,
+    cftMP4,
+    cftSQLite,
+    cftCount
+};
+
+struct CCarvedFile
+{
+    QWORD Cluster; // first cluster of the file
+    QWORD Size;    // estimated file size in bytes
+    int Type;      // from CCarvedFileType family
+};
+
+// source of clusters for the carver; ReadClusters is called from the main thread only
+class CCarvingSource
+{
+public:
+    virtual BOOL ReadClusters(void* buffer, QWORD cluster, QWORD num) = 0;
+};
+
+template <typename CHAR>
+class CVolumeCarvingSource : public CCarvingSource
+{
+public:
+    CVolumeCarvingSource(CVolume<CHAR>* volume) { Volume = volume; }
+    virtual BOOL ReadClusters(void* buffer, QWORD cluster, QWORD num) { return Volume->ReadClusters(buffer, cluster, num); }
+
+protected:
+    CVolume<CHAR>* Volume;
+};
+
+class CFileCarver
+{
+public:
+    CFileCarver(CCarvingSource* source, DWORD bytesPerCluster);
+    ~CFileCarver();
+
+    // scans 'count' cluster ranges and fills Files; returns FALSE on cancel or low memory
+    // (error is displayed already)
+    BOOL Scan(const QWORD* firstCluster, const QWORD* clustersCount, DWORD count, CSnapshotProgressDlg* progress);
+
+    static const char* GetExtension(int type);
+
+    TDirectArray<CCarvedFile> Files; // found files sorted by cluster
+
+protected:
+    struct CCarveHit
+    {
+        QWORD Pos;     // position of the signature in bytes
+        int Type;      // from CCarvedFileType family
+        BOOL IsFooter; // TRUE = footer (JPEG EOI, PDF %%EOF, ZIP end of central directory)
+    };
+
+    struct CCarveHeader
+    {
+        QWORD Pos; // position of the header in bytes
+        QWORD End; // end of cluster range containing the header in bytes
+        int Type;
+    };
+
+    struct CCarveChunk
+    {
+        CCarveChunk() : Hits(1024, 4096)
+        {
+            Buffer = NULL;
+            Pos = 0;
+            Size = 0;
+            RangeEnd = 0;
+            Thread = NULL;
+            Pending = FALSE;
+            LowMemory = FALSE;
+        }
+
+        CFileCarver* Carver;
+        BYTE* Buffer;
+        QWORD Pos;      // position of Buffer on disk in bytes
+        DWORD Size;     // number of valid bytes in Buffer
+        QWORD RangeEnd; // end of cluster range containing this chunk in bytes
+        HANDLE Thread;  // scanning thread or NULL if the chunk was scanned in main thread
+        TDirectArray<CCarveHit> Hits;
+        BOOL Pending;   // chunk is (being) scanned, hits were not merged yet
+        BOOL LowMemory; // set by scanning thread when Hits could not be enlarged
+    };
+
+    CCarvingSource* Source;
+    DWORD BytesPerCluster;
+
+    TDirectArray<CCarveHeader> Headers; // headers found in scanning phase, sorted by position
+    TDirectArray<CCarveHit> Footers;    // footers found in scanning phase, sorted by position
+    QWORD LastHeaderPos[cftCount];      // position of last merged header of each type, (QWORD)-1 = none
+    BYTE PrevTail[8];                   // last bytes of previously merged chunk...
+    QWORD PrevTailEnd;                  // ...and their end position (to find footers crossing chunks)
+    BOOL LowMemory;
+
+    BYTE* Window;     // read window for structure walking
+    DWORD WindowSize; // allocated size of Window
+    QWORD WindowPos;  // position of Window on disk in bytes
+    DWORD WindowLen;  // number of valid bytes in Window
+
+    static void ScanChunk(CCarveChunk* chunk);
+    static void AddHit(CCarveChunk* chunk, QWORD pos, int type, BOOL isFooter);
+    static unsigned WINAPI ScanThread(void* param);
+    void MergeChunk(CCarveChunk* chunk);
+    void AddFooter(QWORD pos, int type);
+
+    BOOL ReadAt(QWORD pos, void* buffer, DWORD size, QWORD limit);
+    int FindFooter(int type, QWORD from, QWORD to);
+    QWORD GetFileSize(int index);
+    QWORD GetJPEGSize(QWORD start, QWORD limit);
+    QWORD GetPNGSize(QWORD start, QWORD limit);
+    QWORD GetPDFSize(int index, QWORD limit);
+    QWORD GetZIPSize(QWORD start, QWORD limit);
+    QWORD GetMP4Size(QWORD start, QWORD limit);
+    QWORD GetSQLiteSize(QWORD start, QWORD limit);
+};
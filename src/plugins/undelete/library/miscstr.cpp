@@ -263,12 +263,14 @@ char* String<char>::CopyFromUnicode(char* dest, const wchar_t* src, unsigned lon
     {
         if (destlen > srclen)
         {
-            if (WideCharToMultiByte(CP_ACP, 0, src, srclen, dest, destlen, NULL, NULL) == 0)
+            // in DBCS code page the result can be longer than srclen, terminate after it
+            int len = WideCharToMultiByte(CP_ACP, 0, src, srclen, dest, destlen - 1, NULL, NULL);
+            if (len == 0)
             {
                 DWORD err = GetLastError();
                 TRACE_E("WideCharToMultiByte error: " << err);
             }
-            dest[srclen] = 0;
+            dest[len] = 0;
         }
         else
             TRACE_E("CopyFromUnicode error: small dest buffer");
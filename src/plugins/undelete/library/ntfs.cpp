@@ -20,6 +20,7 @@
 
 #include "dataruns.h"
 #include "stream.h"
+#include "carver.h"
 #include "ntfs.h"
 
 // **************************************************************************************
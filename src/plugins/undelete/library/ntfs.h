@@ -110,6 +110,10 @@ struct ATTRIBUTE_VOLUME_INFORMATION
 
 #pragma pack(pop, ntfs_h)
 
+#define MFT_READ_SIZE (4 * 1024 * 1024) // how much of MFT we read in one step (in bytes)
+#define MFT_PARSE_THREADS 4             // max. number of threads parsing MFT records
+#define MFT_PARSE_MIN_RECORDS 256       // min. number of records for one parsing thread
+
 template <typename CHAR>
 class CMFTSnapshot : public CSnapshot<CHAR>
 {
@@ -123,7 +127,38 @@ public:
     QWORD MFTItems;
 
 private:
-    BOOL ParseRecord(BYTE* data, QWORD index);
+    // part of MFT parsed by one worker thread
+    struct CParseJob
+    {
+        CMFTSnapshot<CHAR>* Snapshot;
+        BYTE* Data;            // first record
+        QWORD First;           // index of first record
+        QWORD Count;           // number of records
+        CSnapshotArena* Arena; // arena for new records
+        HANDLE Thread;         // worker thread, NULL if job was parsed in main thread
+        int ErrorID;           // 0 = success, otherwise error text ID
+        QWORD ErrorIndex;      // index of failed record
+    };
+
+    // part of MFT read in one step, its records are parsed while the next part is read
+    struct CParseBatch
+    {
+        BYTE* Data;
+        QWORD First; // index of first record
+        QWORD Count; // number of records
+        CParseJob Jobs[MFT_PARSE_THREADS];
+        int JobsCount;
+    };
+
+    // returns 0 on success, otherwise ID of error text (error is not displayed, record could
+    // be parsed in worker thread)
+    int ParseRecord(BYTE* data, QWORD index, CSnapshotArena* arena);
+    void ParseRecords(CParseJob* job);
+    static unsigned WINAPI ParseThread(void* param);
+    void StartParsing(CParseBatch* batch, BYTE* data, QWORD first, QWORD count);
+    // waits for parsing of 'batch' and parses its extension records; returns 0 or error text ID,
+    // in 'errorIndex' returns index of first record which was not parsed
+    int FinishParsing(CParseBatch* batch, QWORD* errorIndex);
     BOOL BuildDirectoryTree();
     BOOL IsValidRef(QWORD fileref);
     void Mark(FILE_RECORD_I<CHAR>* r, DWORD depth);
@@ -136,6 +171,7 @@ private:
     DWORD GetFileCondition(FILE_RECORD_I<CHAR>* record, CClusterBitmap* clusterBitmap);
     BOOL EstimateFileDamage(CLUSTER_MAP_I** clusterMap);
     BOOL GetLostClustersMap(CClusterBitmap* clusterBitmap, CLUSTER_MAP_I* clusterMap);
+    BOOL CarveFiles(CLUSTER_MAP_I* clusterMap);
 
 #ifdef TRACE_ENABLE
     QWORD GetRecordMemUsage(FILE_RECORD_I<CHAR>*);
@@ -151,6 +187,7 @@ private:
     BOOL ErrorsFound;
     BOOL RootAllocated; // fixme: don't forget ErrorsFound on higher levels
     TIndirectArray<VIRTUAL_DIR<CHAR>> VirtualDirs;
+    CSnapshotArena Arenas[MFT_PARSE_THREADS + 1]; // arenas of worker threads, the last one is for main thread
 
     QWORD ClustersProcessed; // current progress in clusters
     QWORD ClustersTotal;     // total progress in clusters
@@ -213,7 +250,7 @@ void CMFTSnapshot<CHAR>::DumpHexData(BYTE* data, DWORD len)
 #endif
 
 template <typename CHAR>
-BOOL CMFTSnapshot<CHAR>::ParseRecord(BYTE* data, QWORD index)
+int CMFTSnapshot<CHAR>::ParseRecord(BYTE* data, QWORD index, CSnapshotArena* arena)
 {
     CALL_STACK_MESSAGE_NONE
     //CALL_STACK_MESSAGE2("CMFTSnapshot::ParseRecord(, %d)", index);
@@ -231,7 +268,7 @@ BOOL CMFTSnapshot<CHAR>::ParseRecord(BYTE* data, QWORD index)
       return Error(IDS_UNDELETE, IDS_ERRORMETADAMAGED); // metafiles must be OK
     else*/
         // fixme // update: on NT4 are records 16-24 unused and doesn't have header, we can skip this check
-        return TRUE; // looks like one of 'BAAD' records, skip it
+        return 0; // looks like one of 'BAAD' records, skip it
     }
 
     if (!meta && !(this->UdFlags & UF_SHOWEXISTING))
@@ -239,7 +276,7 @@ BOOL CMFTSnapshot<CHAR>::ParseRecord(BYTE* data, QWORD index)
         // if it isn't directory and record is used, skip it
         // don't take rheader->BaseRecord into account here, we want to hide (existing) files with BaseRecord != 0
         if (!(rheader->FRHFlags & FRHFLAG_RECORD_IS_DIRECTORY) && (rheader->FRHFlags & FRHFLAG_RECORD_IS_IN_USE))
-            return TRUE;
+            return 0;
     }
 
     WORD* update = (WORD*)(data + rheader->UpdateOffset);
@@ -254,9 +291,9 @@ BOOL CMFTSnapshot<CHAR>::ParseRecord(BYTE* data, QWORD index)
                                        << "(i = " << i << ")");
             DumpHexData(data, BytesPerMFTRecord);
             if (index == 0)
-                return String<CHAR>::Error(IDS_UNDELETE, IDS_MFTRECORDDAMAGED); // we cannot skip MFT
+                return IDS_MFTRECORDDAMAGED; // we cannot skip MFT
             else
-                return TRUE;
+                return 0;
         }
         *lastw = *update++;
         lastw += this->Volume->NTFSBoot.BytesPerSector / 2;
@@ -266,7 +303,7 @@ BOOL CMFTSnapshot<CHAR>::ParseRecord(BYTE* data, QWORD index)
     if (rheader->BaseRecord != 0)
     {
         if (index == 0)
-            return String<CHAR>::Error(IDS_UNDELETE, IDS_MFTRECORDDAMAGED);
+            return IDS_MFTRECORDDAMAGED;
 
         QWORD oldindex = index;
         index = LODWORD(rheader->BaseRecord);
@@ -282,9 +319,9 @@ BOOL CMFTSnapshot<CHAR>::ParseRecord(BYTE* data, QWORD index)
     FILE_RECORD_I<CHAR>*& mftr = MFT[index];
     if (mftr == NULL)
     {
-        mftr = new FILE_RECORD_I<CHAR>;
+        mftr = arena->New<FILE_RECORD_I<CHAR>>();
         if (mftr == NULL)
-            return String<CHAR>::Error(IDS_UNDELETE, IDS_LOWMEM);
+            return IDS_LOWMEM;
     }
     FILE_RECORD_I<CHAR>* record = mftr;
 
@@ -355,19 +392,20 @@ BOOL CMFTSnapshot<CHAR>::ParseRecord(BYTE* data, QWORD index)
             // do we need record?
             if (fname == NULL)
             {
-                fname = new FILE_NAME_I<CHAR>;
+                fname = arena->New<FILE_NAME_I<CHAR>>();
                 if (fname == NULL)
-                    return String<CHAR>::Error(IDS_UNDELETE, IDS_LOWMEM);
+                    return IDS_LOWMEM;
                 fname->FNNext = record->FileNames;
                 record->FileNames = fname;
             }
 
-            // store name
-            if (fname->FNName != NULL)
-                delete[] fname->FNName;
-            fname->FNName = String<CHAR>::NewFromUnicode(attr->FileName, attr->FileNameLength);
+            // store name (overwritten name stays in arena until Free()); NTFS name has up to
+            // 255 WCHARs, which is up to 510 bytes in a DBCS code page
+            CHAR name[2 * MAX_PATH];
+            String<CHAR>::CopyFromUnicode(name, attr->FileName, attr->FileNameLength, 2 * MAX_PATH);
+            fname->FNName = arena->NewStr(name);
             if (fname->FNName == NULL)
-                return String<CHAR>::Error(IDS_UNDELETE, IDS_LOWMEM);
+                return IDS_LOWMEM;
             fname->ParentRecord = attr->ParentDir;
             break;
         }
@@ -378,9 +416,9 @@ BOOL CMFTSnapshot<CHAR>::ParseRecord(BYTE* data, QWORD index)
             //TRACE_I("Found data/stream.");
 
             // do we have already stream with same name?
-            CHAR streamname[MAX_PATH];
-            if (!String<CHAR>::CopyFromUnicode(streamname, (WCHAR*)(data + offset + aheader->NameOffset), aheader->NameLength, MAX_PATH))
-                return String<CHAR>::Error(IDS_UNDELETE, IDS_READINGMFT);
+            CHAR streamname[2 * MAX_PATH]; // DBCS, see $FILE_NAME
+            if (!String<CHAR>::CopyFromUnicode(streamname, (WCHAR*)(data + offset + aheader->NameOffset), aheader->NameLength, 2 * MAX_PATH))
+                return IDS_READINGMFT;
 
             // for attribute $LOGGED_UTILITY_STREAM we are interested only in these related to EFS
             if (aheader->Type == $LOGGED_UTILITY_STREAM && String<CHAR>::StrICmp(streamname, STRING_EFS))
@@ -398,14 +436,14 @@ BOOL CMFTSnapshot<CHAR>::ParseRecord(BYTE* data, QWORD index)
             // if no, create it
             if (stream == NULL)
             {
-                stream = new DATA_STREAM_I<CHAR>;
+                stream = arena->New<DATA_STREAM_I<CHAR>>();
                 if (stream == NULL)
-                    return String<CHAR>::Error(IDS_UNDELETE, IDS_LOWMEM);
+                    return IDS_LOWMEM;
                 if (aheader->NameLength)
                 {
-                    stream->DSName = String<CHAR>::NewStr(streamname);
+                    stream->DSName = arena->NewStr(streamname);
                     if (stream->DSName == NULL)
-                        return String<CHAR>::Error(IDS_UNDELETE, IDS_LOWMEM);
+                        return IDS_LOWMEM;
                 }
                 stream->DSNext = NULL;
                 *lastptr = stream;
@@ -414,17 +452,16 @@ BOOL CMFTSnapshot<CHAR>::ParseRecord(BYTE* data, QWORD index)
             // store data runs or resident data
             if (aheader->NonResident)
             {
-                DATA_POINTERS* ptrs = new DATA_POINTERS;
+                DATA_POINTERS* ptrs = arena->New<DATA_POINTERS>();
                 if (ptrs == NULL)
-                    return String<CHAR>::Error(IDS_UNDELETE, IDS_LOWMEM);
+                    return IDS_LOWMEM;
                 ptrs->DPFlags = aheader->SAHFlags;
                 ptrs->StartVCN = aheader->StartVCN;
                 ptrs->LastVCN = aheader->LastVCN;
                 ptrs->RunsSize = aheader->Length - aheader->DataRunsOffset;
-                ptrs->Runs = new BYTE[ptrs->RunsSize];
+                ptrs->Runs = arena->NewData(data + offset + aheader->DataRunsOffset, ptrs->RunsSize);
                 if (ptrs->Runs == NULL)
-                    return String<CHAR>::Error(IDS_UNDELETE, IDS_LOWMEM);
-                memcpy(ptrs->Runs, data + offset + aheader->DataRunsOffset, ptrs->RunsSize);
+                    return IDS_LOWMEM;
                 ptrs->CompUnit = aheader->CompressionUnit;
 
                 // store to the correct place inside list
@@ -452,12 +489,9 @@ BOOL CMFTSnapshot<CHAR>::ParseRecord(BYTE* data, QWORD index)
             }
             else
             {
-                if (stream->ResidentData != NULL)
-                    delete[] stream->ResidentData;
-                stream->ResidentData = new BYTE[aheader->AttrLength];
+                stream->ResidentData = arena->NewData(data + offset + aheader->AttrOffset, aheader->AttrLength);
                 if (stream->ResidentData == NULL)
-                    return String<CHAR>::Error(IDS_UNDELETE, IDS_LOWMEM);
-                memcpy(stream->ResidentData, data + offset + aheader->AttrOffset, aheader->AttrLength);
+                    return IDS_LOWMEM;
                 stream->DSSize = aheader->AttrLength;
                 stream->DSValidSize = stream->DSSize; // for resident data is valid data same as DSSize
             }
@@ -524,12 +558,119 @@ BOOL CMFTSnapshot<CHAR>::ParseRecord(BYTE* data, QWORD index)
     }
 #endif
 
-    return TRUE;
+    return 0;
 }
 
-#define BUFSIZE 16 // how much MFT clusters we read in one time
 #define DIVROUNDUP(a, b) (((a) + (b)-1) / (b))
 
+template <typename CHAR>
+void CMFTSnapshot<CHAR>::ParseRecords(CParseJob* job)
+{
+    CALL_STACK_MESSAGE1("CMFTSnapshot::ParseRecords()");
+
+    BYTE* data = job->Data;
+    for (QWORD i = job->First; i < job->First + job->Count; i++, data += BytesPerMFTRecord)
+    {
+        // first record is parsed before MFT scan, extension records are modifying their base
+        // record (which could be parsed by another thread), so they are left to FinishParsing()
+        if (i == 0 || ((FILE_RECORD_HEADER*)data)->BaseRecord != 0)
+            continue;
+        int err = ParseRecord(data, i, job->Arena);
+        if (err != 0)
+        {
+            job->ErrorID = err;
+            job->ErrorIndex = i;
+            break;
+        }
+    }
+}
+
+template <typename CHAR>
+unsigned WINAPI CMFTSnapshot<CHAR>::ParseThread(void* param)
+{
+    CALL_STACK_MESSAGE1("CMFTSnapshot::ParseThread()");
+    CParseJob* job = (CParseJob*)param;
+    job->Snapshot->ParseRecords(job);
+    return 0;
+}
+
+template <typename CHAR>
+void CMFTSnapshot<CHAR>::StartParsing(CParseBatch* batch, BYTE* data, QWORD first, QWORD count)
+{
+    CALL_STACK_MESSAGE1("CMFTSnapshot::StartParsing(, , , )");
+
+    batch->Data = data;
+    batch->First = first;
+    batch->Count = count;
+
+    // split records among worker threads, small parts are not worth of starting threads
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    int threads = (int)min((QWORD)min((int)si.dwNumberOfProcessors, MFT_PARSE_THREADS),
+                           DIVROUNDUP(count, MFT_PARSE_MIN_RECORDS));
+    if (threads < 1)
+        threads = 1;
+    QWORD perThread = DIVROUNDUP(count, threads);
+    batch->JobsCount = 0;
+    for (QWORD i = 0; i < count; i += perThread)
+    {
+        CParseJob* job = &batch->Jobs[batch->JobsCount];
+        job->Snapshot = this;
+        job->Data = data + i * BytesPerMFTRecord;
+        job->First = first + i;
+        job->Count = min(perThread, count - i);
+        job->Arena = &Arenas[batch->JobsCount];
+        job->ErrorID = 0;
+        job->ErrorIndex = 0;
+        job->Thread = NULL;
+        if (threads > 1)
+            job->Thread = ThreadQueue.StartThread(ParseThread, job);
+        if (job->Thread == NULL)
+            ParseRecords(job); // single thread is enough or thread was not started
+        batch->JobsCount++;
+    }
+}
+
+template <typename CHAR>
+int CMFTSnapshot<CHAR>::FinishParsing(CParseBatch* batch, QWORD* errorIndex)
+{
+    CALL_STACK_MESSAGE1("CMFTSnapshot::FinishParsing(, )");
+
+    // wait for worker threads, we report error from record with lowest index
+    int err = 0;
+    QWORD end = batch->First + batch->Count;
+    for (int i = 0; i < batch->JobsCount; i++)
+    {
+        CParseJob* job = &batch->Jobs[i];
+        if (job->Thread != NULL)
+            ThreadQueue.WaitForExit(job->Thread);
+        if (job->ErrorID != 0 && job->ErrorIndex < end)
+        {
+            err = job->ErrorID;
+            end = job->ErrorIndex;
+        }
+    }
+    batch->JobsCount = 0;
+
+    // parse extension records of this part in the main thread (in front of failed record)
+    BYTE* data = batch->Data;
+    for (QWORD i = batch->First; i < end; i++, data += BytesPerMFTRecord)
+    {
+        if (i == 0 || ((FILE_RECORD_HEADER*)data)->BaseRecord == 0)
+            continue;
+        int extErr = ParseRecord(data, i, &Arenas[MFT_PARSE_THREADS]);
+        if (extErr != 0)
+        {
+            err = extErr;
+            end = i;
+            break;
+        }
+    }
+    batch->Count = 0;
+    *errorIndex = end;
+    return err;
+}
+
 template <typename CHAR>
 BOOL CMFTSnapshot<CHAR>::Update(CSnapshotProgressDlg* progress, DWORD udFlags, CLUSTER_MAP_I** clusterMap)
 {
@@ -537,6 +678,8 @@ BOOL CMFTSnapshot<CHAR>::Update(CSnapshotProgressDlg* progress, DWORD udFlags, C
 
     TRACE_I("CMFTSnapshot::Update(), udFlags=" << udFlags);
 
+    if (udFlags & UF_CARVEFILES)
+        udFlags |= UF_GETLOSTCLUSTERMAP; // carving scans lost clusters
     if (udFlags & UF_GETLOSTCLUSTERMAP)
         udFlags |= UF_ESTIMATEDAMAGE;
 
@@ -544,6 +687,9 @@ BOOL CMFTSnapshot<CHAR>::Update(CSnapshotProgressDlg* progress, DWORD udFlags, C
     this->UdFlags = udFlags;
     if (clusterMap != NULL)
         *clusterMap = NULL;
+    CLUSTER_MAP_I* lostClusters = NULL; // map for carving if caller does not want it
+    if (clusterMap == NULL && (udFlags & UF_CARVEFILES))
+        clusterMap = &lostClusters;
 
     if (!this->Volume->IsOpen())
         return String<CHAR>::Error(IDS_UNDELETE, IDS_ERRORNOTOPEN);
@@ -574,52 +720,57 @@ BOOL CMFTSnapshot<CHAR>::Update(CSnapshotProgressDlg* progress, DWORD udFlags, C
     if (firstrec == NULL)
         return String<CHAR>::Error(IDS_UNDELETE, IDS_LOWMEM);
     if (!this->Volume->ReadClusters(firstrec, this->Volume->NTFSBoot.MFTStartLCN, clustersPerMFTRecord))
+    {
+        delete[] firstrec;
         return String<CHAR>::SysError(IDS_UNDELETE, IDS_ERRORREADINGMFT);
+    }
     //TRACE_I("First MFT record:");
     //DumpHexData(firstrec, BytesPerMFTRecord);
 
     // get info from first record
-    FILE_RECORD_I<CHAR>* mft = new FILE_RECORD_I<CHAR>;
-    if (mft == NULL)
-    {
-        delete[] firstrec;
-        return String<CHAR>::Error(IDS_UNDELETE, IDS_LOWMEM);
-    }
+    FILE_RECORD_I<CHAR>* mft = NULL;
     MFT = &mft;
     MFTItems = 1;
-    if (!ParseRecord(firstrec, 0))
+    int err = ParseRecord(firstrec, 0, &Arenas[MFT_PARSE_THREADS]);
+    delete[] firstrec;
+    MFT = NULL;
+    MFTItems = 0;
+    if (err != 0)
     {
         TRACE_I("CMFTSnapshot::Update: ParseRecord failed on first record");
-        delete[] firstrec;
-        this->FreeRecord(mft);
-        MFT = NULL;
-        return FALSE;
+        Free();
+        return String<CHAR>::Error(IDS_UNDELETE, err);
     }
-    delete[] firstrec;
 
     // check
-    if (mft->Streams == NULL || mft->Streams->DSNext != NULL ||     // just one stream
+    if (mft == NULL ||
+        mft->Streams == NULL || mft->Streams->DSNext != NULL ||     // just one stream
         mft->IsDir ||                                               // can not be directory
         mft->FileNames == NULL || mft->FileNames->FNNext != NULL || // just one hardlink
         String<CHAR>::StrICmp(mft->FileNames->FNName, STRING_MFT))  // name: $MFT
     {
         TRACE_I("MFT looks corrupted");
-        this->FreeRecord(mft);
-        MFT = NULL;
+        Free();
         return String<CHAR>::Error(IDS_UNDELETE, IDS_MFTRECORDDAMAGED);
     }
 
-    // allocate MFT array and buffer
+    // allocate MFT array and two buffers: one is being read while records from the other are parsed
+    QWORD readClusters = max(MFT_READ_SIZE / this->Volume->BytesPerCluster, clustersPerMFTRecord);
+    readClusters -= readClusters % clustersPerMFTRecord; // don't split records between reads
     MFTItems = mft->Streams->DSSize / BytesPerMFTRecord;
     TRACE_I("MFTItems=" << MFTItems);
     MFT = new FILE_RECORD_I<CHAR>*[(size_t)MFTItems];
-    BYTE* buffer = new BYTE[BUFSIZE * this->Volume->BytesPerCluster];
-    if (MFT == NULL || buffer == NULL)
+    BYTE* buffers[2];
+    buffers[0] = new BYTE[(size_t)(readClusters * this->Volume->BytesPerCluster)];
+    buffers[1] = new BYTE[(size_t)(readClusters * this->Volume->BytesPerCluster)];
+    if (MFT == NULL || buffers[0] == NULL || buffers[1] == NULL)
     {
         delete[] MFT;
-        delete[] buffer;
-        this->FreeRecord(mft);
         MFT = NULL;
+        MFTItems = 0;
+        delete[] buffers[0];
+        delete[] buffers[1];
+        Free();
         return String<CHAR>::Error(IDS_UNDELETE, IDS_LOWMEM);
     }
     memset(MFT, 0, (size_t)(MFTItems * sizeof(FILE_RECORD_I<CHAR>*)));
@@ -634,24 +785,40 @@ BOOL CMFTSnapshot<CHAR>::Update(CSnapshotProgressDlg* progress, DWORD udFlags, C
         ClustersTotal += bitmapClusters; // size of bitmap in clusters
     }
 
-    // scan whole MFT
+    // scan whole MFT: next part of MFT is read while worker threads parse records of previous one
     CStreamReader<CHAR> reader;
     reader.Init(this->Volume, mft->Streams);
     QWORD clustleft = DIVROUNDUP(mft->Streams->DSSize, this->Volume->BytesPerCluster);
     QWORD i = 0;
-    QWORD lastprogress = 0;
+    int cur = 0;
     BOOL ret = TRUE;
     BOOL canceled = FALSE;
+    CParseBatch batch;
+    batch.Data = NULL;
+    batch.First = 0;
+    batch.Count = 0;
+    batch.JobsCount = 0;
 
     while (clustleft && i < MFTItems)
     {
-        QWORD n = min(clustleft, BUFSIZE);
+        QWORD n = min(clustleft, readClusters);
         if (!reader.IsSafeChunk(n))
-            n = clustersPerMFTRecord; // if we are nearing end of fragment, we need to read
-        // with minimized blocks because there could come extension record for $MFT, which we would not process
-        // and stream reader would go out of runs
+        {
+            // we are nearing end of fragment, there could come extension record for $MFT, so parsed
+            // part must be finished first, then we read with minimized blocks, otherwise we would not
+            // process the extension record in time and stream reader would go out of runs
+            QWORD errorIndex;
+            err = FinishParsing(&batch, &errorIndex);
+            if (err != 0)
+            {
+                i = errorIndex;
+                break;
+            }
+            if (!reader.IsSafeChunk(n))
+                n = clustersPerMFTRecord;
+        }
 
-        if (!reader.GetClusters(buffer, n))
+        if (!reader.GetClusters(buffers[cur], n))
         {
             String<CHAR>::SysError(IDS_UNDELETE, IDS_ERRORREADINGMFT);
             TRACE_I("CMFTSnapshot::Update: GetClusters failed, n=" << n << " i=" << i << " clustleft=" << clustleft);
@@ -659,35 +826,47 @@ BOOL CMFTSnapshot<CHAR>::Update(CSnapshotProgressDlg* progress, DWORD udFlags, C
             break;
         }
 
-        for (QWORD j = 0; j < (n * this->Volume->BytesPerCluster) && i < MFTItems; i++)
+        QWORD errorIndex;
+        err = FinishParsing(&batch, &errorIndex);
+        if (err != 0)
         {
-            if (i && !ParseRecord(buffer + j, i))
-            {
-                TRACE_I("CMFTSnapshot::Update: ParseRecord failed");
-                ret = FALSE;
-                break;
-            }
-            j += BytesPerMFTRecord;
+            i = errorIndex;
+            break;
         }
+        QWORD count = min(DIVROUNDUP(n * this->Volume->BytesPerCluster, BytesPerMFTRecord), MFTItems - i);
+        StartParsing(&batch, buffers[cur], i, count);
+        i += count;
+        cur = 1 - cur;
 
-        if ((i - lastprogress >= 512) || i == MFTItems)
+        progress->SetProgress(MulDiv((int)ClustersProcessed, 1000, (int)ClustersTotal));
+        if (progress->GetWantCancel())
         {
-            progress->SetProgress(MulDiv((int)ClustersProcessed, 1000, (int)ClustersTotal));
-            if (progress->GetWantCancel())
-            {
-                ret = FALSE;
-                canceled = TRUE;
-            }
-            lastprogress = i;
+            ret = FALSE;
+            canceled = TRUE;
+            break;
         }
 
-        if (!ret)
-            break;
         clustleft -= n;
         ClustersProcessed += n;
     }
 
-    delete[] buffer;
+    // finish last part (on error or cancel we just wait for worker threads)
+    QWORD errorIndex;
+    int lastErr = FinishParsing(&batch, &errorIndex);
+    if (ret && err == 0 && lastErr != 0)
+    {
+        err = lastErr;
+        i = errorIndex;
+    }
+    if (err != 0)
+    {
+        String<CHAR>::Error(IDS_UNDELETE, err);
+        TRACE_I("CMFTSnapshot::Update: ParseRecord failed, index=" << i);
+        ret = FALSE;
+    }
+
+    delete[] buffers[0];
+    delete[] buffers[1];
 
     // we ended with error but if we have something, don't throw it away
     if (!ret && !canceled && i > MAX_METAFILES && i < MFTItems)
@@ -711,6 +890,8 @@ BOOL CMFTSnapshot<CHAR>::Update(CSnapshotProgressDlg* progress, DWORD udFlags, C
         {
             if (this->UdFlags & UF_ESTIMATEDAMAGE)
                 EstimateFileDamage(clusterMap); // we can live without damage estimation
+            if (this->UdFlags & UF_CARVEFILES)
+                CarveFiles(*clusterMap); // we can live without carved files too
         }
     }
 
@@ -727,22 +908,24 @@ void CMFTSnapshot<CHAR>::Free()
 {
     CALL_STACK_MESSAGE1("CMFTSnapshot::Free()");
 
-    // release MFT
+    // release MFT; records, their names, streams and data runs are in arenas, only arrays
+    // of directory items are allocated separately
     if (MFT != NULL)
     {
-        // NOTE: Following cycle takes approx 15 seconds for 130 000 items when
-        // it is executed from Visual Studio 6 (debug or release version, it doesn't matter).
-        // The slowdown is caused by Visual Studio heap checking. (Tested on Athlon 1.4Ghz)
         for (QWORD i = 0; i < MFTItems; i++)
         {
-            if (MFT[i] != NULL)
-                delete this->FreeRecord(MFT[i]);
+            FILE_RECORD_I<CHAR>* r = MFT[i];
+            // do not delete marked items, see CMFTSnapshot<CHAR>::Mark()
+            if (r != NULL && r->IsDir && r->DirItems != NULL && r->DirItems != (DIR_ITEM_I<CHAR>*)~NULL)
+                delete[] r->DirItems;
         }
 
         delete[] MFT;
         MFT = NULL;
         MFTItems = 0;
     }
+    for (int i = 0; i <= MFT_PARSE_THREADS; i++)
+        Arenas[i].Free();
 
     // release Root if it was allocated
     if (RootAllocated)
@@ -896,10 +1079,7 @@ BOOL CMFTSnapshot<CHAR>::BuildDirectoryTree()
     for (i = 0; i < MFTItems; i++)
     {
         if (MFT[i] != NULL && MFT[i]->FileNames == NULL)
-        {
-            delete this->FreeRecord(MFT[i]);
-            MFT[i] = NULL;
-        }
+            MFT[i] = NULL; // records are allocated in arenas, memory is released in Free()
         NOTIFY; // let know about us
     }
 
@@ -914,7 +1094,6 @@ BOOL CMFTSnapshot<CHAR>::BuildDirectoryTree()
                 r->Streams != NULL && r->Streams->DSNext == NULL && r->Streams->DSSize == 0)
             {
                 // TRACE_I("Removing zero file "<<r->FileNames->Name);
-                delete this->FreeRecord(MFT[i]);
                 MFT[i] = NULL;
             }
             NOTIFY;
@@ -960,10 +1139,7 @@ BOOL CMFTSnapshot<CHAR>::BuildDirectoryTree()
                 DIR_ITEM_I<CHAR>* mark = r->DirItems;
                 r->DirItems = NULL;
                 if (r->IsDir && r != this->Root && mark == NULL)
-                {
-                    delete this->FreeRecord(r);
                     MFT[i] = NULL;
-                }
             }
             NOTIFY;
         }
@@ -999,6 +1175,8 @@ BOOL CMFTSnapshot<CHAR>::BuildDirectoryTree()
         NOTIFY;
     }
     this->Root->NumDirItems += VirtualDirs.Count + 2; // 2 for {All Deleted Files} and {Metafiles}
+    if (this->UdFlags & UF_CARVEFILES)
+        this->Root->NumDirItems++; // {Carved Files}, see CarveFiles()
 
     // allocate arrays in DirItems - in MFT
     for (i = 0; i < MFTItems; i++)
@@ -1494,3 +1672,88 @@ BOOL CMFTSnapshot<CHAR>::GetLostClustersMap(CClusterBitmap* clusterBitmap, CLUST
 
     return TRUE;
 }
+
+template <typename CHAR>
+BOOL CMFTSnapshot<CHAR>::CarveFiles(CLUSTER_MAP_I* clusterMap)
+{
+    CALL_STACK_MESSAGE1("CMFTSnapshot::CarveFiles()");
+
+    // scan lost clusters, whole volume is scanned only in disk images (without the map
+    // we would find existing files too, which does not matter there)
+    QWORD wholeFirst = 0;
+    QWORD wholeCount = this->Volume->NTFSBoot.NumberOfSectors / this->Volume->SectorsPerCluster;
+    const QWORD* firstCluster = &wholeFirst;
+    const QWORD* clustersCount = &wholeCount;
+    DWORD items = 1;
+    if (clusterMap != NULL)
+    {
+        firstCluster = clusterMap->FirstCluster;
+        clustersCount = clusterMap->ClustersCount;
+        items = clusterMap->Items;
+    }
+    else if (!this->Volume->IsImage)
+    {
+        TRACE_I("CMFTSnapshot::CarveFiles(): map of lost clusters is not available, skipping");
+        return TRUE;
+    }
+
+    this->Progress->SetProgressText(IDS_CARVINGFILES);
+    this->Progress->SetProgress(0);
+    CVolumeCarvingSource<CHAR> source(this->Volume);
+    CFileCarver carver(&source, this->Volume->BytesPerCluster);
+    if (!carver.Scan(firstCluster, clustersCount, items, this->Progress))
+        return FALSE;
+    if (carver.Files.Count == 0)
+        return TRUE;
+
+    // add virtual directory "Carved Files", its items are allocated in arena of main thread
+    FILE_RECORD_I<CHAR>* dir = GetVirtualDirectory(0xFFFFFFFD, IDS_CARVEDFILES, FILE_ATTRIBUTE_NORMAL, FR_FLAGS_VIRTUALDIR);
+    if (dir == NULL)
+        return String<CHAR>::Error(IDS_UNDELETE, IDS_LOWMEM);
+    dir->NumDirItems = carver.Files.Count;
+    if (!AllocDirItems(dir))
+        return FALSE;
+    CSnapshotArena* arena = &Arenas[MFT_PARSE_THREADS];
+    CRunsBuffer<CHAR> runs;
+    for (int i = 0; i < carver.Files.Count; i++)
+    {
+        const CCarvedFile* file = &carver.Files[i];
+        QWORD clusters = DIVROUNDUP(file->Size, this->Volume->BytesPerCluster);
+        runs.Clear();
+        if (!runs.EncodeRun(file->Cluster, clusters))
+            return FALSE;
+
+        char nameA[50];
+        sprintf(nameA, "f%010I64u.%s", file->Cluster, CFileCarver::GetExtension(file->Type));
+        CHAR name[50];
+        String<CHAR>::CopyFromASCII(name, nameA, (unsigned long)strlen(nameA), 50);
+
+        FILE_RECORD_I<CHAR>* r = arena->New<FILE_RECORD_I<CHAR>>();
+        FILE_NAME_I<CHAR>* fname = arena->New<FILE_NAME_I<CHAR>>();
+        DATA_STREAM_I<CHAR>* stream = arena->New<DATA_STREAM_I<CHAR>>();
+        DATA_POINTERS* ptrs = arena->New<DATA_POINTERS>();
+        if (r == NULL || fname == NULL || stream == NULL || ptrs == NULL)
+            return String<CHAR>::Error(IDS_UNDELETE, IDS_LOWMEM);
+        fname->FNName = arena->NewStr(name);
+        ptrs->Runs = arena->NewData(runs.RunsBuffer, runs.RunsLen + 1); // +1 for terminator
+        if (fname->FNName == NULL || ptrs->Runs == NULL)
+            return String<CHAR>::Error(IDS_UNDELETE, IDS_LOWMEM);
+        fname->ParentRecord = 0xFFFFFFFD;
+        ptrs->StartVCN = 0;
+        ptrs->LastVCN = clusters - 1;
+        ptrs->RunsSize = runs.RunsLen + 1;
+        stream->Ptrs = ptrs;
+        stream->DSSize = file->Size;
+        stream->DSValidSize = file->Size;
+        r->Attr = FILE_ATTRIBUTE_NORMAL;
+        r->Flags = FR_FLAGS_DELETED | FR_FLAGS_CONDITION_UNKNOWN;
+        r->FileNames = fname;
+        r->Streams = stream;
+        r->TimeCreation = dir->TimeCreation;
+        r->TimeLastAccess = dir->TimeLastAccess;
+        r->TimeLastWrite = dir->TimeLastWrite;
+        AddDirItem(dir, r, fname);
+    }
+    AddDirItem(this->Root, dir, dir->FileNames);
+    return TRUE;
+}
@@ -134,6 +134,101 @@ struct CLUSTER_MAP_I
 
 #pragma pack(pop, snapshot_h)
 
+// CSnapshotArena - allocator for snapshot nodes and their names and data; memory is taken
+// from large blocks and all of it is released at once by Free(), so snapshot with millions
+// of records is neither built nor released item by item; arena is not thread-safe, each
+// thread creating records uses its own arena
+
+#define ARENA_BLOCK_SIZE (1024 * 1024) // default size of one arena block in bytes
+
+class CSnapshotArena
+{
+public:
+    CSnapshotArena()
+    {
+        Blocks = NULL;
+        Ptr = End = NULL;
+    }
+    ~CSnapshotArena() { Free(); }
+
+    // returns 8-byte aligned memory of size 'size', or NULL when out of memory
+    void* Alloc(size_t size)
+    {
+        size = (size + 7) & ~(size_t)7;
+        if ((size_t)(End - Ptr) < size && !AddBlock(size))
+            return NULL;
+        void* ret = Ptr;
+        Ptr += size;
+        return ret;
+    }
+
+    // returns zeroed item of type T (snapshot structures are plain data, their
+    // constructors just clear them)
+    template <class T>
+    T* New()
+    {
+        T* ret = (T*)Alloc(sizeof(T));
+        if (ret != NULL)
+            memset(ret, 0, sizeof(T));
+        return ret;
+    }
+
+    // returns copy of 'size' bytes from 'data'
+    BYTE* NewData(const void* data, size_t size)
+    {
+        BYTE* ret = (BYTE*)Alloc(size);
+        if (ret != NULL)
+            memcpy(ret, data, size);
+        return ret;
+    }
+
+    // returns copy of null-terminated string 'str'
+    template <typename CHAR>
+    CHAR* NewStr(const CHAR* str)
+    {
+        size_t len = 0;
+        while (str[len] != 0)
+            len++;
+        return (CHAR*)NewData(str, (len + 1) * sizeof(CHAR));
+    }
+
+    void Free()
+    {
+        while (Blocks != NULL)
+        {
+            CArenaBlock* block = Blocks;
+            Blocks = Blocks->Next;
+            delete[] (BYTE*)block;
+        }
+        Ptr = End = NULL;
+    }
+
+private:
+    struct CArenaBlock
+    {
+        CArenaBlock* Next;
+        QWORD Align; // data behind header must be 8-byte aligned
+    };
+
+    BOOL AddBlock(size_t size)
+    {
+        size_t blockSize = max(size, (size_t)ARENA_BLOCK_SIZE);
+        BYTE* data = new BYTE[sizeof(CArenaBlock) + blockSize];
+        if (data == NULL)
+            return FALSE;
+        CArenaBlock* block = (CArenaBlock*)data;
+        block->Next = Blocks;
+        Blocks = block;
+        Ptr = data + sizeof(CArenaBlock);
+        End = Ptr + blockSize;
+        return TRUE;
+    }
+
+    CArenaBlock* Blocks; // list of allocated blocks, the current one is first
+    BYTE* Ptr;           // free space in current block
+    BYTE* End;           // end of current block
+};
+
 // forward declarations
 class CSnapshotProgressDlg;
 template <typename CHAR>
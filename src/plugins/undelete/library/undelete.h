@@ -18,6 +18,7 @@
 #define UF_SHOWEMPTYDIRS 0x0008      // show directories that do not contain any files
 #define UF_SHOWMETAFILES 0x0010      // show meta files
 #define UF_ESTIMATEDAMAGE 0x0020     // estimate files damage
+#define UF_CARVEFILES 0x0040        // look for lost files by their signatures (NTFS)
 #define UF_GETLOSTCLUSTERMAP 0x0100  // (for forensic needs only) returns clusters unused by files or occupied by FC_FAIR or FC_POOR files
 
 typedef unsigned __int64 QWORD;
@@ -67,6 +67,8 @@ int SalamanderVersion = 0;
 
 CLUSTER_MAP_I cluster_map;
 
+CThreadQueue ThreadQueue("Undelete Workers");
+
 // ****************************************************************************
 //
 //  CTopIndexMem
@@ -296,6 +298,7 @@ BOOL WINAPI CPluginInterface::Release(HWND parent, BOOL force)
 {
     CALL_STACK_MESSAGE2("CPluginInterface::Release(, %d)", force);
     ReleaseFS();
+    ThreadQueue.KillAll(TRUE); // worker threads end before snapshot is done, this is just a safety net
     OS<char>::OS_ReleaseLibraryData();
     ReleaseWinLib(DLLInstance);
     /*if (ret && InterfaceForFS.GetActiveFSCount() != 0)
@@ -440,6 +443,7 @@ BOOL ConfigShowZeroFiles;
 BOOL ConfigShowEmptyDirs;
 BOOL ConfigShowMetafiles;
 BOOL ConfigEstimateDamage;
+BOOL ConfigCarveFiles;
 char ConfigTempPath[MAX_PATH];
 BOOL ConfigDontShowEncryptedWarning;
 BOOL ConfigDontShowSamePartitionWarning;
@@ -453,6 +457,7 @@ static const char* KEY_SHOWZEROFILES = "Show Zero Files";
 static const char* KEY_SHOWEMPTYDIRS = "Show Empty Dirs";
 static const char* KEY_SHOWMETAFILES = "Show Metafiles";
 static const char* KEY_ESTIMATEDAMAGE = "Estimate Damage";
+static const char* KEY_CARVEFILES = "Carve Files";
 static const char* KEY_TEMPPATH = "Alternate Temp Path";
 static const char* KEY_DONTSHOWENCRYPTED = "Dont Show Encrypted Warning";
 static const char* KEY_DONTSHOWSAMEPARTITION = "Dont Show Same Partition Warning";
@@ -471,6 +476,7 @@ void CPluginInterface::LoadConfiguration(HWND parent, HKEY regKey, CSalamanderRe
     ConfigShowEmptyDirs = TRUE;
     ConfigShowMetafiles = FALSE;
     ConfigEstimateDamage = TRUE;
+    ConfigCarveFiles = FALSE;
     ConfigTempPath[0] = 0;
     ConfigDontShowEncryptedWarning = FALSE;
     ConfigDontShowSamePartitionWarning = FALSE;
@@ -486,6 +492,7 @@ void CPluginInterface::LoadConfiguration(HWND parent, HKEY regKey, CSalamanderRe
         registry->GetValue(regKey, KEY_SHOWEMPTYDIRS, REG_DWORD, &ConfigShowEmptyDirs, sizeof(DWORD));
         registry->GetValue(regKey, KEY_SHOWMETAFILES, REG_DWORD, &ConfigShowMetafiles, sizeof(DWORD));
         registry->GetValue(regKey, KEY_ESTIMATEDAMAGE, REG_DWORD, &ConfigEstimateDamage, sizeof(DWORD));
+        registry->GetValue(regKey, KEY_CARVEFILES, REG_DWORD, &ConfigCarveFiles, sizeof(DWORD));
         registry->GetValue(regKey, KEY_TEMPPATH, REG_SZ, &ConfigTempPath, MAX_PATH);
         registry->GetValue(regKey, KEY_DONTSHOWENCRYPTED, REG_DWORD, &ConfigDontShowEncryptedWarning, MAX_PATH);
         registry->GetValue(regKey, KEY_DONTSHOWSAMEPARTITION, REG_DWORD, &ConfigDontShowSamePartitionWarning, MAX_PATH);
@@ -505,6 +512,7 @@ void CPluginInterface::SaveConfiguration(HWND parent, HKEY regKey, CSalamanderRe
     registry->SetValue(regKey, KEY_SHOWEMPTYDIRS, REG_DWORD, &ConfigShowEmptyDirs, sizeof(DWORD));
     registry->SetValue(regKey, KEY_SHOWMETAFILES, REG_DWORD, &ConfigShowMetafiles, sizeof(DWORD));
     registry->SetValue(regKey, KEY_ESTIMATEDAMAGE, REG_DWORD, &ConfigEstimateDamage, sizeof(DWORD));
+    registry->SetValue(regKey, KEY_CARVEFILES, REG_DWORD, &ConfigCarveFiles, sizeof(DWORD));
     registry->SetValue(regKey, KEY_TEMPPATH, REG_SZ, &ConfigTempPath, -1);
     registry->SetValue(regKey, KEY_DONTSHOWENCRYPTED, REG_DWORD, &ConfigDontShowEncryptedWarning, sizeof(DWORD));
     registry->SetValue(regKey, KEY_DONTSHOWSAMEPARTITION, REG_DWORD, &ConfigDontShowSamePartitionWarning, sizeof(DWORD));
@@ -28,6 +28,7 @@ extern BOOL ConfigShowZeroFiles;
 extern BOOL ConfigShowEmptyDirs;
 extern BOOL ConfigShowMetafiles;
 extern BOOL ConfigEstimateDamage;
+extern BOOL ConfigCarveFiles;
 extern char ConfigTempPath[MAX_PATH];
 extern BOOL ConfigDontShowEncryptedWarning;
 extern BOOL ConfigDontShowSamePartitionWarning;
@@ -47,6 +48,8 @@ extern BOOL ConfigDontShowSamePartitionWarning;
 
 extern CLUSTER_MAP_I cluster_map;
 
+extern CThreadQueue ThreadQueue; // threads parsing MFT records and scanning clusters for lost files (see CMFTSnapshot::Update)
+
 //
 // ****************************************************************************
 // CPluginFSDataInterface
@@ -14,11 +14,14 @@
 CBlockedFile::CCachedBlock::CCachedBlock()
 {
     PosInBuf = 0;
+    MemSize = 0;
+    pPrev = pNext = NULL;
 }
 
 CBlockedFile::CZeroBlock::CZeroBlock(BlockInfo* blockInfo)
 {
     pBlockInfo = blockInfo;
+    MemSize = sizeof(*this);
 }
 
 CBlockedFile::CZeroBlock::~CZeroBlock()
@@ -32,206 +35,187 @@ DWORD CBlockedFile::CZeroBlock::Read(char* buf, DWORD BytesToRead)
     return BytesToRead;
 }
 
-CBlockedFile::CZLIBBlock::CZLIBBlock(BlockInfo* blockInfo, HANDLE hFile)
+CBlockedFile::CDecodedBlock::CDecodedBlock(BlockInfo* blockInfo, char* buffer)
 {
-    CALL_STACK_MESSAGE3("CZLIBBlock::CZLIBBlock(%p, %p)", blockInfo, hFile);
-    CSalZLIB zi;
-    BYTE* inBuf;
-    LONG posHi;
-    DWORD dwBytesRead;
-    int err;
-
     pBlockInfo = blockInfo;
-
-    Buffer = (char*)malloc((size_t)blockInfo->outSize);
-    if (!Buffer)
-    {
-        Error(IDS_INSUFFICIENT_MEMORY, FALSE);
-        return;
-    }
-    inBuf = (BYTE*)malloc((size_t)blockInfo->inSize);
-    if (!inBuf)
-    {
-        free(Buffer);
-        Buffer = NULL;
-        Error(IDS_INSUFFICIENT_MEMORY, FALSE);
-        return;
-    }
-    posHi = (LONG)(blockInfo->inPos >> 32);
-    if ((0xFFFFFFFF == SetFilePointer(hFile, (DWORD)(blockInfo->inPos & 0xFFFFFFFF), &posHi, FILE_BEGIN)) || !ReadFile(hFile, inBuf, (DWORD)blockInfo->inSize, &dwBytesRead, NULL) || (blockInfo->inSize != dwBytesRead))
-    {
-        free(inBuf);
-        free(Buffer);
-        Buffer = NULL;
-        Error(IDS_ERR_BF_READ, FALSE, blockInfo->inPos);
-        return;
-    }
-    if (SAL_Z_OK != SalZLIB->InflateInit(&zi))
-    {
-        free(inBuf);
-        free(Buffer);
-        Buffer = NULL;
-        Error(IDS_INSUFFICIENT_MEMORY, FALSE);
-        return;
-    }
-    zi.avail_in = (UINT)blockInfo->inSize;
-    zi.next_in = inBuf;
-    zi.next_out = (BYTE*)Buffer;
-    zi.avail_out = (UINT)blockInfo->outSize;
-    err = SalZLIB->Inflate(&zi, SAL_Z_FINISH);
-    SalZLIB->InflateEnd(&zi);
-    free(inBuf);
-    if ((err != SAL_Z_STREAM_END) || (zi.avail_out != 0))
-    {
-        free(Buffer);
-        Buffer = NULL;
-        Error(IDS_ERR_BF_ZLIB, FALSE);
-    }
+    Buffer = buffer;
+    MemSize = sizeof(*this) + (size_t)blockInfo->outSize;
 }
 
-CBlockedFile::CZLIBBlock::~CZLIBBlock()
+CBlockedFile::CDecodedBlock::~CDecodedBlock()
 {
     if (Buffer)
         free(Buffer);
 }
 
-DWORD CBlockedFile::CZLIBBlock::Read(char* buf, DWORD BytesToRead)
+DWORD CBlockedFile::CDecodedBlock::Read(char* buf, DWORD BytesToRead)
 {
-    if (!Buffer)
-        return 0;
-
     memcpy(buf, Buffer + PosInBuf, BytesToRead);
     PosInBuf += BytesToRead;
     return BytesToRead;
 }
 
-CBlockedFile::CBZIP2Block::CBZIP2Block(BlockInfo* blockInfo, HANDLE hFile)
+CBlockedFile::CCopyBlock::CCopyBlock(BlockInfo* blockInfo, HANDLE hFile) : File(hFile)
 {
-    CALL_STACK_MESSAGE3("CBZIP2Block::CBZIP2Block(%p, %p)", blockInfo, hFile);
-    CSalBZIP2 bzi;
-    BYTE* inBuf;
-    LONG posHi;
-    DWORD dwBytesRead;
-    int err;
-
+    CALL_STACK_MESSAGE3("CCopyBlock::CCopyBlock(%p, %p)", blockInfo, hFile);
     pBlockInfo = blockInfo;
+    MemSize = sizeof(*this);
+}
 
-    Buffer = (char*)malloc((size_t)blockInfo->outSize);
-    if (!Buffer)
-    {
-        Error(IDS_INSUFFICIENT_MEMORY, FALSE);
-        return;
-    }
-    inBuf = (BYTE*)malloc((size_t)blockInfo->inSize);
-    if (!inBuf)
-    {
-        free(Buffer);
-        Buffer = NULL;
-        Error(IDS_INSUFFICIENT_MEMORY, FALSE);
-        return;
-    }
-    posHi = (LONG)(blockInfo->inPos >> 32);
-    if ((0xFFFFFFFF == SetFilePointer(hFile, (DWORD)(blockInfo->inPos & 0xFFFFFFFF), &posHi, FILE_BEGIN)) || !ReadFile(hFile, inBuf, (DWORD)blockInfo->inSize, &dwBytesRead, NULL) || (blockInfo->inSize != dwBytesRead))
+CBlockedFile::CCopyBlock::~CCopyBlock()
+{
+}
+
+DWORD CBlockedFile::CCopyBlock::Read(char* buf, DWORD BytesToRead)
+{
+    UInt64 pos = pBlockInfo->inPos + PosInBuf;
+    DWORD dwBytesRead;
+
+    if (!ReadFileAt(File, pos, buf, BytesToRead, &dwBytesRead))
     {
-        free(inBuf);
-        free(Buffer);
-        Buffer = NULL;
-        Error(IDS_ERR_BF_READ, FALSE, blockInfo->inPos);
-        return;
+        Error(IDS_ERR_BF_READ, FALSE, pos);
+        return 0;
     }
-    if ((dwBytesRead > 3) && !memcmp(inBuf, "ISz", 3))
+    PosInBuf += dwBytesRead;
+    return dwBytesRead;
+}
+
+static int InflateZLIB(BYTE* inBuf, const CBlockedFile::BlockInfo* block, char* buffer)
+{
+    CSalZLIB zi;
+    int err;
+
+    if (SAL_Z_OK != SalZLIB->InflateInit(&zi))
+        return IDS_INSUFFICIENT_MEMORY;
+    zi.avail_in = (UINT)block->inSize;
+    zi.next_in = inBuf;
+    zi.next_out = (BYTE*)buffer;
+    zi.avail_out = (UINT)block->outSize;
+    err = SalZLIB->Inflate(&zi, SAL_Z_FINISH);
+    SalZLIB->InflateEnd(&zi);
+    if ((err != SAL_Z_STREAM_END) || (zi.avail_out != 0))
+        return IDS_ERR_BF_ZLIB;
+    return 0;
+}
+
+static int DecompressBZIP2(BYTE* inBuf, const CBlockedFile::BlockInfo* block, char* buffer)
+{
+    CSalBZIP2 bzi;
+    int err;
+
+    if ((block->inSize > 3) && !memcmp(inBuf, "ISz", 3))
     {
         // ISZ files use proprietary magic instead of the default one :-(
         memcpy(inBuf, "BZh", 3);
     }
     if (SAL_BZ_OK != SalBZIP2->DecompressInit(&bzi, false))
-    {
-        free(inBuf);
-        free(Buffer);
-        Buffer = NULL;
-        Error(IDS_INSUFFICIENT_MEMORY, FALSE);
-        return;
-    }
-    bzi.avail_in = (UINT)blockInfo->inSize;
+        return IDS_INSUFFICIENT_MEMORY;
+    bzi.avail_in = (UINT)block->inSize;
     bzi.next_in = inBuf;
-    bzi.next_out = (BYTE*)Buffer;
-    bzi.avail_out = (UINT)blockInfo->outSize;
+    bzi.next_out = (BYTE*)buffer;
+    bzi.avail_out = (UINT)block->outSize;
     err = SalBZIP2->Decompress(&bzi);
     SalBZIP2->DecompressEnd(&bzi);
-    free(inBuf);
     if ((err != SAL_BZ_STREAM_END) || (bzi.avail_out != 0))
-    {
-        free(Buffer);
-        Buffer = NULL;
-        Error(IDS_ERR_BF_BZIP2, FALSE);
-    }
-}
-
-CBlockedFile::CBZIP2Block::~CBZIP2Block()
-{
-    if (Buffer)
-        free(Buffer);
-}
-
-DWORD CBlockedFile::CBZIP2Block::Read(char* buf, DWORD BytesToRead)
-{
-    if (!Buffer)
-        return 0;
-
-    memcpy(buf, Buffer + PosInBuf, BytesToRead);
-    PosInBuf += BytesToRead;
-    return BytesToRead;
-}
-
-CBlockedFile::CCopyBlock::CCopyBlock(BlockInfo* blockInfo, HANDLE hFile) : File(hFile)
-{
-    CALL_STACK_MESSAGE3("CCopyBlock::CCopyBlock(%p, %p)", blockInfo, hFile);
-    pBlockInfo = blockInfo;
+        return IDS_ERR_BF_BZIP2;
+    return 0;
 }
 
-CBlockedFile::CCopyBlock::~CCopyBlock()
+BOOL CBlockedFile::IsDecodedType(int blockType)
 {
+    return blockType == BF_BLOCKTYPE_ZLIB || blockType == BF_BLOCKTYPE_BZIP2 || blockType == BF_BLOCKTYPE_ADC;
 }
 
-DWORD CBlockedFile::CCopyBlock::Read(char* buf, DWORD BytesToRead)
+// Reads and decodes ZLIB, BZIP2 or ADC block; returns buffer allocated by malloc() or NULL
+// and error string ID in 'errorID'. Doesn't show any error (it is called also from read-ahead threads).
+char* CBlockedFile::DecodeBlock(const BlockInfo* block, HANDLE hFile, int* errorID)
 {
-    UInt64 pos = pBlockInfo->inPos + PosInBuf;
-    LONG posHi = (DWORD)(pos >> 32);
+    CALL_STACK_MESSAGE2("CBlockedFile::DecodeBlock(%p, , )", block);
+    char* buffer;
+    BYTE* inBuf;
     DWORD dwBytesRead;
 
-    if ((0xFFFFFFFF == SetFilePointer(File, (DWORD)(pos & 0xffffffff), &posHi, FILE_BEGIN)) && (GetLastError() != NO_ERROR))
+    buffer = (char*)malloc((size_t)block->outSize);
+    inBuf = buffer ? (BYTE*)malloc((size_t)block->inSize) : NULL;
+    if (!inBuf)
     {
-        Error(IDS_ERR_BF_SEEK, FALSE, pos);
-        return 0;
+        if (buffer)
+            free(buffer);
+        *errorID = IDS_INSUFFICIENT_MEMORY;
+        return NULL;
     }
-    if (!ReadFile(File, buf, BytesToRead, &dwBytesRead, NULL))
+    if (!ReadFileAt(hFile, block->inPos, inBuf, (DWORD)block->inSize, &dwBytesRead) || (block->inSize != dwBytesRead))
     {
-        Error(IDS_ERR_BF_READ, FALSE);
-        return 0;
+        free(inBuf);
+        free(buffer);
+        *errorID = IDS_ERR_BF_READ;
+        return NULL;
     }
-    PosInBuf += dwBytesRead;
-    return dwBytesRead;
+    switch (block->blockType)
+    {
+    case BF_BLOCKTYPE_ZLIB:
+        *errorID = InflateZLIB(inBuf, block, buffer);
+        break;
+    case BF_BLOCKTYPE_BZIP2:
+        *errorID = DecompressBZIP2(inBuf, block, buffer);
+        break;
+    case BF_BLOCKTYPE_ADC:
+        CDMGFile::DecodeADC(inBuf, (int)block->inSize, (BYTE*)buffer);
+        *errorID = 0;
+        break;
+    default: // Should not happen, see IsDecodedType()
+        *errorID = IDS_ERR_BF_BLOCK_UNK_TYPE;
+        break;
+    }
+    free(inBuf);
+    if (*errorID != 0)
+    {
+        free(buffer);
+        return NULL;
+    }
+    return buffer;
 }
 
 CBlockedFile::CBlockedFile()
 {
     pBlocks = NULL;
     nBlocks = 0;
+    BlocksSorted = -1;
 
-    MRUCachedBlock = 0;
+    CachedBlocks = NULL;
+    pMRUBlock = pLRUBlock = NULL;
+    CacheMemSize = 0;
+    LastLoadedBlock = -2;
     pCurBlock = NULL;
 
     bUnknownBlockErrShown = false;
+
+    InitializeCriticalSection(&ReadAheadCS);
+    for (int i = 0; i < BF_READAHEAD_BLOCKS; i++)
+    {
+        ReadAheadJobs[i].Block = -1;
+        ReadAheadJobs[i].Buffer = NULL;
+    }
+    nReadAheadThreads = 0;
+    ReadAheadSemaphore = NULL;
+    ReadAheadDoneEvent = NULL;
+    ReadAheadExit = FALSE;
 }
 
 CBlockedFile::~CBlockedFile()
 {
-    if (pBlocks)
-        free(pBlocks);
-    for (int i = 0; i < SizeOf(BlockCache); i++)
+    StopReadAhead();
+    DeleteCriticalSection(&ReadAheadCS);
+    while (pMRUBlock)
     {
-        delete BlockCache[i];
+        CCachedBlock* pNext = pMRUBlock->pNext;
+        delete pMRUBlock;
+        pMRUBlock = pNext;
     }
+    if (CachedBlocks)
+        free(CachedBlocks);
+    if (pBlocks)
+        free(pBlocks);
 }
 
 BOOL CBlockedFile::IsOK()
@@ -313,95 +297,377 @@ __int64 CBlockedFile::Seek(__int64 lDistanceToMove, DWORD dwMoveMethod)
     return CurrentPos;
 }
 
-CBlockedFile::CCachedBlock* CBlockedFile::LoadBlock(UInt64 pos)
+int CBlockedFile::FindBlock(UInt64 pos)
 {
-    CALL_STACK_MESSAGE2("CBlockedFile::LoadBlock(%I64u)", pos);
-    for (int i = MRUCachedBlock - 1; i >= 0; i--)
+    if (BlocksSorted < 0)
     {
-        if ((pos >= BlockCache[i]->pBlockInfo->outPos) && (pos < BlockCache[i]->pBlockInfo->outPos + BlockCache[i]->pBlockInfo->outSize))
+        BlocksSorted = 1;
+        for (int i = 1; i < nBlocks; i++)
         {
-            // Found -> put to the end of the list
-            CBlockedFile::CCachedBlock* pCachedBlock = BlockCache[i];
-            memmove(&BlockCache[i], &BlockCache[i + 1], sizeof(void*) * (MRUCachedBlock - i - 1));
-            BlockCache[MRUCachedBlock - 1] = pCachedBlock;
-            return pCachedBlock;
+            if (pBlocks[i].outPos < pBlocks[i - 1].outPos)
+            {
+                BlocksSorted = 0;
+                break;
+            }
+        }
+    }
+    if (BlocksSorted)
+    {
+        // last block starting at or before 'pos'
+        int l = 0, r = nBlocks;
+        while (l < r)
+        {
+            int m = (l + r) / 2;
+            if (pBlocks[m].outPos <= pos)
+                l = m + 1;
+            else
+                r = m;
+        }
+        // blocks of zero size can start at the same position
+        for (int j = l - 1; j >= 0 && pBlocks[j].outPos == pBlocks[l - 1].outPos; j--)
+        {
+            if (pos < pBlocks[j].outPos + pBlocks[j].outSize)
+                return j;
         }
+        return -1;
     }
     for (int j = 0; j < nBlocks; j++)
     {
-        // TODO: better search algorithm
         if ((pos >= pBlocks[j].outPos) && (pos < pBlocks[j].outPos + pBlocks[j].outSize))
-        {
-            CBlockedFile::CCachedBlock* pCachedBlock;
-            CBlockedFile::BlockInfo* pBlock = &pBlocks[j];
+            return j;
+    }
+    return -1;
+}
 
-            switch (pBlock->blockType)
-            {
-            case BF_BLOCKTYPE_ZLIB:
-            {
-                CBlockedFile::CZLIBBlock* pZLIBBlock = new CBlockedFile::CZLIBBlock(pBlock, File);
-
-                if (pZLIBBlock && !pZLIBBlock->IsOK())
-                {
-                    delete pZLIBBlock;
-                    return NULL; // Error reported in CZLIBBlock::CZLIBBlock()
-                }
-                pCachedBlock = pZLIBBlock;
-                break;
-            }
+CBlockedFile::CCachedBlock* CBlockedFile::CreateBlock(int block)
+{
+    CALL_STACK_MESSAGE2("CBlockedFile::CreateBlock(%d)", block);
+    CBlockedFile::CCachedBlock* pCachedBlock;
+    CBlockedFile::BlockInfo* pBlock = &pBlocks[block];
 
-            case BF_BLOCKTYPE_BZIP2:
+    switch (pBlock->blockType)
+    {
+    case BF_BLOCKTYPE_ZLIB:
+    case BF_BLOCKTYPE_BZIP2:
+    case BF_BLOCKTYPE_ADC:
+    {
+        char* buffer;
+        if (!TakeReadAheadBlock(block, &buffer))
+        {
+            int errorID;
+            buffer = DecodeBlock(pBlock, File, &errorID);
+            if (!buffer)
             {
-                CBlockedFile::CBZIP2Block* pBZIP2Block = new CBlockedFile::CBZIP2Block(pBlock, File);
-
-                if (pBZIP2Block && !pBZIP2Block->IsOK())
-                {
-                    delete pBZIP2Block;
-                    return NULL; // Error reported in CBZIP2Block::CBZIP2Block()
-                }
-                pCachedBlock = pBZIP2Block;
-                break;
+                Error(errorID, FALSE, pBlock->inPos);
+                return NULL;
             }
+        }
+        pCachedBlock = new CBlockedFile::CDecodedBlock(pBlock, buffer);
+        if (!pCachedBlock)
+            free(buffer);
+        break;
+    }
 
-            case BF_BLOCKTYPE_COPY:
-                pCachedBlock = new CBlockedFile::CCopyBlock(pBlock, File);
-                break;
+    case BF_BLOCKTYPE_COPY:
+        pCachedBlock = new CBlockedFile::CCopyBlock(pBlock, File);
+        break;
+
+    case BF_BLOCKTYPE_ZERO:
+        pCachedBlock = new CBlockedFile::CZeroBlock(pBlock);
+        break;
+
+    default: // Should not happen
+        Error(IDS_ERR_BF_BLOCK_UNK_TYPE, bUnknownBlockErrShown);
+        bUnknownBlockErrShown = true; // Don't show the same error multiple times
+        return NULL;
+    }
+    if (!pCachedBlock)
+        Error(IDS_INSUFFICIENT_MEMORY, FALSE);
+    return pCachedBlock;
+}
 
-            case BF_BLOCKTYPE_ADC:
-                pCachedBlock = new CDMGFile::CADCBlock(pBlock, File);
+void CBlockedFile::AddToCache(int block, CCachedBlock* pCachedBlock)
+{
+    CachedBlocks[block] = pCachedBlock;
+    pCachedBlock->pPrev = NULL;
+    pCachedBlock->pNext = pMRUBlock;
+    if (pMRUBlock)
+        pMRUBlock->pPrev = pCachedBlock;
+    pMRUBlock = pCachedBlock;
+    if (!pLRUBlock)
+        pLRUBlock = pCachedBlock;
+    CacheMemSize += pCachedBlock->MemSize;
+    TrimCache(pCachedBlock);
+}
+
+// Releases least recently used blocks over the memory budget (Options.DecodedCacheSize)
+void CBlockedFile::TrimCache(CCachedBlock* pKeep)
+{
+    size_t budget = (size_t)max(Options.DecodedCacheSize, (DWORD)1) * 1024 * 1024;
+    while (CacheMemSize > budget && pLRUBlock && pLRUBlock != pKeep)
+    {
+        CCachedBlock* pBlock = pLRUBlock;
+        pLRUBlock = pBlock->pPrev;
+        if (pLRUBlock)
+            pLRUBlock->pNext = NULL;
+        else
+            pMRUBlock = NULL;
+        CachedBlocks[pBlock->pBlockInfo - pBlocks] = NULL;
+        CacheMemSize -= pBlock->MemSize;
+        delete pBlock;
+    }
+}
+
+CBlockedFile::CCachedBlock* CBlockedFile::LoadBlock(UInt64 pos)
+{
+    CALL_STACK_MESSAGE2("CBlockedFile::LoadBlock(%I64u)", pos);
+
+    int block = FindBlock(pos);
+    if (block < 0)
+    {
+        Error(IDS_ERR_DMG_BLOCK_UNDEFINED, FALSE, pos);
+        return NULL;
+    }
+    if (!CachedBlocks)
+    {
+        CachedBlocks = (CCachedBlock**)calloc(nBlocks, sizeof(CCachedBlock*));
+        if (!CachedBlocks)
+        {
+            Error(IDS_INSUFFICIENT_MEMORY, FALSE);
+            return NULL;
+        }
+    }
+    CollectReadAhead();
+
+    CCachedBlock* pCachedBlock = CachedBlocks[block];
+    if (pCachedBlock)
+    {
+        // Found -> move to the head of the LRU list
+        if (pCachedBlock != pMRUBlock)
+        {
+            pCachedBlock->pPrev->pNext = pCachedBlock->pNext;
+            if (pCachedBlock->pNext)
+                pCachedBlock->pNext->pPrev = pCachedBlock->pPrev;
+            else
+                pLRUBlock = pCachedBlock->pPrev;
+            pCachedBlock->pPrev = NULL;
+            pCachedBlock->pNext = pMRUBlock;
+            pMRUBlock->pPrev = pCachedBlock;
+            pMRUBlock = pCachedBlock;
+        }
+    }
+    else
+    {
+        pCachedBlock = CreateBlock(block);
+        if (!pCachedBlock)
+            return NULL; // Error already reported
+        AddToCache(block, pCachedBlock);
+    }
+
+    // sequential reading: decode following blocks in advance
+    if (block == LastLoadedBlock + 1)
+        StartReadAhead(block + 1);
+    LastLoadedBlock = block;
+    return pCachedBlock;
+}
+
+// ****************************************************************************
+//
+// Read-ahead
+//
+
+unsigned WINAPI CBlockedFile::ReadAheadThread(void* param)
+{
+    CBlockedFile* file = (CBlockedFile*)param;
+
+    while (WaitForSingleObject(file->ReadAheadSemaphore, INFINITE) == WAIT_OBJECT_0 && !file->ReadAheadExit)
+    {
+        CReadAheadJob* job = NULL;
+        EnterCriticalSection(&file->ReadAheadCS);
+        for (int i = 0; i < BF_READAHEAD_BLOCKS; i++)
+        {
+            if (file->ReadAheadJobs[i].Block != -1 && file->ReadAheadJobs[i].State == raPending)
+            {
+                job = &file->ReadAheadJobs[i];
+                job->State = raRunning;
                 break;
+            }
+        }
+        LeaveCriticalSection(&file->ReadAheadCS);
+        if (!job)
+            continue; // the job was taken by the main thread, see TakeReadAheadBlock()
+
+        int errorID;
+        char* buffer = DecodeBlock(&file->pBlocks[job->Block], file->File, &errorID);
+
+        EnterCriticalSection(&file->ReadAheadCS);
+        job->Buffer = buffer; // on error the main thread decodes the block again and reports the error
+        job->State = raDone;
+        LeaveCriticalSection(&file->ReadAheadCS);
+        SetEvent(file->ReadAheadDoneEvent);
+    }
+    return 0;
+}
 
-            case BF_BLOCKTYPE_ZERO:
-                pCachedBlock = new CBlockedFile::CZeroBlock(pBlock);
+void CBlockedFile::StartReadAhead(int block)
+{
+    if (nReadAheadThreads == 0)
+    {
+        if (ReadAheadSemaphore)
+            return; // threads could not be started, reading continues without read-ahead
+
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        int threads = min((int)si.dwNumberOfProcessors, BF_READAHEAD_THREADS);
+        ReadAheadSemaphore = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+        ReadAheadDoneEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+        if (!ReadAheadSemaphore || !ReadAheadDoneEvent)
+        {
+            TRACE_E("CBlockedFile::StartReadAhead(): unable to create synchronization objects");
+            return;
+        }
+        ReadAheadExit = FALSE;
+        for (; nReadAheadThreads < threads; nReadAheadThreads++)
+        {
+            HANDLE thread = ThreadQueue.StartThread(ReadAheadThread, this);
+            if (!thread)
                 break;
+            ReadAheadThreads[nReadAheadThreads] = thread;
+        }
+        if (nReadAheadThreads == 0)
+            return;
+    }
 
-            default: // Should not happen
-                Error(IDS_ERR_BF_BLOCK_UNK_TYPE, bUnknownBlockErrShown);
-                bUnknownBlockErrShown = true; // Don't show the same error multiple times
-                return NULL;
-            }
-            if (!pCachedBlock)
+    // decoded data waiting in jobs are limited to one half of the cache budget
+    size_t budget = (size_t)max(Options.DecodedCacheSize, (DWORD)1) * 1024 * 1024 / 2;
+    EnterCriticalSection(&ReadAheadCS);
+    for (int b = block; b < block + BF_READAHEAD_BLOCKS && b < nBlocks; b++)
+    {
+        if (!IsDecodedType(pBlocks[b].blockType) || CachedBlocks[b])
+            continue;
+        int freeJob = -1;
+        BOOL queued = FALSE;
+        size_t pending = 0;
+        for (int i = 0; i < BF_READAHEAD_BLOCKS; i++)
+        {
+            if (ReadAheadJobs[i].Block == b)
+                queued = TRUE;
+            if (ReadAheadJobs[i].Block == -1)
             {
-                Error(IDS_INSUFFICIENT_MEMORY, FALSE);
-                return NULL;
+                if (freeJob == -1)
+                    freeJob = i;
             }
-            if (MRUCachedBlock >= SizeOf(BlockCache))
+            else
+                pending += (size_t)pBlocks[ReadAheadJobs[i].Block].outSize;
+        }
+        if (queued)
+            continue;
+        if (freeJob == -1 || pending + (size_t)pBlocks[b].outSize > budget)
+            break;
+        ReadAheadJobs[freeJob].Block = b;
+        ReadAheadJobs[freeJob].State = raPending;
+        ReadAheadJobs[freeJob].Buffer = NULL;
+        ReleaseSemaphore(ReadAheadSemaphore, 1, NULL);
+    }
+    LeaveCriticalSection(&ReadAheadCS);
+}
+
+// Returns TRUE and the decoded data of 'block' if it was decoded by a read-ahead thread;
+// waits if the block is being decoded right now
+BOOL CBlockedFile::TakeReadAheadBlock(int block, char** buffer)
+{
+    if (nReadAheadThreads == 0)
+        return FALSE;
+
+    BOOL ret = FALSE;
+    EnterCriticalSection(&ReadAheadCS);
+    for (int i = 0; i < BF_READAHEAD_BLOCKS; i++)
+    {
+        CReadAheadJob* job = &ReadAheadJobs[i];
+        if (job->Block != block)
+            continue;
+        while (job->State == raRunning)
+        {
+            LeaveCriticalSection(&ReadAheadCS);
+            WaitForSingleObject(ReadAheadDoneEvent, INFINITE);
+            EnterCriticalSection(&ReadAheadCS);
+        }
+        // not started yet -> we will decode it ourselves
+        if (job->State == raDone && job->Buffer)
+        {
+            *buffer = job->Buffer;
+            ret = TRUE;
+        }
+        job->Block = -1;
+        job->Buffer = NULL;
+        break;
+    }
+    LeaveCriticalSection(&ReadAheadCS);
+    return ret;
+}
+
+// Moves blocks decoded by read-ahead threads to the cache
+void CBlockedFile::CollectReadAhead()
+{
+    if (nReadAheadThreads == 0)
+        return;
+
+    EnterCriticalSection(&ReadAheadCS);
+    for (int i = 0; i < BF_READAHEAD_BLOCKS; i++)
+    {
+        CReadAheadJob* job = &ReadAheadJobs[i];
+        if (job->Block == -1 || job->State != raDone)
+            continue;
+        if (job->Buffer)
+        {
+            if (CachedBlocks[job->Block])
+                free(job->Buffer); // cannot happen, blocks in cache are not queued
+            else
             {
-                delete BlockCache[0];
-                memmove(BlockCache, &BlockCache[1], sizeof(void*) * --MRUCachedBlock);
+                CCachedBlock* pCachedBlock = new CBlockedFile::CDecodedBlock(&pBlocks[job->Block], job->Buffer);
+                if (pCachedBlock)
+                    AddToCache(job->Block, pCachedBlock);
+                else
+                    free(job->Buffer);
             }
-            BlockCache[MRUCachedBlock++] = pCachedBlock;
-            return pCachedBlock;
         }
+        job->Block = -1;
+        job->Buffer = NULL;
     }
-    Error(IDS_ERR_DMG_BLOCK_UNDEFINED, FALSE, pos);
-    return NULL;
+    LeaveCriticalSection(&ReadAheadCS);
+}
+
+void CBlockedFile::StopReadAhead()
+{
+    if (nReadAheadThreads > 0)
+    {
+        ReadAheadExit = TRUE;
+        ReleaseSemaphore(ReadAheadSemaphore, nReadAheadThreads, NULL);
+        for (int i = 0; i < nReadAheadThreads; i++)
+            ThreadQueue.WaitForExit(ReadAheadThreads[i]);
+        nReadAheadThreads = 0;
+    }
+    for (int i = 0; i < BF_READAHEAD_BLOCKS; i++)
+    {
+        if (ReadAheadJobs[i].Buffer)
+            free(ReadAheadJobs[i].Buffer);
+        ReadAheadJobs[i].Block = -1;
+        ReadAheadJobs[i].Buffer = NULL;
+    }
+    if (ReadAheadSemaphore)
+        CloseHandle(ReadAheadSemaphore);
+    if (ReadAheadDoneEvent)
+        CloseHandle(ReadAheadDoneEvent);
+    ReadAheadSemaphore = NULL;
+    ReadAheadDoneEvent = NULL;
 }
 
 BOOL CBlockedFile::Close(LPCTSTR fileName, HWND parent)
 {
     BOOL ret = TRUE;
 
+    StopReadAhead(); // read-ahead threads use File
+
     if (File != INVALID_HANDLE_VALUE)
     {
         ret = CloseHandle(File);
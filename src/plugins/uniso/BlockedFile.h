@@ -13,6 +13,9 @@
 #define BF_BLOCKTYPE_ADC 4
 #define BF_BLOCKTYPE_UNKNOWN 255
 
+#define BF_READAHEAD_BLOCKS 4  // Number of blocks decoded in advance during sequential reading
+#define BF_READAHEAD_THREADS 4 // Maximal number of read-ahead threads
+
 class CBlockedFile : public CFile
 {
 
@@ -32,6 +35,10 @@ public:
     public:
         BlockInfo* pBlockInfo;
         size_t PosInBuf; // must remain unsigned!
+        size_t MemSize;  // Memory occupied by the block (counted in the cache budget)
+
+        CCachedBlock* pPrev; // LRU list of cached blocks, see CBlockedFile::LoadBlock()
+        CCachedBlock* pNext;
 
         CCachedBlock();
         virtual ~CCachedBlock(){};
@@ -46,28 +53,14 @@ public:
         virtual DWORD Read(char* buf, DWORD BytesToRead);
     };
 
-    class CZLIBBlock : public CCachedBlock
-    {
-    public:
-        CZLIBBlock(BlockInfo* blockInfo, HANDLE hFile);
-        virtual ~CZLIBBlock();
-        virtual DWORD Read(char* buf, DWORD BytesToRead);
-
-        bool IsOK() { return Buffer ? true : false; };
-
-    private:
-        char* Buffer;
-    };
-
-    class CBZIP2Block : public CCachedBlock
+    // Block decoded into memory (ZLIB, BZIP2, ADC), see DecodeBlock()
+    class CDecodedBlock : public CCachedBlock
     {
     public:
-        CBZIP2Block(BlockInfo* blockInfo, HANDLE hFile);
-        virtual ~CBZIP2Block();
+        CDecodedBlock(BlockInfo* blockInfo, char* buffer); // takes ownership of 'buffer'
+        virtual ~CDecodedBlock();
         virtual DWORD Read(char* buf, DWORD BytesToRead);
 
-        bool IsOK() { return Buffer ? true : false; };
-
     private:
         char* Buffer;
     };
@@ -98,16 +91,56 @@ public:
     virtual BOOL IsOK();
 
 protected:
+    // Block decoded in advance by a read-ahead thread
+    struct CReadAheadJob
+    {
+        int Block;    // Index into pBlocks, -1 = free slot
+        int State;    // raPending, raRunning, raDone
+        char* Buffer; // Decoded data, NULL if decoding failed
+    };
+
+    enum
+    {
+        raPending,
+        raRunning,
+        raDone
+    };
+
     BlockInfo* pBlocks;
     int nBlocks;
+    int BlocksSorted; // -1 = not checked yet, 0/1 = pBlocks (not) sorted by outPos
 
     UInt64 CurrentPos;
     UInt64 FileSize;
 
-    CCachedBlock* BlockCache[32]; // 32 MRU blocks
-    int MRUCachedBlock;           // index into MRUCachedBlock
+    CCachedBlock** CachedBlocks; // [nBlocks], cached block of given index or NULL
+    CCachedBlock* pMRUBlock;     // LRU list: most recently used block
+    CCachedBlock* pLRUBlock;     // LRU list: least recently used block
+    size_t CacheMemSize;         // Memory occupied by cached blocks
+    int LastLoadedBlock;         // For detecting sequential reading
     CCachedBlock* pCurBlock;
     bool bUnknownBlockErrShown;
 
+    CRITICAL_SECTION ReadAheadCS; // Protects ReadAheadJobs
+    CReadAheadJob ReadAheadJobs[BF_READAHEAD_BLOCKS];
+    HANDLE ReadAheadThreads[BF_READAHEAD_THREADS]; // Threads in ThreadQueue
+    int nReadAheadThreads;
+    HANDLE ReadAheadSemaphore; // Number of pending jobs
+    HANDLE ReadAheadDoneEvent; // Set after a job is finished
+    volatile BOOL ReadAheadExit;
+
     virtual CCachedBlock* LoadBlock(UInt64 pos);
+
+    int FindBlock(UInt64 pos);
+    CCachedBlock* CreateBlock(int block);
+    void AddToCache(int block, CCachedBlock* pCachedBlock);
+    void TrimCache(CCachedBlock* pKeep);
+    BOOL TakeReadAheadBlock(int block, char** buffer);
+    void CollectReadAhead();
+    void StartReadAhead(int block);
+    void StopReadAhead();
+
+    static BOOL IsDecodedType(int blockType);
+    static char* DecodeBlock(const BlockInfo* block, HANDLE hFile, int* errorID);
+    static unsigned WINAPI ReadAheadThread(void* param);
 };
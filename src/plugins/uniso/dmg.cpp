@@ -107,9 +107,7 @@ CDMGFile::CDMGFile(HANDLE hFile, BOOL quiet)
     pBlocks = NULL;
     nBlocks = 0;
     pCurBlock = 0;
-    memset(BlockCache, 0, sizeof(BlockCache));
     CurrentPos = FileSize = 0;
-    MRUCachedBlock = 0;
 
     posLo = SetFilePointer(hFile, -512, &posHi, FILE_END);
     if (!ReadFile(hFile, &footer, sizeof(footer), &dwBytesRead, NULL) || (sizeof(footer) != dwBytesRead))
@@ -304,41 +302,8 @@ CDMGFile::~CDMGFile()
 }
 
 // Apple Data Compression, see http://www.macdisk.com/dmgen.php
-CDMGFile::CADCBlock::CADCBlock(BlockInfo* blockInfo, HANDLE hFile)
+void CDMGFile::DecodeADC(const BYTE* in, int size, BYTE* out)
 {
-    CALL_STACK_MESSAGE3("CADCBlock::CADCBlock(%p, %p)", blockInfo, hFile);
-    BYTE *inBuf, *in, *out;
-    LONG posHi;
-    DWORD dwBytesRead;
-    int size;
-
-    pBlockInfo = blockInfo;
-
-    Buffer = (char*)malloc((size_t)blockInfo->outSize);
-    if (!Buffer)
-    {
-        Error(IDS_INSUFFICIENT_MEMORY, FALSE);
-        return;
-    }
-    in = inBuf = (BYTE*)malloc((size_t)blockInfo->inSize);
-    if (!inBuf)
-    {
-        free(Buffer);
-        Buffer = NULL;
-        Error(IDS_INSUFFICIENT_MEMORY, FALSE);
-        return;
-    }
-    size = (int)blockInfo->inSize;
-    posHi = (LONG)(blockInfo->inPos >> 32);
-    if ((0xFFFFFFFF == SetFilePointer(hFile, (DWORD)(blockInfo->inPos & 0xFFFFFFFF), &posHi, FILE_BEGIN)) || !ReadFile(hFile, inBuf, size, &dwBytesRead, NULL) || (blockInfo->inSize != dwBytesRead))
-    {
-        free(inBuf);
-        free(Buffer);
-        Buffer = NULL;
-        Error(IDS_ERR_BF_READ, FALSE, blockInfo->inPos);
-        return;
-    }
-    out = (BYTE*)Buffer;
     while (size > 0)
     {
         if (*in & 0x80)
@@ -390,22 +355,4 @@ CDMGFile::CADCBlock::CADCBlock(BlockInfo* blockInfo, HANDLE hFile)
             size -= 2;
         }
     }
-
-    free(inBuf);
-}
-
-CDMGFile::CADCBlock::~CADCBlock()
-{
-    if (Buffer)
-        free(Buffer);
-}
-
-DWORD CDMGFile::CADCBlock::Read(char* buf, DWORD BytesToRead)
-{
-    if (!Buffer)
-        return 0;
-
-    memcpy(buf, Buffer + PosInBuf, BytesToRead);
-    PosInBuf += BytesToRead;
-    return BytesToRead;
 }
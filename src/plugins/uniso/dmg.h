@@ -52,18 +52,8 @@ private:
 
 #pragma pack(pop)
 
-    class CADCBlock : public CBlockedFile::CCachedBlock
-    { // Apple Data Compression
-    public:
-        CADCBlock(BlockInfo* blockInfo, HANDLE hFile);
-        virtual ~CADCBlock();
-        virtual DWORD Read(char* buf, DWORD BytesToRead);
-
-        bool IsOK() { return Buffer ? true : false; };
-
-    private:
-        char* Buffer;
-    };
+    // Apple Data Compression, 'out' must be large enough for the decompressed data
+    static void DecodeADC(const BYTE* in, int size, BYTE* out);
 
 public:
     CDMGFile(HANDLE hFile, BOOL quiet);
@@ -46,6 +46,31 @@ BOOL SafeReadFile(HANDLE hFile, LPVOID lpBuffer, DWORD nBytesToRead, DWORD* pnBy
     return TRUE;
 }
 
+BOOL ReadFileAt(HANDLE hFile, __int64 pos, LPVOID lpBuffer, DWORD nBytesToRead, DWORD* pnBytesRead)
+{
+    OVERLAPPED ov;
+    memset(&ov, 0, sizeof(ov));
+    ov.Offset = (DWORD)(pos & 0xFFFFFFFF);
+    ov.OffsetHigh = (DWORD)(pos >> 32);
+    *pnBytesRead = 0;
+    return ReadFile(hFile, lpBuffer, nBytesToRead, pnBytesRead, &ov) || GetLastError() == ERROR_HANDLE_EOF;
+}
+
+BOOL SafeReadFileAt(HANDLE hFile, __int64 pos, LPVOID lpBuffer, DWORD nBytesToRead, DWORD* pnBytesRead, const char* fileName, HWND parent)
+{
+    while (!ReadFileAt(hFile, pos, lpBuffer, nBytesToRead, pnBytesRead))
+    {
+        int lastErr = GetLastError();
+        char error[1024];
+        FormatMessage(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, NULL, lastErr,
+                      MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), error, 1024, NULL);
+        if (SalamanderGeneral->DialogError(parent == NULL ? SalamanderGeneral->GetMsgBoxParent() : parent, BUTTONS_RETRYCANCEL,
+                                           fileName, error, LoadStr(IDS_READERROR)) != DIALOG_RETRY)
+            return FALSE;
+    }
+    return TRUE;
+}
+
 BOOL SafeWriteFile(HANDLE hFile, LPVOID lpBuffer, DWORD nBytesToWrite, DWORD* pnBytesWritten, LPCTSTR fileName, HWND parent)
 {
     while (!WriteFile(hFile, lpBuffer, nBytesToWrite, pnBytesWritten, NULL))
@@ -72,6 +97,12 @@ CBufferedFile::CBufferedFile(DWORD bufferSize /* = 32768*/)
     BufferSize = bufferSize;
     Buffer = new BYTE[BufferSize];
 
+    ReadAhead = FALSE;
+    ReadAheadBuffer = NULL;
+    ReadAheadStart = 0;
+    ReadAheadFilled = 0;
+    ReadAheadThread = NULL;
+
     //  ::InitializeCriticalSection(&CS);
 }
 
@@ -84,6 +115,12 @@ CBufferedFile::CBufferedFile(HANDLE hFile, DWORD dwDesiredAccess, DWORD bufferSi
     BufferSize = bufferSize;
     Buffer = new BYTE[BufferSize];
 
+    ReadAhead = FALSE;
+    ReadAheadBuffer = NULL;
+    ReadAheadStart = 0;
+    ReadAheadFilled = 0;
+    ReadAheadThread = NULL;
+
     //  ::InitializeCriticalSection(&CS);
 
     EmptyCache();
@@ -97,7 +134,10 @@ CBufferedFile::~CBufferedFile()
     if (File != NULL)
         this->Close("", SalamanderGeneral->GetMainWindowHWND());
 
+    WaitForReadAhead();
     delete[] Buffer;
+    if (ReadAheadBuffer != NULL)
+        delete[] ReadAheadBuffer;
 }
 
 /*void CBufferedFile::Lock() {
@@ -126,24 +166,34 @@ BOOL CBufferedFile::Create(LPCTSTR lpFileName, DWORD dwDesiredAccess, DWORD dwSh
 
 __int64 CBufferedFile::Seek(__int64 lDistanceToMove, DWORD dwMoveMethod)
 {
+    // only the logical position changes, Read uses positioned reads
     __int64 newPos = 0;
     switch (dwMoveMethod)
     {
+    case FILE_BEGIN:
+        newPos = lDistanceToMove;
+        break;
+
     case FILE_CURRENT:
         newPos = BufferStart + BufferPos + lDistanceToMove;
-        newPos = FileSeek(File, newPos, FILE_BEGIN);
         break;
 
     default:
-        newPos = FileSeek(File, lDistanceToMove, dwMoveMethod);
+    {
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(File, &size))
+            return -1;
+        newPos = size.QuadPart + lDistanceToMove;
         break;
     }
+    }
+    if (newPos < 0)
+        return -1;
 
-    if (BufferStart <= newPos && newPos < BufferStart + BufferFilled)
+    // the end of the buffer is kept too, so that the next Read is recognized as sequential
+    if (BufferStart <= newPos && newPos <= BufferStart + BufferFilled)
     {
         BufferPos = (DWORD)(newPos - BufferStart);
-        // Ensure next Read reads from the correct position
-        FileSeek(File, BufferStart + BufferFilled, FILE_BEGIN);
     }
     else
     {
@@ -184,17 +234,9 @@ BOOL CBufferedFile::Read(LPVOID lpBuffer, DWORD nBytesToRead, DWORD* pnBytesRead
             int nToRead = BufferFilled - BufferPos;
             if (nToRead <= 0)
             {
-                DWORD read;
-                LONG offsetHigh = 0;
-                BufferStart = ::SetFilePointer(File, 0, &offsetHigh, FILE_CURRENT);
-                BufferStart += ((__int64)(DWORD)offsetHigh) << 32;
-                ret = SafeReadFile(File, Buffer, BufferSize, &read, fileName, parent);
-                BufferFilled = read;
-                BufferPos = 0;
-
-                if (!ret || read == 0)
+                if (!FillBuffer(BufferStart + BufferPos, fileName, parent))
                 {
-                    // reading beyond the end of the file
+                    // read error or reading beyond the end of the file
                     ret = FALSE;
                     break;
                 }
@@ -214,6 +256,82 @@ BOOL CBufferedFile::Read(LPVOID lpBuffer, DWORD nBytesToRead, DWORD* pnBytesRead
     return ret;
 }
 
+BOOL CBufferedFile::FillBuffer(__int64 pos, const char* fileName, HWND parent)
+{
+    BOOL sequential = BufferFilled > 0 && pos == BufferStart + BufferFilled;
+
+    WaitForReadAhead();
+    if (ReadAheadFilled > 0 && ReadAheadStart <= pos && pos < ReadAheadStart + ReadAheadFilled)
+    {
+        // data were read in advance, just swap the buffers
+        BYTE* tmp = Buffer;
+        Buffer = ReadAheadBuffer;
+        ReadAheadBuffer = tmp;
+        BufferStart = ReadAheadStart;
+        BufferFilled = ReadAheadFilled;
+        BufferPos = (DWORD)(pos - BufferStart);
+        ReadAheadFilled = 0;
+        if (ReadAhead && BufferFilled == BufferSize)
+            StartReadAhead();
+        return TRUE;
+    }
+    ReadAheadFilled = 0;
+
+    // random reads (directories, headers) do not need the whole buffer, sequential
+    // reading (extraction of files) fills it all
+    __int64 start = pos - pos % BF_READ_ALIGNMENT;
+    DWORD size = BufferSize;
+    if (!sequential && BufferSize >= 2 * BF_RANDOM_READ_SIZE)
+        size = BF_RANDOM_READ_SIZE;
+
+    DWORD read;
+    BOOL ret = SafeReadFileAt(File, start, Buffer, size, &read, fileName, parent);
+    if (!ret || read <= (DWORD)(pos - start))
+    {
+        // keep the logical position, the buffer is empty
+        EmptyCache();
+        BufferStart = pos;
+        EndOfFile = ret;
+        return FALSE;
+    }
+    BufferStart = start;
+    BufferFilled = read;
+    BufferPos = (DWORD)(pos - start);
+
+    if (ReadAhead && sequential && read == size)
+        StartReadAhead();
+    return TRUE;
+}
+
+void CBufferedFile::StartReadAhead()
+{
+    if (ReadAheadBuffer == NULL)
+        ReadAheadBuffer = new BYTE[BufferSize];
+    ReadAheadStart = BufferStart + BufferFilled;
+    ReadAheadFilled = 0;
+    // if the thread cannot be started, the next FillBuffer simply reads the data itself
+    ReadAheadThread = ThreadQueue.StartThread(ReadAheadThreadBody, this);
+}
+
+void CBufferedFile::WaitForReadAhead()
+{
+    if (ReadAheadThread != NULL)
+    {
+        ThreadQueue.WaitForExit(ReadAheadThread);
+        ReadAheadThread = NULL;
+    }
+}
+
+unsigned WINAPI CBufferedFile::ReadAheadThreadBody(void* param)
+{
+    CBufferedFile* file = (CBufferedFile*)param;
+    DWORD read;
+    // on error nothing is read in advance, main thread reads the data again and reports the error
+    if (ReadFileAt(file->File, file->ReadAheadStart, file->ReadAheadBuffer, file->BufferSize, &read))
+        file->ReadAheadFilled = read;
+    return 0;
+}
+
 BOOL CBufferedFile::Write(LPCVOID lpBuffer, DWORD nBytesToWrite, DWORD* pnBytesWritten, char* fileName, HWND parent)
 {
     DWORD nRemain = nBytesToWrite;
@@ -254,6 +372,8 @@ BOOL CBufferedFile::Write(LPCVOID lpBuffer, DWORD nBytesToWrite, DWORD* pnBytesW
 
 BOOL CBufferedFile::Close(LPCTSTR fileName, HWND parent)
 {
+    WaitForReadAhead();
+
     // flush buffers
     if ((Access & GENERIC_WRITE) && Buffer != NULL && BufferPos > 0)
     {
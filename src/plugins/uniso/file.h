@@ -29,6 +29,14 @@ protected:
 //
 // pro bufferovane cteni/zapis ze/do souboru
 //
+// Reading uses positioned reads, the file pointer of the handle is not used. Random
+// reads fill only BF_RANDOM_READ_SIZE bytes (aligned), sequential reading fills the
+// whole buffer and with EnableReadAhead() the following part of the file is read
+// by another thread meanwhile.
+//
+
+#define BF_READ_ALIGNMENT 0x1000    // reads start at multiples of this value
+#define BF_RANDOM_READ_SIZE 0x10000 // max. size of read which does not continue the previous one
 
 class CBufferedFile : public CFile
 {
@@ -48,6 +56,10 @@ public:
     /*    void Lock();
     void Unlock();*/
 
+    // during sequential reading the next buffer is read in advance by a thread from
+    // ThreadQueue, so reading of the file overlaps with processing of read data
+    void EnableReadAhead() { ReadAhead = TRUE; }
+
 protected:
     BOOL EndOfFile;
     BYTE* Buffer;
@@ -58,13 +70,27 @@ protected:
 
     DWORD Access; // desired access to the file
 
+    BOOL ReadAhead;          // TRUE = read the next buffer in advance (see EnableReadAhead())
+    BYTE* ReadAheadBuffer;   // buffer being filled by ReadAheadThread (BufferSize bytes)
+    __int64 ReadAheadStart;  // position within the file where ReadAheadBuffer starts
+    DWORD ReadAheadFilled;   // number of valid bytes in ReadAheadBuffer (0 = read-ahead failed)
+    HANDLE ReadAheadThread;  // thread reading ReadAheadBuffer or NULL
+
     BOOL EmptyCache();
+    BOOL FillBuffer(__int64 pos, const char* fileName, HWND parent);
+    void StartReadAhead();
+    void WaitForReadAhead();
+
+    static unsigned WINAPI ReadAheadThreadBody(void* param);
 
     //    CRITICAL_SECTION CS;
 };
 
 // file helpers
 BOOL SafeReadFile(HANDLE hFile, LPVOID lpBuffer, DWORD nBytesToRead, DWORD* pnBytesRead, const char* fileName, HWND parent);
+// reads from position 'pos' without using the file pointer, so it can be called from several threads
+BOOL ReadFileAt(HANDLE hFile, __int64 pos, LPVOID lpBuffer, DWORD nBytesToRead, DWORD* pnBytesRead);
+BOOL SafeReadFileAt(HANDLE hFile, __int64 pos, LPVOID lpBuffer, DWORD nBytesToRead, DWORD* pnBytesRead, const char* fileName, HWND parent);
 BOOL SafeWriteFile(HANDLE hFile, LPVOID lpBuffer, DWORD nBytesToWrite, DWORD* pnBytesWritten, const char* fileName, HWND parent);
 
 __int64 FileSeek(HANDLE hf, __int64 distance, DWORD moveMethod);
@@ -20,4 +20,7 @@ public:
                                CSalamanderDirectoryAbstract* dir, CPluginDataInterfaceAbstract*& pluginData) = 0;
     virtual int UnpackFile(CSalamanderForOperationsAbstract* salamander, const char* srcPath, const char* path,
                            const char* nameInArc, const CFileData* fileData, DWORD& silent, BOOL& toSkip) = 0;
+    // vraci pozici dat souboru v obrazu (v sektorech/blocich daneho FS), podle ni se radi soubory
+    // pri vybalovani vice souboru (viz CISOImage::AddToExtractPlan()); (ULONGLONG)-1 = neznama pozice
+    virtual ULONGLONG GetFileDataPos(const CFileData* fileData) { return (ULONGLONG)-1; }
 };
@@ -584,6 +584,21 @@ int CHFS::UnpackFile(CSalamanderForOperationsAbstract* salamander, const char* s
     return ret;
 }
 
+ULONGLONG CHFS::GetFileDataPos(const CFileData* fileData)
+{
+    CISOImage::CFilePos* filePos = (CISOImage::CFilePos*)fileData->PluginData;
+    if (filePos == NULL)
+        return (ULONGLONG)-1;
+
+    HFSPlusCatalogKey* pKey = (HFSPlusCatalogKey*)pCatalog->GetRecord(filePos->Extent);
+    if (pKey == NULL)
+        return (ULONGLONG)-1;
+    SInt16* type = (SInt16*)((char*)pKey + FromM16(pKey->keyLength) + sizeof(UInt16));
+    if (*type != kHFSFileRecord)
+        return (ULONGLONG)-1;
+    return FromM32(((HFSPlusCatalogFile*)type)->dataFork.extents[0].startBlock);
+}
+
 CHFS::BTree::BTree(CHFS* hfs, CHFS::HFSPlusForkData* fork, BOOL quiet)
 {
     CALL_STACK_MESSAGE1("BTree::BTree(,,)");
@@ -420,6 +420,7 @@ public:
                                CSalamanderDirectoryAbstract* dir, CPluginDataInterfaceAbstract*& pluginData);
     virtual int UnpackFile(CSalamanderForOperationsAbstract* salamander, const char* srcPath, const char* path,
                            const char* nameInArc, const CFileData* fileData, DWORD& silent, BOOL& toSkip);
+    virtual ULONGLONG GetFileDataPos(const CFileData* fileData);
 
     BOOL GetRootName(char* rootName, int maxlen);
 
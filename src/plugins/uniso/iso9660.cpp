@@ -42,11 +42,16 @@ CISO9660::CISO9660(CISOImage* image, DWORD extent) : CUnISOFSAbstract(image)
     ExtentOffset = extent;
 
     BootRecordInfo = NULL;
+
+    DirCache = NULL;
+    DirCacheBlock = 0;
+    DirCacheBlocks = 0;
 }
 
 CISO9660::~CISO9660()
 {
     delete BootRecordInfo;
+    FreeDirCache();
 }
 
 BOOL CISO9660::Open(BOOL quiet)
@@ -430,7 +435,86 @@ BOOL CISO9660::ListDirectory(char* path, int session,
     CALL_STACK_MESSAGE3("CISO9660::ListDirectory(%s, %d, , )", path, session);
 
     AddBootRecord(path, session, dir, pluginData);
-    return ListDirectoryRe(path, &Root, dir, pluginData) != ERR_TERMINATE;
+    PrefetchDirectories();
+    BOOL ret = ListDirectoryRe(path, &Root, dir, pluginData) != ERR_TERMINATE;
+    FreeDirCache();
+    return ret;
+}
+
+// podle path table nacte jednim ctenim oblast obrazu se vsemi adresari, ListDirectoryRe()
+// pak nemusi cist kazdy adresar zvlast; pri jakemkoliv problemu se nic nenacte a adresare
+// se ctou postaru
+void CISO9660::PrefetchDirectories()
+{
+    CALL_STACK_MESSAGE1("CISO9660::PrefetchDirectories()");
+
+    FreeDirCache();
+    if (Image->GetSectorUserSize() != SECTOR_SIZE)
+        return; // DirCache pocita se sektory velikosti SECTOR_SIZE
+
+    DWORD tableSize = Ext == extJoliet ? SVD.PathTableSize : PVD.PathTableSize;
+    DWORD tableExtent = Ext == extJoliet ? SVD.LocationOfTypeLPathTable : PVD.LocationOfTypeLPathTable;
+    if (tableSize == 0 || tableSize > ISO_DIR_CACHE_MAX_SIZE || tableExtent <= ExtentOffset)
+        return;
+
+    BYTE* table = new BYTE[tableSize];
+    if (table == NULL)
+        return;
+    if (Image->ReadBlock(tableExtent - ExtentOffset, tableSize, table) != tableSize)
+    {
+        delete[] table;
+        return;
+    }
+
+    DWORD first = 0xFFFFFFFF;
+    DWORD last = 0;
+    DWORD offset = 0;
+    while (offset + 8 <= tableSize)
+    {
+        CPathTableRecord record;
+        FillPathTableRecord(record, table + offset);
+        if (record.LengthOfDirectoryIdentifier == 0)
+            break; // konec tabulky (nebo poskozena data)
+
+        if (record.LocationOfExtent > ExtentOffset)
+        {
+            DWORD block = record.LocationOfExtent - ExtentOffset + record.ExtendedAttributeRecordLength;
+            if (block < first)
+                first = block;
+            if (block > last)
+                last = block;
+        }
+        // identifikator je zarovnany na sudy pocet bajtu
+        offset += 8 + record.LengthOfDirectoryIdentifier + (record.LengthOfDirectoryIdentifier & 1);
+    }
+    delete[] table;
+
+    // adresare delsi nez jeden sektor na konci oblasti se prectou pri listovani
+    if (first > last || (ULONGLONG)(last - first + 1) * SECTOR_SIZE > ISO_DIR_CACHE_MAX_SIZE)
+        return; // adresare jsou rozhazene po celem obrazu, nevyplati se to
+
+    DWORD blocks = last - first + 1;
+    DirCache = new char[blocks * SECTOR_SIZE];
+    if (DirCache == NULL)
+        return;
+    if (Image->ReadBlock(first, blocks * SECTOR_SIZE, DirCache) != blocks * SECTOR_SIZE)
+    {
+        FreeDirCache();
+        return;
+    }
+    DirCacheBlock = first;
+    DirCacheBlocks = blocks;
+}
+
+void CISO9660::FreeDirCache()
+{
+    if (DirCache != NULL)
+    {
+        delete[] DirCache;
+        DirCache = NULL;
+    }
+    DirCacheBlock = 0;
+    DirCacheBlocks = 0;
 }
 
 //
@@ -453,7 +537,10 @@ int CISO9660::ListDirectoryRe(char* path, CDirectoryRecord* root,
         return ERR_TERMINATE;
     }
 
-    if (Image->ReadBlock(block, size, data) != (DWORD)size)
+    DWORD sectors = ((DWORD)size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+    if (DirCache != NULL && block >= DirCacheBlock && block - DirCacheBlock + sectors <= DirCacheBlocks)
+        memcpy(data, DirCache + (block - DirCacheBlock) * SECTOR_SIZE, size); // adresar uz je nacteny
+    else if (Image->ReadBlock(block, size, data) != (DWORD)size)
     {
         delete[] data;
         Error(IDS_ERROR_LISTING_IMAGE, FALSE, block);
@@ -590,7 +677,7 @@ int CISO9660::UnpackFile(CSalamanderForOperationsAbstract* salamander, const cha
     HANDLE hFile = SalamanderSafeFile->SafeFileCreate(name, GENERIC_WRITE, FILE_SHARE_READ, attrs, FALSE,
                                                       SalamanderGeneral->GetMainWindowHWND(), nameInArc, fileInfo,
                                                       &silent, TRUE, &toSkip, NULL, 0, NULL, NULL);
-    CBufferedFile file(hFile, GENERIC_WRITE);
+    CBufferedFile file(hFile, GENERIC_WRITE, ISO_UNPACK_SECTORS * SECTOR_SIZE);
     // set file time
     file.SetFileTime(&ft, &ft, &ft);
 
@@ -611,8 +698,10 @@ int CISO9660::UnpackFile(CSalamanderForOperationsAbstract* salamander, const cha
     DWORD block = fp->Extent - ExtentOffset;
     CQuadWord remain = fileData->Size;
     DWORD sectorUserSize = 0x800;
-    DWORD nbytes = sectorUserSize;
-    BYTE* buffer = new BYTE[sectorUserSize];
+    // cteme vic sektoru najednou, aby se mene volalo ReadBlock() a zapisovalo po vetsich blocich
+    DWORD bufferSize = ISO_UNPACK_SECTORS * sectorUserSize;
+    DWORD nbytes = bufferSize;
+    BYTE* buffer = new BYTE[bufferSize];
     if (!buffer)
     {
         Error(IDS_INSUFFICIENT_MEMORY);
@@ -628,7 +717,8 @@ int CISO9660::UnpackFile(CSalamanderForOperationsAbstract* salamander, const cha
         if (remain.Value < nbytes)
             nbytes = remain.LoDWord; // !!! velikost bufferu nesmi byt vetsi nez DWORD
 
-        if (!Image->ReadBlock(block, sectorUserSize, buffer))
+        DWORD sectors = (nbytes + sectorUserSize - 1) / sectorUserSize;
+        if (!Image->ReadBlock(block, sectors * sectorUserSize, buffer))
         {
             if (silent == 0)
             {
@@ -656,7 +746,7 @@ int CISO9660::UnpackFile(CSalamanderForOperationsAbstract* salamander, const cha
             break;
         }
 
-        block++;
+        block += sectors;
 
         if (!salamander->ProgressAddSize(nbytes, TRUE)) // delayedPaint==TRUE, abychom nebrzdili
         {
@@ -710,6 +800,12 @@ int CISO9660::UnpackFile(CSalamanderForOperationsAbstract* salamander, const cha
     return ret;
 }
 
+ULONGLONG CISO9660::GetFileDataPos(const CFileData* fileData)
+{
+    CISOImage::CFilePos* fp = (CISOImage::CFilePos*)fileData->PluginData;
+    return fp != NULL ? fp->Extent : (ULONGLONG)-1;
+}
+
 BOOL CISO9660::DumpInfo(FILE* outStream)
 {
     char* s;
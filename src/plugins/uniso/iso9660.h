@@ -18,6 +18,9 @@
 
 #define ISO_MAX_PATH_LEN 1024
 
+#define ISO_UNPACK_SECTORS 64                     // pocet sektoru ctenych najednou pri rozbalovani
+#define ISO_DIR_CACHE_MAX_SIZE (16 * 1024 * 1024) // max. velikost oblasti s adresari nactene najednou pri listovani
+
 class CISO9660 : public CUnISOFSAbstract
 {
 protected:
@@ -266,6 +269,10 @@ protected:
     DWORD ExtentOffset;
     CBootRecordInfo* BootRecordInfo;
 
+    char* DirCache;       // sektory s adresari nactene pred listovanim (viz PrefetchDirectories()), NULL = nejsou
+    DWORD DirCacheBlock;  // prvni sektor v DirCache
+    DWORD DirCacheBlocks; // pocet sektoru v DirCache
+
 public:
     //    CISO9660();
     //    CISO9660(CISOImage *image, EExt ext, BYTE *root, WORD LogicalBlockSize);
@@ -286,6 +293,7 @@ public:
     ///    virtual int UnpackFile(CSalamanderForOperationsAbstract *salamander, HANDLE outFile, CQuadWord fileSize, DWORD block, BOOL &whole);
     virtual int UnpackFile(CSalamanderForOperationsAbstract* salamander, const char* srcPath, const char* path,
                            const char* nameInArc, const CFileData* fileData, DWORD& silent, BOOL& toSkip);
+    virtual ULONGLONG GetFileDataPos(const CFileData* fileData);
 
 protected:
     void FillDirectoryRecord(CDirectoryRecord& root, BYTE bytes[]);
@@ -293,6 +301,8 @@ protected:
 
     int ListDirectoryRe(char* path, CDirectoryRecord* root,
                         CSalamanderDirectoryAbstract* dir, CPluginDataInterfaceAbstract*& pluginData);
+    void PrefetchDirectories();
+    void FreeDirCache();
 
     void ConvJolietName(char* dest, const char* src, int nLen);
 
@@ -155,7 +155,8 @@ void CISOImage::Track::SetLabel(const char*)
 }
 
 CISOImage::CISOImage() : Session(10, 5),
-                         Tracks(30, 10, dtDelete)
+                         Tracks(30, 10, dtDelete),
+                         ExtractPlan(100, 1000, dtDelete)
 {
     FileName = NULL;
     File = NULL;
@@ -878,7 +879,10 @@ BOOL CISOImage::Open(const char* fileName, BOOL quiet /* = FALSE*/)
         else
         {
             // If an error occured, CBufferedFile will complain soon...
-            File = new CBufferedFile(hFile, GENERIC_READ);
+            CBufferedFile* bufferedFile = new CBufferedFile(hFile, GENERIC_READ, IMAGE_READ_BUFFER_SIZE);
+            if (bufferedFile)
+                bufferedFile->EnableReadAhead(); // cteni obrazu se prekryva se zapisem rozbalovanych souboru
+            File = bufferedFile;
         }
     }
 
@@ -1293,6 +1297,10 @@ CISOImage::ReadBlock(DWORD block, DWORD size, void* data)
 {
     SLOW_CALL_STACK_MESSAGE4("CISOImage::ReadBlock(%u, %u, 0x%p)", block, size, data);
 
+    // sektory bez hlavicek lezi v obrazu za sebou, cteme je najednou
+    if (SectorHeaderSize == 0 && SectorRawSize == SectorUserSize)
+        return ReadDataByPos(GetSectorOffset(block), size, data) == size ? size : 0;
+
     char sectorStat[0x8000];
     char* sector = SectorUserSize <= sizeof(sectorStat) ? sectorStat : new char[SectorUserSize]; // nemuze selhat (viz allochan.* v Salamanderovi)
 
@@ -1494,22 +1502,28 @@ int CISOImage::ExtractAllItems(CSalamanderForOperationsAbstract* salamander, cha
 {
     CALL_STACK_MESSAGE7("CISOImage::ExtractAllItems(, %s, , %s, %s, %d, %u, %d)", srcPath, mask, path, pathBufSize, silent, toSkip);
 
+    // nejdriv vytvorime adresare a posbirame soubory, pak je vybalime v poradi podle pozice v obrazu
+    int ret = PlanAllItems(salamander, srcPath, dir, mask, path, pathBufSize);
+    if (ret != UNPACK_CANCEL)
+        ret = UnpackExtractPlan(salamander, silent, toSkip, NULL);
+    ClearExtractPlan();
+    return ret;
+}
+
+int CISOImage::PlanAllItems(CSalamanderForOperationsAbstract* salamander, char* srcPath,
+                            CSalamanderDirectoryAbstract const* dir, const char* mask,
+                            char* path, int pathBufSize)
+{
+    CALL_STACK_MESSAGE5("CISOImage::PlanAllItems(, %s, , %s, %s, %d)", srcPath, mask, path, pathBufSize);
+
     int count = dir->GetFilesCount();
     int i;
     for (i = 0; i < count; i++)
     {
         CFileData const* file = dir->GetFile(i);
-        //    TRACE_I("EnumAllItems(): file: " << path << (path[0] != 0 ? "\\" : "") << file->Name);
-        salamander->ProgressDialogAddText(file->Name, TRUE); // delayedPaint==TRUE, abychom nebrzdili
-
-        salamander->ProgressSetSize(CQuadWord(0, 0), CQuadWord(-1, -1), TRUE);
-        salamander->ProgressSetTotalSize(file->Size + CQuadWord(1, 0), CQuadWord(-1, -1));
-
         if (SalamanderGeneral->AgreeMask(file->Name, mask, file->Ext[0] != 0))
         {
-            //      SalamanderGeneral->CheckAndCreateDirectory(path);
-            if (UnpackFile(salamander, srcPath, path, file, silent, toSkip) == UNPACK_CANCEL ||
-                !salamander->ProgressAddSize(1, TRUE))
+            if (!AddToExtractPlan(srcPath, path, file))
                 return UNPACK_CANCEL;
         }
     } // for
@@ -1532,7 +1546,7 @@ int CISOImage::ExtractAllItems(CSalamanderForOperationsAbstract* salamander, cha
 
         CSalamanderDirectoryAbstract const* subDir = dir->GetSalDir(j);
         SalamanderGeneral->SalPathAppend(srcPath, file->Name, ISO_MAX_PATH_LEN);
-        if (ExtractAllItems(salamander, srcPath, subDir, mask, path, pathBufSize, silent, toSkip) == UNPACK_CANCEL)
+        if (PlanAllItems(salamander, srcPath, subDir, mask, path, pathBufSize) == UNPACK_CANCEL)
             return UNPACK_CANCEL;
 
         srcPath[srcPathLen] = '\0';
@@ -1542,6 +1556,140 @@ int CISOImage::ExtractAllItems(CSalamanderForOperationsAbstract* salamander, cha
     return UNPACK_OK;
 }
 
+//
+// planovani vybalovani
+//
+
+CISOImage::CExtractItem::CExtractItem()
+{
+    SrcPath = NULL;
+    Path = NULL;
+    FileData = NULL;
+    DataPos = 0;
+    Order = 0;
+}
+
+CISOImage::CExtractItem::~CExtractItem()
+{
+    delete[] SrcPath;
+    delete[] Path;
+}
+
+ULONGLONG
+CISOImage::GetFileDataPos(const CFileData* fileData)
+{
+    CFilePos* fp = (CFilePos*)fileData->PluginData;
+    if (fp == NULL)
+        return (ULONGLONG)-1; // audio track
+
+    BYTE track = GetTrackFromExtent(fp->Extent);
+    if (!OpenTrack(track, TRUE) || Tracks[track]->FileSystem == NULL)
+        return (ULONGLONG)-1; // chybu ohlasi az UnpackFile()
+    return Tracks[track]->FileSystem->GetFileDataPos(fileData);
+}
+
+BOOL CISOImage::AddToExtractPlan(const char* srcPath, const char* path, const CFileData* fileData)
+{
+    CALL_STACK_MESSAGE3("CISOImage::AddToExtractPlan(%s, %s, )", srcPath, path);
+
+    CExtractItem* item = new CExtractItem;
+    if (item == NULL)
+        return Error(IDS_INSUFFICIENT_MEMORY);
+    item->SrcPath = new char[strlen(srcPath) + 1];
+    item->Path = new char[strlen(path) + 1];
+    if (item->SrcPath == NULL || item->Path == NULL)
+    {
+        delete item;
+        return Error(IDS_INSUFFICIENT_MEMORY);
+    }
+    strcpy(item->SrcPath, srcPath);
+    strcpy(item->Path, path);
+    item->FileData = fileData;
+    item->DataPos = GetFileDataPos(fileData);
+    item->Order = ExtractPlan.Count;
+
+    ExtractPlan.Add(item);
+    if (!ExtractPlan.IsGood())
+    {
+        ExtractPlan.ResetState();
+        delete item;
+        return Error(IDS_INSUFFICIENT_MEMORY);
+    }
+    return TRUE;
+}
+
+int CISOImage::CompareExtractItems(const CExtractItem* a, const CExtractItem* b)
+{
+    if (a->DataPos != b->DataPos)
+        return a->DataPos < b->DataPos ? -1 : 1;
+    return a->Order - b->Order;
+}
+
+void CISOImage::SortExtractPlan(int left, int right)
+{
+    int i = left, j = right;
+    CExtractItem* pivot = ExtractPlan[(i + j) / 2];
+
+    do
+    {
+        while (CompareExtractItems(ExtractPlan[i], pivot) < 0 && i < right)
+            i++;
+        while (CompareExtractItems(pivot, ExtractPlan[j]) < 0 && j > left)
+            j--;
+
+        if (i <= j)
+        {
+            CExtractItem* swap = ExtractPlan[i];
+            ExtractPlan[i] = ExtractPlan[j];
+            ExtractPlan[j] = swap;
+            i++;
+            j--;
+        }
+    } while (i <= j);
+
+    if (left < j)
+        SortExtractPlan(left, j);
+    if (i < right)
+        SortExtractPlan(i, right);
+}
+
+int CISOImage::UnpackExtractPlan(CSalamanderForOperationsAbstract* salamander, DWORD& silent, BOOL& toSkip,
+                                 BOOL* audioEncountered)
+{
+    CALL_STACK_MESSAGE3("CISOImage::UnpackExtractPlan(, %u, %d, )", silent, toSkip);
+
+    if (ExtractPlan.Count > 1)
+        SortExtractPlan(0, ExtractPlan.Count - 1);
+
+    int ret = UNPACK_OK;
+    int i;
+    for (i = 0; i < ExtractPlan.Count; i++)
+    {
+        CExtractItem* item = ExtractPlan[i];
+        salamander->ProgressDialogAddText(item->FileData->Name, TRUE); // delayedPaint==TRUE, abychom nebrzdili
+
+        salamander->ProgressSetSize(CQuadWord(0, 0), CQuadWord(-1, -1), TRUE);
+        salamander->ProgressSetTotalSize(item->FileData->Size + CQuadWord(1, 0), CQuadWord(-1, -1));
+
+        int err = UnpackFile(salamander, item->SrcPath, item->Path, item->FileData, silent, toSkip);
+
+        if (err == UNPACK_AUDIO_UNSUP && audioEncountered != NULL && !*audioEncountered)
+        {
+            *audioEncountered = TRUE;
+            Error(IDS_AUDIO_NOT_EXTRACTABLE);
+        }
+
+        if (err == UNPACK_CANCEL || !salamander->ProgressAddSize(1, TRUE)) // correction for zero-sized files
+        {
+            ret = UNPACK_CANCEL;
+            break;
+        }
+    }
+
+    ClearExtractPlan();
+    return ret;
+}
+
 CISOImage::Track*
 CISOImage::GetTrack(int track)
 {
@@ -28,6 +28,9 @@ class CUnISOFSAbstract;
 
 #define ISO_MAX_PATH_LEN 1024
 
+// velikost bufferu pro cteni obrazu (CBufferedFile), sekvencni cteni plni cely buffer
+#define IMAGE_READ_BUFFER_SIZE (2 * 1024 * 1024)
+
 // ****************************************************************************
 //
 // CISOImage
@@ -134,8 +137,24 @@ protected:
     TIndirectArray<Track> Tracks; // tracky
     TDirectArray<int> Session;    // pocet tracku v session
 
+    // polozka planu vybalovani (viz AddToExtractPlan())
+    struct CExtractItem
+    {
+        char* SrcPath;             // cesta v obrazu
+        char* Path;                // cilovy adresar
+        const CFileData* FileData; // vybalovany soubor
+        ULONGLONG DataPos;         // pozice dat v obrazu (viz CUnISOFSAbstract::GetFileDataPos())
+        int Order;                 // poradi pridani, pri shodne pozici se zachova
+
+        CExtractItem();
+        ~CExtractItem();
+    };
+
+    TIndirectArray<CExtractItem> ExtractPlan; // soubory cekajici na vybaleni
+
 public:
     DWORD ReadBlock(DWORD block, DWORD size, void* data);
+    DWORD GetSectorUserSize() { return SectorUserSize; }
 
     // Otevre ISO image s nazev 'fileName'. Parametr 'quiet' urcuje, zda
     // budou vyskakovat MessageBoxy s chybama
@@ -150,6 +169,16 @@ public:
     // vracit jednu z konstant UNPACK_XXX
     int UnpackDir(const char* dirName, const CFileData* fileData);
 
+    // vybalovani vice souboru najednou: soubory se nejdriv pridaji do planu (pritom se zjisti pozice
+    // jejich dat v obrazu), UnpackExtractPlan() je pak vybali serazene podle pozice, aby se obraz
+    // cetl popredu a ne na preskacku v poradi oznaceni v panelu
+    BOOL AddToExtractPlan(const char* srcPath, const char* path, const CFileData* fileData);
+    // vracit jednu z konstant UNPACK_XXX; 'audioEncountered' (muze byt NULL) - pri prvnim audio
+    // tracku se zobrazi hlaska a nastavi se na TRUE
+    int UnpackExtractPlan(CSalamanderForOperationsAbstract* salamander, DWORD& silent, BOOL& toSkip,
+                          BOOL* audioEncountered);
+    void ClearExtractPlan() { ExtractPlan.DestroyMembers(); }
+
     // vracit jednu z konstant UNPACK_XXX
     int ExtractAllItems(CSalamanderForOperationsAbstract* salamander, char* srcPath, CSalamanderDirectoryAbstract const* dir,
                         const char* mask, char* path, int pathBufSize, DWORD& silent, BOOL& toSkip);
@@ -177,6 +206,12 @@ protected:
     DWORD ReadDataByPos(LONGLONG position, DWORD size, void* data);
     BOOL ListDirectory(char* path, int session, CSalamanderDirectoryAbstract* dir, CPluginDataInterfaceAbstract*& pluginData);
 
+    ULONGLONG GetFileDataPos(const CFileData* fileData);
+    void SortExtractPlan(int left, int right);
+    static int CompareExtractItems(const CExtractItem* a, const CExtractItem* b);
+    int PlanAllItems(CSalamanderForOperationsAbstract* salamander, char* srcPath, CSalamanderDirectoryAbstract const* dir,
+                     const char* mask, char* path, int pathBufSize);
+
     // support
     void DetectSectorType();
     BOOL SetSectorFormat(ESectorType format);
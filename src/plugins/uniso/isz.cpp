@@ -53,9 +53,7 @@ CISZFile::CISZFile(HANDLE hFile, BOOL quiet)
     pBlocks = NULL;
     nBlocks = 0;
     pCurBlock = 0;
-    memset(BlockCache, 0, sizeof(BlockCache));
     CurrentPos = FileSize = 0;
-    MRUCachedBlock = 0;
 
     posLo = SetFilePointer(hFile, 0, NULL, FILE_BEGIN);
     if (!ReadFile(hFile, &header, sizeof(header), &dwBytesRead, NULL) || (sizeof(header) != dwBytesRead))
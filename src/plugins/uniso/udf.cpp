@@ -1226,6 +1226,38 @@ int CUDF::UnpackFile(CSalamanderForOperationsAbstract* salamander, const char* s
     return ret;
 }
 
+ULONGLONG CUDF::GetFileDataPos(const CFileData* fileData)
+{
+    CALL_STACK_MESSAGE2("CUDF::GetFileDataPos(%p)", fileData);
+
+    CISOImage::CFilePos* fp = (CISOImage::CFilePos*)fileData->PluginData;
+    if (fp == NULL)
+        return (ULONGLONG)-1;
+
+    // data souboru mohou byt jinde nez jeho File Entry, pozici zjistime z prvniho alokovaneho extentu
+    BYTE fileEntry[SECTOR_SIZE];
+    DWORD lbNum = LogSector(fp->Extent - ExtentOffset, fp->Partition);
+    if (!ReadBlockLog(lbNum, 1, fileEntry))
+        return (ULONGLONG)-1;
+
+    CDescriptorTag tag;
+    ReadDescriptorTag(fileEntry, &tag);
+    if ((UDF_TAGID_FENTRY != tag.ID) && (UDF_TAGID_EXTFENTRY != tag.ID))
+        return (ULONGLONG)-1;
+
+    CICBTag icbTag;
+    CAD icbs[32];
+    int nicbs = ReadFileEntry(fileEntry, UDF_TAGID_EXTFENTRY == tag.ID, fp->Partition, &icbTag, icbs, sizeof(icbs) / sizeof(CAD));
+    int i;
+    for (i = 0; i < nicbs; i++)
+    {
+        if (UDF_EXT_ALLOCATED == icbs[i].Flags)
+            return (ULONGLONG)PD.Start + icbs[i].Location;
+    }
+    // data jsou primo ve File Entry (nicbs == -1) nebo soubor nema zadna data
+    return (ULONGLONG)PD.Start + lbNum;
+}
+
 BOOL CUDF::DumpInfo(FILE* outStream)
 {
     CALL_STACK_MESSAGE1("CUDF::DumpInfo( )");
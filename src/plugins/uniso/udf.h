@@ -251,6 +251,7 @@ public:
                                CSalamanderDirectoryAbstract* dir, CPluginDataInterfaceAbstract*& pluginData);
     virtual int UnpackFile(CSalamanderForOperationsAbstract* salamander, const char* srcPath, const char* path,
                            const char* nameInArc, const CFileData* fileData, DWORD& silent, BOOL& toSkip);
+    virtual ULONGLONG GetFileDataPos(const CFileData* fileData);
 
 protected:
     BOOL ReadBlockPhys(Uint32 lbNumber, size_t blocks, unsigned char* data);
@@ -192,6 +192,28 @@ int CUDFISO::UnpackFile(CSalamanderForOperationsAbstract* salamander, const char
     }
 }
 
+ULONGLONG CUDFISO::GetFileDataPos(const CFileData* fileData)
+{
+    CISOImage::CFilePos* fp = (CISOImage::CFilePos*)fileData->PluginData;
+    if (fp == NULL)
+        return (ULONGLONG)-1;
+
+    switch (fp->Type)
+    {
+    case FS_TYPE_ISO9660:
+        return ISO->GetFileDataPos(fileData);
+
+    case FS_TYPE_UDF:
+        return UDF->GetFileDataPos(fileData);
+
+    case FS_TYPE_HFS:
+        return HFS->GetFileDataPos(fileData);
+
+    default:
+        return (ULONGLONG)-1;
+    }
+}
+
 BOOL CUDFISO::DumpInfo(FILE* outStream)
 {
     CALL_STACK_MESSAGE1("CUDFISO::DumpInfo( )");
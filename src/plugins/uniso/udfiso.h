@@ -34,4 +34,5 @@ public:
                                CSalamanderDirectoryAbstract* dir, CPluginDataInterfaceAbstract*& pluginData);
     virtual int UnpackFile(CSalamanderForOperationsAbstract* salamander, const char* srcPath, const char* path,
                            const char* nameInArc, const CFileData* fileData, DWORD& silent, BOOL& toSkip);
+    virtual ULONGLONG GetFileDataPos(const CFileData* fileData);
 };
@@ -45,6 +45,9 @@ CSalamanderGUIAbstract* SalamanderGUI = NULL;
 // definice promenne pro "spl_com.h"
 int SalamanderVersion = 0;
 
+// fronta threadu pro dekodovani bloku komprimovanych obrazu dopredu (viz CBlockedFile)
+CThreadQueue ThreadQueue("UnISO Read-Ahead");
+
 int ConfigVersion = 0;
 #define CURRENT_CONFIG_VERSION 6
 const char* CONFIG_VERSION = "Version";
@@ -63,6 +66,7 @@ int SortByExtDirsAsFiles = FALSE; // aktualni hodnota konfiguracni promenne Sala
 const char* CONFIG_CLEAR_READONLY = "Clear Read Only";
 const char* CONFIG_SESSION_AS_DIR = "Show Session As Directory";
 const char* CONFIG_BOOTIMAGE_AS_FILE = "Show Boot Image As File";
+const char* CONFIG_DECODED_CACHE_SIZE = "Decoded Blocks Cache Size";
 
 BOOL WINAPI DllMain(HINSTANCE hinstDLL, DWORD fdwReason, LPVOID lpvReserved)
 {
@@ -244,6 +248,8 @@ BOOL CPluginInterface::Release(HWND parent, BOOL force)
 {
     CALL_STACK_MESSAGE2("CPluginInterface::Release(, %d)", force);
 
+    ThreadQueue.KillAll(TRUE); // read-ahead thready konci se zavrenim obrazu, tohle je jen pojistka
+
     ReleaseWinLib(DLLInstance);
 
     return TRUE;
@@ -267,12 +273,14 @@ void CPluginInterface::LoadConfiguration(HWND parent, HKEY regKey, CSalamanderRe
     Options.ClearReadOnly = TRUE;
     Options.SessionAsDirectory = TRUE; // implicitne ukazeme, jak jsme dobry (muzou si to pripadne vypnout)
     Options.BootImageAsFile = TRUE;    // implicitne ukazujeme boot image (muzou si to pripadne vypnout)
+    Options.DecodedCacheSize = 64;     // v MB, nastavuje se jen v registry
 
     if (regKey != NULL) // load z registry
     {
         registry->GetValue(regKey, CONFIG_CLEAR_READONLY, REG_DWORD, &Options.ClearReadOnly, sizeof(DWORD));
         registry->GetValue(regKey, CONFIG_SESSION_AS_DIR, REG_DWORD, &Options.SessionAsDirectory, sizeof(DWORD));
         registry->GetValue(regKey, CONFIG_BOOTIMAGE_AS_FILE, REG_DWORD, &Options.BootImageAsFile, sizeof(DWORD));
+        registry->GetValue(regKey, CONFIG_DECODED_CACHE_SIZE, REG_DWORD, &Options.DecodedCacheSize, sizeof(DWORD));
     }
 }
 
@@ -286,6 +294,7 @@ void CPluginInterface::SaveConfiguration(HWND parent, HKEY regKey, CSalamanderRe
     registry->SetValue(regKey, CONFIG_CLEAR_READONLY, REG_DWORD, &Options.ClearReadOnly, sizeof(DWORD));
     registry->SetValue(regKey, CONFIG_SESSION_AS_DIR, REG_DWORD, &Options.SessionAsDirectory, sizeof(DWORD));
     registry->SetValue(regKey, CONFIG_BOOTIMAGE_AS_FILE, REG_DWORD, &Options.BootImageAsFile, sizeof(DWORD));
+    registry->SetValue(regKey, CONFIG_DECODED_CACHE_SIZE, REG_DWORD, &Options.DecodedCacheSize, sizeof(DWORD));
 }
 
 void CPluginInterface::Configuration(HWND parent)
@@ -543,8 +552,6 @@ BOOL CPluginInterfaceForArchiver::UnpackArchive(CSalamanderForOperationsAbstract
                 }
                 else
                 {
-                    salamander->ProgressDialogAddText(name, TRUE); // delayedPaint==TRUE, abychom nebrzdili
-
                     //  pokud neexistuje cesta kam rozbalujeme -> vytvorit ji
                     char* lastComp = strrchr(destPath, '\\');
                     if (lastComp != NULL)
@@ -553,18 +560,8 @@ BOOL CPluginInterfaceForArchiver::UnpackArchive(CSalamanderForOperationsAbstract
                         SalamanderGeneral->CheckAndCreateDirectory(destPath);
                     } // if
 
-                    salamander->ProgressSetSize(CQuadWord(0, 0), CQuadWord(-1, -1), TRUE);
-                    salamander->ProgressSetTotalSize(fileData->Size + CQuadWord(1, 0), CQuadWord(-1, -1));
-
-                    int err = isoImage.UnpackFile(salamander, currentISOPath, destPath, fileData, silent, toSkip);
-
-                    if ((UNPACK_AUDIO_UNSUP == err) && !bAudioEncountered)
-                    {
-                        bAudioEncountered = TRUE;
-                        Error(IDS_AUDIO_NOT_EXTRACTABLE);
-                    }
-
-                    if (err == UNPACK_CANCEL || !salamander->ProgressAddSize(1, TRUE)) // correction for zero-sized files
+                    // soubory se vybali az po projiti vyberu, serazene podle pozice v obrazu
+                    if (!isoImage.AddToExtractPlan(currentISOPath, destPath, fileData))
                     {
                         ret = FALSE;
                         break;
@@ -579,6 +576,10 @@ BOOL CPluginInterfaceForArchiver::UnpackArchive(CSalamanderForOperationsAbstract
             }
         } // while
 
+        if (ret)
+            ret = isoImage.UnpackExtractPlan(salamander, silent, toSkip, &bAudioEncountered) != UNPACK_CANCEL;
+        isoImage.ClearExtractPlan();
+
         salamander->CloseProgressDialog();
     }
 
@@ -148,10 +148,13 @@ struct COptions
     BOOL ClearReadOnly;      // Clear read-only attribute when copying from archive
     BOOL SessionAsDirectory; // Show session as directory (allow access to all sessions)
     BOOL BootImageAsFile;    // Show boot image disk as file
+    DWORD DecodedCacheSize;  // Memory for decoded blocks of compressed images (DMG, ISZ) in MB
 };
 
 extern COptions Options; // konfigurace
 
+extern CThreadQueue ThreadQueue; // read-ahead thready CBlockedFile
+
 char* LoadStr(int resID);
 void GetInfo(char* buffer, FILETIME* lastWrite, unsigned size);
 BOOL Error(int resID, BOOL quiet = FALSE, ...);
@@ -8,6 +8,9 @@
 #include "regparse.h"
 
 #define REG_MAX_KEY_NAME_LEN 256
+#ifndef NAME_HASH_MIN_COUNT     // can be overridden to measure linear search, see tester.cpp
+#define NAME_HASH_MIN_COUNT 16 // keys with fewer subkeys/values are searched linearly
+#endif
 
 BOOL StrEndsWith(LPCTSTR txt, LPCTSTR pattern, size_t patternLen);
 
@@ -33,6 +36,52 @@ namespace RegLib
         VT_INVALID = -1
     } eVT_VALUE_TYPE;
 
+    // Hash index of names of subkeys or values of a key: maps name (case-insensitive) to
+    // index in SubKeys or Values. It is built in CKey::GetKey/GetValue for keys with at
+    // least NAME_HASH_MIN_COUNT items, updated when item is added to the end of list and
+    // dropped when item is removed (indexes of following items change).
+    class CNameHash
+    {
+    public:
+        CNameHash()
+        {
+            Slots = NULL;
+            Mask = 0;
+            Used = 0;
+        }
+        ~CNameHash() { Invalidate(); }
+
+        static DWORD HashName(LPCTSTR name);
+
+        BOOL IsValid() { return Slots != NULL; }
+        void Invalidate();
+
+        // allocates empty index for 'count' names, returns FALSE on lack of memory
+        BOOL Init(int count);
+        // adds 'name' with 'index'; if index is full, it is dropped (rebuilt on next lookup)
+        void Add(LPCTSTR name, int index);
+
+        // returns index of first/next item with hash 'hash' (it must be compared by name),
+        // -1 = no more items; 'pos' is search state
+        int FindFirst(DWORD hash, DWORD& pos)
+        {
+            pos = hash & Mask;
+            return FindNext(hash, pos);
+        }
+        int FindNext(DWORD hash, DWORD& pos);
+
+    private:
+        struct CSlot
+        {
+            int Index; // index of item + 1, 0 = empty slot
+            DWORD Hash;
+        };
+
+        CSlot* Slots;
+        DWORD Mask; // count of slots - 1 (count of slots is power of two)
+        int Used;
+    };
+
     class CValue
     {
     public:
@@ -65,6 +114,8 @@ namespace RegLib
         int nCount;
         TKeyList SubKeys;
         TValueList Values;
+        CNameHash SubKeysHash; // valid only for keys with many subkeys, see CNameHash
+        CNameHash ValuesHash;  // valid only for keys with many values, see CNameHash
 
         CKey(CKey* parent, LPCTSTR name);
         ~CKey();
@@ -76,6 +127,7 @@ namespace RegLib
 
         BOOL RemoveValue(CValue* pChild);
         CValue* GetValue(LPCTSTR name);
+        BOOL AddValue(CValue& value); // adds value (see CValue), returns FALSE on lack of memory
 
         BOOL Clear();
 
@@ -208,6 +260,77 @@ namespace RegLib
         return TRUE;
     }
 
+    //////////////////////////// CNameHash ////////////////////////////
+
+    DWORD CNameHash::HashName(LPCTSTR name)
+    {
+        // FNV-1a; only ASCII letters are case-folded, all other non-ASCII characters have
+        // the same hash because _tcsicmp can fold them depending on current locale
+        DWORD hash = 2166136261;
+        for (; *name; name++)
+        {
+            unsigned c = (_TUCHAR)*name;
+            if (c >= 'A' && c <= 'Z')
+                c += 'a' - 'A';
+            else if (c >= 0x80)
+                c = 0x80;
+            hash = (hash ^ c) * 16777619;
+        }
+        return hash;
+    }
+
+    void CNameHash::Invalidate()
+    {
+        if (Slots)
+            free(Slots);
+        Slots = NULL;
+        Mask = 0;
+        Used = 0;
+    }
+
+    BOOL CNameHash::Init(int count)
+    {
+        Invalidate();
+        DWORD size = 16;
+        while (size < (DWORD)count * 4) // at most quarter full after build, rebuilt when half full
+            size *= 2;
+        Slots = (CSlot*)calloc(size, sizeof(CSlot));
+        if (!Slots)
+            return FALSE;
+        Mask = size - 1;
+        return TRUE;
+    }
+
+    void CNameHash::Add(LPCTSTR name, int index)
+    {
+        if (!Slots)
+            return;
+        if ((DWORD)(Used + 1) * 2 > Mask + 1)
+        {
+            Invalidate(); // full, rebuilt larger on next lookup
+            return;
+        }
+        DWORD hash = HashName(name);
+        DWORD pos = hash & Mask;
+        while (Slots[pos].Index)
+            pos = (pos + 1) & Mask;
+        Slots[pos].Index = index + 1;
+        Slots[pos].Hash = hash;
+        Used++;
+    }
+
+    int CNameHash::FindNext(DWORD hash, DWORD& pos)
+    {
+        while (Slots[pos].Index)
+        {
+            CSlot* slot = &Slots[pos];
+            pos = (pos + 1) & Mask;
+            if (slot->Hash == hash)
+                return slot->Index - 1;
+        }
+        return -1;
+    }
+
     //////////////////////////// CValue ////////////////////////////
 
     CValue::CValue(LPCTSTR name, eVT_VALUE_TYPE type, LPCVOID data, DWORD size)
@@ -300,6 +423,7 @@ namespace RegLib
         if (pParent)
         {
             pParent->SubKeys.Add(this);
+            pParent->SubKeysHash.Add(Name, pParent->SubKeys.Count - 1);
         }
         nCount = 1;
     }
@@ -335,6 +459,7 @@ namespace RegLib
             if (SubKeys[i] == pChild)
             {
                 SubKeys.Detach(i);
+                SubKeysHash.Invalidate();
                 return TRUE;
             }
         }
@@ -344,6 +469,24 @@ namespace RegLib
     CKey* CKey::GetKey(LPCTSTR name)
     {
         int i;
+        if (SubKeys.Count >= NAME_HASH_MIN_COUNT)
+        {
+            if (!SubKeysHash.IsValid() && SubKeysHash.Init(SubKeys.Count))
+            {
+                for (i = 0; i < SubKeys.Count; i++)
+                    SubKeysHash.Add(SubKeys[i]->Name, i);
+            }
+            if (SubKeysHash.IsValid())
+            {
+                DWORD hash = CNameHash::HashName(name), pos;
+                for (i = SubKeysHash.FindFirst(hash, pos); i >= 0; i = SubKeysHash.FindNext(hash, pos))
+                {
+                    if (!_tcsicmp(SubKeys[i]->Name, name))
+                        return SubKeys[i];
+                }
+                return NULL;
+            }
+        }
         for (i = 0; i < SubKeys.Count; i++)
         {
             if (!_tcsicmp(SubKeys[i]->Name, name))
@@ -362,6 +505,7 @@ namespace RegLib
             if (&Values[i] == pChild)
             {
                 Values.Delete(i);
+                ValuesHash.Invalidate();
                 return TRUE;
             }
         }
@@ -371,6 +515,24 @@ namespace RegLib
     CValue* CKey::GetValue(LPCTSTR name)
     {
         int i;
+        if (Values.Count >= NAME_HASH_MIN_COUNT)
+        {
+            if (!ValuesHash.IsValid() && ValuesHash.Init(Values.Count))
+            {
+                for (i = 0; i < Values.Count; i++)
+                    ValuesHash.Add(Values[i].Name, i);
+            }
+            if (ValuesHash.IsValid())
+            {
+                DWORD hash = CNameHash::HashName(name), pos;
+                for (i = ValuesHash.FindFirst(hash, pos); i >= 0; i = ValuesHash.FindNext(hash, pos))
+                {
+                    if (!_tcsicmp(Values[i].Name, name))
+                        return &Values[i];
+                }
+                return NULL;
+            }
+        }
         for (i = 0; i < Values.Count; i++)
         {
             if (!_tcsicmp(Values[i].Name, name))
@@ -381,6 +543,19 @@ namespace RegLib
         return NULL;
     }
 
+    BOOL CKey::AddValue(CValue& value)
+    {
+        Values.Add(value);
+        if (!Values.IsGood())
+        {
+            Values.ResetState();
+            return FALSE;
+        }
+        value.Invalidate(); // All pointers were copied in Add() -> do not free them now
+        ValuesHash.Add(Values[Values.Count - 1].Name, Values.Count - 1);
+        return TRUE;
+    }
+
     BOOL CKey::Clear()
     {
         int i;
@@ -389,6 +564,7 @@ namespace RegLib
             SubKeys[i]->Release();
         }
         Values.DestroyMembers();
+        ValuesHash.Invalidate();
         return TRUE;
     }
 
@@ -623,6 +799,7 @@ namespace RegLib
             if (::StrEndsWith(Values[i].Name, _T(".hidden"), SizeOf(_T(".hidden")) - 1))
             {
                 Values.Delete(i);
+                ValuesHash.Invalidate();
                 i--;
             }
         }
@@ -877,18 +1054,19 @@ namespace RegLib
         if (!pKey)
             return FALSE;
 
-        CValue* pValue = pKey->GetValue(name);
-        if (pValue)
-        {
-            pKey->RemoveValue(pValue);
-        }
-
         CValue value(name, (eVT_VALUE_TYPE)type, data, dataSize);
         if (value.IsOK())
         {
-            pKey->Values.Add(value);
-            value.Invalidate(); // All pointers were copied in Add() -> do not free them now
-            return TRUE;
+            CValue* pValue = pKey->GetValue(name);
+            if (pValue)
+            {
+                // Replace the value in place, index of values stays valid
+                CValue old = *pValue; // 'old' frees the previous name+data
+                *pValue = value;
+                value.Invalidate();
+                return TRUE;
+            }
+            return pKey->AddValue(value);
         }
         // Out of memory :-(
 
@@ -23,6 +23,8 @@ typedef enum eRPE_ERROR
     RPE_VALUE_STRING,
     RPE_VALUE_HEX,
     RPE_INVALID_MBCS,
+    RPE_SNAPSHOT_INVALID,
+    RPE_FILE_WRITE,
 } eRPE_ERROR;
 
 #ifdef UNICODE
@@ -54,14 +56,33 @@ public: // Methods added by Jan Patera
 #ifdef UNICODE
 #define REG_SysRegistryFactory REG_SysRegistryFactoryW
 #define REG_MemRegistryFactory REG_MemRegistryFactoryW
+#define REG_SnapshotRecorderFactory REG_SnapshotRecorderFactoryW
 #else
 #define REG_SysRegistryFactory REG_SysRegistryFactoryA
 #define REG_MemRegistryFactory REG_MemRegistryFactoryA
+#define REG_SnapshotRecorderFactory REG_SnapshotRecorderFactoryA
 #endif
 
 CSalamanderRegistryExAbstract* REG_SysRegistryFactory();
 CSalamanderRegistryExAbstract* REG_MemRegistryFactory();
 
+// Binary snapshot of .reg file: operations done by Parse() on registry (keys created, subtrees
+// deleted, values set) stored in compact binary form. LoadSnapshot() maps the snapshot file
+// and replays the operations without parsing text. The .reg file stays the only format for
+// import/export, snapshot is just a cache valid while the .reg file is not changed.
+
+// Returns registry which forwards all calls to 'pTarget' and records operations done by
+// Parse(); 'pTarget' is not released by Release() of returned registry
+CSalamanderRegistryExAbstract* REG_SnapshotRecorderFactory(CSalamanderRegistryExAbstract* pTarget);
+// Saves operations recorded by 'pRecorder' (from REG_SnapshotRecorderFactory) to 'snapshotName',
+// snapshot remembers size and time of last write of 'regFileName'
+eRPE_ERROR SaveSnapshot(CSalamanderRegistryExAbstract* pRecorder, LPCTSTR snapshotName, LPCTSTR regFileName);
+// Replays snapshot 'snapshotName' to 'pRegistry' (same result as Parse() of 'regFileName');
+// returns RPE_SNAPSHOT_INVALID without touching 'pRegistry' if snapshot does not exist, is
+// damaged or 'regFileName' was changed after SaveSnapshot()
+eRPE_ERROR LoadSnapshot(LPCTSTR snapshotName, LPCTSTR regFileName, CSalamanderRegistryExAbstract* pRegistry,
+                        BOOL doNotDeleteHiddenKeysAndValues);
+
 eRPE_ERROR Parse(LPTSTR buf, CSalamanderRegistryExAbstract* pRegistry, BOOL doNotDeleteHiddenKeysAndValues);
 eRPE_ERROR CopyBranch(LPCTSTR branch, CSalamanderRegistryExAbstract* pInRegistry, CSalamanderRegistryExAbstract* pOutRegistry);
 
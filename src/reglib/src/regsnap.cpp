@@ -0,0 +1,413 @@
+﻿// SPDX-FileCopyrightText: 2023 Open Salamander Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "precomp.h"
+
+#include <tchar.h>
+
+#include "regparse.h"
+
+// Snapshot file: CSnapshotHeader followed by stream of records (no alignment):
+//   SNAP_KEY:       BYTE op, BYTE root, DWORD nameLen, TCHAR name[nameLen]
+//   SNAP_DELETEKEY: BYTE op, BYTE root, DWORD nameLen, TCHAR name[nameLen]
+//   SNAP_VALUE:     BYTE op, DWORD type, DWORD nameLen, TCHAR name[nameLen], DWORD dataSize, BYTE data[dataSize]
+// SNAP_VALUE belongs to key from last SNAP_KEY, names are without terminating NUL.
+
+#define SNAP_SIGNATURE "SALREGS1"
+#define SNAP_MAX_NAME_LEN 4096 // longer names are not stored to snapshot (whole snapshot is not created)
+
+enum eSNAP_OP
+{
+    SNAP_KEY = 1,       // CreateKey() of key, values follow
+    SNAP_DELETEKEY = 2, // deleting of key subtree (see Parse())
+    SNAP_VALUE = 3,     // SetValue()
+};
+
+struct CSnapshotHeader
+{
+    char Signature[8];     // SNAP_SIGNATURE
+    DWORD CharSize;        // sizeof(TCHAR) of writer
+    DWORD DataSize;        // size of stream of records
+    DWORD DataChecksum;    // FNV-1a of stream of records
+    DWORD RegFileSizeLow;  // size of .reg file ...
+    DWORD RegFileSizeHigh; // ...
+    FILETIME RegFileTime;  // time of last write of .reg file
+};
+
+static const HKEY SnapshotRoots[] = {HKEY_CLASSES_ROOT, HKEY_CURRENT_USER, HKEY_LOCAL_MACHINE, HKEY_USERS,
+                                     HKEY_CURRENT_CONFIG, HKEY_DYN_DATA, HKEY_PERFORMANCE_DATA};
+
+static int GetSnapshotRoot(HKEY key)
+{
+    int i;
+    for (i = 0; i < SizeOf(SnapshotRoots); i++)
+    {
+        if (SnapshotRoots[i] == key)
+            return i;
+    }
+    return -1;
+}
+
+static DWORD SnapshotChecksum(const BYTE* data, DWORD size)
+{
+    DWORD hash = 2166136261;
+    while (size--)
+        hash = (hash ^ *data++) * 16777619;
+    return hash;
+}
+
+static BOOL GetRegFileStamp(LPCTSTR regFileName, CSnapshotHeader* hdr)
+{
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesEx(regFileName, GetFileExInfoStandard, &data))
+        return FALSE;
+    hdr->RegFileSizeLow = data.nFileSizeLow;
+    hdr->RegFileSizeHigh = data.nFileSizeHigh;
+    hdr->RegFileTime = data.ftLastWriteTime;
+    return TRUE;
+}
+
+//////////////////////////// CSnapshotRecorder ////////////////////////////
+
+class CSnapshotRecorder : public CSalamanderRegistryExAbstract
+{
+public:
+    CSnapshotRecorder(CSalamanderRegistryExAbstract* pTarget)
+    {
+        Target = pTarget;
+        Data = NULL;
+        Size = Allocated = 0;
+        Failed = FALSE;
+        CurKey = NULL;
+    }
+    virtual ~CSnapshotRecorder()
+    {
+        if (Data)
+            free(Data);
+    }
+
+    virtual BOOL WINAPI ClearKey(HKEY key) { return Target->ClearKey(key); }
+    virtual BOOL WINAPI CreateKey(HKEY key, LPCTSTR name, HKEY& createdKey);
+    virtual BOOL WINAPI OpenKey(HKEY key, LPCTSTR name, HKEY& openedKey);
+    virtual void WINAPI CloseKey(HKEY key);
+    virtual BOOL WINAPI DeleteKey(HKEY key, LPCTSTR name) { return Target->DeleteKey(key, name); }
+    virtual BOOL WINAPI GetValue(HKEY key, LPCTSTR name, DWORD type, LPVOID data, DWORD dataSize)
+    {
+        return Target->GetValue(key, name, type, data, dataSize);
+    }
+    virtual BOOL WINAPI SetValue(HKEY key, LPCTSTR name, DWORD type, LPCVOID data, DWORD dataSize);
+    virtual BOOL WINAPI DeleteValue(HKEY key, LPCTSTR name)
+    {
+        Failed = TRUE; // Parse() does not use it, it is not stored to snapshot
+        return Target->DeleteValue(key, name);
+    }
+    virtual BOOL WINAPI GetSize(HKEY key, LPCTSTR name, DWORD type, DWORD& bufferSize)
+    {
+        return Target->GetSize(key, name, type, bufferSize);
+    }
+
+    virtual BOOL WINAPI EnumKey(HKEY key, DWORD subKeyIndex, LPTSTR name, DWORD bufferSize)
+    {
+        return Target->EnumKey(key, subKeyIndex, name, bufferSize);
+    }
+    virtual BOOL WINAPI EnumValue(HKEY key, DWORD valIndex, LPTSTR name, DWORD nameSize, LPDWORD valType, LPBYTE data, LPDWORD dataSize)
+    {
+        return Target->EnumValue(key, valIndex, name, nameSize, valType, data, dataSize);
+    }
+
+    virtual void WINAPI RemoveHiddenKeysAndValues() { Target->RemoveHiddenKeysAndValues(); }
+    virtual BOOL WINAPI ClearKeyEx(HKEY key, BOOL doNotDeleteHiddenKeysAndValues, BOOL* keyIsNotEmpty)
+    {
+        return Target->ClearKeyEx(key, doNotDeleteHiddenKeysAndValues, keyIsNotEmpty);
+    }
+
+    virtual void WINAPI Release() { delete this; }
+    virtual BOOL WINAPI Dump(LPCTSTR fileName, LPCTSTR clearKeyName) { return Target->Dump(fileName, clearKeyName); }
+
+    eRPE_ERROR Save(LPCTSTR snapshotName, LPCTSTR regFileName);
+
+private:
+    CSalamanderRegistryExAbstract* Target;
+    LPBYTE Data; // stream of records
+    DWORD Size;
+    DWORD Allocated;
+    BOOL Failed; // operation which cannot be stored to snapshot was done (or lack of memory)
+    HKEY CurKey; // key from last SNAP_KEY (its values are recorded)
+
+    BOOL Write(LPCVOID data, DWORD size);
+    void RecordKey(eSNAP_OP op, HKEY root, LPCTSTR name);
+};
+
+BOOL CSnapshotRecorder::Write(LPCVOID data, DWORD size)
+{
+    if (Failed)
+        return FALSE;
+    if (Size + size > Allocated)
+    {
+        DWORD newSize = Allocated ? Allocated * 2 : 64 * 1024;
+        while (newSize < Size + size)
+            newSize *= 2;
+        LPBYTE newData = (LPBYTE)realloc(Data, newSize);
+        if (!newData)
+        {
+            Failed = TRUE;
+            return FALSE;
+        }
+        Data = newData;
+        Allocated = newSize;
+    }
+    memcpy(Data + Size, data, size);
+    Size += size;
+    return TRUE;
+}
+
+void CSnapshotRecorder::RecordKey(eSNAP_OP op, HKEY root, LPCTSTR name)
+{
+    int rootIndex = GetSnapshotRoot(root);
+    DWORD len = (DWORD)_tcslen(name);
+    if (rootIndex < 0 || len > SNAP_MAX_NAME_LEN)
+    {
+        Failed = TRUE; // Parse() opens keys only from root keys
+        return;
+    }
+    BYTE b[2] = {(BYTE)op, (BYTE)rootIndex};
+    if (Write(b, sizeof(b)) && Write(&len, sizeof(len)))
+        Write(name, len * sizeof(TCHAR));
+}
+
+BOOL CSnapshotRecorder::CreateKey(HKEY key, LPCTSTR name, HKEY& createdKey)
+{
+    if (!Target->CreateKey(key, name, createdKey))
+        return FALSE;
+    RecordKey(SNAP_KEY, key, name);
+    CurKey = createdKey;
+    return TRUE;
+}
+
+BOOL CSnapshotRecorder::OpenKey(HKEY key, LPCTSTR name, HKEY& openedKey)
+{
+    // Parse() opens key only to delete its subtree; it is recorded even if the key does
+    // not exist in 'Target', because it can exist in registry where snapshot is loaded
+    RecordKey(SNAP_DELETEKEY, key, name);
+    return Target->OpenKey(key, name, openedKey);
+}
+
+void CSnapshotRecorder::CloseKey(HKEY key)
+{
+    if (key == CurKey)
+        CurKey = NULL;
+    Target->CloseKey(key);
+}
+
+BOOL CSnapshotRecorder::SetValue(HKEY key, LPCTSTR name, DWORD type, LPCVOID data, DWORD dataSize)
+{
+    if (!Target->SetValue(key, name, type, data, dataSize))
+        return FALSE;
+    DWORD len = (DWORD)_tcslen(name);
+    if (key != CurKey || len > SNAP_MAX_NAME_LEN)
+    {
+        Failed = TRUE;
+        return TRUE;
+    }
+    if ((DWORD)-1 == dataSize) // string with computed length (see CSalamanderRegistryAbstract::SetValue)
+        dataSize = (DWORD)((_tcslen((LPCTSTR)data) + 1) * sizeof(TCHAR));
+    BYTE op = SNAP_VALUE;
+    if (Write(&op, sizeof(op)) && Write(&type, sizeof(type)) && Write(&len, sizeof(len)) &&
+        Write(name, len * sizeof(TCHAR)) && Write(&dataSize, sizeof(dataSize)))
+    {
+        Write(data, dataSize);
+    }
+    return TRUE;
+}
+
+eRPE_ERROR CSnapshotRecorder::Save(LPCTSTR snapshotName, LPCTSTR regFileName)
+{
+    if (Failed)
+        return RPE_SNAPSHOT_INVALID;
+
+    CSnapshotHeader hdr;
+    memcpy(hdr.Signature, SNAP_SIGNATURE, sizeof(hdr.Signature));
+    hdr.CharSize = sizeof(TCHAR);
+    hdr.DataSize = Size;
+    hdr.DataChecksum = SnapshotChecksum(Data, Size);
+    if (!GetRegFileStamp(regFileName, &hdr))
+        return RPE_SNAPSHOT_INVALID;
+
+    HANDLE hFile = CreateFile(snapshotName, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, 0);
+    if (INVALID_HANDLE_VALUE == hFile)
+        return RPE_FILE_WRITE;
+    DWORD nBytesWritten;
+    BOOL ret = WriteFile(hFile, &hdr, sizeof(hdr), &nBytesWritten, NULL) && (sizeof(hdr) == nBytesWritten) &&
+               (!Size || WriteFile(hFile, Data, Size, &nBytesWritten, NULL) && (Size == nBytesWritten));
+    CloseHandle(hFile);
+    if (!ret)
+    {
+        DeleteFile(snapshotName); // incomplete snapshot would be rejected anyway, do not leave it on disk
+        return RPE_FILE_WRITE;
+    }
+    return RPE_OK;
+}
+
+//////////////////////////// loading of snapshot ////////////////////////////
+
+// reads name with 'len' characters from 'data' to 'buf' (SNAP_MAX_NAME_LEN + 1 characters)
+static void ReadSnapshotName(const BYTE* data, DWORD len, LPTSTR buf)
+{
+    memcpy(buf, data, len * sizeof(TCHAR));
+    buf[len] = 0;
+}
+
+static eRPE_ERROR ReplaySnapshot(const BYTE* data, DWORD size, CSalamanderRegistryExAbstract* pRegistry,
+                                 BOOL doNotDeleteHiddenKeysAndValues)
+{
+    TCHAR name[SNAP_MAX_NAME_LEN + 1];
+    const BYTE* end = data + size;
+    HKEY hKey = NULL;
+    eRPE_ERROR ret = RPE_OK;
+
+    while (data < end)
+    {
+        BYTE op = *data++;
+        if (SNAP_KEY == op || SNAP_DELETEKEY == op)
+        {
+            DWORD len;
+            if ((DWORD)(end - data) < 1 + sizeof(len))
+            {
+                ret = RPE_SNAPSHOT_INVALID;
+                break;
+            }
+            BYTE rootIndex = *data++;
+            memcpy(&len, data, sizeof(len));
+            data += sizeof(len);
+            if (rootIndex >= SizeOf(SnapshotRoots) || len > SNAP_MAX_NAME_LEN || (DWORD)(end - data) < len * sizeof(TCHAR))
+            {
+                ret = RPE_SNAPSHOT_INVALID;
+                break;
+            }
+            ReadSnapshotName(data, len, name);
+            data += len * sizeof(TCHAR);
+
+            if (hKey)
+            {
+                pRegistry->CloseKey(hKey);
+                hKey = NULL;
+            }
+            HKEY hParentKey = SnapshotRoots[rootIndex];
+            if (SNAP_KEY == op)
+            {
+                if (!pRegistry->CreateKey(hParentKey, name, hKey))
+                {
+                    hKey = NULL;
+                    ret = RPE_KEY_CREATE;
+                    break;
+                }
+            }
+            else
+            {
+                // the same as deleting of key in Parse()
+                HKEY hDelKey;
+                if (pRegistry->OpenKey(hParentKey, name, hDelKey))
+                {
+                    BOOL keyIsNotEmpty = FALSE;
+                    pRegistry->ClearKeyEx(hDelKey, doNotDeleteHiddenKeysAndValues, &keyIsNotEmpty);
+                    pRegistry->CloseKey(hDelKey);
+                    if (!keyIsNotEmpty)
+                        pRegistry->DeleteKey(hParentKey, name);
+                }
+            }
+        }
+        else if (SNAP_VALUE == op)
+        {
+            DWORD type, len, dataSize;
+            if ((DWORD)(end - data) < sizeof(type) + sizeof(len))
+            {
+                ret = RPE_SNAPSHOT_INVALID;
+                break;
+            }
+            memcpy(&type, data, sizeof(type));
+            memcpy(&len, data + sizeof(type), sizeof(len));
+            data += sizeof(type) + sizeof(len);
+            if (len > SNAP_MAX_NAME_LEN || (DWORD)(end - data) < len * sizeof(TCHAR) + sizeof(dataSize))
+            {
+                ret = RPE_SNAPSHOT_INVALID;
+                break;
+            }
+            ReadSnapshotName(data, len, name);
+            data += len * sizeof(TCHAR);
+            memcpy(&dataSize, data, sizeof(dataSize));
+            data += sizeof(dataSize);
+            if ((DWORD)(end - data) < dataSize || !hKey)
+            {
+                ret = RPE_SNAPSHOT_INVALID;
+                break;
+            }
+            // data are passed directly from mapped file
+            if (!pRegistry->SetValue(hKey, name, type, data, dataSize))
+            {
+                ret = RPE_VALUE_SET;
+                break;
+            }
+            data += dataSize;
+        }
+        else
+        {
+            ret = RPE_SNAPSHOT_INVALID;
+            break;
+        }
+    }
+    if (hKey)
+        pRegistry->CloseKey(hKey);
+    return ret;
+}
+
+eRPE_ERROR LoadSnapshot(LPCTSTR snapshotName, LPCTSTR regFileName, CSalamanderRegistryExAbstract* pRegistry,
+                        BOOL doNotDeleteHiddenKeysAndValues)
+{
+    CSnapshotHeader stamp;
+    if (!GetRegFileStamp(regFileName, &stamp))
+        return RPE_SNAPSHOT_INVALID;
+
+    HANDLE hFile = CreateFile(snapshotName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, 0);
+    if (INVALID_HANDLE_VALUE == hFile)
+        return RPE_SNAPSHOT_INVALID;
+    eRPE_ERROR ret = RPE_SNAPSHOT_INVALID;
+    DWORD sizeHigh;
+    DWORD size = GetFileSize(hFile, &sizeHigh);
+    if (size != INVALID_FILE_SIZE && !sizeHigh && size >= sizeof(CSnapshotHeader))
+    {
+        HANDLE hMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (hMapping)
+        {
+            const BYTE* view = (const BYTE*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+            if (view)
+            {
+                const CSnapshotHeader* hdr = (const CSnapshotHeader*)view;
+                if (!memcmp(hdr->Signature, SNAP_SIGNATURE, sizeof(hdr->Signature)) &&
+                    hdr->CharSize == sizeof(TCHAR) &&
+                    hdr->DataSize == size - sizeof(CSnapshotHeader) &&
+                    hdr->RegFileSizeLow == stamp.RegFileSizeLow &&
+                    hdr->RegFileSizeHigh == stamp.RegFileSizeHigh &&
+                    CompareFileTime(&hdr->RegFileTime, &stamp.RegFileTime) == 0 &&
+                    hdr->DataChecksum == SnapshotChecksum(view + sizeof(CSnapshotHeader), hdr->DataSize))
+                {
+                    ret = ReplaySnapshot(view + sizeof(CSnapshotHeader), hdr->DataSize, pRegistry,
+                                         doNotDeleteHiddenKeysAndValues);
+                }
+                UnmapViewOfFile(view);
+            }
+            CloseHandle(hMapping);
+        }
+    }
+    CloseHandle(hFile);
+    return ret;
+}
+
+eRPE_ERROR SaveSnapshot(CSalamanderRegistryExAbstract* pRecorder, LPCTSTR snapshotName, LPCTSTR regFileName)
+{
+    return ((CSnapshotRecorder*)pRecorder)->Save(snapshotName, regFileName);
+}
+
+CSalamanderRegistryExAbstract* REG_SnapshotRecorderFactory(CSalamanderRegistryExAbstract* pTarget)
+{
+    return new CSnapshotRecorder(pTarget);
+}
@@ -8,6 +8,13 @@
 
 #include "regparse.h"
 
+// TDirectArray of Salamander (src/common/array.h) with growth policies; reglib uses its own
+// older copy of array.h, so this one is placed into its own namespace
+namespace SalArray
+{
+#include "../../common/array.h"
+}
+
 // Chceme se dozvedet o SEH Exceptions i na x64 Windows 7 SP1 a dal
 // http://blog.paulbetts.org/index.php/2010/07/20/the-case-of-the-disappearing-onload-exception-user-mode-callback-exceptions-in-x64/
 // http://connect.microsoft.com/VisualStudio/feedback/details/550944/hardware-exceptions-on-x64-machines-are-silently-caught-in-wndproc-messages
@@ -39,6 +46,131 @@ void EnableExceptionsOn64()
     }
 }
 
+// Measures lookups of value and subkey names in memory registry for keys with various
+// counts of items. Keys with less than NAME_HASH_MIN_COUNT items are searched linearly,
+// larger keys through hash index. To compare with linear search also for large keys,
+// build with NAME_HASH_MIN_COUNT=0x7FFFFFFF.
+int Benchmark()
+{
+    static const int counts[] = {8, 15, 16, 64, 256, 1024, 4096, 16384};
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+    printf("%8s %18s %18s\n", "items", "value ns/lookup", "subkey ns/lookup");
+    for (int c = 0; c < _countof(counts); c++)
+    {
+        int count = counts[c];
+        CSalamanderRegistryExAbstract* pRegistry = REG_MemRegistryFactory();
+        TCHAR(*names)[32] = (TCHAR(*)[32])malloc(count * sizeof(*names));
+        HKEY hKey;
+        if (!pRegistry || !names || !pRegistry->CreateKey(HKEY_CURRENT_USER, _T("Software\\RegLibBench"), hKey))
+        {
+            printf("Error: Could not prepare registry\n");
+            if (pRegistry)
+                pRegistry->Release();
+            free(names);
+            return 15;
+        }
+        int i;
+        for (i = 0; i < count; i++)
+        {
+            DWORD data = i;
+            HKEY hSubKey;
+            _stprintf(names[i], _T("Item%d"), i);
+            pRegistry->SetValue(hKey, names[i], REG_DWORD, &data, sizeof(data));
+            if (pRegistry->CreateKey(hKey, names[i], hSubKey))
+                pRegistry->CloseKey(hSubKey);
+            _tcsupr(names[i]); // lookups are case-insensitive
+        }
+
+        int lookups = (1000000 / count + 1) * count; // every name is looked up the same number of times
+        DWORD found = 0;
+        LARGE_INTEGER t0, t1, t2;
+        QueryPerformanceCounter(&t0);
+        for (i = 0; i < lookups; i++)
+        {
+            DWORD data;
+            if (pRegistry->GetValue(hKey, names[i % count], REG_DWORD, &data, sizeof(data)))
+                found++;
+        }
+        QueryPerformanceCounter(&t1);
+        for (i = 0; i < lookups; i++)
+        {
+            HKEY hSubKey;
+            if (pRegistry->OpenKey(hKey, names[i % count], hSubKey))
+            {
+                pRegistry->CloseKey(hSubKey);
+                found++;
+            }
+        }
+        QueryPerformanceCounter(&t2);
+
+        if (found != 2 * (DWORD)lookups)
+            printf("Error: Some lookups failed\n");
+        printf("%8d %18.1f %18.1f\n", count,
+               (t1.QuadPart - t0.QuadPart) * 1e9 / freq.QuadPart / lookups,
+               (t2.QuadPart - t1.QuadPart) * 1e9 / freq.QuadPart / lookups);
+        pRegistry->CloseKey(hKey);
+        pRegistry->Release();
+        free(names);
+    }
+    return 0;
+}
+
+struct CArrayBenchItem
+{
+    DWORD Data[4];
+};
+
+// Measures filling of Salamander's TDirectArray with linear growth (default), geometric
+// growth and with Reserve(), then alternating Add and Delete of the last item. Arrays have
+// base and delta of CFilesArray and item counts are base + n * delta, so with linear growth
+// the filled array is just at the reallocation boundary.
+int ArrayBenchmark()
+{
+    static const int counts[] = {8200, 80200, 800200};
+    static const char* growths[] = {"linear", "geometric", "reserve"};
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+    printf("%8s %10s %14s %20s\n", "items", "growth", "fill ns/item", "add+delete ns/pair");
+    CArrayBenchItem item;
+    memset(&item, 0, sizeof(item));
+    for (int c = 0; c < _countof(counts); c++)
+    {
+        int count = counts[c];
+        for (int g = 0; g < _countof(growths); g++)
+        {
+            SalArray::TDirectArray<CArrayBenchItem> array(200, 800);
+            if (g == 1)
+                array.SetGrowth(SalArray::agGeometric);
+            LARGE_INTEGER t0, t1, t2;
+            QueryPerformanceCounter(&t0);
+            if (g == 2)
+                array.Reserve(count);
+            int i;
+            for (i = 0; i < count; i++)
+                array.Add(item);
+            QueryPerformanceCounter(&t1);
+            int pairs = 200; // with linear growth each pair reallocates the whole array twice
+            for (i = 0; i < pairs; i++)
+            {
+                array.Add(item);
+                array.Delete(array.Count - 1);
+            }
+            QueryPerformanceCounter(&t2);
+
+            if (!array.IsGood() || array.Count != count)
+            {
+                printf("Error: Array operations failed\n");
+                return 15;
+            }
+            printf("%8d %10s %14.1f %20.1f\n", count, growths[g],
+                   (t1.QuadPart - t0.QuadPart) * 1e9 / freq.QuadPart / count,
+                   (t2.QuadPart - t1.QuadPart) * 1e9 / freq.QuadPart / pairs);
+        }
+    }
+    return 0;
+}
+
 int _tmain(int argc, TCHAR* argv[])
 {
     EnableExceptionsOn64();
@@ -51,14 +183,21 @@ int _tmain(int argc, TCHAR* argv[])
 
     _CrtSetDbgFlag(_CRTDBG_LEAK_CHECK_DF | _CRTDBG_ALLOC_MEM_DF);
 
+    if ((argc == 2) && (_tcscmp(argv[1], _T("-bench")) == 0))
+        return Benchmark();
+    if ((argc == 2) && (_tcscmp(argv[1], _T("-arraybench")) == 0))
+        return ArrayBenchmark();
+
     if ((argc != 2) && (argc != 3))
     {
         printf("RegParser reads in MBCS Reg4.0 and UTF16 Reg5.0 file and stores its content in Registry or second file.\n\n"
-               "Usage:\n  RegParser.exe {InFile.reg [OutFile.reg]} | {branch OutFile.reg}\n\n"
+               "Usage:\n  RegParser.exe {InFile.reg [OutFile.reg]} | {branch OutFile.reg} | -bench | -arraybench\n\n"
                "1 argument - InFile.reg copied to system registry\n"
                "2 file arguments - InFile.reg parsed and resaved to OutFile.reg\n"
                "branch + 1 file argument - branch in system registry copied to OutFile.reg\n"
-               "                           The branch must be enclosed in []\n\n");
+               "                           The branch must be enclosed in []\n"
+               "-bench - measures name lookups in memory registry\n"
+               "-arraybench - measures growth policies of Salamander's TDirectArray\n\n");
         return 0;
     }
 
@@ -34,8 +34,13 @@ protected:
 
 public:
     // j.r. zvetsuji deltu na 800, protoze pri vstupu do vetsich adresaru (nekolik tisic souboru)
-    // zacina Enlarge() podle profileru celkem zrat CPU
-    CFilesArray(int base = 200, int delta = 800) : TDirectArray<CFileData>(base, delta) { DeleteData = TRUE; }
+    // zacina Enlarge() podle profileru celkem zrat CPU; u adresaru se statisici soubory ani
+    // delta nestaci, proto pole roste geometricky
+    CFilesArray(int base = 200, int delta = 800) : TDirectArray<CFileData>(base, delta)
+    {
+        DeleteData = TRUE;
+        SetGrowth(agGeometric);
+    }
     ~CFilesArray() { Destroy(); }
 
     void SetDeleteData(BOOL deleteData) { DeleteData = deleteData; }
@@ -1162,3 +1167,8 @@ void RegenEnvironmentVariables();
 
 // pokus o detekce SSD, vice viz CSalamanderGeneralAbstract::IsPathOnSSD()
 BOOL IsPathOnSSD(const char* path);
+
+// vraci identifikaci fyzickeho disku, na kterem lezi cesta 'path', pokud jde o disk se "seek
+// penalty" (rotacni disk, CD/DVD); pro SSD, sitove cesty a pri neuspechu vraci -1; pouziva
+// fronta diskovych Copy/Move operaci (viz COperationsQueue)
+DWORD GetPathSpinningDisk(const char* path);
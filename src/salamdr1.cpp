@@ -683,8 +683,8 @@ COLORREF CustomColors[NUMBER_OF_CUSTOMCOLORS] =
 // CRC32
 //
 
-static DWORD Crc32Tab[256];
-static BOOL Crc32TabInitialized = FALSE;
+static DWORD Crc32Tab[8][256]; // tabulky pro slicing-by-8, Crc32Tab[0] je klasicka bajtova tabulka
+static volatile BOOL Crc32TabInitialized = FALSE;
 
 void MakeCrc32Table(DWORD* crcTab)
 {
@@ -714,6 +714,25 @@ void MakeCrc32Table(DWORD* crcTab)
     }
 }
 
+// Crc32Tab[k][n] je CRC bajtu 'n' nasledovaneho 'k' nulovymi bajty; muze bezet soucasne
+// ve vice threadech, vsechny zapisuji stejne hodnoty
+static void MakeCrc32Tables()
+{
+    MakeCrc32Table(Crc32Tab[0]);
+    int n;
+    for (n = 0; n < 256; n++)
+    {
+        DWORD c = Crc32Tab[0][n];
+        int k;
+        for (k = 1; k < 8; k++)
+        {
+            c = Crc32Tab[0][c & 0xff] ^ (c >> 8);
+            Crc32Tab[k][n] = c;
+        }
+    }
+    Crc32TabInitialized = TRUE;
+}
+
 DWORD UpdateCrc32(const void* buffer, DWORD count, DWORD crcVal)
 {
     CALL_STACK_MESSAGE_NONE
@@ -722,68 +741,39 @@ DWORD UpdateCrc32(const void* buffer, DWORD count, DWORD crcVal)
         return 0;
 
     if (!Crc32TabInitialized)
-    {
-        MakeCrc32Table(Crc32Tab);
-        Crc32TabInitialized = TRUE;
-    }
+        MakeCrc32Tables();
 
-    BYTE* p = (BYTE*)buffer;
+    const BYTE* p = (const BYTE*)buffer;
     DWORD c = crcVal ^ 0xFFFFFFFF;
 
-    if (count)
-        do
-        {
-            c = Crc32Tab[((int)c ^ (*p++)) & 0xff] ^ (c >> 8);
-        } while (--count);
-
-    // Honza: meril jsem nasledujici optimalizace a nemaji zadny vyznam;
-    // jedina sance by bylo prepsani do ASM a cteni pameti po DWORDech,
-    // ze kterych by pak bylo mozne vyzobavat jednotlive bajty;
-    // pri soucasnem nastaveni release verze neni prekladac schopen tuto
-    // optimalizaci provest za nas.
-    /*
-  int remain = count % 8;
-  count -= remain;
-  while (remain)
-  {
-    c = Crc32Tab[((int)c ^ (*p++)) & 0xff] ^ (c >> 8);
-    remain--;
-  }
-  while (count)
-  {
-    c = Crc32Tab[((int)c ^ (*p++)) & 0xff] ^ (c >> 8);
-    c = Crc32Tab[((int)c ^ (*p++)) & 0xff] ^ (c >> 8);
-    c = Crc32Tab[((int)c ^ (*p++)) & 0xff] ^ (c >> 8);
-    c = Crc32Tab[((int)c ^ (*p++)) & 0xff] ^ (c >> 8);
-    c = Crc32Tab[((int)c ^ (*p++)) & 0xff] ^ (c >> 8);
-    c = Crc32Tab[((int)c ^ (*p++)) & 0xff] ^ (c >> 8);
-    c = Crc32Tab[((int)c ^ (*p++)) & 0xff] ^ (c >> 8);
-    c = Crc32Tab[((int)c ^ (*p++)) & 0xff] ^ (c >> 8);
-    count -= 8;
-  }
-*/
-    /*
-  int remain = count % 4;
-  count -= remain;
-  while (remain > 0)
-  {
-    c = Crc32Tab[((int)c ^ (*p++)) & 0xff] ^ (c >> 8);
-    remain--;
-  }
-
+    // bajtova smycka je omezena zavislosti kazdeho kroku na predchozim; slicing-by-8 zpracuje
+    // osm bajtu (dva DWORDy) osmi nezavislymi pristupy do tabulek (x86/x64 je little-endian)
+    while (count > 0 && ((ULONG_PTR)p & 3) != 0)
+    {
+        c = Crc32Tab[0][(c ^ *p++) & 0xff] ^ (c >> 8);
+        count--;
+    }
+    while (count >= 8)
+    {
+        DWORD one = *(const DWORD*)p ^ c;
+        DWORD two = *(const DWORD*)(p + 4);
+        c = Crc32Tab[7][one & 0xff] ^
+            Crc32Tab[6][(one >> 8) & 0xff] ^
+            Crc32Tab[5][(one >> 16) & 0xff] ^
+            Crc32Tab[4][one >> 24] ^
+            Crc32Tab[3][two & 0xff] ^
+            Crc32Tab[2][(two >> 8) & 0xff] ^
+            Crc32Tab[1][(two >> 16) & 0xff] ^
+            Crc32Tab[0][two >> 24];
+        p += 8;
+        count -= 8;
+    }
+    while (count > 0)
+    {
+        c = Crc32Tab[0][(c ^ *p++) & 0xff] ^ (c >> 8);
+        count--;
+    }
 
-  DWORD *pdw = (DWORD*)p;
-  DWORD dw;
-  while (count > 0)
-  {
-    dw = *pdw++;
-    c = Crc32Tab[((int)c ^ ((BYTE)(dw))) & 0xFF] ^ (c >> 8);
-    c = Crc32Tab[((int)c ^ ((BYTE)(dw >> 8))) & 0xFF] ^ (c >> 8);
-    c = Crc32Tab[((int)c ^ ((BYTE)(dw >> 16))) & 0xFF] ^ (c >> 8);
-    c = Crc32Tab[((int)c ^ ((BYTE)(dw >> 24))) & 0xFF] ^ (c >> 8);
-    count -= 4;
-  }
-*/
     return c ^ 0xFFFFFFFF; /* (instead of ~c for 64-bit machines) */
 }
 
@@ -2725,6 +2725,31 @@ BOOL ImportConfiguration(HWND hParent, const char* fileName, BOOL ignoreIfNotExi
 
     IfExistSetSplashScreenText(LoadStr(IDS_STARTUP_IMPORT_CONFIG));
 
+    // binarni snapshot souboru (viz LoadSnapshot) vznika pri uspesnem importu a pri dalsim
+    // startu se importuje misto parsovani .reg souboru (dvakrat: do pameti a do registry),
+    // dokud se .reg soubor nezmeni (napr. exportem konfigurace)
+    char snapshotName[MAX_PATH];
+    BOOL useSnapshot = _snprintf_s(snapshotName, _TRUNCATE, "%s.snapshot", fileName) >= 0;
+    if (useSnapshot)
+    {
+        CSalamanderRegistryExAbstract* sysReg = REG_SysRegistryFactory();
+        LoadSaveToRegistryMutex.Enter();
+        TRACE_I("ImportConfiguration(): Load snapshot to registry: begin");
+        eRPE_ERROR regerr = LoadSnapshot(snapshotName, fileName, sysReg, TRUE); // dirty hack: viz Parse() nize
+        TRACE_I("ImportConfiguration(): Load snapshot to registry: end");
+        LoadSaveToRegistryMutex.Leave();
+        sysReg->Release();
+        if (RPE_OK == regerr)
+        {
+            HANDLES(CloseHandle(file));
+            Configuration.ConfigWasImported = TRUE;
+            TRACE_I("ImportConfiguration(): end");
+            return TRUE;
+        }
+        if (RPE_SNAPSHOT_INVALID != regerr) // chyba pri zapisu do registry, import z .reg souboru to zopakuje (i s pripadnym hlasenim chyby)
+            TRACE_E("ImportConfiguration(): unable to load snapshot " << snapshotName << ": error " << regerr);
+    }
+
     BOOL ret = FALSE;
     LPTSTR buf = NULL;
     CQuadWord size;
@@ -2774,17 +2799,23 @@ BOOL ImportConfiguration(HWND hParent, const char* fileName, BOOL ignoreIfNotExi
     {
         // nejdrive ho zkusime parsnout do pameti, pokud obsahuje syntakticky chyby, vubec ho nebudeme cpat do registry
         CSalamanderRegistryExAbstract* memReg = REG_MemRegistryFactory();
+        // pri parsovani do pameti zaroven zaznamename operace s registry pro snapshot
+        CSalamanderRegistryExAbstract* recorder = useSnapshot ? REG_SnapshotRecorderFactory(memReg) : NULL;
         LPTSTR bufMem = _tcsdup(buf); // volani Parse buffer zmeni, tedy pro dalsi Parse musime zachovat original
         TRACE_I("ImportConfiguration(): Parse to memory: begin");
-        eRPE_ERROR regerr = bufMem != NULL ? Parse(bufMem, memReg, TRUE) : RPE_OUT_OF_MEMORY; // dirty hack: pri mazani klice s konfiguraci nesmazneme .hidden klice a hodnoty (kvuli trial version + checkveru)
+        eRPE_ERROR regerr = bufMem != NULL ? Parse(bufMem, recorder != NULL ? recorder : memReg, TRUE) : RPE_OUT_OF_MEMORY; // dirty hack: pri mazani klice s konfiguraci nesmazneme .hidden klice a hodnoty (kvuli trial version + checkveru)
         TRACE_I("ImportConfiguration(): Parse to memory: end");
         free(bufMem);
         BOOL verIsOK = RPE_OK == regerr; // overime jestli soubor vubec obsahuje nasi verzi konfigurace
+        BOOL isOurVer = FALSE;           // TRUE = import bez dotazu, snapshot muze import pri dalsim startu nahradit
         if (verIsOK)
         {
             HKEY key;
             if (memReg->OpenKey(HKEY_CURRENT_USER, SalamanderConfigurationRoots[0], key))
+            {
                 memReg->CloseKey(key);
+                isOurVer = TRUE;
+            }
             else
             {
                 char text[MAX_PATH + 300];
@@ -2811,7 +2842,16 @@ BOOL ImportConfiguration(HWND hParent, const char* fileName, BOOL ignoreIfNotExi
 
             Configuration.ConfigWasImported = TRUE;
             sysReg->Release();
+
+            if (ret && isOurVer && recorder != NULL)
+            {
+                eRPE_ERROR snapErr = SaveSnapshot(recorder, snapshotName, fileName);
+                if (RPE_OK != snapErr) // snapshot je jen urychleni, chyba (napr. read-only adresar) se nehlasi
+                    TRACE_I("ImportConfiguration(): unable to save snapshot " << snapshotName << ": error " << snapErr);
+            }
         }
+        if (recorder != NULL)
+            recorder->Release();
         if (RPE_OK != regerr)
         {
             int errTextID = IDS_IMPORTCFG_REGERR;
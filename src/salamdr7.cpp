@@ -498,6 +498,42 @@ BOOL IsPathOnSSD(const char* path)
     return FALSE;
 }
 
+DWORD GetPathSpinningDisk(const char* path)
+{
+    if (IsUNCPath(path) || MyGetDriveType(path) == DRIVE_REMOTE)
+        return -1; // u sitovych cest disky nezjistime (a zatez serveru stejne neovlivnime)
+
+    char guidPath[MAX_PATH];
+    if (!GetResolvedPathMountPointAndGUID(path, NULL, guidPath))
+        return -1;
+    SalPathRemoveBackslash(guidPath); // nasledujicim CreateFile vadilo zpetne lomitko za volumem
+    BOOL seekPenalty = TRUE;          // pokud se nepodari zjistit (napr. CD/DVD), bereme disk jako rotacni
+    QueryVolumeSeekPenalty(guidPath, &seekPenalty);
+    if (!seekPenalty)
+        return -1;
+
+    DWORD ret = -1;
+    HANDLE hVolume = HANDLES(CreateFile(guidPath, FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL));
+    if (hVolume != INVALID_HANDLE_VALUE)
+    {
+        STORAGE_DEVICE_NUMBER sdn;
+        DWORD bytesReturned = 0;
+        if (DeviceIoControl(hVolume, IOCTL_STORAGE_GET_DEVICE_NUMBER,
+                            NULL, 0, &sdn, sizeof(sdn), &bytesReturned, NULL))
+        {
+            ret = (sdn.DeviceType << 16) | (sdn.DeviceNumber & 0xFFFF);
+        }
+        else
+        {
+            int err = ::GetLastError(); // napr. svazek pres vice disku
+            TRACE_I("GetPathSpinningDisk(): DeviceIoControl failed. Err=" << err);
+        }
+        HANDLES(CloseHandle(hVolume));
+    }
+    return ret;
+}
+
 BOOL GetResolvedPathMountPointAndGUID(const char* path, char* mountPoint, char* guidPath)
 {
     char resolvedPath[MAX_PATH];
@@ -0,0 +1,199 @@
+﻿// SPDX-FileCopyrightText: 2023 Open Salamander Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// tbldump - prevod binarniho logu TRACE hlasek (viz makro TRACE_BINLOG_ENABLE v trace.h) na text;
+// vystup ma stejne sloupce jako soubor z TRACE_TO_FILE (bez UTID), kodovani UTF-8
+
+#include <windows.h>
+#include <limits.h>
+#include <stdio.h>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+#include "trace.h"
+
+struct CSite
+{
+    DWORD Line;
+    std::wstring File;
+};
+
+static std::wstring ToWide(const char* s, int len)
+{
+    std::wstring ret;
+    if (len > 0)
+    {
+        int wlen = MultiByteToWideChar(CP_ACP, 0, s, len, NULL, 0);
+        ret.resize(wlen);
+        MultiByteToWideChar(CP_ACP, 0, s, len, &ret[0], wlen);
+    }
+    return ret;
+}
+
+static void PrintUTF8(FILE* out, const WCHAR* s, int len)
+{
+    if (len <= 0)
+        return;
+    int size = WideCharToMultiByte(CP_UTF8, 0, s, len, NULL, 0, NULL, NULL);
+    std::string buf(size, 0);
+    WideCharToMultiByte(CP_UTF8, 0, s, len, &buf[0], size, NULL, NULL);
+    fwrite(buf.data(), 1, size, out);
+}
+
+// text zaznamu (za hlavickou) prevedeny na WCHARy
+static std::wstring GetRecordText(const C__TraceBinRecord* rec, DWORD skip)
+{
+    const char* data = (const char*)(rec + 1) + skip;
+    int size = rec->Size - sizeof(C__TraceBinRecord) - skip;
+    if (rec->Flags & __TBF_UNICODE)
+    {
+        std::wstring ret((const WCHAR*)data, size / sizeof(WCHAR));
+        return ret.substr(0, wcslen(ret.c_str())); // bez nul a zarovnani na konci
+    }
+    std::wstring ret = ToWide(data, size);
+    return ret.substr(0, wcslen(ret.c_str()));
+}
+
+static void PrintRecord(FILE* out, const C__TraceBinFileHeader* header, const C__TraceBinRecord* rec,
+                        const std::unordered_map<DWORD, CSite>& sites)
+{
+    double counter = header->PerfFrequency != 0 ? (double)rec->Counter / header->PerfFrequency : 0;
+    double fromStart = header->PerfFrequency != 0 ? (double)(rec->Counter - header->StartCounter) / header->PerfFrequency : 0;
+    ULARGE_INTEGER time;
+    time.LowPart = header->StartTime.dwLowDateTime;
+    time.HighPart = header->StartTime.dwHighDateTime;
+    time.QuadPart += (__int64)(fromStart * 10000000.0);
+    FILETIME ft, localFt;
+    ft.dwLowDateTime = time.LowPart;
+    ft.dwHighDateTime = time.HighPart;
+    SYSTEMTIME st;
+    if (!FileTimeToLocalFileTime(&ft, &localFt) || !FileTimeToSystemTime(&localFt, &st))
+        memset(&st, 0, sizeof(st));
+
+    const WCHAR* type = rec->Type == __tbrInformation ? L"Info" : L"Error";
+    WCHAR buf[200];
+    int len = swprintf_s(buf, L"%s\t%u\t%d.%d.%d\t%d:%02d:%02d.%03d\t%.3lf\t", type, rec->ThreadID,
+                         st.wDay, st.wMonth, st.wYear, st.wHour, st.wMinute, st.wSecond, st.wMilliseconds,
+                         counter * 1000.0);
+    PrintUTF8(out, buf, len);
+
+    if (rec->Type == __tbrDropped)
+    {
+        DWORD count = rec->Size >= sizeof(C__TraceBinRecord) + sizeof(DWORD) ? *(const DWORD*)(rec + 1) : 0;
+        len = swprintf_s(buf, L"\t0\t%u message(s) dropped, trace buffer of this thread was full\n", count);
+        PrintUTF8(out, buf, len);
+        return;
+    }
+
+    auto site = sites.find(rec->SiteID);
+    if (site != sites.end())
+    {
+        PrintUTF8(out, site->second.File.c_str(), (int)site->second.File.length());
+        len = swprintf_s(buf, L"\t%u\t", site->second.Line);
+    }
+    else
+        len = swprintf_s(buf, L"?\t0\t"); // definice mista se nevesla do logu
+    PrintUTF8(out, buf, len);
+    std::wstring text = GetRecordText(rec, 0);
+    PrintUTF8(out, text.c_str(), (int)text.length());
+    fputc('\n', out);
+}
+
+int wmain(int argc, WCHAR* argv[])
+{
+    if (argc < 2 || argc > 3)
+    {
+        fwprintf(stderr, L"Converts binary trace log (*.tbl) to text.\n\n"
+                         L"Usage: tbldump <log.tbl> [<output.txt>]\n");
+        return 1;
+    }
+
+    // log muze byt prave zapisovan, proto sdilime i zapis
+    HANDLE file = CreateFileW(argv[1], GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        fwprintf(stderr, L"Unable to open file %s, error %u.\n", argv[1], GetLastError());
+        return 1;
+    }
+    LARGE_INTEGER size;
+    HANDLE mapping = NULL;
+    const char* view = NULL;
+    if (GetFileSizeEx(file, &size) && size.QuadPart >= __TRACEBIN_FILE_SIZE)
+        mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping != NULL)
+        view = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, __TRACEBIN_FILE_SIZE);
+    const C__TraceBinFileHeader* header = (const C__TraceBinFileHeader*)view;
+    if (view == NULL || header->Signature != __TRACEBIN_SIGNATURE || header->Version != __TRACEBIN_VERSION)
+    {
+        fwprintf(stderr, L"File %s is not a binary trace log or its version is not supported.\n", argv[1]);
+        if (view != NULL)
+            UnmapViewOfFile(view);
+        if (mapping != NULL)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        return 1;
+    }
+
+    FILE* out = stdout;
+    if (argc == 3 && _wfopen_s(&out, argv[2], L"wb") != 0)
+    {
+        fwprintf(stderr, L"Unable to create file %s.\n", argv[2]);
+        UnmapViewOfFile(view);
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return 1;
+    }
+
+    // definice mist volani
+    std::unordered_map<DWORD, CSite> sites;
+    const char* sitesArea = view + __TRACEBIN_HEADER_SIZE;
+    DWORD sitesUsed = header->SitesUsed <= __TRACEBIN_SITES_SIZE ? header->SitesUsed : __TRACEBIN_SITES_SIZE;
+    for (DWORD pos = 0; pos + sizeof(C__TraceBinRecord) <= sitesUsed;)
+    {
+        const C__TraceBinRecord* rec = (const C__TraceBinRecord*)(sitesArea + pos);
+        if (rec->Size < sizeof(C__TraceBinRecord) + sizeof(DWORD) || pos + rec->Size > sitesUsed)
+            break; // poskozena data
+        CSite site;
+        site.Line = *(const DWORD*)(rec + 1);
+        site.File = GetRecordText(rec, sizeof(DWORD));
+        sites[rec->SiteID] = site;
+        pos += rec->Size;
+    }
+    if (header->SitesDropped > 0)
+    {
+        fwprintf(stderr, L"Warning: %u call site definition(s) did not fit into the log, "
+                         L"their messages show '?' instead of file and line.\n",
+                 header->SitesDropped);
+    }
+
+    // zpravy z kruhove oblasti: po pretoceni zacneme blokem za prave zapisovanym blokem, ten
+    // obsahuje nejstarsi zpravy (kazdy blok zacina zaznamem, viz C__TraceBin::WriteRecord)
+    const char* ring = view + __TRACEBIN_HEADER_SIZE + __TRACEBIN_SITES_SIZE;
+    const __int64 ringSize = (__int64)__TRACEBIN_BLOCK_SIZE * __TRACEBIN_BLOCKS;
+    __int64 writePos = header->WritePos;
+    __int64 pos = 0;
+    if (writePos > ringSize)
+        pos = (writePos / __TRACEBIN_BLOCK_SIZE + 1) * __TRACEBIN_BLOCK_SIZE - ringSize;
+    while (pos < writePos)
+    {
+        DWORD rest = __TRACEBIN_BLOCK_SIZE - (DWORD)(pos % __TRACEBIN_BLOCK_SIZE);
+        const C__TraceBinRecord* rec = (const C__TraceBinRecord*)(ring + pos % ringSize);
+        if (rec->Size == 0 || rest < sizeof(C__TraceBinRecord) ||
+            rec->Size < sizeof(C__TraceBinRecord) || rec->Size > rest)
+        { // konec bloku (nebo poskozena data), pokracujeme dalsim blokem
+            pos += rest;
+            continue;
+        }
+        PrintRecord(out, header, rec, sites);
+        pos += rec->Size;
+    }
+
+    if (out != stdout)
+        fclose(out);
+    UnmapViewOfFile(view);
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return 0;
+}
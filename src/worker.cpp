@@ -461,6 +461,155 @@ void CProgressSpeedMeter::BytesReceived(DWORD count, DWORD time, DWORD maxPacket
     }
 }
 
+//
+// ****************************************************************************
+// CScriptNames
+//
+
+// je SourceName/TargetName operace s kodem 'opcode' jmeno? (jinak jde o DWORD hodnotu, viz COperationCode)
+BOOL OpSourceIsName(COperationCode opcode)
+{
+    return opcode != ocCopyDirTime && opcode != ocLabelForSkipOfCreateDir;
+}
+
+BOOL OpTargetIsName(COperationCode opcode)
+{
+    return opcode != ocChangeAttrs && opcode != ocLabelForSkipOfCreateDir;
+}
+
+CScriptNames::CScriptNames() : Blocks(10, 50), Dirs(100, 1000)
+{
+    BlockPtr = NULL;
+    BlockFree = 0;
+    int i;
+    for (i = 0; i < SCRIPTNAMES_RECENT_DIRS; i++)
+        RecentDirs[i] = -1;
+    RecentDirsNext = 0;
+}
+
+CScriptNames::~CScriptNames()
+{
+    int i;
+    for (i = 0; i < Blocks.Count; i++)
+        free(Blocks[i]);
+}
+
+BOOL CScriptNames::CanStore(const char* name)
+{
+    return name == NULL || strlen(name) < MAX_PATH && strrchr(name, '\\') != NULL;
+}
+
+char* CScriptNames::Alloc(int size)
+{
+    size = (size + 3) & ~3; // zaznamy obsahuji DWORDy, zarovname je
+    if (size > BlockFree)
+    {
+        char* block = (char*)malloc(SCRIPTNAMES_BLOCK_SIZE);
+        if (block == NULL)
+        {
+            TRACE_E(LOW_MEMORY);
+            return NULL;
+        }
+        Blocks.Add(block);
+        if (!Blocks.IsGood())
+        {
+            Blocks.ResetState();
+            free(block);
+            return NULL;
+        }
+        BlockPtr = block;
+        BlockFree = SCRIPTNAMES_BLOCK_SIZE;
+    }
+    char* ret = BlockPtr;
+    BlockPtr += size;
+    BlockFree -= size;
+    return ret;
+}
+
+int CScriptNames::GetDirIndex(const char* path, int len)
+{
+    int i;
+    for (i = 0; i < SCRIPTNAMES_RECENT_DIRS; i++)
+    {
+        int index = RecentDirs[i];
+        if (index != -1 && Dirs[index].Len == len && memcmp(Dirs[index].Path, path, len) == 0)
+            return index;
+    }
+    char* s = Alloc(len + 1);
+    if (s == NULL)
+        return -1;
+    memcpy(s, path, len);
+    s[len] = 0;
+    CDirItem item;
+    item.Path = s;
+    item.Len = len;
+    int index = Dirs.Add(item);
+    if (!Dirs.IsGood())
+    {
+        Dirs.ResetState();
+        return -1;
+    }
+    RecentDirs[RecentDirsNext] = index;
+    RecentDirsNext = (RecentDirsNext + 1) % SCRIPTNAMES_RECENT_DIRS;
+    return index;
+}
+
+const void*
+CScriptNames::Store(const char* source, const char* target)
+{
+    const char* sourceName = source != NULL ? strrchr(source, '\\') + 1 : NULL;
+    const char* targetName = target != NULL ? strrchr(target, '\\') + 1 : NULL;
+    int sourceDir = -1;
+    if (source != NULL && (sourceDir = GetDirIndex(source, (int)(sourceName - 1 - source))) == -1)
+        return NULL;
+    int targetDir = -1;
+    if (target != NULL && (targetDir = GetDirIndex(target, (int)(targetName - 1 - target))) == -1)
+        return NULL;
+    BOOL sameName = sourceName != NULL && targetName != NULL && strcmp(sourceName, targetName) == 0;
+
+    int sourceLen = sourceName != NULL ? (int)strlen(sourceName) + 1 : 0;
+    int targetLen = targetName != NULL && !sameName ? (int)strlen(targetName) + 1 : 0;
+    CRecord* rec = (CRecord*)Alloc(sizeof(CRecord) + sourceLen + targetLen);
+    if (rec == NULL)
+        return NULL;
+    rec->SourceDir = sourceDir;
+    rec->TargetDir = targetDir;
+    rec->TargetSameName = sameName;
+    char* names = (char*)(rec + 1);
+    if (sourceLen > 0)
+        memcpy(names, sourceName, sourceLen);
+    if (targetLen > 0)
+        memcpy(names + sourceLen, targetName, targetLen);
+    return rec;
+}
+
+void CScriptNames::Load(const void* rec, char** source, char* sourceBuf, char** target, char* targetBuf)
+{
+    const CRecord* r = (const CRecord*)rec;
+    const char* sourceName = (const char*)(r + 1);
+    const char* targetName = sourceName;
+    *source = NULL;
+    if (r->SourceDir != -1)
+    {
+        CDirItem* dir = &Dirs[r->SourceDir];
+        memcpy(sourceBuf, dir->Path, dir->Len);
+        sourceBuf[dir->Len] = '\\';
+        strcpy(sourceBuf + dir->Len + 1, sourceName);
+        *source = sourceBuf;
+        if (!r->TargetSameName)
+            targetName = sourceName + strlen(sourceName) + 1;
+    }
+    *target = NULL;
+    if (r->TargetDir != -1)
+    {
+        CDirItem* dir = &Dirs[r->TargetDir];
+        memcpy(targetBuf, dir->Path, dir->Len);
+        targetBuf[dir->Len] = '\\';
+        strcpy(targetBuf + dir->Len + 1, targetName);
+        *target = targetBuf;
+    }
+}
+
 //
 // ****************************************************************************
 // COperations
@@ -469,6 +618,7 @@ void CProgressSpeedMeter::BytesReceived(DWORD count, DWORD time, DWORD maxPacket
 COperations::COperations(int base, int delta, char* waitInQueueSubject, char* waitInQueueFrom,
                          char* waitInQueueTo) : TDirectArray<COperation>(base, delta), Sizes(1, 400)
 {
+    SetGrowth(agGeometric); // skript muze mit miliony operaci
     TotalSize = CQuadWord(0, 0);
     CompressedSize = CQuadWord(0, 0);
     OccupiedSpace = CQuadWord(0, 0);
@@ -486,6 +636,8 @@ COperations::COperations(int base, int delta, char* waitInQueueSubject, char* wa
     CopySecurity = FALSE;
     PreserveDirTime = FALSE;
     SourcePathIsNetwork = FALSE;
+    SrcSpinningDisk = -1;
+    TgtSpinningDisk = -1;
     CopyAttrs = FALSE;
     StartOnIdle = FALSE;
     ShowStatus = FALSE;
@@ -505,11 +657,13 @@ COperations::COperations(int base, int delta, char* waitInQueueSubject, char* wa
     WorkPath1InclSubDirs = FALSE;
     WorkPath2[0] = 0;
     WorkPath2InclSubDirs = FALSE;
+    TargetPath[0] = 0;
     WaitInQueueSubject = waitInQueueSubject; // uvolnuje se ve FreeScript()
     WaitInQueueFrom = waitInQueueFrom;       // uvolnuje se ve FreeScript()
     WaitInQueueTo = waitInQueueTo;           // uvolnuje se ve FreeScript()
     HANDLES(InitializeCriticalSection(&StatusCS));
     TransferredFileSize = CQuadWord(0, 0);
+    UnchangedFileSize = CQuadWord(0, 0);
     ProgressSize = CQuadWord(0, 0);
     UseSpeedLimit = FALSE;
     SpeedLimit = 1;
@@ -522,6 +676,86 @@ COperations::COperations(int base, int delta, char* waitInQueueSubject, char* wa
     LastProgBufLimTestTime = GetTickCount() - 1000;
     LastFileBlockCount = 0;
     LastFileStartTime = GetTickCount();
+    Streaming = FALSE;
+    StreamCaption[0] = 0;
+    StreamDlgStarted = FALSE;
+    StreamSpaceChecked = FALSE;
+    HANDLES(InitializeCriticalSection(&StreamCS));
+    StreamEvent = NULL;
+    BuildEndEvent = NULL;
+    PublishedCount = 0;
+    BuildEnded = FALSE;
+    BuildFailed = FALSE;
+    StreamAborted = FALSE;
+    PublishedSize = CQuadWord(0, 0);
+}
+
+COperations::~COperations()
+{
+    if (StreamEvent != NULL)
+        HANDLES(CloseHandle(StreamEvent));
+    if (BuildEndEvent != NULL)
+        HANDLES(CloseHandle(BuildEndEvent));
+    HANDLES(DeleteCriticalSection(&StreamCS));
+    HANDLES(DeleteCriticalSection(&StatusCS));
+}
+
+int COperations::Add(const COperation& op)
+{
+    BOOL targetIsName = OpTargetIsName(op.Opcode);
+    BOOL compact = OpSourceIsName(op.Opcode) && CScriptNames::CanStore(op.SourceName) &&
+                   (!targetIsName || CScriptNames::CanStore(op.TargetName));
+    if (Streaming)
+        HANDLES(EnterCriticalSection(&StreamCS)); // pole i Names muze byt realokovano, worker z nich prave muze cist
+    COperation addOp = op;
+    if (compact)
+    {
+        const void* rec = Names.Store(op.SourceName, targetIsName ? op.TargetName : NULL);
+        if (rec != NULL)
+        {
+            addOp.SourceName = (char*)rec;
+            if (targetIsName)
+                addOp.TargetName = NULL;
+            addOp.OpFlags |= OPFL_COMPACT_NAMES;
+        }
+        else
+            compact = FALSE; // nedostatek pameti, nechame alokovana jmena
+    }
+    int index = TDirectArray<COperation>::Add(addOp);
+    BOOL ok = IsGood();
+    if (Streaming)
+        HANDLES(LeaveCriticalSection(&StreamCS));
+    if (compact && ok) // jmena uz jsou v Names
+    {
+        if (op.SourceName != NULL)
+            free(op.SourceName);
+        if (targetIsName && op.TargetName != NULL)
+            free(op.TargetName);
+    }
+    return index;
+}
+
+void COperations::Delete(int index)
+{
+    if (Streaming)
+        HANDLES(EnterCriticalSection(&StreamCS));
+    if (Streaming && index < PublishedCount)
+        TRACE_E("COperations::Delete(): unable to delete already published operation!");
+    else
+    {
+        FreeNames(&At(index));
+        TDirectArray<COperation>::Delete(index);
+    }
+    if (Streaming)
+        HANDLES(LeaveCriticalSection(&StreamCS));
+}
+
+void COperations::FreeNames(COperation* op)
+{
+    if (op->SourceName != NULL && OpSourceIsName(op->Opcode) && (op->OpFlags & OPFL_COMPACT_NAMES) == 0)
+        free(op->SourceName);
+    if (op->TargetName != NULL && OpTargetIsName(op->Opcode)) // u OPFL_COMPACT_NAMES je zde NULL
+        free(op->TargetName);
 }
 
 void COperations::SetTFS(const CQuadWord& TFS)
@@ -767,7 +1001,7 @@ void COperations::SetProgressSize(const CQuadWord& pSize)
 
 void COperations::GetStatus(CQuadWord* transferredFileSize, CQuadWord* transferSpeed,
                             CQuadWord* progressSize, CQuadWord* progressSpeed,
-                            BOOL* useSpeedLimit, DWORD* speedLimit)
+                            BOOL* useSpeedLimit, DWORD* speedLimit, CQuadWord* unchangedFileSize)
 {
     HANDLES(EnterCriticalSection(&StatusCS));
     *transferredFileSize = TransferredFileSize;
@@ -776,9 +1010,23 @@ void COperations::GetStatus(CQuadWord* transferredFileSize, CQuadWord* transferS
     ProgressSpeedMeter.GetSpeed(progressSpeed);
     *useSpeedLimit = UseSpeedLimit;
     *speedLimit = SpeedLimit;
+    *unchangedFileSize = UnchangedFileSize;
     HANDLES(LeaveCriticalSection(&StatusCS));
 }
 
+void COperations::AddUnchangedBytes(const CQuadWord& bytesCount, BOOL subtract)
+{
+    if (ShowStatus)
+    {
+        HANDLES(EnterCriticalSection(&StatusCS));
+        if (subtract)
+            UnchangedFileSize -= bytesCount;
+        else
+            UnchangedFileSize += bytesCount;
+        HANDLES(LeaveCriticalSection(&StatusCS));
+    }
+}
+
 void COperations::InitSpeedMeters(BOOL operInProgress)
 {
     if (ShowStatus)
@@ -831,6 +1079,147 @@ void COperations::GetSpeedLimit(BOOL* useSpeedLimit, DWORD* speedLimit)
     HANDLES(LeaveCriticalSection(&StatusCS));
 }
 
+BOOL COperations::StartStreaming(const char* caption)
+{
+    StreamEvent = HANDLES(CreateEvent(NULL, FALSE, FALSE, NULL)); // "nonsignaled" state, auto
+    BuildEndEvent = HANDLES(CreateEvent(NULL, TRUE, FALSE, NULL)); // "nonsignaled" state, manual
+    if (StreamEvent == NULL || BuildEndEvent == NULL)
+    {
+        TRACE_E("COperations::StartStreaming(): unable to create events!");
+        return FALSE;
+    }
+    lstrcpyn(StreamCaption, caption, 50);
+    Streaming = TRUE;
+    return TRUE;
+}
+
+BOOL COperations::PublishOps(BOOL all)
+{
+    HANDLES(EnterCriticalSection(&StreamCS));
+    int count = Count;
+    if (!all)
+    { // koncovou radu ocCreateDir operaci zatim nezverejnime, prazdne adresare se jeste mohou vyhodit
+        while (count > PublishedCount && At(count - 1).Opcode == ocCreateDir)
+            count--;
+    }
+    BOOL published = count > PublishedCount;
+    for (; PublishedCount < count; PublishedCount++)
+        PublishedSize += At(PublishedCount).Size; // TotalSize si prebere worker v HasOp()
+    BOOL ret = !StreamAborted;
+    HANDLES(LeaveCriticalSection(&StreamCS));
+    if (published)
+        SetEvent(StreamEvent);
+    return ret;
+}
+
+int COperations::GetPublishedCount()
+{
+    HANDLES(EnterCriticalSection(&StreamCS));
+    int count = PublishedCount;
+    HANDLES(LeaveCriticalSection(&StreamCS));
+    return count;
+}
+
+void COperations::EndStreaming(BOOL success)
+{
+    if (!Streaming)
+        return;
+    HANDLES(EnterCriticalSection(&StreamCS));
+    BuildEnded = TRUE;
+    BuildFailed = !success;
+    HANDLES(LeaveCriticalSection(&StreamCS));
+    SetEvent(StreamEvent);
+    SetEvent(BuildEndEvent); // POZOR: od ted muze worker skript kdykoliv uvolnit
+}
+
+BOOL COperations::IsOpAvailable(int index)
+{
+    if (!Streaming)
+        return index < Count;
+    HANDLES(EnterCriticalSection(&StreamCS));
+    BOOL ret = index < PublishedCount;
+    HANDLES(LeaveCriticalSection(&StreamCS));
+    return ret;
+}
+
+BOOL COperations::HasOp(int index)
+{
+    if (!Streaming)
+        return index < Count;
+    while (1)
+    {
+        HANDLES(EnterCriticalSection(&StreamCS));
+        BOOL ret = index < PublishedCount && !BuildFailed;
+        BOOL wait = !ret && !BuildEnded && !StreamAborted;
+        // TotalSize meni jen worker (zde), progress dialog ho cte v teto sekci pres GetTotalSize()
+        TotalSize = PublishedSize == CQuadWord(0, 0) ? CQuadWord(1, 0) : PublishedSize; // proti deleni nulou
+        HANDLES(LeaveCriticalSection(&StreamCS));
+        if (!wait)
+            return ret;
+        WaitForSingleObject(StreamEvent, INFINITE); // pockame na zverejneni dalsich operaci (nebo na cancel, viz AbortStreaming())
+    }
+}
+
+COperation*
+COperations::GetOp(int index, COperationBuf* buf)
+{
+    if (Streaming)
+        HANDLES(EnterCriticalSection(&StreamCS));
+    COperation* op = &At(index);
+    *(COperation*)buf = *op;
+    if (op->OpFlags & OPFL_COMPACT_NAMES)
+    {
+        char* target;
+        Names.Load(op->SourceName, &buf->SourceName, buf->SourceBuf, &target, buf->TargetBuf);
+        if (OpTargetIsName(op->Opcode))
+            buf->TargetName = target;
+        buf->OpFlags &= ~OPFL_COMPACT_NAMES;
+    }
+    if (Streaming)
+        HANDLES(LeaveCriticalSection(&StreamCS));
+    return buf;
+}
+
+void COperations::SetOp(int index, const COperation* op)
+{
+    if (Streaming)
+        HANDLES(EnterCriticalSection(&StreamCS));
+    At(index).Attr = op->Attr;
+    if (Streaming)
+        HANDLES(LeaveCriticalSection(&StreamCS));
+}
+
+void COperations::AbortStreaming()
+{
+    if (!Streaming)
+        return;
+    HANDLES(EnterCriticalSection(&StreamCS));
+    StreamAborted = TRUE;
+    HANDLES(LeaveCriticalSection(&StreamCS));
+    SetEvent(StreamEvent); // worker muze cekat v HasOp()
+}
+
+CQuadWord COperations::GetTotalSize()
+{
+    if (!Streaming)
+        return TotalSize;
+    HANDLES(EnterCriticalSection(&StreamCS));
+    CQuadWord size = TotalSize;
+    HANDLES(LeaveCriticalSection(&StreamCS));
+    return size;
+}
+
+BOOL COperations::WaitForBuildEnd()
+{
+    if (!Streaming)
+        return TRUE;
+    WaitForSingleObject(BuildEndEvent, INFINITE);
+    HANDLES(EnterCriticalSection(&StreamCS));
+    BOOL ret = !BuildFailed;
+    HANDLES(LeaveCriticalSection(&StreamCS));
+    return ret;
+}
+
 //
 // ****************************************************************************
 // CAsyncCopyParams
@@ -971,12 +1360,15 @@ struct CWorkerData
     int* SummaryProgress;
 };
 
+class CCopyVerifier;
+
 struct CProgressDlgData
 {
     HANDLE WorkerNotSuspended;
     BOOL* CancelWorker;
     int* OperationProgress;
     int* SummaryProgress;
+    CCopyVerifier* Verifier; // kontrola zkopirovanych souboru (viz Configuration.VerifyCopy), NULL = nekontroluje se
 
     BOOL OverwriteAll; // drzi stav automatickeho prepisovani targetu sourcem
     BOOL OverwriteHiddenAll;
@@ -1008,6 +1400,7 @@ struct CProgressDlgData
     BOOL SkipAllDirOver;
     BOOL SkipAllFileOutLossEncr;
     BOOL SkipAllDirCrLossEncr;
+    BOOL SkipAllVerify;
 
     BOOL IgnoreAllADSReadErr;
     BOOL IgnoreAllADSOpenOutErr;
@@ -3162,140 +3555,496 @@ void SetTFSandPSforSkippedFile(COperation* op, CQuadWord& lastTransferredFileSiz
     script->SetTFSandProgressSize(lastTransferredFileSize, pSize);
 }
 
-void DoCopyFileLoopOrig(HANDLE& in, HANDLE& out, void* buffer, int& limitBufferSize,
-                        COperations* script, CProgressDlgData& dlgData, BOOL wholeFileAllocated,
-                        COperation* op, const CQuadWord& totalDone, BOOL& copyError, BOOL& skipCopy,
-                        HWND hProgressDlg, CQuadWord& operationDone, CQuadWord& fileSize,
-                        int bufferSize, int& allocWholeFileOnStart, BOOL& copyAgain)
+//
+// ****************************************************************************
+// CCopyVerifier
+//
+// Kontrola zkopirovanych souboru (viz Configuration.VerifyCopy): zapsana data se behem
+// kopirovani predavaji pomocnemu threadu, ktery z nich pocita CRC32 (worker jen
+// zkopiruje data do volneho bufferu kruhu, pocitani CRC tak kopirovani nebrzdi). Po
+// zavreni ciloveho souboru se cil precte znovu necachovane (FILE_FLAG_NO_BUFFERING,
+// aby se cetlo z disku a ne z cache) a jeho CRC32 se porovna s CRC32 zapsanych dat.
+// Pri Configuration.CopyChecksumManifest se CRC32 overenych souboru zapisuji do SFV
+// souboru v cilovem adresari operace (viz COperations::TargetPath).
+
+#define VERIFY_BUFFERS 4                   // pocet bufferu v kruhu pro CRC thread
+#define VERIFY_BUF_SIZE ASYNC_COPY_BUF_SIZE // velikost bufferu v kruhu a bufferu pro cteni cile
+#define VERIFY_MANIFEST_NAME "checksums"   // jmeno SFV souboru s kontrolnimi soucty (bez pripony)
+
+DWORD WINAPI ThreadCopyVerifier(void* param);
+
+class CCopyVerifier
 {
-    int autoRetryAttemptsSNAP = 0;
-    DWORD read;
-    DWORD written;
-    while (1)
-    {
-        if (ReadFile(in, buffer, limitBufferSize, &read, NULL))
-        {
-            autoRetryAttemptsSNAP = 0;
-            if (read == 0)
-                break;                                                     // EOF
-            if (!script->ChangeSpeedLimit)                                 // pokud se muze zmenit speed-limit, tady neni "vhodne" misto pro cekani
-                WaitForSingleObject(dlgData.WorkerNotSuspended, INFINITE); // pokud mame byt v suspend-modu, cekame ...
-            if (*dlgData.CancelWorker)
-            {
-                copyError = TRUE; // goto COPY_ERROR
-                return;
-            }
+protected:
+    HANDLE WorkerNotSuspended;
+    BOOL* CancelWorker;
 
-            while (1)
-            {
-                if (WriteFile(out, buffer, read, &written, NULL) &&
-                    read == written)
-                {
-                    break;
-                }
+    char* Buffers[VERIFY_BUFFERS]; // kruh bufferu pro CRC thread
+    DWORD BufferLen[VERIFY_BUFFERS];
+    char* ReadBuffer; // buffer pro cteni cile (zarovnany pro necachovane cteni)
 
-            WRITE_ERROR:
+    HANDLE FreeSem; // pocet volnych bufferu kruhu
+    HANDLE DataSem; // pocet bufferu s daty pro CRC thread
+    HANDLE Thread;
+    BOOL Abort; // CRC thread ma skoncit (volani Stop())
 
-                DWORD err;
-                err = GetLastError();
+    int WriteIndex;      // poradove cislo dalsiho plneneho bufferu (jen worker)
+    int HashIndex;       // poradove cislo dalsiho bufferu pro CRC thread (jen CRC thread)
+    DWORD Crc;           // CRC32 dat predanych CRC threadu (worker cte jen po WaitForHash())
+    CQuadWord DataSize;  // pocet bytu predanych CRC threadu
+    BOOL Invalid;        // data neprisla za sebou (nemelo by nastat), soubor nelze zkontrolovat
+    DWORD VerifiedCrc;   // CRC32 posledniho uspesne overeneho souboru
 
-                WaitForSingleObject(dlgData.WorkerNotSuspended, INFINITE); // pokud mame byt v suspend-modu, cekame ...
-                if (*dlgData.CancelWorker)
-                {
-                    copyError = TRUE; // goto COPY_ERROR
-                    return;
-                }
+    char ManifestDir[MAX_PATH]; // adresar pro SFV soubor (s backslashem na konci), "" = SFV se nezapisuje
+    HANDLE Manifest;            // otevreny SFV soubor, NULL = zatim neotevreny
 
-                if (dlgData.SkipAllFileWrite)
-                {
-                    skipCopy = TRUE; // goto SKIP_COPY
-                    return;
-                }
+public:
+    CCopyVerifier(CProgressDlgData& dlgData);
+    ~CCopyVerifier();
 
-                int ret;
-                ret = IDCANCEL;
-                char* data[4];
-                data[0] = (char*)&ret;
-                data[1] = LoadStr(IDS_ERRORWRITINGFILE);
-                data[2] = op->TargetName;
-                if (err == NO_ERROR && read != written)
-                    err = ERROR_DISK_FULL;
-                data[3] = GetErrorText(err);
-                SendMessage(hProgressDlg, WM_USER_DIALOG, 0, (LPARAM)data);
-                switch (ret)
-                {
-                case IDRETRY: // na siti musime otevrit znovu handle, na lokale to nedovoli sharing
-                {
-                    if (out != NULL)
-                    {
-                        if (wholeFileAllocated)
-                            SetEndOfFile(out);     // u floppy by se jinak zapisoval zbytek souboru
-                        HANDLES(CloseHandle(out)); // zavreme invalidni handle
-                    }
-                    out = HANDLES_Q(CreateFile(op->TargetName, GENERIC_WRITE | GENERIC_READ, 0, NULL,
-                                               OPEN_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, NULL));
-                    if (out != INVALID_HANDLE_VALUE) // otevreno, jeste nastavime offset
-                    {
-                        LONG lo, hi;
-                        lo = GetFileSize(out, (DWORD*)&hi);
-                        if (lo == INVALID_FILE_SIZE && GetLastError() != NO_ERROR || // nelze ziskat velikost
-                            CQuadWord(lo, hi) < operationDone ||                     // soubor je prilis maly
-                            wholeFileAllocated && CQuadWord(lo, hi) > fileSize &&
-                                CQuadWord(lo, hi) > operationDone + CQuadWord(read, 0) || // predalokovany soubor je prilis velky (vetsi nez predalokovana velikost a zaroven vetsi nez zapsana velikost vcetne posledniho zapisovaneho bloku) = doslo k pridani zapisovanych bytu na konec souboru (allocWholeFileOnStart by melo byt 0 /* need-test */)
-                            !CheckTailOfOutFile(NULL, in, out, operationDone, operationDone + CQuadWord(read, 0), FALSE))
-                        { // jedeme to cely znovu
-                            HANDLES(CloseHandle(in));
-                            HANDLES(CloseHandle(out));
-                            DeleteFile(op->TargetName);
-                            copyAgain = TRUE; // goto COPY_AGAIN;
-                            return;
-                        }
-                    }
-                    else // nejde otevrit, problem trva ...
-                    {
-                        out = NULL;
-                        goto WRITE_ERROR;
-                    }
-                    break;
-                }
+    // alokuje buffery a spusti CRC thread; 'manifestDir' je adresar pro SFV soubor
+    // ("" = nezapisovat); vraci FALSE pri nedostatku pameti nebo chybe startu threadu
+    BOOL Start(const char* manifestDir);
 
-                case IDB_SKIPALL:
-                    dlgData.SkipAllFileWrite = TRUE;
-                case IDB_SKIP:
-                {
-                    skipCopy = TRUE; // goto SKIP_COPY
-                    return;
-                }
+    // zacatek kopirovani souboru (i opakovaneho po Retry)
+    void StartFile();
 
-                case IDCANCEL:
-                {
-                    copyError = TRUE; // goto COPY_ERROR
-                    return;
-                }
-                }
-            }
-            if (!script->ChangeSpeedLimit)                                 // pokud se muze zmenit speed-limit, tady neni "vhodne" misto pro cekani
-                WaitForSingleObject(dlgData.WorkerNotSuspended, INFINITE); // pokud mame byt v suspend-modu, cekame ...
-            if (*dlgData.CancelWorker)
-            {
-                copyError = TRUE; // goto COPY_ERROR
-                return;
-            }
+    // data 'data' o delce 'len' byla zapsana do cile na offset 'offset'; data pred jiz
+    // predanou delkou souboru se ignoruji (opakovany zapis po chybe zapisu)
+    void AddData(const CQuadWord& offset, const void* data, DWORD len);
 
-            script->AddBytesToSpeedMetersAndTFSandPS(read, FALSE, bufferSize, &limitBufferSize);
+    // precte zavreny cilovy soubor 'name' a porovna ho se zapsanymi daty; vraci NO_ERROR
+    // (shoda), ERROR_CRC (neshoda), ERROR_CANCELLED (cancel operace) nebo chybu cteni
+    DWORD VerifyTarget(const char* name);
 
-            if (!script->ChangeSpeedLimit)                                 // pokud se muze zmenit speed-limit, tady neni "vhodne" misto pro cekani
-                WaitForSingleObject(dlgData.WorkerNotSuspended, INFINITE); // pokud mame byt v suspend-modu, cekame ...
-            operationDone += CQuadWord(read, 0);
-            SetProgressWithoutSuspend(hProgressDlg, CaclProg(operationDone, op->Size),
-                                      CaclProg(totalDone + operationDone, script->TotalSize), dlgData);
+    // prida posledni overeny soubor 'name' do SFV souboru (pri chybe zapisu SFV
+    // soubor zavre a dalsi soubory uz nepridava)
+    void AddToManifest(const char* name);
 
-            if (script->ChangeSpeedLimit)                                  // asi se bude menit speed-limit, zde je "vhodne" misto na cekani, az se
-            {                                                              // worker zase rozbehne, ziskame znovu velikost bufferu pro kopirovani
-                WaitForSingleObject(dlgData.WorkerNotSuspended, INFINITE); // pokud mame byt v suspend-modu, cekame ...
-                script->GetNewBufSize(&limitBufferSize, bufferSize);
-            }
-        }
+    // ukonci CRC thread, uvolni buffery a zavre SFV soubor
+    void Stop();
+
+protected:
+    void WaitForHash(); // pocka, az CRC thread zpracuje vsechna predana data
+    BOOL OpenManifest();
+
+    friend unsigned ThreadCopyVerifierBody(void* param);
+};
+
+CCopyVerifier::CCopyVerifier(CProgressDlgData& dlgData)
+{
+    WorkerNotSuspended = dlgData.WorkerNotSuspended;
+    CancelWorker = dlgData.CancelWorker;
+    int i;
+    for (i = 0; i < VERIFY_BUFFERS; i++)
+        Buffers[i] = NULL;
+    ReadBuffer = NULL;
+    FreeSem = DataSem = Thread = NULL;
+    Abort = FALSE;
+    WriteIndex = HashIndex = 0;
+    Crc = 0;
+    DataSize = CQuadWord(0, 0);
+    Invalid = FALSE;
+    VerifiedCrc = 0;
+    ManifestDir[0] = 0;
+    Manifest = NULL;
+}
+
+CCopyVerifier::~CCopyVerifier()
+{
+    Stop();
+}
+
+BOOL CCopyVerifier::Start(const char* manifestDir)
+{
+    CALL_STACK_MESSAGE2("CCopyVerifier::Start(%s)", manifestDir);
+    BOOL ok = TRUE;
+    int i;
+    for (i = 0; i < VERIFY_BUFFERS; i++)
+    {
+        Buffers[i] = (char*)malloc(VERIFY_BUF_SIZE);
+        if (Buffers[i] == NULL)
+            ok = FALSE;
+    }
+    // necachovane cteni vyzaduje buffer zarovnany na velikost sektoru, VirtualAlloc vraci zarovnani na stranku
+    ReadBuffer = (char*)VirtualAlloc(NULL, VERIFY_BUF_SIZE, MEM_COMMIT, PAGE_READWRITE);
+    FreeSem = HANDLES(CreateSemaphore(NULL, VERIFY_BUFFERS, VERIFY_BUFFERS, NULL));
+    DataSem = HANDLES(CreateSemaphore(NULL, 0, VERIFY_BUFFERS, NULL));
+    if (ok && ReadBuffer != NULL && FreeSem != NULL && DataSem != NULL)
+    {
+        DWORD threadID;
+        Thread = HANDLES(CreateThread(NULL, 0, ThreadCopyVerifier, this, 0, &threadID));
+    }
+    if (Thread == NULL)
+    {
+        TRACE_E("CCopyVerifier::Start(): unable to allocate buffers or start thread, copied files will not be verified!");
+        Stop();
+        return FALSE;
+    }
+    if (manifestDir[0] != 0)
+    {
+        lstrcpyn(ManifestDir, manifestDir, MAX_PATH);
+        if (!SalPathAddBackslash(ManifestDir, MAX_PATH))
+            ManifestDir[0] = 0;
+    }
+    return TRUE;
+}
+
+void CCopyVerifier::Stop()
+{
+    if (Thread != NULL)
+    { // CRC thread muze cekat jen na DataSem, nepotrebna data uz nezpracuje
+        WaitForHash();
+        Abort = TRUE;
+        ReleaseSemaphore(DataSem, 1, NULL);
+        WaitForSingleObject(Thread, INFINITE);
+        HANDLES(CloseHandle(Thread));
+        Thread = NULL;
+    }
+    if (FreeSem != NULL)
+        HANDLES(CloseHandle(FreeSem));
+    if (DataSem != NULL)
+        HANDLES(CloseHandle(DataSem));
+    FreeSem = DataSem = NULL;
+    int i;
+    for (i = 0; i < VERIFY_BUFFERS; i++)
+    {
+        if (Buffers[i] != NULL)
+            free(Buffers[i]);
+        Buffers[i] = NULL;
+    }
+    if (ReadBuffer != NULL)
+        VirtualFree(ReadBuffer, 0, MEM_RELEASE);
+    ReadBuffer = NULL;
+    if (Manifest != NULL)
+        HANDLES(CloseHandle(Manifest));
+    Manifest = NULL;
+    ManifestDir[0] = 0;
+}
+
+void CCopyVerifier::WaitForHash()
+{
+    // vsechny buffery kruhu jsou volne teprve az CRC thread zpracuje vsechna predana data
+    int i;
+    for (i = 0; i < VERIFY_BUFFERS; i++)
+        WaitForSingleObject(FreeSem, INFINITE);
+    ReleaseSemaphore(FreeSem, VERIFY_BUFFERS, NULL);
+}
+
+void CCopyVerifier::StartFile()
+{
+    WaitForHash(); // CRC thread muze jeste zpracovavat data predchoziho (nedokonceneho) pokusu
+    Crc = 0;
+    DataSize = CQuadWord(0, 0);
+    Invalid = FALSE;
+}
+
+void CCopyVerifier::AddData(const CQuadWord& offset, const void* data, DWORD len)
+{
+    if (Invalid)
+        return;
+    if (offset > DataSize)
+    {
+        TRACE_E("CCopyVerifier::AddData(): unexpected data offset, file will not be verified!");
+        Invalid = TRUE;
+        return;
+    }
+    CQuadWord skip = DataSize - offset;
+    if (skip >= CQuadWord(len, 0))
+        return; // data uz CRC thread ma (opakovany zapis po chybe)
+    const char* d = (const char*)data + skip.LoDWord;
+    len -= skip.LoDWord;
+    while (len > 0)
+    {
+        WaitForSingleObject(FreeSem, INFINITE);
+        int i = WriteIndex++ % VERIFY_BUFFERS;
+        DWORD chunk = min(len, (DWORD)VERIFY_BUF_SIZE);
+        memcpy(Buffers[i], d, chunk);
+        BufferLen[i] = chunk;
+        ReleaseSemaphore(DataSem, 1, NULL);
+        DataSize += CQuadWord(chunk, 0);
+        d += chunk;
+        len -= chunk;
+    }
+}
+
+DWORD CCopyVerifier::VerifyTarget(const char* name)
+{
+    CALL_STACK_MESSAGE2("CCopyVerifier::VerifyTarget(%s)", name);
+    WaitForHash();
+    if (Invalid)
+        return NO_ERROR; // neni s cim porovnavat, chyba uz je v TRACE
+
+    HANDLE file = HANDLES_Q(CreateFile(name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                       FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN, NULL));
+    if (file == INVALID_HANDLE_VALUE && GetLastError() == ERROR_INVALID_PARAMETER)
+    { // necachovane cteni nektere (hlavne sitove) disky nepodporuji, cteme aspon standardne
+        file = HANDLES_Q(CreateFile(name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                    FILE_FLAG_SEQUENTIAL_SCAN, NULL));
+    }
+    if (file == INVALID_HANDLE_VALUE)
+        return GetLastError();
+
+    DWORD err = NO_ERROR;
+    DWORD crc = 0;
+    CQuadWord size(0, 0);
+    DWORD read;
+    while (1)
+    {
+        WaitForSingleObject(WorkerNotSuspended, INFINITE); // pokud mame byt v suspend-modu, cekame ...
+        if (*CancelWorker)
+        {
+            err = ERROR_CANCELLED;
+            break;
+        }
+        if (!ReadFile(file, ReadBuffer, VERIFY_BUF_SIZE, &read, NULL))
+        {
+            err = GetLastError();
+            break;
+        }
+        if (read == 0)
+            break; // EOF
+        crc = UpdateCrc32(ReadBuffer, read, crc);
+        size += CQuadWord(read, 0);
+    }
+    HANDLES(CloseHandle(file));
+
+    if (err == NO_ERROR)
+    {
+        if (size != DataSize || crc != Crc)
+            err = ERROR_CRC;
+        else
+            VerifiedCrc = crc;
+    }
+    return err;
+}
+
+BOOL CCopyVerifier::OpenManifest()
+{
+    char name[MAX_PATH];
+    int i;
+    for (i = 1; i <= 100; i++) // existujici soubory neprepisujeme, zkusime jmena "checksums (2).sfv", atd.
+    {
+        if (i == 1)
+            _snprintf_s(name, _TRUNCATE, "%s%s.sfv", ManifestDir, VERIFY_MANIFEST_NAME);
+        else
+            _snprintf_s(name, _TRUNCATE, "%s%s (%d).sfv", ManifestDir, VERIFY_MANIFEST_NAME, i);
+        Manifest = HANDLES_Q(CreateFile(name, GENERIC_WRITE, 0, NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, NULL));
+        if (Manifest != INVALID_HANDLE_VALUE)
+            return TRUE;
+        if (GetLastError() != ERROR_FILE_EXISTS && GetLastError() != ERROR_ALREADY_EXISTS)
+            break;
+    }
+    DWORD err = GetLastError();
+    TRACE_E("CCopyVerifier::OpenManifest(): unable to create checksum file in " << ManifestDir << ", error: " << GetErrorText(err));
+    Manifest = NULL;
+    return FALSE;
+}
+
+void CCopyVerifier::AddToManifest(const char* name)
+{
+    if (ManifestDir[0] == 0)
+        return;
+    if (Manifest == NULL && !OpenManifest())
+    {
+        ManifestDir[0] = 0; // dalsi pokusy si odpustime
+        return;
+    }
+    // jmena v SFV souboru jsou relativni k jeho adresari (soubory mimo nej maji plne jmeno)
+    int dirLen = (int)strlen(ManifestDir);
+    const char* relName = StrNICmp(name, ManifestDir, dirLen) == 0 ? name + dirLen : name;
+    char line[MAX_PATH + 20];
+    int len = _snprintf_s(line, _TRUNCATE, "%s %08X\r\n", relName, VerifiedCrc);
+    DWORD written;
+    if (len < 0 || !WriteFile(Manifest, line, len, &written, NULL) || written != (DWORD)len)
+    {
+        DWORD err = GetLastError();
+        TRACE_E("CCopyVerifier::AddToManifest(): unable to write checksum file, error: " << GetErrorText(err));
+        HANDLES(CloseHandle(Manifest));
+        Manifest = NULL;
+        ManifestDir[0] = 0;
+    }
+}
+
+unsigned ThreadCopyVerifierBody(void* param)
+{
+    CALL_STACK_MESSAGE1("ThreadCopyVerifierBody()");
+    SetThreadNameInVCAndTrace("CopyVerifier");
+    CCopyVerifier* verifier = (CCopyVerifier*)param;
+    while (1)
+    {
+        WaitForSingleObject(verifier->DataSem, INFINITE);
+        if (verifier->Abort)
+            break;
+        int i = verifier->HashIndex++ % VERIFY_BUFFERS;
+        verifier->Crc = UpdateCrc32(verifier->Buffers[i], verifier->BufferLen[i], verifier->Crc);
+        ReleaseSemaphore(verifier->FreeSem, 1, NULL);
+    }
+    return 0;
+}
+
+unsigned ThreadCopyVerifierEH(void* param)
+{
+#ifndef CALLSTK_DISABLE
+    __try
+    {
+#endif // CALLSTK_DISABLE
+        return ThreadCopyVerifierBody(param);
+#ifndef CALLSTK_DISABLE
+    }
+    __except (CCallStack::HandleException(GetExceptionInformation()))
+    {
+        TRACE_I("Thread CopyVerifier: calling ExitProcess(1).");
+        //    ExitProcess(1);
+        TerminateProcess(GetCurrentProcess(), 1); // tvrdsi exit (tenhle jeste neco vola)
+        return 1;
+    }
+#endif // CALLSTK_DISABLE
+}
+
+DWORD WINAPI ThreadCopyVerifier(void* param)
+{
+    CCallStack stack;
+    return ThreadCopyVerifierEH(param);
+}
+
+void DoCopyFileLoopOrig(HANDLE& in, HANDLE& out, void* buffer, int& limitBufferSize,
+                        COperations* script, CProgressDlgData& dlgData, BOOL wholeFileAllocated,
+                        COperation* op, const CQuadWord& totalDone, BOOL& copyError, BOOL& skipCopy,
+                        HWND hProgressDlg, CQuadWord& operationDone, CQuadWord& fileSize,
+                        int bufferSize, int& allocWholeFileOnStart, BOOL& copyAgain)
+{
+    int autoRetryAttemptsSNAP = 0;
+    DWORD read;
+    DWORD written;
+    while (1)
+    {
+        if (ReadFile(in, buffer, limitBufferSize, &read, NULL))
+        {
+            autoRetryAttemptsSNAP = 0;
+            if (read == 0)
+                break;                                                     // EOF
+            if (!script->ChangeSpeedLimit)                                 // pokud se muze zmenit speed-limit, tady neni "vhodne" misto pro cekani
+                WaitForSingleObject(dlgData.WorkerNotSuspended, INFINITE); // pokud mame byt v suspend-modu, cekame ...
+            if (*dlgData.CancelWorker)
+            {
+                copyError = TRUE; // goto COPY_ERROR
+                return;
+            }
+
+            while (1)
+            {
+                if (WriteFile(out, buffer, read, &written, NULL) &&
+                    read == written)
+                {
+                    break;
+                }
+
+            WRITE_ERROR:
+
+                DWORD err;
+                err = GetLastError();
+
+                WaitForSingleObject(dlgData.WorkerNotSuspended, INFINITE); // pokud mame byt v suspend-modu, cekame ...
+                if (*dlgData.CancelWorker)
+                {
+                    copyError = TRUE; // goto COPY_ERROR
+                    return;
+                }
+
+                if (dlgData.SkipAllFileWrite)
+                {
+                    skipCopy = TRUE; // goto SKIP_COPY
+                    return;
+                }
+
+                int ret;
+                ret = IDCANCEL;
+                char* data[4];
+                data[0] = (char*)&ret;
+                data[1] = LoadStr(IDS_ERRORWRITINGFILE);
+                data[2] = op->TargetName;
+                if (err == NO_ERROR && read != written)
+                    err = ERROR_DISK_FULL;
+                data[3] = GetErrorText(err);
+                SendMessage(hProgressDlg, WM_USER_DIALOG, 0, (LPARAM)data);
+                switch (ret)
+                {
+                case IDRETRY: // na siti musime otevrit znovu handle, na lokale to nedovoli sharing
+                {
+                    if (out != NULL)
+                    {
+                        if (wholeFileAllocated)
+                            SetEndOfFile(out);     // u floppy by se jinak zapisoval zbytek souboru
+                        HANDLES(CloseHandle(out)); // zavreme invalidni handle
+                    }
+                    out = HANDLES_Q(CreateFile(op->TargetName, GENERIC_WRITE | GENERIC_READ, 0, NULL,
+                                               OPEN_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN, NULL));
+                    if (out != INVALID_HANDLE_VALUE) // otevreno, jeste nastavime offset
+                    {
+                        LONG lo, hi;
+                        lo = GetFileSize(out, (DWORD*)&hi);
+                        if (lo == INVALID_FILE_SIZE && GetLastError() != NO_ERROR || // nelze ziskat velikost
+                            CQuadWord(lo, hi) < operationDone ||                     // soubor je prilis maly
+                            wholeFileAllocated && CQuadWord(lo, hi) > fileSize &&
+                                CQuadWord(lo, hi) > operationDone + CQuadWord(read, 0) || // predalokovany soubor je prilis velky (vetsi nez predalokovana velikost a zaroven vetsi nez zapsana velikost vcetne posledniho zapisovaneho bloku) = doslo k pridani zapisovanych bytu na konec souboru (allocWholeFileOnStart by melo byt 0 /* need-test */)
+                            !CheckTailOfOutFile(NULL, in, out, operationDone, operationDone + CQuadWord(read, 0), FALSE))
+                        { // jedeme to cely znovu
+                            HANDLES(CloseHandle(in));
+                            HANDLES(CloseHandle(out));
+                            DeleteFile(op->TargetName);
+                            copyAgain = TRUE; // goto COPY_AGAIN;
+                            return;
+                        }
+                    }
+                    else // nejde otevrit, problem trva ...
+                    {
+                        out = NULL;
+                        goto WRITE_ERROR;
+                    }
+                    break;
+                }
+
+                case IDB_SKIPALL:
+                    dlgData.SkipAllFileWrite = TRUE;
+                case IDB_SKIP:
+                {
+                    skipCopy = TRUE; // goto SKIP_COPY
+                    return;
+                }
+
+                case IDCANCEL:
+                {
+                    copyError = TRUE; // goto COPY_ERROR
+                    return;
+                }
+                }
+            }
+            if (!script->ChangeSpeedLimit)                                 // pokud se muze zmenit speed-limit, tady neni "vhodne" misto pro cekani
+                WaitForSingleObject(dlgData.WorkerNotSuspended, INFINITE); // pokud mame byt v suspend-modu, cekame ...
+            if (*dlgData.CancelWorker)
+            {
+                copyError = TRUE; // goto COPY_ERROR
+                return;
+            }
+
+            script->AddBytesToSpeedMetersAndTFSandPS(read, FALSE, bufferSize, &limitBufferSize);
+
+            if (dlgData.Verifier != NULL)
+                dlgData.Verifier->AddData(operationDone, buffer, read);
+
+            if (!script->ChangeSpeedLimit)                                 // pokud se muze zmenit speed-limit, tady neni "vhodne" misto pro cekani
+                WaitForSingleObject(dlgData.WorkerNotSuspended, INFINITE); // pokud mame byt v suspend-modu, cekame ...
+            operationDone += CQuadWord(read, 0);
+            SetProgressWithoutSuspend(hProgressDlg, CaclProg(operationDone, op->Size),
+                                      CaclProg(totalDone + operationDone, script->TotalSize), dlgData);
+
+            if (script->ChangeSpeedLimit)                                  // asi se bude menit speed-limit, zde je "vhodne" misto na cekani, az se
+            {                                                              // worker zase rozbehne, ziskame znovu velikost bufferu pro kopirovani
+                WaitForSingleObject(dlgData.WorkerNotSuspended, INFINITE); // pokud mame byt v suspend-modu, cekame ...
+                script->GetNewBufSize(&limitBufferSize, bufferSize);
+            }
+        }
         else
         {
         READ_ERROR:
@@ -3442,6 +4191,195 @@ void DoCopyFileLoopOrig(HANDLE& in, HANDLE& out, void* buffer, int& limitBufferS
     }
 }
 
+//
+// ****************************************************************************
+// delta kopirovani (viz Configuration.DeltaCopy): pri prepisu velkeho existujiciho souboru
+// se zdroj porovnava s cilem po castech a zapisuji se jen zmenene casti (napr. obrazy disku
+// virtualnich stroju, databaze), nakonec se cil zkrati/prodlouzi na velikost zdroje
+
+#define DELTACOPY_MIN_FILE_SIZE CQuadWord(64 * 1024 * 1024, 0) // minimalni velikost zdroje pro delta kopirovani
+#define DELTACOPY_BUF_SIZE (1024 * 1024)                      // velikost bloku cteneho ze zdroje i z cile
+#define DELTACOPY_CMP_SIZE (64 * 1024)                        // po jak velkych castech bloku se porovnava (a zapisuje)
+
+// zapise 'len' bytu z 'data' do 'out' (otevreny s FILE_FLAG_OVERLAPPED) na offset 'offset';
+// pri chybe vraci FALSE a chybu v 'err'
+BOOL DeltaCopyWrite(HANDLE out, const char* data, DWORD len, const CQuadWord& offset, DWORD* err)
+{
+    OVERLAPPED ov;
+    memset(&ov, 0, sizeof(ov));
+    ov.Offset = offset.LoDWord;
+    ov.OffsetHigh = offset.HiDWord;
+    DWORD written;
+    if (!WriteFile(out, data, len, NULL, &ov) && GetLastError() != ERROR_IO_PENDING ||
+        !GetOverlappedResult(out, &ov, &written, TRUE))
+    {
+        *err = GetLastError();
+        return FALSE;
+    }
+    if (written != len)
+    {
+        *err = ERROR_DISK_FULL;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// 'out' je existujici cilovy soubor otevreny pro cteni i zapis s FILE_FLAG_OVERLAPPED: cteni
+// bloku cile bezi soubezne se ctenim bloku zdroje ('in' je synchronni); 'srcBuf' a 'tgtBuf'
+// jsou buffery o velikosti DELTACOPY_BUF_SIZE
+void DoCopyFileLoopDelta(HANDLE& in, HANDLE& out, char* srcBuf, char* tgtBuf,
+                         COperations* script, CProgressDlgData& dlgData, COperation* op,
+                         const CQuadWord& totalDone, BOOL& copyError, BOOL& skipCopy,
+                         HWND hProgressDlg, CQuadWord& operationDone)
+{
+    CQuadWord unchanged(0, 0); // kolik bytu souboru uz cil obsahoval
+    while (1)
+    {
+        DWORD err = NO_ERROR;
+        BOOL errInTarget = FALSE;
+
+        // zadame cteni bloku cile, behem nej cteme blok zdroje
+        OVERLAPPED ov;
+        memset(&ov, 0, sizeof(ov));
+        ov.Offset = operationDone.LoDWord;
+        ov.OffsetHigh = operationDone.HiDWord;
+        DWORD tgtRead = 0;
+        BOOL tgtPending = ReadFile(out, tgtBuf, DELTACOPY_BUF_SIZE, NULL, &ov) || GetLastError() == ERROR_IO_PENDING;
+        if (!tgtPending && GetLastError() != ERROR_HANDLE_EOF) // za koncem cile se jen zapisuje
+        {
+            err = GetLastError();
+            errInTarget = TRUE;
+        }
+        DWORD read = 0;
+        if (!ReadFile(in, srcBuf, DELTACOPY_BUF_SIZE, &read, NULL) && err == NO_ERROR)
+            err = GetLastError();
+        if (tgtPending && !GetOverlappedResult(out, &ov, &tgtRead, TRUE))
+        {
+            tgtRead = 0;
+            if (GetLastError() != ERROR_HANDLE_EOF && err == NO_ERROR)
+            {
+                err = GetLastError();
+                errInTarget = TRUE;
+            }
+        }
+
+        DWORD blockUnchanged = 0;
+        if (err == NO_ERROR)
+        {
+            if (read == 0) // EOF: cil zkratime/prodlouzime na velikost zdroje
+            {
+                if (SalSetFilePointer(out, operationDone) && SetEndOfFile(out))
+                    break;
+                err = GetLastError();
+                errInTarget = TRUE;
+            }
+            else
+            {
+                // porovname po castech, souvisle rady zmenenych casti zapiseme jednim zapisem
+                DWORD pos = 0;
+                while (pos < read)
+                {
+                    DWORD len = min(read - pos, (DWORD)DELTACOPY_CMP_SIZE);
+                    if (pos + len <= tgtRead && memcmp(srcBuf + pos, tgtBuf + pos, len) == 0)
+                    {
+                        blockUnchanged += len;
+                        pos += len;
+                        continue;
+                    }
+                    DWORD end = pos + len;
+                    while (end < read)
+                    {
+                        len = min(read - end, (DWORD)DELTACOPY_CMP_SIZE);
+                        if (end + len <= tgtRead && memcmp(srcBuf + end, tgtBuf + end, len) == 0)
+                            break;
+                        end += len;
+                    }
+                    if (!DeltaCopyWrite(out, srcBuf + pos, end - pos, operationDone + CQuadWord(pos, 0), &err))
+                    {
+                        errInTarget = TRUE;
+                        break;
+                    }
+                    pos = end;
+                }
+            }
+        }
+
+        if (err != NO_ERROR)
+        {
+            WaitForSingleObject(dlgData.WorkerNotSuspended, INFINITE); // pokud mame byt v suspend-modu, cekame ...
+            if (*dlgData.CancelWorker)
+            {
+                copyError = TRUE; // goto COPY_ERROR
+                break;
+            }
+
+            if (errInTarget ? dlgData.SkipAllFileWrite : dlgData.SkipAllFileRead)
+            {
+                skipCopy = TRUE; // goto SKIP_COPY
+                break;
+            }
+
+            int ret;
+            ret = IDCANCEL;
+            char* data[4];
+            data[0] = (char*)&ret;
+            data[1] = LoadStr(errInTarget ? IDS_ERRORWRITINGFILE : IDS_ERRORREADINGFILE);
+            data[2] = errInTarget ? op->TargetName : op->SourceName;
+            data[3] = GetErrorText(err);
+            SendMessage(hProgressDlg, WM_USER_DIALOG, 0, (LPARAM)data);
+            switch (ret)
+            {
+            case IDRETRY: // blok zpracujeme znovu (cil se cte a zapisuje na zadanych offsetech)
+            {
+                SalSetFilePointer(in, operationDone);
+                continue;
+            }
+
+            case IDB_SKIPALL:
+                if (errInTarget)
+                    dlgData.SkipAllFileWrite = TRUE;
+                else
+                    dlgData.SkipAllFileRead = TRUE;
+            case IDB_SKIP:
+            {
+                skipCopy = TRUE; // goto SKIP_COPY
+                break;
+            }
+
+            case IDCANCEL:
+            {
+                copyError = TRUE; // goto COPY_ERROR
+                break;
+            }
+            }
+            break;
+        }
+
+        WaitForSingleObject(dlgData.WorkerNotSuspended, INFINITE); // pokud mame byt v suspend-modu, cekame ...
+        if (*dlgData.CancelWorker)
+        {
+            copyError = TRUE; // goto COPY_ERROR
+            break;
+        }
+
+        script->AddBytesToSpeedMetersAndTFSandPS(read, FALSE, DELTACOPY_BUF_SIZE, NULL);
+        if (blockUnchanged > 0)
+        {
+            script->AddUnchangedBytes(CQuadWord(blockUnchanged, 0), FALSE);
+            unchanged += CQuadWord(blockUnchanged, 0);
+        }
+
+        if (dlgData.Verifier != NULL)
+            dlgData.Verifier->AddData(operationDone, srcBuf, read);
+
+        operationDone += CQuadWord(read, 0);
+        SetProgressWithoutSuspend(hProgressDlg, CaclProg(operationDone, op->Size),
+                                  CaclProg(totalDone + operationDone, script->TotalSize), dlgData);
+    }
+    if (copyError || skipCopy) // cil se smaze, nezmenena data uz nezapocitavame
+        script->AddUnchangedBytes(unchanged, TRUE);
+}
+
 enum CCopy_BlkState
 {
     cbsFree,       // blok se nepouziva
@@ -3660,6 +4598,8 @@ BOOL CCopy_Context::StartWriting(int blkIndex, DWORD* err)
         return FALSE; // cancel se provede v error-handlingu
     }
 
+    if (DlgData->Verifier != NULL) // data bufferu se do dokonceni zapisu nemeni, muzeme je predat uz ted
+        DlgData->Verifier->AddData(WriteOffset, AsyncPar->Buffers[blkIndex], BlockDataLen[blkIndex]);
     WriteOffset.Value += BlockDataLen[blkIndex];
     BlockState[blkIndex] = cbsWriting; // blok byl pred volanim teto metody ve stavu cbsRead
     BlockTime[blkIndex] = CurTime++;
@@ -4515,6 +5455,35 @@ BOOL DoCopyFile(COperation* op, HWND hProgressDlg, void* buffer,
         ~CDisableProgressBufferLimit() { Script->EnableProgressBufferLimit(FALSE); }
     } DisableProgressBufferLimit(script);
 
+    // delta kopirovani jen pri synchronnim kopirovani bez omezeni rychlosti (DoCopyFileLoopDelta
+    // ho neresi) a bez prenosu Compressed/Encrypted atributu (ty se nastavuji pri vytvoreni cile)
+    BOOL useSpeedLimit;
+    DWORD speedLimit;
+    script->GetSpeedLimit(&useSpeedLimit, &speedLimit);
+    BOOL tryDeltaCopy = Configuration.DeltaCopy && !useAsyncAlg && !useSpeedLimit && !script->CopyAttrs &&
+                        !copyAsEncrypted && !invalidTgtName && op->FileSize >= DELTACOPY_MIN_FILE_SIZE;
+    struct CDeltaCopyBuffers // buffery pro delta kopirovani, uvolni se na vsech exitech z teto funkce
+    {
+        char* Source;
+        char* Target;
+        CDeltaCopyBuffers() { Source = Target = NULL; }
+        ~CDeltaCopyBuffers()
+        {
+            if (Source != NULL)
+                free(Source);
+            if (Target != NULL)
+                free(Target);
+        }
+        BOOL Alloc()
+        {
+            if (Source == NULL)
+                Source = (char*)malloc(DELTACOPY_BUF_SIZE);
+            if (Target == NULL)
+                Target = (char*)malloc(DELTACOPY_BUF_SIZE);
+            return Source != NULL && Target != NULL;
+        }
+    } deltaBuffers;
+
     CQuadWord operationDone;
     CQuadWord lastTransferredFileSize;
     script->GetTFSandResetTrSpeedIfNeeded(&lastTransferredFileSize);
@@ -4564,6 +5533,7 @@ COPY_AGAIN:
             HANDLE out;
             BOOL lossEncryptionAttr = FALSE;
             BOOL skipAllocWholeFileOnStart = FALSE;
+            BOOL deltaCopy = FALSE; // TRUE = existujici cil je otevreny pro delta kopirovani (viz DoCopyFileLoopDelta)
             while (1)
             {
             OPEN_TGT_FILE:
@@ -4661,7 +5631,8 @@ COPY_AGAIN:
 
                     // pokud je to mozne, provedeme alokaci potrebneho mista pro soubor (nedochazi pak k fragmentaci disku + hladsi zapis na diskety)
                     BOOL wholeFileAllocated = FALSE;
-                    if (!skipAllocWholeFileOnStart &&               // minule doslo k chybe, ted by nejspis doslo k te same
+                    if (!deltaCopy &&                               // pri delta kopirovani cil uz existuje (velikost se upravi na konci)
+                        !skipAllocWholeFileOnStart &&               // minule doslo k chybe, ted by nejspis doslo k te same
                         allocWholeFileOnStart != 2 /* no */ &&      // alokovani celeho souboru neni zakazano
                         fileSize > CQuadWord(limitBufferSize, 0) && // pod velikost kopirovaciho bufferu nema alokace souboru smysl
                         fileSize < CQuadWord(0, 0x80000000))        // velikost souboru je kladne cislo (jinak nelze seekovat - jde o cisla nad 8EB, takze zrejme nikdy nenastane)
@@ -4711,11 +5682,18 @@ COPY_AGAIN:
                     }
 
                     script->SetFileStartParams();
+                    if (dlgData.Verifier != NULL)
+                        dlgData.Verifier->StartFile();
 
                     BOOL copyError = FALSE;
                     BOOL skipCopy = FALSE;
                     BOOL copyAgain = FALSE;
-                    if (useAsyncAlg)
+                    if (deltaCopy)
+                    {
+                        DoCopyFileLoopDelta(in, out, deltaBuffers.Source, deltaBuffers.Target, script, dlgData, op,
+                                            totalDone, copyError, skipCopy, hProgressDlg, operationDone);
+                    }
+                    else if (useAsyncAlg)
                     {
                         DoCopyFileLoopAsync(asyncPar, in, out, buffer, limitBufferSize, script, dlgData, wholeFileAllocated, op,
                                             totalDone, copyError, skipCopy, hProgressDlg, operationDone, fileSize,
@@ -4989,6 +5967,56 @@ COPY_AGAIN:
                                 goto COPY_ERROR;
                             }
                         }
+                        out = NULL; // soubor uz je zavreny, SKIP_COPY ani COPY_ERROR ho nesmi zavirat
+
+                        while (dlgData.Verifier != NULL) // kontrola zkopirovaneho souboru (precteni z disku + porovnani CRC)
+                        {
+                            DWORD err = dlgData.Verifier->VerifyTarget(op->TargetName);
+                            if (err == NO_ERROR)
+                            {
+                                dlgData.Verifier->AddToManifest(op->TargetName);
+                                break;
+                            }
+
+                            WaitForSingleObject(dlgData.WorkerNotSuspended, INFINITE); // pokud mame byt v suspend-modu, cekame ...
+                            if (*dlgData.CancelWorker)
+                                goto COPY_ERROR;
+
+                            if (dlgData.SkipAllVerify)
+                                goto SKIP_COPY;
+
+                            int ret = IDCANCEL;
+                            char* data[4];
+                            data[0] = (char*)&ret;
+                            data[1] = LoadStr(IDS_ERRORVERIFYINGFILE);
+                            data[2] = op->TargetName;
+                            data[3] = err == ERROR_CRC ? LoadStr(IDS_VERIFYMISMATCH) : GetErrorText(err);
+                            SendMessage(hProgressDlg, WM_USER_DIALOG, 0, (LPARAM)data);
+                            switch (ret)
+                            {
+                            case IDRETRY:
+                            {
+                                if (err == ERROR_CRC) // cil obsahuje jina data nez zdroj, kopirujeme znovu
+                                {
+                                    if (DeleteFile(op->TargetName) == 0)
+                                    {
+                                        DWORD err2 = GetLastError();
+                                        TRACE_E("DoCopyFile(): Unable to remove newly created file: " << op->TargetName << ", error: " << GetErrorText(err2));
+                                    }
+                                    goto COPY_AGAIN;
+                                }
+                                break; // chyba cteni cile, zkusime ho precist znovu
+                            }
+
+                            case IDB_SKIPALL:
+                                dlgData.SkipAllVerify = TRUE;
+                            case IDB_SKIP:
+                                goto SKIP_COPY; // nezkontrolovany cil smazeme, Move nesmaze zdroj
+
+                            case IDCANCEL:
+                                goto COPY_ERROR;
+                            }
+                        }
 
                         SetFileAttributes(op->TargetName, script->CopyAttrs ? attr : (attr | FILE_ATTRIBUTE_ARCHIVE));
                     }
@@ -5300,12 +6328,35 @@ COPY_AGAIN:
                                         err = GetLastError();
                                         if (chAttr)
                                             SetFileAttributes(op->TargetName, attr);
-                                        errDeletingFile = TRUE;
-                                        goto NORMAL_ERROR;
+                                        errDeletingFile = TRUE;
+                                        goto NORMAL_ERROR;
+                                    }
+                                }
+                                else // jdeme soubor prepsat na miste
+                                {
+                                    if (tryDeltaCopy && attr != INVALID_FILE_ATTRIBUTES &&
+                                        (attr & FILE_ATTRIBUTE_ENCRYPTED) == 0 && deltaBuffers.Alloc())
+                                    { // delta kopirovani: cil otevreme bez zkraceni, zmenene casti do nej zapise DoCopyFileLoopDelta
+                                        tryDeltaCopy = FALSE; // pri neuspechu uz jen standardni prepis
+                                        if (attr & FILE_ATTRIBUTE_READONLY)
+                                            SetFileAttributes(op->TargetName, attr & ~FILE_ATTRIBUTE_READONLY);
+                                        out = HANDLES_Q(CreateFile(op->TargetName, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING,
+                                                                   FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, NULL));
+                                        // stejne jako pri CREATE_ALWAYS nechceme v cili puvodni ADS
+                                        if (out != INVALID_HANDLE_VALUE && script->TargetPathSupADS && !DeleteAllADS(out, op->TargetName))
+                                        {
+                                            HANDLES(CloseHandle(out));
+                                            out = INVALID_HANDLE_VALUE;
+                                        }
+                                        if (out != INVALID_HANDLE_VALUE)
+                                        {
+                                            deltaCopy = TRUE;
+                                            break;
+                                        }
+                                        if (attr & FILE_ATTRIBUTE_READONLY)
+                                            SetFileAttributes(op->TargetName, attr);
                                     }
-                                }
-                                else // jdeme soubor prepsat na miste
-                                {
+
                                     // pokud jsme jeste nedelali test funkcnosti zkraceni souboru na nulu, ziskame soucasnou velikost souboru
                                     CQuadWord origFileSize(0, 0); // velikost souboru pred zkracenim
                                     if (mustDeleteFileBeforeOverwrite == 0 /* need test */)
@@ -7683,117 +8734,787 @@ BOOL DoChangeAttrs(HWND hProgressDlg, char* name, const CQuadWord& size, DWORD a
         }
         if (error == ERROR_SUCCESS && changeEncryption && (attrs & FILE_ATTRIBUTE_ENCRYPTED))
         {
-            BOOL cancelOper = FALSE;
-            error = MyEncryptFile(hProgressDlg, name, fileAttr, attrs, dlgData, cancelOper, TRUE);
-            if (*dlgData.CancelWorker || cancelOper)
-                return FALSE;
-            if (error != ERROR_SUCCESS)
-            {
-                errTitle = LoadStr(IDS_ERRORENCRYPTING);
-                if (error == ERROR_INVALID_FUNCTION)
-                    showEncryptErr = TRUE; // not supported
-            }
+            BOOL cancelOper = FALSE;
+            error = MyEncryptFile(hProgressDlg, name, fileAttr, attrs, dlgData, cancelOper, TRUE);
+            if (*dlgData.CancelWorker || cancelOper)
+                return FALSE;
+            if (error != ERROR_SUCCESS)
+            {
+                errTitle = LoadStr(IDS_ERRORENCRYPTING);
+                if (error == ERROR_INVALID_FUNCTION)
+                    showEncryptErr = TRUE; // not supported
+            }
+        }
+        if (showCompressErr || showEncryptErr)
+        {
+            WaitForSingleObject(dlgData.WorkerNotSuspended, INFINITE); // pokud mame byt v suspend-modu, cekame ...
+            if (*dlgData.CancelWorker)
+                return FALSE;
+
+            if (showCompressErr)
+                changeCompression = FALSE;
+            if (showEncryptErr)
+                changeEncryption = FALSE;
+            char* data[3];
+            data[0] = LoadStr((showCompressErr && (attrs & FILE_ATTRIBUTE_COMPRESSED) || !showEncryptErr) ? IDS_ERRORCOMPRESSING : IDS_ERRORENCRYPTING);
+            data[1] = name;
+            data[2] = LoadStr((showCompressErr && (attrs & FILE_ATTRIBUTE_COMPRESSED) || !showEncryptErr) ? IDS_COMPRNOTSUPPORTED : IDS_ENCRYPNOTSUPPORTED);
+            SendMessage(hProgressDlg, WM_USER_DIALOG, 5, (LPARAM)data);
+            error = ERROR_SUCCESS;
+        }
+        if (error == ERROR_SUCCESS && SetFileAttributes(nameSetAttrs, attrs))
+        {
+            BOOL isDir = ((attrs & FILE_ATTRIBUTE_DIRECTORY) != 0);
+            // pokud mame nastavit jeden z casu
+            if (timeModified != NULL || timeCreated != NULL || timeAccessed != NULL)
+            {
+                HANDLE file;
+                if (attrs & FILE_ATTRIBUTE_READONLY)
+                    SetFileAttributes(nameSetAttrs, attrs & (~FILE_ATTRIBUTE_READONLY));
+                file = HANDLES_Q(CreateFile(nameSetAttrs, GENERIC_READ | GENERIC_WRITE,
+                                            FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                            NULL, OPEN_EXISTING, isDir ? FILE_FLAG_BACKUP_SEMANTICS : 0, NULL));
+                if (file != INVALID_HANDLE_VALUE)
+                {
+                    FILETIME ftCreated, ftAccessed, ftModified;
+                    GetFileTime(file, &ftCreated, &ftAccessed, &ftModified);
+                    if (timeCreated != NULL)
+                        ftCreated = *timeCreated;
+                    if (timeAccessed != NULL)
+                        ftAccessed = *timeAccessed;
+                    if (timeModified != NULL)
+                        ftModified = *timeModified;
+                    SetFileTime(file, &ftCreated, &ftAccessed, &ftModified);
+                    HANDLES(CloseHandle(file));
+                    if (attrs & FILE_ATTRIBUTE_READONLY)
+                        SetFileAttributes(nameSetAttrs, attrs);
+                }
+                else
+                {
+                    if (attrs & FILE_ATTRIBUTE_READONLY)
+                        SetFileAttributes(nameSetAttrs, attrs);
+                    goto SHOW_ERROR;
+                }
+            }
+            totalDone += size;
+            SetProgress(hProgressDlg, 0, CaclProg(totalDone, script->TotalSize), dlgData);
+            return TRUE;
+        }
+        else
+        {
+        SHOW_ERROR:
+
+            if (error == ERROR_SUCCESS)
+                error = GetLastError();
+            if (errTitle == NULL)
+                errTitle = LoadStr(IDS_ERRORCHANGINGATTRS);
+
+            WaitForSingleObject(dlgData.WorkerNotSuspended, INFINITE); // pokud mame byt v suspend-modu, cekame ...
+            if (*dlgData.CancelWorker)
+                return FALSE;
+
+            if (dlgData.SkipAllChangeAttrs)
+                goto SKIP_ATTRS_ERROR;
+
+            int ret;
+            ret = IDCANCEL;
+            char* data[4];
+            data[0] = (char*)&ret;
+            data[1] = errTitle;
+            data[2] = name;
+            data[3] = GetErrorText(error);
+            SendMessage(hProgressDlg, WM_USER_DIALOG, 0, (LPARAM)data);
+            switch (ret)
+            {
+            case IDRETRY:
+                break;
+
+            case IDB_SKIPALL:
+                dlgData.SkipAllChangeAttrs = TRUE;
+            case IDB_SKIP:
+            {
+            SKIP_ATTRS_ERROR:
+
+                totalDone += size;
+                SetProgress(hProgressDlg, 0, CaclProg(totalDone, script->TotalSize), dlgData);
+                return TRUE;
+            }
+
+            case IDCANCEL:
+                return FALSE;
+            }
+        }
+    }
+}
+
+//
+// ****************************************************************************
+// CSmallFilesCopier
+//
+// Soubezne kopirovani malych souboru: pri kopirovani mnoha malych souboru prevazuje
+// cekani na otevreni/zavreni souboru (hlavne na sitovych discich) nad prenosem dat,
+// proto pomocne thready dopredu kopiruji male soubory z nasledujicich ocCopyFile
+// operaci skriptu (jen souvisly beh ocCopyFile operaci, dalsi operace muze napr.
+// vytvaret cilovy adresar). Pomocny thread zkousi jen "bezproblemovy" pripad (cil
+// neexistuje, zadne chyby); pri jakekoliv chybe po sobe uklidi a operaci provede
+// hlavni thread standardne pres DoCopyFile (vcetne dialogu chyb, prepisu, atd.).
+// Hlavni thread preda vysledky (progress, celkova velikost) v poradi operaci skriptu.
+// Pri cancelu (i z dialogu chyby drivejsi operace) se nezapocate operace z fronty zahodi
+// a soubory, ktere pomocne thready zkopirovaly dopredu a hlavni thread je jeste neprevzal,
+// se z cile smazou (pomocny thread je vytvari jen jako nove, viz CREATE_NEW).
+
+#define SMALLCOPY_MAX_FILE_SIZE (64 * 1024) // max. velikost souboru pro pomocne thready
+#define SMALLCOPY_THREADS 8                 // pocet pomocnych threadu
+#define SMALLCOPY_QUEUE_SIZE 64             // max. pocet operaci zarazenych dopredu
+
+enum CSmallCopyState
+{
+    scsWaiting, // ceka na pomocny thread
+    scsCopying, // pomocny thread ho prave kopiruje
+    scsDone,    // zkopirovano
+    scsFailed,  // nezkopirovano, operaci musi provest DoCopyFile
+};
+
+DWORD WINAPI ThreadSmallFilesCopier(void* param);
+
+class CSmallFilesCopier
+{
+protected:
+    struct CItem
+    {
+        int Index;             // index operace ve skriptu
+        COperationBuf Op;      // kopie operace s plnymi jmeny, viz COperations::GetOp()
+        CSmallCopyState State; // stav prvku (meni se v kriticke sekci CS)
+        DWORD Copied;          // pocet zkopirovanych bytu (pro scsDone)
+    };
+
+    COperations* Script;
+    DWORD ClearReadonlyMask;
+    HANDLE WorkerNotSuspended;
+    BOOL* CancelWorker;
+    BOOL Enabled; // FALSE = vse kopiruje hlavni thread (nevhodny skript nebo chyba pri startu threadu)
+
+    CRITICAL_SECTION CS; // sekce pro pristup k Queue a Taken
+    CItem Queue[SMALLCOPY_QUEUE_SIZE];
+    int Queued;    // pocet prvku zarazenych do fronty (jen hlavni thread)
+    int Taken;     // pocet prvku prevzatych pomocnymi thready
+    int Consumed;  // pocet prvku zpracovanych hlavnim threadem (jen hlavni thread)
+    int NextIndex; // index prvni operace skriptu, ktera jeste nebyla zvazena pro frontu
+
+    HANDLE WorkSem;    // pocet prvku cekajicich na pomocny thread
+    HANDLE DoneEvent;  // pomocny thread dokoncil prvek (auto-reset)
+    HANDLE AbortEvent; // pomocne thready maji skoncit (manual-reset)
+    HANDLE Threads[SMALLCOPY_THREADS];
+    int ThreadsCount;
+
+public:
+    CSmallFilesCopier(COperations* script, DWORD clearReadonlyMask, CProgressDlgData& dlgData);
+    ~CSmallFilesCopier();
+
+    // zaradi do fronty male soubory z behu ocCopyFile operaci od indexu 'index'
+    // (pri prvnim volani spusti pomocne thready)
+    void Prefetch(int index);
+
+    // pocka, az pomocny thread dokonci operaci 'index'; vraci TRUE pokud je soubor
+    // zkopirovany (v 'copied' vraci pocet zkopirovanych bytu), FALSE pokud operace
+    // nebyla ve fronte nebo se nepodarila (pak ji musi provest DoCopyFile)
+    BOOL TakeResult(int index, DWORD* copied);
+
+    // ukonci pomocne thready (konec skriptu, chyba nebo cancel), nezapocate prvky fronty
+    // se zahodi a neprevzate zkopirovane soubory se smazou
+    void Stop();
+
+protected:
+    BOOL IsSmallFileOp(COperation* op);
+    BOOL StartThreads();
+    BOOL CopySmallFile(COperation* op, char* buffer, DWORD* copied);
+
+    friend unsigned ThreadSmallFilesCopierBody(void* param);
+};
+
+CSmallFilesCopier::CSmallFilesCopier(COperations* script, DWORD clearReadonlyMask, CProgressDlgData& dlgData)
+{
+    Script = script;
+    ClearReadonlyMask = clearReadonlyMask;
+    WorkerNotSuspended = dlgData.WorkerNotSuspended;
+    CancelWorker = dlgData.CancelWorker;
+    // pri kopirovani atributu/security, na vymennych discich (maly buffer kvuli
+    // progressu) a pri kontrole zkopirovanych souboru zustavame u standardniho kopirovani
+    Enabled = Configuration.ConcurrentSmallCopy && !script->CopyAttrs && !script->CopySecurity &&
+              !script->RemovableSrcDisk && !script->RemovableTgtDisk && dlgData.Verifier == NULL;
+    HANDLES(InitializeCriticalSection(&CS));
+    Queued = Taken = Consumed = 0;
+    NextIndex = 0;
+    WorkSem = DoneEvent = AbortEvent = NULL;
+    ThreadsCount = 0;
+}
+
+CSmallFilesCopier::~CSmallFilesCopier()
+{
+    Stop();
+    HANDLES(DeleteCriticalSection(&CS));
+}
+
+BOOL CSmallFilesCopier::IsSmallFileOp(COperation* op)
+{
+    return op->FileSize <= CQuadWord(SMALLCOPY_MAX_FILE_SIZE, 0) &&
+           (op->OpFlags & (OPFL_COPY_ADS | OPFL_AS_ENCRYPTED)) == 0 &&
+           !FileNameIsInvalid(op->SourceName, TRUE) && !FileNameIsInvalid(op->TargetName, TRUE);
+}
+
+BOOL CSmallFilesCopier::StartThreads()
+{
+    WorkSem = HANDLES(CreateSemaphore(NULL, 0, LONG_MAX, NULL));
+    DoneEvent = HANDLES(CreateEvent(NULL, FALSE, FALSE, NULL));
+    AbortEvent = HANDLES(CreateEvent(NULL, TRUE, FALSE, NULL));
+    if (WorkSem != NULL && DoneEvent != NULL && AbortEvent != NULL)
+    {
+        for (ThreadsCount = 0; ThreadsCount < SMALLCOPY_THREADS; ThreadsCount++)
+        {
+            DWORD threadID;
+            Threads[ThreadsCount] = HANDLES(CreateThread(NULL, 0, ThreadSmallFilesCopier, this, 0, &threadID));
+            if (Threads[ThreadsCount] == NULL)
+                break;
+        }
+    }
+    if (ThreadsCount == 0)
+    {
+        TRACE_E("CSmallFilesCopier::StartThreads(): unable to start threads!");
+        Stop();
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void CSmallFilesCopier::Prefetch(int index)
+{
+    if (!Enabled)
+        return;
+    BOOL useSpeedLimit;
+    DWORD speedLimit;
+    Script->GetSpeedLimit(&useSpeedLimit, &speedLimit);
+    if (useSpeedLimit)
+        return; // omezeni rychlosti resi DoCopyFile, soubeh by ho jen obchazel
+
+    if (NextIndex < index)
+        NextIndex = index;
+    while (Script->IsOpAvailable(NextIndex) && Queued - Consumed < SMALLCOPY_QUEUE_SIZE)
+    {
+        // volny prvek fronty pomocne thready nepouzivaji, operaci nacteme primo do nej
+        CItem* item = &Queue[Queued % SMALLCOPY_QUEUE_SIZE];
+        COperation* op = Script->GetOp(NextIndex, &item->Op);
+        if (op->Opcode != ocCopyFile)
+            break; // konec behu ocCopyFile operaci
+        if (IsSmallFileOp(op))
+        {
+            if (ThreadsCount == 0 && !StartThreads())
+            {
+                Enabled = FALSE;
+                return;
+            }
+            HANDLES(EnterCriticalSection(&CS));
+            item->Index = NextIndex;
+            item->State = scsWaiting;
+            item->Copied = 0;
+            Queued++;
+            HANDLES(LeaveCriticalSection(&CS));
+            ReleaseSemaphore(WorkSem, 1, NULL);
+        }
+        NextIndex++;
+    }
+}
+
+BOOL CSmallFilesCopier::TakeResult(int index, DWORD* copied)
+{
+    while (Consumed < Queued)
+    {
+        CItem* item = &Queue[Consumed % SMALLCOPY_QUEUE_SIZE];
+        if (item->Index > index)
+            return FALSE; // operace neni ve fronte (velky soubor, atd.)
+
+        CSmallCopyState state;
+        while (1) // pockame na dokonceni prvku
+        {
+            HANDLES(EnterCriticalSection(&CS));
+            state = item->State;
+            HANDLES(LeaveCriticalSection(&CS));
+            if (state == scsDone || state == scsFailed)
+                break;
+            WaitForSingleObject(DoneEvent, INFINITE);
+        }
+        Consumed++;
+        if (item->Index == index)
+        {
+            *copied = item->Copied;
+            return state == scsDone;
+        }
+        TRACE_E("CSmallFilesCopier::TakeResult(): skipped operation in queue: index=" << item->Index);
+    }
+    return FALSE;
+}
+
+void CSmallFilesCopier::Stop()
+{
+    if (ThreadsCount > 0)
+    {
+        SetEvent(AbortEvent);
+        WaitForMultipleObjects(ThreadsCount, Threads, TRUE, INFINITE);
+        int i;
+        for (i = 0; i < ThreadsCount; i++)
+            HANDLES(CloseHandle(Threads[i]));
+        ThreadsCount = 0;
+    }
+    // soubory zkopirovane dopredu za mistem, kde skript skoncil (chyba nebo cancel),
+    // v cili nechavat nechceme
+    for (; Consumed < Queued; Consumed++)
+    {
+        CItem* item = &Queue[Consumed % SMALLCOPY_QUEUE_SIZE];
+        if (item->State == scsDone)
+        {
+            ClearReadOnlyAttr(item->Op.TargetName);
+            if (!DeleteFile(item->Op.TargetName))
+                TRACE_E("CSmallFilesCopier::Stop(): unable to delete copied file: " << item->Op.TargetName);
+        }
+    }
+    if (WorkSem != NULL)
+        HANDLES(CloseHandle(WorkSem));
+    if (DoneEvent != NULL)
+        HANDLES(CloseHandle(DoneEvent));
+    if (AbortEvent != NULL)
+        HANDLES(CloseHandle(AbortEvent));
+    WorkSem = DoneEvent = AbortEvent = NULL;
+    Queued = Taken = Consumed = 0;
+    Enabled = FALSE; // po zastaveni uz vse kopiruje hlavni thread
+}
+
+BOOL CSmallFilesCopier::CopySmallFile(COperation* op, char* buffer, DWORD* copied)
+{
+    // chyby se tu nehlasi, operaci s pripadnymi dialogy zopakuje hlavni thread v DoCopyFile
+    HANDLE in = HANDLES_Q(CreateFile(op->SourceName, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                                     OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL));
+    if (in == INVALID_HANDLE_VALUE)
+        return FALSE;
+    DWORD read = 0;
+    DWORD numRead;
+    BOOL ok;
+    // cteme az o byte vic, aby se poznalo, ze soubor mezitim narostl
+    while ((ok = ReadFile(in, buffer + read, SMALLCOPY_MAX_FILE_SIZE + 1 - read, &numRead, NULL)) != FALSE &&
+           numRead > 0)
+    {
+        read += numRead;
+        if (read > SMALLCOPY_MAX_FILE_SIZE)
+        {
+            ok = FALSE;
+            break;
+        }
+    }
+    FILETIME lastWrite;
+    if (ok && !GetFileTime(in, NULL, NULL, &lastWrite))
+        ok = FALSE;
+    HANDLES(CloseHandle(in));
+    if (!ok || WaitForSingleObject(AbortEvent, 0) == WAIT_OBJECT_0 || *CancelWorker)
+        return FALSE;
+
+    HANDLE out = HANDLES_Q(CreateFile(op->TargetName, GENERIC_WRITE, 0, NULL, CREATE_NEW,
+                                      FILE_FLAG_SEQUENTIAL_SCAN, NULL));
+    if (out == INVALID_HANDLE_VALUE)
+        return FALSE; // typicky cil existuje, prepis resi DoCopyFile
+    DWORD written;
+    ok = (read == 0 || WriteFile(out, buffer, read, &written, NULL) && written == read) &&
+         SetFileTime(out, NULL, NULL, &lastWrite);
+    if (!HANDLES(CloseHandle(out)))
+        ok = FALSE;
+    if (ok && !SetFileAttributes(op->TargetName, (op->Attr & ClearReadonlyMask) | FILE_ATTRIBUTE_ARCHIVE))
+        ok = FALSE;
+    if (!ok)
+    {
+        ClearReadOnlyAttr(op->TargetName);
+        DeleteFile(op->TargetName);
+        return FALSE;
+    }
+    *copied = read;
+    return TRUE;
+}
+
+unsigned ThreadSmallFilesCopierBody(void* param)
+{
+    CALL_STACK_MESSAGE1("ThreadSmallFilesCopierBody()");
+    SetThreadNameInVCAndTrace("SmallFilesCopier");
+    CSmallFilesCopier* copier = (CSmallFilesCopier*)param;
+
+    char* buffer = (char*)malloc(SMALLCOPY_MAX_FILE_SIZE + 1);
+    HANDLE work[2] = {copier->AbortEvent, copier->WorkSem};
+    HANDLE resume[2] = {copier->AbortEvent, copier->WorkerNotSuspended};
+    while (WaitForMultipleObjects(2, work, FALSE, INFINITE) == WAIT_OBJECT_0 + 1)
+    {
+        HANDLES(EnterCriticalSection(&copier->CS));
+        CSmallFilesCopier::CItem* item = &copier->Queue[copier->Taken++ % SMALLCOPY_QUEUE_SIZE];
+        item->State = scsCopying;
+        COperation* op = &item->Op; // prvek se do zpracovani hlavnim threadem nemeni
+        HANDLES(LeaveCriticalSection(&copier->CS));
+
+        // pokud mame byt v suspend-modu, cekame ...
+        BOOL abort = WaitForMultipleObjects(2, resume, FALSE, INFINITE) != WAIT_OBJECT_0 + 1;
+        DWORD copied = 0;
+        BOOL ok = buffer != NULL && !abort && !*copier->CancelWorker &&
+                  copier->CopySmallFile(op, buffer, &copied);
+
+        HANDLES(EnterCriticalSection(&copier->CS));
+        item->State = ok ? scsDone : scsFailed;
+        item->Copied = copied;
+        HANDLES(LeaveCriticalSection(&copier->CS));
+        SetEvent(copier->DoneEvent);
+        if (abort)
+            break;
+    }
+    if (buffer != NULL)
+        free(buffer);
+    return 0;
+}
+
+unsigned ThreadSmallFilesCopierEH(void* param)
+{
+#ifndef CALLSTK_DISABLE
+    __try
+    {
+#endif // CALLSTK_DISABLE
+        return ThreadSmallFilesCopierBody(param);
+#ifndef CALLSTK_DISABLE
+    }
+    __except (CCallStack::HandleException(GetExceptionInformation()))
+    {
+        TRACE_I("Thread SmallFilesCopier: calling ExitProcess(1).");
+        //    ExitProcess(1);
+        TerminateProcess(GetCurrentProcess(), 1); // tvrdsi exit (tenhle jeste neco vola)
+        return 1;
+    }
+#endif // CALLSTK_DISABLE
+}
+
+DWORD WINAPI ThreadSmallFilesCopier(void* param)
+{
+    CCallStack stack;
+    return ThreadSmallFilesCopierEH(param);
+}
+
+//
+// ****************************************************************************
+// CParallelDeleter
+//
+// Soubezne mazani souboru: pri mazani velkeho stromu (statisice souboru) prevazuje
+// cekani na jednotlive DeleteFile (hlavne na sitovych discich), proto pomocne thready
+// dopredu mazou soubory z nasledujicich ocDeleteFile operaci skriptu. Skript maze
+// adresare az po jejich obsahu (ocDeleteDir/ocDeleteDirLink jsou za soubory v nich),
+// adresare maze dal hlavni thread v poradi skriptu, az kdyz prevzal vysledky vsech
+// predchozich souboru, takze pri zarazovani do fronty se operace adresaru jen preskoci.
+// Pomocny thread zkousi jen "bezproblemovy" pripad (bez kose, bez dotazu na mazani
+// hidden/system souboru); pri chybe operaci provede hlavni thread standardne pres
+// DoDeleteFile (vcetne dialogu chyb). Pocet soubezne mazanych souboru je omezen poctem
+// pomocnych threadu, ktery se ridi typem zdrojoveho disku. Smazani nejde vratit, proto
+// se dopredu zarazuje jen par souboru na pomocny thread a behem operaci provadenych
+// hlavnim threadem (muzou zobrazit dialog chyby nebo dotaz) pomocne thready nezacinaji
+// mazat dalsi soubory; pri cancelu nebo chybe se nezapocate operace z fronty zahodi a
+// ceka se jen na dokonceni prave probihajicich mazani.
+
+#define PARDELETE_THREADS 8          // pocet pomocnych threadu (lokalni disk bez seekovani, napr. SSD)
+#define PARDELETE_THREADS_NET 16     // pocet pomocnych threadu pro sitovy disk (ceka se hlavne na odezvu serveru)
+#define PARDELETE_THREADS_SPINNING 2 // pocet pomocnych threadu pro rotacni disk (vic soubeznych pozadavku jen pridava seekovani)
+#define PARDELETE_QUEUE_PER_THREAD 2 // max. pocet operaci zarazenych dopredu na jeden pomocny thread
+#define PARDELETE_QUEUE_SIZE (PARDELETE_QUEUE_PER_THREAD * PARDELETE_THREADS_NET)
+
+enum CParDeleteState
+{
+    pdsWaiting,  // ceka na pomocny thread
+    pdsDeleting, // pomocny thread ho prave maze
+    pdsDone,     // smazano
+    pdsFailed,   // nesmazano, operaci musi provest DoDeleteFile
+};
+
+DWORD WINAPI ThreadParallelDeleter(void* param);
+
+class CParallelDeleter
+{
+protected:
+    struct CItem
+    {
+        int Index;             // index operace ve skriptu
+        COperationBuf Op;      // kopie operace s plnymi jmeny, viz COperations::GetOp()
+        CParDeleteState State; // stav prvku (meni se v kriticke sekci CS)
+    };
+
+    COperations* Script;
+    CProgressDlgData* DlgData; // DeleteHiddenAll a CnfrmSHFileDel cte jen hlavni thread (v Prefetch)
+    HANDLE WorkerNotSuspended;
+    BOOL* CancelWorker;
+    BOOL Enabled; // FALSE = vse maze hlavni thread (maze se do kose nebo chyba pri startu threadu)
+
+    CRITICAL_SECTION CS; // sekce pro pristup k Queue a Taken
+    CItem Queue[PARDELETE_QUEUE_SIZE];
+    int Queued;    // pocet prvku zarazenych do fronty (jen hlavni thread)
+    int Taken;     // pocet prvku prevzatych pomocnymi thready
+    int Consumed;  // pocet prvku zpracovanych hlavnim threadem (jen hlavni thread)
+    int NextIndex; // index prvni operace skriptu, ktera jeste nebyla zvazena pro frontu
+
+    HANDLE WorkSem;    // pocet prvku cekajicich na pomocny thread
+    HANDLE DoneEvent;  // pomocny thread dokoncil prvek (auto-reset)
+    HANDLE AbortEvent; // pomocne thready maji skoncit (manual-reset)
+    HANDLE RunEvent;   // pomocne thready smi zacit mazat dalsi prvek (manual-reset, viz Pause())
+    HANDLE Threads[PARDELETE_THREADS_NET];
+    int ThreadsCount;
+
+public:
+    CParallelDeleter(COperations* script, CProgressDlgData& dlgData);
+    ~CParallelDeleter();
+
+    // zaradi do fronty soubory z behu mazacich operaci od indexu 'index'
+    // (pri prvnim volani spusti pomocne thready)
+    void Prefetch(int index);
+
+    // pocka, az pomocny thread dokonci operaci 'index'; vraci TRUE pokud je soubor
+    // smazany, FALSE pokud operace nebyla ve fronte nebo se nepodarila (pak ji musi
+    // provest DoDeleteFile)
+    BOOL TakeResult(int index);
+
+    // pomocne thready nezacnou mazat dalsi soubory, dokud se nezavola Continue()
+    // (hlavni thread provadi operaci, ktera muze zobrazit dialog; probihajici mazani
+    // se dokonci)
+    void Pause();
+    void Continue();
+
+    // ukonci pomocne thready (konec skriptu, chyba nebo cancel), nezapocate prvky fronty
+    // se zahodi
+    void Stop();
+
+protected:
+    BOOL IsSimpleDeleteOp(COperation* op);
+    BOOL StartThreads();
+
+    friend unsigned ThreadParallelDeleterBody(void* param);
+};
+
+CParallelDeleter::CParallelDeleter(COperations* script, CProgressDlgData& dlgData)
+{
+    Script = script;
+    DlgData = &dlgData;
+    WorkerNotSuspended = dlgData.WorkerNotSuspended;
+    CancelWorker = dlgData.CancelWorker;
+    // pri mazani do kose (i jen podle masek) zustavame u standardniho mazani, SHFileOperation
+    // s kosem soubezne volat nechceme
+    BOOL recycleBin = script->CanUseRecycleBin &&
+                      (dlgData.UseRecycleBin == 0 ? script->InvertRecycleBin : !script->InvertRecycleBin);
+    Enabled = Configuration.ParallelDelete && !recycleBin;
+    HANDLES(InitializeCriticalSection(&CS));
+    Queued = Taken = Consumed = 0;
+    NextIndex = 0;
+    WorkSem = DoneEvent = AbortEvent = RunEvent = NULL;
+    ThreadsCount = 0;
+}
+
+CParallelDeleter::~CParallelDeleter()
+{
+    Stop();
+    HANDLES(DeleteCriticalSection(&CS));
+}
+
+BOOL CParallelDeleter::IsSimpleDeleteOp(COperation* op)
+{
+    // hidden/system soubory jen pokud se na ne DoDeleteFile nebude ptat
+    return ((op->Attr & (FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM)) == 0 ||
+            DlgData->DeleteHiddenAll || !DlgData->CnfrmSHFileDel) &&
+           !FileNameIsInvalid(op->SourceName, TRUE);
+}
+
+BOOL CParallelDeleter::StartThreads()
+{
+    int threads = PARDELETE_THREADS;
+    if (Script->SourcePathIsNetwork)
+        threads = PARDELETE_THREADS_NET;
+    else if (Script->SrcSpinningDisk != -1)
+        threads = PARDELETE_THREADS_SPINNING;
+
+    WorkSem = HANDLES(CreateSemaphore(NULL, 0, LONG_MAX, NULL));
+    DoneEvent = HANDLES(CreateEvent(NULL, FALSE, FALSE, NULL));
+    AbortEvent = HANDLES(CreateEvent(NULL, TRUE, FALSE, NULL));
+    RunEvent = HANDLES(CreateEvent(NULL, TRUE, TRUE, NULL));
+    if (WorkSem != NULL && DoneEvent != NULL && AbortEvent != NULL && RunEvent != NULL)
+    {
+        for (ThreadsCount = 0; ThreadsCount < threads; ThreadsCount++)
+        {
+            DWORD threadID;
+            Threads[ThreadsCount] = HANDLES(CreateThread(NULL, 0, ThreadParallelDeleter, this, 0, &threadID));
+            if (Threads[ThreadsCount] == NULL)
+                break;
         }
-        if (showCompressErr || showEncryptErr)
-        {
-            WaitForSingleObject(dlgData.WorkerNotSuspended, INFINITE); // pokud mame byt v suspend-modu, cekame ...
-            if (*dlgData.CancelWorker)
-                return FALSE;
+    }
+    if (ThreadsCount == 0)
+    {
+        TRACE_E("CParallelDeleter::StartThreads(): unable to start threads!");
+        Stop();
+        return FALSE;
+    }
+    return TRUE;
+}
 
-            if (showCompressErr)
-                changeCompression = FALSE;
-            if (showEncryptErr)
-                changeEncryption = FALSE;
-            char* data[3];
-            data[0] = LoadStr((showCompressErr && (attrs & FILE_ATTRIBUTE_COMPRESSED) || !showEncryptErr) ? IDS_ERRORCOMPRESSING : IDS_ERRORENCRYPTING);
-            data[1] = name;
-            data[2] = LoadStr((showCompressErr && (attrs & FILE_ATTRIBUTE_COMPRESSED) || !showEncryptErr) ? IDS_COMPRNOTSUPPORTED : IDS_ENCRYPNOTSUPPORTED);
-            SendMessage(hProgressDlg, WM_USER_DIALOG, 5, (LPARAM)data);
-            error = ERROR_SUCCESS;
-        }
-        if (error == ERROR_SUCCESS && SetFileAttributes(nameSetAttrs, attrs))
+void CParallelDeleter::Prefetch(int index)
+{
+    if (!Enabled)
+        return;
+
+    if (NextIndex < index)
+        NextIndex = index;
+    // pred spustenim threadu staci misto pro prvni prvek, pak podle poctu threadu
+    while (Script->IsOpAvailable(NextIndex) &&
+           Queued - Consumed < PARDELETE_QUEUE_PER_THREAD * max(ThreadsCount, 1))
+    {
+        // volny prvek fronty pomocne thready nepouzivaji, operaci nacteme primo do nej
+        CItem* item = &Queue[Queued % PARDELETE_QUEUE_SIZE];
+        COperation* op = Script->GetOp(NextIndex, &item->Op);
+        if (op->Opcode != ocDeleteFile && op->Opcode != ocDeleteDir && op->Opcode != ocDeleteDirLink)
+            break; // konec behu mazacich operaci
+        if (op->Opcode == ocDeleteFile && IsSimpleDeleteOp(op))
         {
-            BOOL isDir = ((attrs & FILE_ATTRIBUTE_DIRECTORY) != 0);
-            // pokud mame nastavit jeden z casu
-            if (timeModified != NULL || timeCreated != NULL || timeAccessed != NULL)
+            if (ThreadsCount == 0 && !StartThreads())
             {
-                HANDLE file;
-                if (attrs & FILE_ATTRIBUTE_READONLY)
-                    SetFileAttributes(nameSetAttrs, attrs & (~FILE_ATTRIBUTE_READONLY));
-                file = HANDLES_Q(CreateFile(nameSetAttrs, GENERIC_READ | GENERIC_WRITE,
-                                            FILE_SHARE_READ | FILE_SHARE_WRITE,
-                                            NULL, OPEN_EXISTING, isDir ? FILE_FLAG_BACKUP_SEMANTICS : 0, NULL));
-                if (file != INVALID_HANDLE_VALUE)
-                {
-                    FILETIME ftCreated, ftAccessed, ftModified;
-                    GetFileTime(file, &ftCreated, &ftAccessed, &ftModified);
-                    if (timeCreated != NULL)
-                        ftCreated = *timeCreated;
-                    if (timeAccessed != NULL)
-                        ftAccessed = *timeAccessed;
-                    if (timeModified != NULL)
-                        ftModified = *timeModified;
-                    SetFileTime(file, &ftCreated, &ftAccessed, &ftModified);
-                    HANDLES(CloseHandle(file));
-                    if (attrs & FILE_ATTRIBUTE_READONLY)
-                        SetFileAttributes(nameSetAttrs, attrs);
-                }
-                else
-                {
-                    if (attrs & FILE_ATTRIBUTE_READONLY)
-                        SetFileAttributes(nameSetAttrs, attrs);
-                    goto SHOW_ERROR;
-                }
+                Enabled = FALSE;
+                return;
             }
-            totalDone += size;
-            SetProgress(hProgressDlg, 0, CaclProg(totalDone, script->TotalSize), dlgData);
-            return TRUE;
+            HANDLES(EnterCriticalSection(&CS));
+            item->Index = NextIndex;
+            item->State = pdsWaiting;
+            Queued++;
+            HANDLES(LeaveCriticalSection(&CS));
+            ReleaseSemaphore(WorkSem, 1, NULL);
         }
-        else
-        {
-        SHOW_ERROR:
+        NextIndex++;
+    }
+}
 
-            if (error == ERROR_SUCCESS)
-                error = GetLastError();
-            if (errTitle == NULL)
-                errTitle = LoadStr(IDS_ERRORCHANGINGATTRS);
+BOOL CParallelDeleter::TakeResult(int index)
+{
+    while (Consumed < Queued)
+    {
+        CItem* item = &Queue[Consumed % PARDELETE_QUEUE_SIZE];
+        if (item->Index > index)
+            return FALSE; // operace neni ve fronte (adresar, hidden soubor, atd.)
 
-            WaitForSingleObject(dlgData.WorkerNotSuspended, INFINITE); // pokud mame byt v suspend-modu, cekame ...
-            if (*dlgData.CancelWorker)
-                return FALSE;
+        CParDeleteState state;
+        while (1) // pockame na dokonceni prvku
+        {
+            HANDLES(EnterCriticalSection(&CS));
+            state = item->State;
+            HANDLES(LeaveCriticalSection(&CS));
+            if (state == pdsDone || state == pdsFailed)
+                break;
+            WaitForSingleObject(DoneEvent, INFINITE);
+        }
+        Consumed++;
+        if (item->Index == index)
+            return state == pdsDone;
+        TRACE_E("CParallelDeleter::TakeResult(): skipped operation in queue: index=" << item->Index);
+    }
+    return FALSE;
+}
 
-            if (dlgData.SkipAllChangeAttrs)
-                goto SKIP_ATTRS_ERROR;
+void CParallelDeleter::Pause()
+{
+    if (RunEvent != NULL)
+        ResetEvent(RunEvent);
+}
 
-            int ret;
-            ret = IDCANCEL;
-            char* data[4];
-            data[0] = (char*)&ret;
-            data[1] = errTitle;
-            data[2] = name;
-            data[3] = GetErrorText(error);
-            SendMessage(hProgressDlg, WM_USER_DIALOG, 0, (LPARAM)data);
-            switch (ret)
-            {
-            case IDRETRY:
-                break;
+void CParallelDeleter::Continue()
+{
+    if (RunEvent != NULL)
+        SetEvent(RunEvent);
+}
 
-            case IDB_SKIPALL:
-                dlgData.SkipAllChangeAttrs = TRUE;
-            case IDB_SKIP:
-            {
-            SKIP_ATTRS_ERROR:
+void CParallelDeleter::Stop()
+{
+    if (ThreadsCount > 0)
+    {
+        SetEvent(AbortEvent);
+        WaitForMultipleObjects(ThreadsCount, Threads, TRUE, INFINITE);
+        int i;
+        for (i = 0; i < ThreadsCount; i++)
+            HANDLES(CloseHandle(Threads[i]));
+        ThreadsCount = 0;
+    }
+    if (WorkSem != NULL)
+        HANDLES(CloseHandle(WorkSem));
+    if (DoneEvent != NULL)
+        HANDLES(CloseHandle(DoneEvent));
+    if (AbortEvent != NULL)
+        HANDLES(CloseHandle(AbortEvent));
+    if (RunEvent != NULL)
+        HANDLES(CloseHandle(RunEvent));
+    WorkSem = DoneEvent = AbortEvent = RunEvent = NULL;
+    Queued = Taken = Consumed = 0;
+    Enabled = FALSE; // po zastaveni uz vse maze hlavni thread
+}
 
-                totalDone += size;
-                SetProgress(hProgressDlg, 0, CaclProg(totalDone, script->TotalSize), dlgData);
-                return TRUE;
-            }
+unsigned ThreadParallelDeleterBody(void* param)
+{
+    CALL_STACK_MESSAGE1("ThreadParallelDeleterBody()");
+    SetThreadNameInVCAndTrace("ParallelDeleter");
+    CParallelDeleter* deleter = (CParallelDeleter*)param;
+
+    HANDLE work[2] = {deleter->AbortEvent, deleter->WorkSem};
+    HANDLE resume[2] = {deleter->AbortEvent, deleter->WorkerNotSuspended};
+    HANDLE run[2] = {deleter->AbortEvent, deleter->RunEvent};
+    while (WaitForMultipleObjects(2, work, FALSE, INFINITE) == WAIT_OBJECT_0 + 1)
+    {
+        HANDLES(EnterCriticalSection(&deleter->CS));
+        CParallelDeleter::CItem* item = &deleter->Queue[deleter->Taken++ % PARDELETE_QUEUE_SIZE];
+        item->State = pdsDeleting;
+        COperation* op = &item->Op; // prvek se do zpracovani hlavnim threadem nemeni
+        HANDLES(LeaveCriticalSection(&deleter->CS));
+
+        // pokud mame byt v suspend-modu nebo hlavni thread provadi operaci s moznym
+        // dialogem (viz CParallelDeleter::Pause()), cekame ...
+        BOOL abort = WaitForMultipleObjects(2, resume, FALSE, INFINITE) != WAIT_OBJECT_0 + 1 ||
+                     WaitForMultipleObjects(2, run, FALSE, INFINITE) != WAIT_OBJECT_0 + 1;
+        BOOL ok = FALSE;
+        if (!abort && !*deleter->CancelWorker)
+        {
+            // chyby se tu nehlasi, operaci s pripadnym dialogem zopakuje hlavni thread v DoDeleteFile
+            BOOL attrCleared = ClearReadOnlyAttr(op->SourceName, op->Attr); // aby sel smazat ...
+            ok = DeleteFile(op->SourceName);
+            if (!ok && attrCleared)
+                SetFileAttributes(op->SourceName, op->Attr);
+        }
+
+        HANDLES(EnterCriticalSection(&deleter->CS));
+        item->State = ok ? pdsDone : pdsFailed;
+        HANDLES(LeaveCriticalSection(&deleter->CS));
+        SetEvent(deleter->DoneEvent);
+        if (abort)
+            break;
+    }
+    return 0;
+}
 
-            case IDCANCEL:
-                return FALSE;
-            }
-        }
+unsigned ThreadParallelDeleterEH(void* param)
+{
+#ifndef CALLSTK_DISABLE
+    __try
+    {
+#endif // CALLSTK_DISABLE
+        return ThreadParallelDeleterBody(param);
+#ifndef CALLSTK_DISABLE
+    }
+    __except (CCallStack::HandleException(GetExceptionInformation()))
+    {
+        TRACE_I("Thread ParallelDeleter: calling ExitProcess(1).");
+        //    ExitProcess(1);
+        TerminateProcess(GetCurrentProcess(), 1); // tvrdsi exit (tenhle jeste neco vola)
+        return 1;
     }
+#endif // CALLSTK_DISABLE
+}
+
+DWORD WINAPI ThreadParallelDeleter(void* param)
+{
+    CCallStack stack;
+    return ThreadParallelDeleterEH(param);
 }
 
 unsigned ThreadWorkerBody(void* parameter)
@@ -7827,7 +9548,8 @@ unsigned ThreadWorkerBody(void* parameter)
                                                             dlgData.FileOutLossEncrAll = dlgData.SkipAllDirCrLossEncr =
                                                                 dlgData.DirCrLossEncrAll = dlgData.IgnoreAllGetFileTimeErr =
                                                                     dlgData.IgnoreAllSetFileTimeErr = dlgData.SkipAllGetFileTime =
-                                                                        dlgData.SkipAllSetFileTime = FALSE;
+                                                                        dlgData.SkipAllSetFileTime = dlgData.SkipAllVerify = FALSE;
+    dlgData.Verifier = NULL;
     dlgData.CnfrmFileOver = Configuration.CnfrmFileOver;
     dlgData.CnfrmDirOver = Configuration.CnfrmDirOver;
     dlgData.CnfrmSHFileOver = Configuration.CnfrmSHFileOver;
@@ -7878,6 +9600,14 @@ unsigned ThreadWorkerBody(void* parameter)
     BOOL novellRenamePatch = FALSE; // TRUE pokud je nutne odstranovat read-only atribut pred volanim MoveFile (nutne na Novellu)
     char* tgtBuffer = NULL;         // prekladovy buffer pro ocConvert
     CAsyncCopyParams* asyncPar = NULL;
+    CCopyVerifier copyVerifier(dlgData);
+    if (buffer != NULL && Configuration.VerifyCopy && script->IsCopyOrMoveOperation &&
+        copyVerifier.Start(Configuration.CopyChecksumManifest ? script->TargetPath : ""))
+    {
+        dlgData.Verifier = &copyVerifier;
+    }
+    CSmallFilesCopier smallFilesCopier(script, clearReadonlyMask, dlgData);
+    CParallelDeleter parallelDeleter(script, dlgData);
     if (buffer != NULL)
     {
         // nacteme retezce dopredu, aby se to nedelalo pro kazdou operaci zvlast (plni se rychle LoadStr buffer + brzdi)
@@ -7899,9 +9629,11 @@ unsigned ThreadWorkerBody(void* parameter)
         lstrcpyn(opChangAttrs, LoadStr(IDS_CHANGINGATTRS), 50);
 
         int i;
-        for (i = 0; !*dlgData.CancelWorker && i < script->Count; i++)
+        for (i = 0; !*dlgData.CancelWorker && script->HasOp(i); i++)
         {
-            COperation* op = &script->At(i);
+            COperationBuf opBuf; // pracujeme s kopii operace s plnymi jmeny, viz COperations::GetOp()
+            COperation* op = script->GetOp(i, &opBuf);
+            int opIndex = i; // 'i' se muze behem operace posunout (skip vytvareni adresare)
 
             switch (op->Opcode)
             {
@@ -7917,12 +9649,36 @@ unsigned ThreadWorkerBody(void* parameter)
 
                 BOOL lantasticCheck = IsLantasticDrive(op->TargetName, lastLantasticCheckRoot, lastIsLantasticPath);
 
-                Error = !DoCopyFile(op, hProgressDlg, buffer, script, totalDone,
-                                    clearReadonlyMask, NULL, lantasticCheck, mustDeleteFileBeforeOverwrite,
-                                    allocWholeFileOnStart, dlgData,
-                                    (op->OpFlags & OPFL_COPY_ADS) != 0,
-                                    (op->OpFlags & OPFL_AS_ENCRYPTED) != 0,
-                                    FALSE, asyncPar);
+                if (!lantasticCheck) // na Lantasticu se musi kontrolovat velikost ciloveho souboru, to dela jen DoCopyFile
+                    smallFilesCopier.Prefetch(i);
+                DWORD copied;
+                if (smallFilesCopier.TakeResult(i, &copied))
+                { // soubor uz zkopiroval pomocny thread, jen zapocteme progress jako v DoCopyFile
+                    CQuadWord lastTransferredFileSize;
+                    script->GetTFSandResetTrSpeedIfNeeded(&lastTransferredFileSize);
+                    int limitBufferSize = OPERATION_BUFFER;
+                    script->SetTFSandProgressSize(lastTransferredFileSize, totalDone, &limitBufferSize, OPERATION_BUFFER);
+                    script->SetFileStartParams();
+                    if (copied > 0)
+                        script->AddBytesToSpeedMetersAndTFSandPS(copied, FALSE, OPERATION_BUFFER, &limitBufferSize);
+                    if (CQuadWord(copied, 0) < COPY_MIN_FILE_SIZE)
+                    {
+                        script->AddBytesToSpeedMetersAndTFSandPS((DWORD)(COPY_MIN_FILE_SIZE - CQuadWord(copied, 0)).Value,
+                                                                 TRUE, 0, NULL, MAX_OP_FILESIZE);
+                    }
+                    totalDone += op->Size;
+                    script->SetProgressSize(totalDone);
+                    SetProgress(hProgressDlg, 0, CaclProg(totalDone, script->TotalSize), dlgData);
+                }
+                else
+                {
+                    Error = !DoCopyFile(op, hProgressDlg, buffer, script, totalDone,
+                                        clearReadonlyMask, NULL, lantasticCheck, mustDeleteFileBeforeOverwrite,
+                                        allocWholeFileOnStart, dlgData,
+                                        (op->OpFlags & OPFL_COPY_ADS) != 0,
+                                        (op->OpFlags & OPFL_AS_ENCRYPTED) != 0,
+                                        FALSE, asyncPar);
+                }
                 break;
             }
 
@@ -7974,17 +9730,20 @@ unsigned ThreadWorkerBody(void* parameter)
                         // preskocime vsechny operace skriptu az do znacky uzavreni tohoto adresare
                         CQuadWord skipTotal(0, 0);
                         int createDirIndex = i;
-                        while (++i < script->Count)
+                        BOOL labelFound = FALSE;
+                        while (script->HasOp(++i))
                         {
-                            COperation* oper = &script->At(i);
+                            COperationBuf skipOp;
+                            COperation* oper = script->GetOp(i, &skipOp);
                             if (oper->Opcode == ocLabelForSkipOfCreateDir && (int)oper->Attr == createDirIndex)
                             {
                                 script->AddBytesToTFS(CQuadWord((DWORD)(DWORD_PTR)oper->SourceName, (DWORD)(DWORD_PTR)oper->TargetName));
+                                labelFound = TRUE;
                                 break;
                             }
                             skipTotal += oper->Size;
                         }
-                        if (i == script->Count)
+                        if (!labelFound)
                         {
                             i = createDirIndex;
                             TRACE_E("ThreadWorkerBody(): unable to find end-label for dir-create operation: opcode=" << op->Opcode << ", index=" << i);
@@ -8012,19 +9771,28 @@ unsigned ThreadWorkerBody(void* parameter)
                 // najdeme skip-label, u nej je index create-dir operace a v ni je ulozene, jestli
                 // cilovy adresar uz existoval nebo jestli jsme ho vytvareli (datum&cas se kopiruje
                 // jen pokud jsme adresar vytvareli)
+                COperationBuf labelBuf;
                 COperation* skipLabel = NULL;
-                if (i + 1 < script->Count && script->At(i + 1).Opcode == ocLabelForSkipOfCreateDir)
-                    skipLabel = &script->At(i + 1);
-                else
+                if (script->HasOp(i + 1))
                 {
-                    if (i + 2 < script->Count && script->At(i + 2).Opcode == ocLabelForSkipOfCreateDir)
-                        skipLabel = &script->At(i + 2);
+                    skipLabel = script->GetOp(i + 1, &labelBuf);
+                    if (skipLabel->Opcode != ocLabelForSkipOfCreateDir)
+                    {
+                        skipLabel = NULL;
+                        if (script->HasOp(i + 2))
+                        {
+                            skipLabel = script->GetOp(i + 2, &labelBuf);
+                            if (skipLabel->Opcode != ocLabelForSkipOfCreateDir)
+                                skipLabel = NULL;
+                        }
+                    }
                 }
                 if (skipLabel != NULL)
                 {
-                    if (skipLabel->Attr < (DWORD)script->Count)
+                    if ((int)skipLabel->Attr >= 0 && script->IsOpAvailable((int)skipLabel->Attr))
                     {
-                        COperation* crDir = &script->At(skipLabel->Attr);
+                        COperationBuf crDirBuf;
+                        COperation* crDir = script->GetOp((int)skipLabel->Attr, &crDirBuf);
                         if (crDir->Opcode == ocCreateDir && (crDir->OpFlags & OPFL_AS_ENCRYPTED) == 0)
                         {
                             if (crDir->Attr == 0x10000000 /* dir already existed */)
@@ -8081,13 +9849,25 @@ unsigned ThreadWorkerBody(void* parameter)
 
                 SetProgress(hProgressDlg, 0, CaclProg(totalDone, script->TotalSize), dlgData);
 
+                parallelDeleter.Prefetch(i);
                 if (op->Opcode == ocDeleteFile)
                 {
-                    Error = !DoDeleteFile(hProgressDlg, op->SourceName, op->Size,
-                                          script, totalDone, op->Attr, dlgData);
+                    if (parallelDeleter.TakeResult(i))
+                    { // soubor uz smazal pomocny thread, jen zapocteme progress jako v DoDeleteFile
+                        totalDone += op->Size;
+                        SetProgress(hProgressDlg, 0, CaclProg(totalDone, script->TotalSize), dlgData);
+                    }
+                    else
+                    {
+                        parallelDeleter.Pause(); // muze se zobrazit dialog, po cancelu uz nesmi ubyt dalsi soubory
+                        Error = !DoDeleteFile(hProgressDlg, op->SourceName, op->Size,
+                                              script, totalDone, op->Attr, dlgData);
+                        parallelDeleter.Continue();
+                    }
                 }
                 else
                 {
+                    parallelDeleter.Pause(); // muze se zobrazit dialog, po cancelu uz nesmi ubyt dalsi soubory
                     if (op->Opcode == ocDeleteDir)
                     {
                         Error = !DoDeleteDir(hProgressDlg, op->SourceName, op->Size,
@@ -8099,6 +9879,7 @@ unsigned ThreadWorkerBody(void* parameter)
                         Error = !DoDeleteDirLink(hProgressDlg, op->SourceName, op->Size,
                                                  script, totalDone, dlgData);
                     }
+                    parallelDeleter.Continue();
                 }
                 break;
             }
@@ -8155,10 +9936,15 @@ unsigned ThreadWorkerBody(void* parameter)
             case ocLabelForSkipOfCreateDir:
                 break; // zadna cinnost
             }
+            script->SetOp(opIndex, op); // vratime zmeny operace do skriptu (Attr u ocCreateDir)
             if (Error)
                 break;
             WaitForSingleObject(dlgData.WorkerNotSuspended, INFINITE); // pokud mame byt v suspend-modu, cekame ...
         }
+        smallFilesCopier.Stop();
+        parallelDeleter.Stop();
+        copyVerifier.Stop(); // zavre i SFV soubor s kontrolnimi soucty
+        dlgData.Verifier = NULL;
         if (!Error && !*dlgData.CancelWorker && i == script->Count && totalDone != script->TotalSize &&
             (totalDone != CQuadWord(0, 0) || script->TotalSize != CQuadWord(1, 0))) // umyslna zmena script->TotalSize na jednicku (opatreni proti deleni nulou)
         {
@@ -8188,6 +9974,12 @@ unsigned ThreadWorkerBody(void* parameter)
         free(tgtBuffer);
     if (bufferIsAllocated)
         free(buffer);
+    if (script->Streaming)
+    { // skript jeste muze stavet hlavni thread, pred jeho uvolnenim musime pockat na konec stavby
+        script->AbortStreaming(); // pokud stavba jeste bezi, uz ji nepotrebujeme (cancel, chyba)
+        if (!script->WaitForBuildEnd() && !*dlgData.CancelWorker)
+            Error = TRUE; // stavba skriptu byla prerusena, zbytek operace se neprovedl
+    }
     *dlgData.CancelWorker = Error;                  // pokud jde o Cancel, dame to najevo ...
     SendMessage(hProgressDlg, WM_COMMAND, IDOK, 0); // koncime ...
     WaitForSingleObject(wContinue, INFINITE);       // potrebujeme zastavit hl.thread
@@ -8276,13 +10068,7 @@ void FreeScript(COperations* script)
         return;
     int i;
     for (i = 0; i < script->Count; i++)
-    {
-        COperation* op = &script->At(i);
-        if (op->SourceName != NULL && op->Opcode != ocCopyDirTime && op->Opcode != ocLabelForSkipOfCreateDir)
-            free(op->SourceName);
-        if (op->TargetName != NULL && op->Opcode != ocChangeAttrs && op->Opcode != ocLabelForSkipOfCreateDir)
-            free(op->TargetName);
-    }
+        COperations::FreeNames(&script->At(i));
     if (script->WaitInQueueSubject != NULL)
         free(script->WaitInQueueSubject);
     if (script->WaitInQueueFrom != NULL)
@@ -8292,7 +10078,54 @@ void FreeScript(COperations* script)
     delete script;
 }
 
-BOOL COperationsQueue::AddOperation(HWND dlg, BOOL startOnIdle, BOOL* startPaused)
+BOOL COperationsQueue::IsDiskBusy(DWORD srcDisk, DWORD tgtDisk, int skipIndex)
+{
+    int i;
+    for (i = 0; i < OperDisks.Count; i++)
+    {
+        if (i != skipIndex && OperPaused[i] == 0 /* running */)
+        {
+            COperDisks* d = &OperDisks[i];
+            if (srcDisk != -1 && (d->SrcDisk == srcDisk || d->TgtDisk == srcDisk) ||
+                tgtDisk != -1 && (d->SrcDisk == tgtDisk || d->TgtDisk == tgtDisk))
+            {
+                return TRUE;
+            }
+        }
+    }
+    return FALSE;
+}
+
+void COperationsQueue::ResumeWaitingOperations(HWND dlg, HWND* foregroundWnd)
+{
+    int j;
+    for (j = 0; j < OperPaused.Count && OperPaused[j] == 1 /* auto-paused */; j++)
+        ; // operace cekajici az nic nepobezi se spusti jen pokud nebezi zadna operace ani nebyla zadna operace rucne pausnuta
+    BOOL idle = j == OperPaused.Count;
+
+    int i;
+    for (i = 0; i < OperDlgs.Count; i++)
+    {
+        if (OperPaused[i] != 1 /* auto-paused */)
+            continue;
+        COperDisks* d = &OperDisks[i];
+        if (d->WaitForAll ? idle : !IsDiskBusy(d->SrcDisk, d->TgtDisk, i))
+        {
+            OperPaused[i] = 0 /* running */; // aby dalsi cekajici operace videly jeji disky jako obsazene
+            idle = FALSE;
+            PostMessage(OperDlgs[i], WM_COMMAND, CM_RESUMEOPER, 0);
+            if (foregroundWnd != NULL && GetForegroundWindow() == dlg)
+            {
+                *foregroundWnd = OperDlgs[i];
+                foregroundWnd = NULL; // aktivujeme jen prvni spustenou operaci
+            }
+            if (d->WaitForAll)
+                break; // operace ma bezet sama, dalsi cekajici operace spustime az po jejim dokonceni
+        }
+    }
+}
+
+BOOL COperationsQueue::AddOperation(HWND dlg, BOOL startOnIdle, DWORD srcDisk, DWORD tgtDisk, BOOL* startPaused)
 {
     CALL_STACK_MESSAGE1("COperationsQueue::AddOperation()");
 
@@ -8306,28 +10139,45 @@ BOOL COperationsQueue::AddOperation(HWND dlg, BOOL startOnIdle, BOOL* startPause
     BOOL ret = FALSE;
     if (i == OperDlgs.Count) // operaci je mozne pridat
     {
+        if (startOnIdle)
+        {
+            int j;
+            for (j = 0; j < OperPaused.Count && OperPaused[j] == 1 /* auto-paused */; j++)
+                ; // pokud jiz nejaka operace bezi nebo byla rucne pausnuta, startujeme tuto operaci jako "auto-paused"
+            *startPaused = j < OperPaused.Count;
+        }
+        else // pokud nektera bezici operace pracuje se stejnym rotacnim diskem, pockame na jeji dokonceni
+            *startPaused = IsDiskBusy(srcDisk, tgtDisk, -1);
+        COperDisks disks;
+        disks.SrcDisk = srcDisk;
+        disks.TgtDisk = tgtDisk;
+        disks.WaitForAll = startOnIdle;
+
         OperDlgs.Add(dlg);
         if (OperDlgs.IsGood())
         {
-            if (startOnIdle)
+            OperPaused.Add(*startPaused ? 1 /* auto-paused */ : 0 /* running */);
+            if (OperPaused.IsGood())
             {
-                int j;
-                for (j = 0; j < OperPaused.Count && OperPaused[j] == 1 /* auto-paused */; j++)
-                    ; // pokud jiz nejaka operace bezi nebo byla rucne pausnuta, startujeme tuto operaci jako "auto-paused"
-                *startPaused = j < OperPaused.Count;
+                OperDisks.Add(disks);
+                if (OperDisks.IsGood())
+                    ret = TRUE;
+                else
+                {
+                    OperDisks.ResetState();
+                    OperPaused.Delete(OperPaused.Count - 1);
+                    if (!OperPaused.IsGood())
+                        OperPaused.ResetState();
+                }
             }
             else
-                *startPaused = FALSE;
-            OperPaused.Add(*startPaused ? 1 /* auto-paused */ : 0 /* running */);
-            if (!OperPaused.IsGood())
-            {
                 OperPaused.ResetState();
+            if (!ret)
+            {
                 OperDlgs.Delete(OperDlgs.Count - 1);
                 if (!OperDlgs.IsGood())
                     OperDlgs.ResetState();
             }
-            else
-                ret = TRUE;
         }
         else
             OperDlgs.ResetState();
@@ -8359,6 +10209,9 @@ void COperationsQueue::OperationEnded(HWND dlg, BOOL doNotResume, HWND* foregrou
             OperPaused.Delete(i);
             if (!OperPaused.IsGood())
                 OperPaused.ResetState();
+            OperDisks.Delete(i);
+            if (!OperDisks.IsGood())
+                OperDisks.ResetState();
             break;
         }
     }
@@ -8367,17 +10220,7 @@ void COperationsQueue::OperationEnded(HWND dlg, BOOL doNotResume, HWND* foregrou
     else
     {
         if (!doNotResume)
-        {
-            int j;
-            for (j = 0; j < OperPaused.Count && OperPaused[j] == 1 /* auto-paused */; j++)
-                ; // pokud nebezi zadna operace ani nebyla zadna operace rucne pausnuta, resumneme prvni operaci ve fronte
-            if (j == OperPaused.Count && OperDlgs.Count > 0)
-            {
-                PostMessage(OperDlgs[0], WM_COMMAND, CM_RESUMEOPER, 0);
-                if (foregroundWnd != NULL && GetForegroundWindow() == dlg)
-                    *foregroundWnd = OperDlgs[0];
-            }
-        }
+            ResumeWaitingOperations(dlg, foregroundWnd);
     }
 
     HANDLES(LeaveCriticalSection(&QueueCritSect));
@@ -8425,31 +10268,48 @@ void COperationsQueue::AutoPauseOperation(HWND dlg, HWND* foregroundWnd)
     {
         if (OperDlgs[i] == dlg)
         {
+            COperDisks disks = OperDisks[i];
             int j;
             for (j = i; j + 1 < OperDlgs.Count; j++)
                 OperDlgs[j] = OperDlgs[j + 1];
             for (j = i; j + 1 < OperPaused.Count; j++)
                 OperPaused[j] = OperPaused[j + 1];
+            for (j = i; j + 1 < OperDisks.Count; j++)
+                OperDisks[j] = OperDisks[j + 1];
             OperDlgs[j] = dlg;
             OperPaused[j] = 1 /* auto-paused */;
+            disks.WaitForAll = TRUE; // "Wait Until All Other Copy/Move Operations are Finished"
+            OperDisks[j] = disks;
             break;
         }
     }
     if (i == OperDlgs.Count)
         TRACE_E("COperationsQueue::AutoPauseOperation(): operation was not found!");
 
-    // pokud nebezi zadna operace ani nebyla zadna operace rucne pausnuta, resumneme prvni operaci ve fronte
-    int j;
-    for (j = 0; j < OperPaused.Count && OperPaused[j] == 1 /* auto-paused */; j++)
-        ;
-    if (j == OperPaused.Count && OperDlgs.Count > 0)
+    // spustime cekajici operace, ktere uz mohou bezet
+    ResumeWaitingOperations(dlg, foregroundWnd);
+
+    HANDLES(LeaveCriticalSection(&QueueCritSect));
+}
+
+BOOL COperationsQueue::IsWaitingForDisk(HWND dlg)
+{
+    CALL_STACK_MESSAGE1("COperationsQueue::IsWaitingForDisk()");
+
+    HANDLES(EnterCriticalSection(&QueueCritSect));
+    BOOL ret = FALSE;
+    int i;
+    for (i = 0; i < OperDlgs.Count; i++)
     {
-        PostMessage(OperDlgs[0], WM_COMMAND, CM_RESUMEOPER, 0);
-        if (foregroundWnd != NULL && GetForegroundWindow() == dlg)
-            *foregroundWnd = OperDlgs[0];
+        if (OperDlgs[i] == dlg)
+        {
+            ret = OperPaused[i] == 1 /* auto-paused */ && !OperDisks[i].WaitForAll &&
+                  IsDiskBusy(OperDisks[i].SrcDisk, OperDisks[i].TgtDisk, i);
+            break;
+        }
     }
-
     HANDLES(LeaveCriticalSection(&QueueCritSect));
+    return ret;
 }
 
 int COperationsQueue::GetNumOfOperations()
@@ -211,6 +211,7 @@ enum COperationCode
 #define OPFL_TGTPATH_IS_NET 0x00000020       // cilova cesta je sitova
 #define OPFL_TGTPATH_IS_FAST 0x00000040      // cilova cesta je disk, disk na USB, flashka, flash-card-reader, CD, DVD nebo ram-disk (nejde o: sit a disketu)
 #define OPFL_IGNORE_INVALID_NAME 0x00000080  // skipnout test na validitu jmena (pouziva se u adresaru: nemenili jsme nazev = nerveme, ze je invalidni)
+#define OPFL_COMPACT_NAMES 0x00000100        // jmena jsou ulozena v CScriptNames: SourceName je ukazatel na zaznam, TargetName je NULL (nebo DWORD hodnota u ocChangeAttrs); plna jmena vraci jen COperations::GetOp()
 
 struct COperation
 {
@@ -223,10 +224,69 @@ struct COperation
     DWORD OpFlags; // kombinace OPFL_xxx, viz vyse
 };
 
+// operace vracena z COperations::GetOp(): kopie operace, jejiz jmena mohou byt sestavena
+// do SourceBuf a TargetBuf (POZOR: proto se nesmi kopirovat prirazenim)
+struct COperationBuf : public COperation
+{
+    char SourceBuf[MAX_PATH];
+    char TargetBuf[MAX_PATH];
+};
+
+#define SCRIPTNAMES_BLOCK_SIZE 65536 // velikost bloku, do kterych se ukladaji jmena
+#define SCRIPTNAMES_RECENT_DIRS 8    // pocet naposledy pouzitych adresaru, mezi kterymi se hleda pred pridanim noveho
+
+// kompaktni ulozeni jmen operaci skriptu: cesta se rozdeli na adresar (tabulka adresaru,
+// skript vznika pruchodem stromu, takze po sobe jdouci operace maji vetsinou stejny adresar
+// a ten se ulozi jen jednou) a jmeno bez cesty; shoduje-li se jmeno zdroje a cile (Copy/Move),
+// ulozi se jen jednou; vse lezi v blocich, ktere se uvolnuji az se skriptem (zadny malloc
+// pro kazde jmeno)
+class CScriptNames
+{
+protected:
+    struct CDirItem
+    {
+        const char* Path; // cesta bez koncoveho backslashe (lezi v bloku)
+        int Len;          // delka Path
+    };
+
+    struct CRecord // jmena jedne operace (lezi v bloku, za nim nasleduji jmena bez cest)
+    {
+        int SourceDir;       // index adresare zdroje v Dirs, -1 = zdroj je NULL
+        int TargetDir;       // index adresare cile v Dirs, -1 = cil je NULL
+        BOOL TargetSameName; // TRUE = jmeno cile je shodne se jmenem zdroje (neni ulozene)
+    };
+
+    TDirectArray<char*> Blocks; // alokovane bloky
+    char* BlockPtr;             // volne misto v poslednim bloku
+    int BlockFree;              // velikost volneho mista v poslednim bloku
+    TDirectArray<CDirItem> Dirs;
+    int RecentDirs[SCRIPTNAMES_RECENT_DIRS]; // indexy naposledy pouzitych adresaru (-1 = nepouzito)
+    int RecentDirsNext;                      // kam se zapise dalsi adresar do RecentDirs
+
+public:
+    CScriptNames();
+    ~CScriptNames();
+
+    // lze jmeno 'name' ulozit? (NULL, nebo plna cesta kratsi nez MAX_PATH)
+    static BOOL CanStore(const char* name);
+
+    // ulozi jmena 'source' a 'target' (viz CanStore()); vraci ukazatel na zaznam nebo NULL
+    // pri nedostatku pameti
+    const void* Store(const char* source, const char* target);
+
+    // sestavi jmena ze zaznamu 'rec' do bufferu 'sourceBuf' a 'targetBuf' (MAX_PATH znaku),
+    // v 'source' a 'target' vraci ukazatel na buffer nebo NULL (jmeno nebylo ulozeno)
+    void Load(const void* rec, char** source, char* sourceBuf, char** target, char* targetBuf);
+
+protected:
+    char* Alloc(int size);                      // vraci NULL pri nedostatku pameti
+    int GetDirIndex(const char* path, int len); // vraci -1 pri nedostatku pameti
+};
+
 class COperations : public TDirectArray<COperation>
 {
 public:
-    CQuadWord TotalSize;      // POZOR: neni velikost souboru v bytech (je zde velikost pouzitelna jen pro progress)
+    CQuadWord TotalSize;      // POZOR: neni velikost souboru v bytech (je zde velikost pouzitelna jen pro progress); pri streamovani ho meni worker v HasOp(), z jinych threadu cist jen pres GetTotalSize()
     CQuadWord CompressedSize; // soucet velikosti souboru po kompresi
     CQuadWord OccupiedSpace;  // zabrane misto na disku
     CQuadWord TotalFileSize;  // soucet velikosti souboru na disku
@@ -262,6 +322,8 @@ public:
     BOOL PreserveDirTime;       // zachovat datumy a casy adresaru (pouziva se pri Move: detekujeme jestli se nahodou nemeni cas, pokud ano, opravujeme ho "rucne", dela napr. na Sambe)
     BOOL StartOnIdle;           // ma se spustit az nic jineho nepobezi
     BOOL SourcePathIsNetwork;   // TRUE = zdrojova cesta je sitova (UNC nebo mapovany disk)
+    DWORD SrcSpinningDisk;      // rotacni disk zdrojove cesty pro frontu Copy/Move operaci a pro Delete (viz GetPathSpinningDisk), -1 = zadny
+    DWORD TgtSpinningDisk;      // rotacni disk cilove cesty pro frontu Copy/Move operaci (viz GetPathSpinningDisk), -1 = zadny
 
     // pro status radek v progress dialogu (jen Copy a Move)
     BOOL ShowStatus;       // ma se pod druhym progress-barem zobrazovat status operace (rychlost kopirovani, atd.)
@@ -276,10 +338,20 @@ public:
     char WorkPath2[MAX_PATH];  // jde-li o neprazdny retezec, je to druha cesta, na ktere se pracovalo (pouziva se pro hlaseni zmen)
     BOOL WorkPath2InclSubDirs; // TRUE/FALSE = vcetne/bez podadresaru (druha cesta)
 
+    char TargetPath[MAX_PATH]; // Copy/Move: cilovy adresar operace (sem se zapisuje manifest kontrolnich souctu, viz Configuration.CopyChecksumManifest), "" = neznamy
+
     char* WaitInQueueSubject; // text pro stav "waiting in queue": titulek dialogu
     char* WaitInQueueFrom;    // text pro stav "waiting in queue": horni radek (From)
     char* WaitInQueueTo;      // text pro stav "waiting in queue": dolni radek (To)
 
+    // streamovane Copy/Move (viz Configuration.StreamingCopy): hlavni thread stavi skript a
+    // prubezne zverejnuje hotove operace, worker je soucasne provadi; pole operaci muze hlavni
+    // thread pri pridavani realokovat, worker proto k operacim pristupuje jen pres GetOp/SetOp
+    BOOL Streaming;          // TRUE = skript se stavi soucasne s jeho provadenim
+    char StreamCaption[50];  // titulek progress dialogu (jen hlavni thread)
+    BOOL StreamDlgStarted;   // TRUE = progress dialog a worker uz bezi, skript uvolni worker (jen hlavni thread)
+    BOOL StreamSpaceChecked; // TRUE = dotaz na nedostatek mista na cilovem disku uz probehl (jen hlavni thread)
+
 private:
     // pro status radek v progress dialogu (jen Copy a Move)
     CRITICAL_SECTION StatusCS;              // kriticka sekce pro pristup k TransferSpeedMeter, ProgressSpeedMeter a
@@ -287,6 +359,7 @@ private:
     CProgressSpeedMeter ProgressSpeedMeter; // merak pro vypocet "time left" (meri i rychlosti vytvareni adresaru, kopirovani prazdnych souboru, atd. - pracuje se stejnymi velikostmi operaci jako progress)
     CQuadWord TransferredFileSize;          // kolik bytu uz bylo realne prekopirovano/preneseno (konecny soucet by mel vyjit TotalFileSize, ovsem pokud se nezmeni data na disku)
     CQuadWord ProgressSize;                 // progres vyjadreny v prekopirovanych/prenesenych "bytech" (pracuje se stejnymi velikostmi operaci jako progress)
+    CQuadWord UnchangedFileSize;            // kolik bytu z TransferredFileSize se nezapsalo, protoze je cil uz obsahoval (delta kopirovani, viz Configuration.DeltaCopy)
 
     // data pro speed-limit, pouzivaji se jen v sekci StatusCS
     BOOL UseSpeedLimit;             // TRUE = pouzivame speed-limit
@@ -303,9 +376,31 @@ private:
     DWORD LastFileBlockCount;     // kolik bloku uz se prekopirovalo od zacatku posledniho souboru (POZOR: je chranene pred pretecenim, pocet > 1000000 znamena "hafo", kolik presne neni dulezite)
     DWORD LastFileStartTime;      // GetTickCount() z okamziku, kdy jsme zacali kopirovat posledni soubor
 
+    // jen pro streamovane Copy/Move: data pro predavani operaci workeru, pouzivaji se jen v sekci StreamCS
+    CRITICAL_SECTION StreamCS; // kriticka sekce pro pristup k poli operaci a nasledujicim promennym
+    HANDLE StreamEvent;        // (auto-reset) nastavi se pri zverejneni dalsich operaci a na konci stavby skriptu
+    HANDLE BuildEndEvent;      // (manual-reset) nastavi se na konci stavby skriptu, pak uz hlavni thread skript nepouziva
+    int PublishedCount;        // pocet operaci, ktere smi worker provadet
+    BOOL BuildEnded;           // TRUE = stavba skriptu skoncila (vsechny operace jsou zverejnene, pokud neni BuildFailed)
+    BOOL BuildFailed;          // TRUE = stavba skriptu byla prerusena (cancel nebo chyba)
+    BOOL StreamAborted;        // TRUE = worker skoncil (cancel nebo chyba), stavba skriptu se ma prerusit
+    CQuadWord PublishedSize;   // soucet velikosti zverejnenych operaci, worker ho v HasOp() prebira do TotalSize
+
+    CScriptNames Names; // kompaktne ulozena jmena operaci (pri streamovani se pouziva v sekci StreamCS)
+
 public:
     COperations(int base, int delta, char* waitInQueueSubject, char* waitInQueueFrom, char* waitInQueueTo);
-    ~COperations() { HANDLES(DeleteCriticalSection(&StatusCS)); }
+    ~COperations();
+
+    // pridani operace (pri streamovani pod zamkem, pole muze byt realokovano); jmena operace
+    // se pri uspechu presunou do kompaktniho ulozeni (viz CScriptNames), alokovane retezce
+    // 'op.SourceName' a 'op.TargetName' se pritom uvolni, pri chybe (IsGood() vraci FALSE)
+    // zustavaji volajicimu
+    int Add(const COperation& op);
+    // vyhozeni operace (pri streamovani pod zamkem) vcetne uvolneni jejich jmen
+    void Delete(int index);
+    // uvolni alokovana jmena operace (kompaktne ulozena jmena se uvolni az se skriptem)
+    static void FreeNames(COperation* op);
 
     void SetWorkPath1(const char* path, BOOL inclSubDirs)
     {
@@ -319,6 +414,8 @@ public:
         WorkPath2InclSubDirs = inclSubDirs;
     }
 
+    void SetTargetPath(const char* path) { lstrcpyn(TargetPath, path, MAX_PATH); }
+
     void SetTFS(const CQuadWord& TFS);
     void SetTFSandProgressSize(const CQuadWord& TFS, const CQuadWord& pSize,
                                int* limitBufferSize = NULL, int bufferSize = 0);
@@ -338,12 +435,50 @@ public:
 
     void GetStatus(CQuadWord* transferredFileSize, CQuadWord* transferSpeed,
                    CQuadWord* progressSize, CQuadWord* progressSpeed,
-                   BOOL* useSpeedLimit, DWORD* speedLimit);
+                   BOOL* useSpeedLimit, DWORD* speedLimit, CQuadWord* unchangedFileSize);
+    // delta kopirovani: pricte (pri 'subtract' TRUE odecte) byty, ktere se nemusely zapsat
+    void AddUnchangedBytes(const CQuadWord& bytesCount, BOOL subtract);
     void InitSpeedMeters(BOOL operInProgress);
     BOOL GetTFSandProgressSize(CQuadWord* transferredFileSize, CQuadWord* progressSize);
 
     void SetSpeedLimit(BOOL useSpeedLimit, DWORD speedLimit);
     void GetSpeedLimit(BOOL* useSpeedLimit, DWORD* speedLimit);
+
+    // streamovane Copy/Move, volani z hlavniho threadu: StartStreaming() pred stavbou skriptu
+    // (vraci FALSE pri chybe vytvoreni eventu), PublishOps() behem stavby zverejni hotove
+    // operace ('all' je FALSE: krome koncove rady ocCreateDir operaci, ktere mohou byt jeste
+    // vyhozeny, viz SkipEmptyDirs) a pricte je do TotalSize, vraci FALSE pokud worker skoncil
+    // a stavba se ma prerusit; EndStreaming() po stavbe skriptu ('success' je FALSE pri
+    // preruseni stavby), pokud bezi worker (StreamDlgStarted), nesmi se pak skript uz pouzivat
+    BOOL StartStreaming(const char* caption);
+    BOOL PublishOps(BOOL all);
+    int GetPublishedCount();
+    void EndStreaming(BOOL success);
+
+    // streamovane Copy/Move, volani z worker threadu: IsOpAvailable() vraci TRUE pokud je
+    // operace 'index' zverejnena; HasOp() na jeji zverejneni pripadne pocka a vraci FALSE
+    // pokud uz zadna takova operace nebude (konec nebo preruseni stavby); bez streamovani
+    // jde jen o test indexu; GetOp() vraci kopii operace v 'buf' s plnymi jmeny (lze volat
+    // z libovolneho threadu), SetOp() zapise zpet do pole jediny udaj, ktery worker v operaci
+    // meni (Attr)
+    BOOL IsOpAvailable(int index);
+    BOOL HasOp(int index);
+    COperation* GetOp(int index, COperationBuf* buf);
+    void SetOp(int index, const COperation* op);
+    // worker skoncil nebo ho uzivatel stornoval (volani i z progress dialogu): stavba skriptu
+    // se ma prerusit a worker cekajici v HasOp() se probudi
+    void AbortStreaming();
+    // TotalSize pro cteni z jineho threadu nez workera (pri streamovani ho worker prubezne meni)
+    CQuadWord GetTotalSize();
+    // pocka na konec stavby skriptu (pred uvolnenim skriptu); vraci FALSE pokud byla stavba prerusena
+    BOOL WaitForBuildEnd();
+};
+
+struct COperDisks // rotacni disky, se kterymi pracuje operace ve fronte diskovych Copy/Move operaci
+{
+    DWORD SrcDisk;   // rotacni disk zdrojove cesty (viz GetPathSpinningDisk), -1 = zadny
+    DWORD TgtDisk;   // rotacni disk cilove cesty (viz GetPathSpinningDisk), -1 = zadny
+    BOOL WaitForAll; // TRUE = "auto-paused" operace ceka az nic jineho nepobezi, FALSE = ceka jen na uvolneni svych disku
 };
 
 class COperationsQueue // fronta diskovych Copy/Move operaci
@@ -351,30 +486,34 @@ class COperationsQueue // fronta diskovych Copy/Move operaci
 protected:
     CRITICAL_SECTION QueueCritSect; // kriticka sekce objektu
 
-    // pole OperDlgs a OperPaused maji stejny pocet prvku a stejne indexovani (jedna operace ma jeden index v obou polich)
-    TDirectArray<HWND> OperDlgs;    // pole typu HWND: dialogy operaci ve fronte
-    TDirectArray<DWORD> OperPaused; // pole typu int: stav operace ve fronte: 2/1/0 = "manually-paused"/"auto-paused"/"running"
+    // pole OperDlgs, OperPaused a OperDisks maji stejny pocet prvku a stejne indexovani (jedna operace ma jeden index ve vsech polich)
+    TDirectArray<HWND> OperDlgs;        // pole typu HWND: dialogy operaci ve fronte
+    TDirectArray<DWORD> OperPaused;     // pole typu int: stav operace ve fronte: 2/1/0 = "manually-paused"/"auto-paused"/"running"
+    TDirectArray<COperDisks> OperDisks; // pole typu COperDisks: rotacni disky operace a duvod cekani
 
 public:
-    COperationsQueue() : OperDlgs(5, 10), OperPaused(5, 10)
+    COperationsQueue() : OperDlgs(5, 10), OperPaused(5, 10), OperDisks(5, 10)
     {
         HANDLES(InitializeCriticalSection(&QueueCritSect));
     }
     ~COperationsQueue()
     {
-        if (OperDlgs.Count > 0 || OperPaused.Count > 0)
+        if (OperDlgs.Count > 0 || OperPaused.Count > 0 || OperDisks.Count > 0)
             TRACE_E("~COperationsQueue(): unexpected situation: operation queue is not empty!");
         HANDLES(DeleteCriticalSection(&QueueCritSect));
     }
 
     // prida operaci do fronty; vraci TRUE pri uspechu, jinak se pridani nepodarilo (malo pameti);
     // 'dlg' je handle okna dialogu operace; 'startOnIdle' je TRUE pokud ma dojit ke spusteni
-    // operace az nic jineho nepobezi; ve 'startPaused' (nesmi byt NULL) vraci TRUE pokud
-    // se ma pridana operace spustit v "paused" rezimu, jinak se spousti v "running" rezimu
-    BOOL AddOperation(HWND dlg, BOOL startOnIdle, BOOL* startPaused);
+    // operace az nic jineho nepobezi; 'srcDisk' a 'tgtDisk' jsou rotacni disky operace (viz
+    // GetPathSpinningDisk, -1 = zadny), operace sdilejici rotacni disk s jiz bezici operaci
+    // se spousti az po jejim dokonceni (operace na ruznych discich bezi soucasne); ve
+    // 'startPaused' (nesmi byt NULL) vraci TRUE pokud se ma pridana operace spustit v "paused"
+    // rezimu, jinak se spousti v "running" rezimu
+    BOOL AddOperation(HWND dlg, BOOL startOnIdle, DWORD srcDisk, DWORD tgtDisk, BOOL* startPaused);
 
     // vyhodi operaci z fronty (operace se dokoncila); je-li 'doNotResume' FALSE, postne
-    // "resume" prvni operace ve fronte v pripade, ze vsechny operace z fronty jsou "paused";
+    // "resume" cekajicim operacim, ktere uz mohou bezet (viz ResumeWaitingOperations());
     // neni-li 'foregroundWnd' NULL, ulozi se do nej handle dialogu operace, ktery je potreba
     // aktivovat (pokud neni potreba nic aktivovat, hodnota se nemeni)
     void OperationEnded(HWND dlg, BOOL doNotResume, HWND* foregroundWnd);
@@ -390,6 +529,21 @@ public:
 
     // vraci aktualni pocet operaci ve fronte
     int GetNumOfOperations();
+
+    // vraci TRUE pokud operace 'dlg' je "auto-paused" kvuli rotacnimu disku, se kterym pracuje
+    // jina bezici operace (pro zobrazeni duvodu cekani)
+    BOOL IsWaitingForDisk(HWND dlg);
+
+protected:
+    // vraci TRUE pokud nektera bezici operace (mimo operaci na indexu 'skipIndex') pracuje
+    // s rotacnim diskem 'srcDisk' nebo 'tgtDisk'; volat jen z kriticke sekce QueueCritSect
+    BOOL IsDiskBusy(DWORD srcDisk, DWORD tgtDisk, int skipIndex);
+
+    // postne "resume" "auto-paused" operacim, ktere uz mohou bezet: operacim cekajicim na
+    // disk, pokud se jejich disky uvolnily, a prvni operaci cekajici az nic nepobezi, pokud
+    // zadna operace nebezi ani neni rucne pausnuta; 'dlg' a 'foregroundWnd' viz OperationEnded();
+    // volat jen z kriticke sekce QueueCritSect
+    void ResumeWaitingOperations(HWND dlg, HWND* foregroundWnd);
 };
 
 extern COperationsQueue OperationsQueue; // fronta diskovych Copy/Move operaci